@@ -1,6 +1,8 @@
 ﻿// Copyright Steve Streeting 2022
 // Released under the MIT license https://opensource.org/license/MIT/
 #include "SUDS.h"
+#include "SUDSDialogue.h"
+#include "Misc/CoreDelegates.h"
 #include "Modules/ModuleManager.h"
 
 #define LOCTEXT_NAMESPACE "FSUDSModule"
@@ -8,12 +10,25 @@
 void FSUDSModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+#if STATS || CSV_PROFILER
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FSUDSModule::RecordFrameStats);
+#endif
 }
 
 void FSUDSModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	EndFrameHandle.Reset();
+}
+
+void FSUDSModule::RecordFrameStats()
+{
+	SET_DWORD_STAT(STAT_SUDS_LiveDialogues, USUDSDialogue::GetNumLiveDialogues());
+	SET_MEMORY_STAT(STAT_SUDS_StateMemory, USUDSDialogue::GetTotalStateMemory());
+	CSV_CUSTOM_STAT(SUDS, LiveDialogues, USUDSDialogue::GetNumLiveDialogues(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(SUDS, StateMemoryKB, static_cast<float>(USUDSDialogue::GetTotalStateMemory()) / 1024.0f, ECsvCustomStatOp::Set);
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,80 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#include "SUDSAsyncDialogueAction.h"
+
+#include "SUDSDialogue.h"
+
+USUDSAsyncDialogueAction* USUDSAsyncDialogueAction::Create(USUDSDialogue* Dialogue, EStep Step)
+{
+	USUDSAsyncDialogueAction* Action = NewObject<USUDSAsyncDialogueAction>();
+	Action->Dialogue = Dialogue;
+	Action->Step = Step;
+	Action->RegisterWithGameInstance(Dialogue);
+	return Action;
+}
+
+USUDSAsyncDialogueAction* USUDSAsyncDialogueAction::StartDialogueAsync(USUDSDialogue* Dialogue, FName Label)
+{
+	USUDSAsyncDialogueAction* Action = Create(Dialogue, EStep::Start);
+	Action->Label = Label;
+	return Action;
+}
+
+USUDSAsyncDialogueAction* USUDSAsyncDialogueAction::ContinueDialogueAsync(USUDSDialogue* Dialogue)
+{
+	return Create(Dialogue, EStep::Continue);
+}
+
+USUDSAsyncDialogueAction* USUDSAsyncDialogueAction::ChooseDialogueAsync(USUDSDialogue* Dialogue, int Index)
+{
+	USUDSAsyncDialogueAction* Action = Create(Dialogue, EStep::Choose);
+	Action->ChoiceIndex = Index;
+	return Action;
+}
+
+void USUDSAsyncDialogueAction::Activate()
+{
+	if (!IsValid(Dialogue))
+	{
+		SetReadyToDestroy();
+		return;
+	}
+
+	switch (Step)
+	{
+	case EStep::Start:
+		Dialogue->Start(Label);
+		break;
+	case EStep::Continue:
+		Dialogue->Continue();
+		break;
+	case EStep::Choose:
+		Dialogue->Choose(ChoiceIndex);
+		break;
+	}
+
+	TWeakObjectPtr<USUDSAsyncDialogueAction> WeakThis(this);
+	Dialogue->WaitForAsyncVariables().Then([WeakThis](TFuture<void>)
+	{
+		if (USUDSAsyncDialogueAction* Action = WeakThis.Get())
+		{
+			Action->Complete();
+		}
+	});
+}
+
+void USUDSAsyncDialogueAction::Complete()
+{
+	if (IsValid(Dialogue))
+	{
+		if (Dialogue->IsEnded())
+		{
+			OnFinished.Broadcast(Dialogue);
+		}
+		else
+		{
+			OnSpeakerLine.Broadcast(Dialogue);
+		}
+	}
+	SetReadyToDestroy();
+}
@@ -0,0 +1,44 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#include "SUDSAsyncVariableProvider.h"
+
+#include "SUDSDialogue.h"
+#include "Async/Async.h"
+
+bool ISUDSAsyncVariableProvider::ProvidesDialogueVariableAsync_Implementation(USUDSDialogue* Dialogue, FName VariableName)
+{
+	return false;
+}
+
+void ISUDSAsyncVariableProvider::OnDialogueAsyncVariableRequested_Implementation(USUDSDialogue* Dialogue, FName VariableName, int32 RequestId)
+{
+	TWeakObjectPtr<USUDSDialogue> WeakDialogue(Dialogue);
+	RequestDialogueVariableAsync(Dialogue, VariableName).Next([WeakDialogue, VariableName, RequestId](FSUDSValue Value)
+	{
+		auto Complete = [WeakDialogue, VariableName, RequestId, Value]()
+		{
+			if (USUDSDialogue* Dlg = WeakDialogue.Get())
+			{
+				Dlg->CompleteAsyncVariable(VariableName, Value, RequestId);
+			}
+		};
+		if (IsInGameThread())
+		{
+			Complete();
+		}
+		else
+		{
+			AsyncTask(ENamedThreads::GameThread, MoveTemp(Complete));
+		}
+	});
+}
+
+TFuture<FSUDSValue> ISUDSAsyncVariableProvider::RequestDialogueVariableAsync(USUDSDialogue* Dialogue, FName VariableName)
+{
+	UE_LOG(LogSUDSDialogue,
+	       Error,
+	       TEXT("%s said it provides variable %s asynchronously but doesn't implement OnDialogueAsyncVariableRequested or RequestDialogueVariableAsync"),
+	       *Cast<UObject>(this)->GetName(),
+	       *VariableName.ToString());
+	return MakeFulfilledPromise<FSUDSValue>().GetFuture();
+}
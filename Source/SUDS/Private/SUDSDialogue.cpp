@@ -2,8 +2,11 @@
 // Released under the MIT license https://opensource.org/license/MIT/
 #include "SUDSDialogue.h"
 
+#include "SUDSAsyncVariableProvider.h"
+#include "SUDSCustomVersion.h"
 #include "SUDSInternal.h"
 #include "SUDSLibrary.h"
+#include "SUDSNativeParticipant.h"
 #include "SUDSParticipant.h"
 #include "SUDSScript.h"
 #include "SUDSScriptNode.h"
@@ -12,35 +15,247 @@
 #include "SUDSScriptNodeSet.h"
 #include "SUDSScriptNodeText.h"
 #include "SUDSSubsystem.h"
+#include "SUDSTrace.h"
 #include "Kismet/GameplayStatics.h"
+#include "Serialization/CustomVersion.h"
 #include "Sound/DialogueSoundWaveProxy.h"
 #include "Sound/DialogueWave.h"
 
 DEFINE_LOG_CATEGORY(LogSUDSDialogue);
 
+DEFINE_STAT(STAT_SUDS_StepTime);
+DEFINE_STAT(STAT_SUDS_UpdateChoicesTime);
+DEFINE_STAT(STAT_SUDS_FormatTextTime);
+DEFINE_STAT(STAT_SUDS_ParticipantCallsTime);
+DEFINE_STAT(STAT_SUDS_LiveDialogues);
+DEFINE_STAT(STAT_SUDS_Steps);
+DEFINE_STAT(STAT_SUDS_NodesRun);
+DEFINE_STAT(STAT_SUDS_ChoicesEvaluated);
+DEFINE_STAT(STAT_SUDS_ExpressionsEvaluated);
+DEFINE_STAT(STAT_SUDS_VariableRequests);
+DEFINE_STAT(STAT_SUDS_ParticipantCalls);
+DEFINE_STAT(STAT_SUDS_FormattedTexts);
+DEFINE_STAT(STAT_SUDS_StateMemory);
+CSV_DEFINE_CATEGORY_MODULE(SUDS_API, SUDS, true);
+
+#if SUDS_TRACE_ENABLED
+TRACE_DECLARE_INT_COUNTER(SUDS_Steps, TEXT("SUDS/Steps"));
+TRACE_DECLARE_INT_COUNTER(SUDS_NodesRun, TEXT("SUDS/NodesRun"));
+TRACE_DECLARE_INT_COUNTER(SUDS_ChoicesEvaluated, TEXT("SUDS/ChoicesEvaluated"));
+TRACE_DECLARE_INT_COUNTER(SUDS_ExpressionsEvaluated, TEXT("SUDS/ExpressionsEvaluated"));
+TRACE_DECLARE_INT_COUNTER(SUDS_VariableRequests, TEXT("SUDS/VariableRequests"));
+TRACE_DECLARE_INT_COUNTER(SUDS_ParticipantCalls, TEXT("SUDS/ParticipantCalls"));
+TRACE_DECLARE_INT_COUNTER(SUDS_FormattedTexts, TEXT("SUDS/FormattedTexts"));
+#endif
+
+/// Add to a counter in Insights, "stat SUDS" and CSV profiles all at once
+#define SUDS_COUNT(Name, Amount) \
+	do \
+	{ \
+		SUDS_TRACE_COUNTER_ADD(SUDS_##Name, Amount); \
+		INC_DWORD_STAT_BY(STAT_SUDS_##Name, Amount); \
+		CSV_CUSTOM_STAT(SUDS, Name, static_cast<int32>(Amount), ECsvCustomStatOp::Accumulate); \
+	} while (0)
+
+std::atomic<int32> USUDSDialogue::NumLiveDialogues { 0 };
+std::atomic<int64> USUDSDialogue::TotalStateMemory { 0 };
+
 const FText USUDSDialogue::DummyText = FText::FromString("INVALID");
 const FString USUDSDialogue::DummyString = "INVALID";
 
+const FGuid FSUDSCustomVersion::GUID(0xA5CEA265, 0xAB7D45B8, 0xAFB1DEB2, 0x080428DC);
+FCustomVersionRegistration GRegisterSUDSCustomVersion(FSUDSCustomVersion::GUID, FSUDSCustomVersion::LatestVersion, TEXT("SUDSVer"));
+
+
+/// Version of the FSUDSDialogueState layout, written into the stream itself since plain memory archives don't carry
+/// custom versions. Bump if the layout changes
+static constexpr uint8 DialogueStateVersion = 1;
+/// First inline version which includes the random seed
+static constexpr uint8 DialogueStateRandomSeedVersion = 1;
 
+/// Works out which layout a dialogue state uses. Archives which do carry our custom version from before the version
+/// was inline (e.g. packages) go by that instead, since there's no version in their stream
+static bool IsDialogueStateVersionInline(FArchive& Ar, uint8& OutVersion)
+{
+	Ar.UsingCustomVersion(FSUDSCustomVersion::GUID);
+	const int32 CustomVer = Ar.CustomVer(FSUDSCustomVersion::GUID);
+	if (!Ar.IsLoading() || CustomVer < 0 || CustomVer >= FSUDSCustomVersion::AddedDialogueStateInlineVersion)
+	{
+		OutVersion = DialogueStateVersion;
+		return true;
+	}
+	OutVersion = CustomVer >= FSUDSCustomVersion::AddedDialogueRandomSeed ? DialogueStateRandomSeedVersion : 0;
+	return false;
+}
+
+static bool IsDialogueStateVersionSupported(FArchive& Ar, uint8 Version)
+{
+	if (Ar.IsLoading() && Version > DialogueStateVersion)
+	{
+		UE_LOG(LogSUDSDialogue, Error, TEXT("Unsupported dialogue state version %d"), Version);
+		Ar.SetError();
+		return false;
+	}
+	return true;
+}
 
 FArchive& operator<<(FArchive& Ar, FSUDSDialogueState& Value)
 {
+	uint8 Version;
+	const bool bInlineVersion = IsDialogueStateVersionInline(Ar, Version);
+	if (bInlineVersion)
+	{
+		Ar << Version;
+		if (!IsDialogueStateVersionSupported(Ar, Version))
+		{
+			return Ar;
+		}
+	}
+
 	Ar << Value.TextNodeID;
 	Ar << Value.Variables;
 	Ar << Value.ChoicesTaken;
 	Ar << Value.ReturnStack;
+	// States saved before this have no seed, the dialogue will just carry on with its own stream
+	if (bInlineVersion)
+	{
+		// Might not have one to save either, if it was restored from an old save and never got to its dialogue
+		uint8 bHasRandomSeed = Value.bHasRandomSeed ? 1 : 0;
+		Ar << bHasRandomSeed;
+		Value.bHasRandomSeed = bHasRandomSeed != 0;
+	}
+	else if (Ar.IsLoading())
+	{
+		Value.bHasRandomSeed = Version >= DialogueStateRandomSeedVersion;
+	}
+	if (Value.bHasRandomSeed)
+	{
+		Ar << Value.RandomSeed;
+	}
 	
 	return Ar;
 }
 
 void operator<<(FStructuredArchive::FSlot Slot, FSUDSDialogueState& Value)
 {
+	uint8 Version;
+	const bool bInlineVersion = IsDialogueStateVersionInline(Slot.GetUnderlyingArchive(), Version);
+
 	FStructuredArchive::FRecord Record = Slot.EnterRecord();
+	if (bInlineVersion)
+	{
+		Record << SA_VALUE(TEXT("Version"), Version);
+		if (!IsDialogueStateVersionSupported(Slot.GetUnderlyingArchive(), Version))
+		{
+			return;
+		}
+	}
 	Record
 		<< SA_VALUE(TEXT("TextNodeID"), Value.TextNodeID)
 		<< SA_VALUE(TEXT("Variables"), Value.Variables)
 		<< SA_VALUE(TEXT("ChoicesTaken"), Value.ChoicesTaken)
 		<< SA_VALUE(TEXT("ReturnStack"), Value.ReturnStack);
+	if (bInlineVersion)
+	{
+		Record << SA_VALUE(TEXT("HasRandomSeed"), Value.bHasRandomSeed);
+	}
+	else if (Slot.GetUnderlyingArchive().IsLoading())
+	{
+		Value.bHasRandomSeed = Version >= DialogueStateRandomSeedVersion;
+	}
+	if (Value.bHasRandomSeed)
+	{
+		Record << SA_VALUE(TEXT("RandomSeed"), Value.RandomSeed);
+	}
+
+}
+
+/// Version of the compact binary layout, bump if it changes
+static constexpr uint8 CompactDialogueStateVersion = 2;
+/// First compact version which includes the random seed
+static constexpr uint8 CompactDialogueStateRandomSeedVersion = 2;
+
+static void SerializeNameAsString(FArchive& Ar, FName& Name)
+{
+	FString NameStr = Name.ToString();
+	Ar << NameStr;
+	if (Ar.IsLoading())
+		Name = FName(NameStr);
+}
+
+static void SerializeHashArray(FArchive& Ar, TArray<uint32>& Hashes)
+{
+	uint32 Count = Hashes.Num();
+	Ar.SerializeIntPacked(Count);
+	if (Ar.IsLoading())
+		Hashes.SetNumUninitialized(Count);
+	// Hashes are uniformly distributed so there's nothing to gain from packing them
+	for (uint32& Hash : Hashes)
+	{
+		Ar << Hash;
+	}
+}
+
+FArchive& operator<<(FArchive& Ar, FSUDSCompactDialogueState& Value)
+{
+	uint8 Version = CompactDialogueStateVersion;
+	Ar << Version;
+	if (Ar.IsLoading() && (Version == 0 || Version > CompactDialogueStateVersion))
+	{
+		UE_LOG(LogSUDSDialogue, Error, TEXT("Unsupported compact dialogue state version %d"), Version);
+		Ar.SetError();
+		return Ar;
+	}
+
+	Ar << Value.TextNodeHash;
+
+	uint32 VarCount = Value.ChangedVariables.Num();
+	Ar.SerializeIntPacked(VarCount);
+	if (Ar.IsLoading())
+	{
+		Value.ChangedVariables.Empty(VarCount);
+		for (uint32 i = 0; i < VarCount && !Ar.IsError(); ++i)
+		{
+			FName Name;
+			FSUDSValue Val;
+			SerializeNameAsString(Ar, Name);
+			InternalSerializeCompactValue(Ar, Val, SerializeNameAsString);
+			Value.ChangedVariables.Add(Name, Val);
+		}
+	}
+	else
+	{
+		for (auto& Pair : Value.ChangedVariables)
+		{
+			FName Name = Pair.Key;
+			SerializeNameAsString(Ar, Name);
+			InternalSerializeCompactValue(Ar, Pair.Value, SerializeNameAsString);
+		}
+	}
+
+	SerializeHashArray(Ar, Value.ChoicesTaken);
+	SerializeHashArray(Ar, Value.ReturnStack);
+	if (Version >= CompactDialogueStateRandomSeedVersion)
+	{
+		Ar << Value.RandomSeed;
+	}
+	if (Ar.IsLoading())
+	{
+		Value.bHasRandomSeed = Version >= CompactDialogueStateRandomSeedVersion;
+	}
+
+	return Ar;
+}
+
+void operator<<(FStructuredArchive::FSlot Slot, FSUDSCompactDialogueState& Value)
+{
+	FStructuredArchive::FRecord Record = Slot.EnterRecord();
+	Record
+		<< SA_VALUE(TEXT("TextNodeHash"), Value.TextNodeHash)
+		<< SA_VALUE(TEXT("ChangedVariables"), Value.ChangedVariables)
+		<< SA_VALUE(TEXT("ChoicesTaken"), Value.ChoicesTaken)
+		<< SA_VALUE(TEXT("ReturnStack"), Value.ReturnStack)
+		<< SA_VALUE(TEXT("RandomSeed"), Value.RandomSeed);
 
 }
 
@@ -50,6 +265,33 @@ USUDSDialogue::USUDSDialogue(): BaseScript(nullptr),
                                 bParamNamesExtracted(false),
                                 CurrentSourceLineNo(0)
 {
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		bCountedAsLive = true;
+		NumLiveDialogues.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void USUDSDialogue::BeginDestroy()
+{
+	if (bCountedAsLive)
+	{
+		bCountedAsLive = false;
+		NumLiveDialogues.fetch_sub(1, std::memory_order_relaxed);
+		TotalStateMemory.fetch_sub(StateMemory, std::memory_order_relaxed);
+		StateMemory = 0;
+	}
+	// Nothing will be resuming now, don't leave anyone waiting forever
+	CancelAsyncVariables();
+	Super::BeginDestroy();
+}
+
+void USUDSDialogue::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	USUDSDialogue* This = CastChecked<USUDSDialogue>(InThis);
+	// Forks sharing the stack all report it, which is harmless
+	Collector.AddReferencedObjects(This->GosubReturnStack.EditShared(), This);
+	Super::AddReferencedObjects(InThis, Collector);
 }
 
 void USUDSDialogue::Initialise(const USUDSScript* Script)
@@ -57,6 +299,7 @@ void USUDSDialogue::Initialise(const USUDSScript* Script)
 	BaseScript = Script;
 	CurrentSpeakerNode = nullptr;
 
+	InitRandomStream(NAME_None);
 	InitVariables();
 
 	CurrentSpeakerNode = nullptr;
@@ -65,11 +308,54 @@ void USUDSDialogue::Initialise(const USUDSScript* Script)
 
 void USUDSDialogue::InitVariables()
 {
-	VariableState.Empty();
+	VariableState.Reset();
+	InvalidateVariableHandles();
 	// Run header nodes immediately (only set nodes)
 	RunUntilNextSpeakerNodeOrEnd(BaseScript->GetHeaderNode(), false);
 }
 
+void USUDSDialogue::InitRandomStream(FName StartLabel)
+{
+	// Seed from the master seed plus the script's package, the owner & where we start from, so that a dialogue has a
+	// reproducible sequence which doesn't depend on the order other dialogues consume random numbers. The owner's path
+	// is included so that several NPCs using the same script don't all make the same random choices; the dialogue's
+	// own name isn't, since that depends on how many other dialogues the owner has made
+	int32 MasterSeed;
+	if (auto Sub = GetSUDSSubsystem(GetWorld()))
+	{
+		MasterSeed = Sub->GetMasterRandomSeed();
+	}
+	else
+	{
+		// No subsystem (editor / tests), keep the old behaviour of varying each time
+		MasterSeed = FMath::Rand();
+	}
+	uint32 Identity = HashCombine(GetTypeHash(BaseScript ? BaseScript->GetPackage()->GetName() : FString()),
+	                              GetTypeHash(StartLabel.ToString()));
+	if (const UObject* Owner = GetOuter())
+	{
+		Identity = HashCombine(Identity, GetTypeHash(Owner->GetPathName()));
+	}
+	RandomStream.Initialize(static_cast<int32>(HashCombine(static_cast<uint32>(MasterSeed), Identity)));
+	bRandomStreamUsed = false;
+}
+
+float USUDSDialogue::NextRandomFraction()
+{
+	// Convert the same way as FMath::SRand() does, so a given seed produces the same selections as it used to
+	bRandomStreamUsed = true;
+	const uint32 Bits = 0x3F800000U | (RandomStream.GetUnsignedInt() & 0x007FFFFFU);
+	float Result;
+	FMemory::Memcpy(&Result, &Bits, sizeof(float));
+	return Result - 1.0f;
+}
+
+void USUDSDialogue::SetRandomSeed(int32 Seed)
+{
+	RandomStream.Initialize(Seed);
+	bRandomStreamUsed = true;
+}
+
 void USUDSDialogue::Start(FName Label)
 {
 	// Only start if not already on a speaker node
@@ -108,6 +394,21 @@ void USUDSDialogue::AddParticipant(UObject* Participant)
 	}
 }
 
+static bool GetParticipantPriority(const UObject& P, int& OutPriority)
+{
+	if (const ISUDSNativeParticipant* Native = Cast<const ISUDSNativeParticipant>(&P))
+	{
+		OutPriority = Native->GetDialogueParticipantPriority();
+		return true;
+	}
+	if (P.Implements<USUDSParticipant>())
+	{
+		OutPriority = ISUDSParticipant::Execute_GetDialogueParticipantPriority(&P);
+		return true;
+	}
+	return false;
+}
+
 void USUDSDialogue::SortParticipants()
 {
 	if (!Participants.IsEmpty())
@@ -117,24 +418,105 @@ void USUDSDialogue::SortParticipants()
 		// We'll do a stable sort so that otherwise order is maintained
 		Participants.StableSort([](const UObject& A, const UObject& B)
 		{
-			if (A.Implements<USUDSParticipant>() && B.Implements<USUDSParticipant>())
+			int PriorityA, PriorityB;
+			if (GetParticipantPriority(A, PriorityA) && GetParticipantPriority(B, PriorityB))
 			{
-				return ISUDSParticipant::Execute_GetDialogueParticipantPriority(&A) <
-					ISUDSParticipant::Execute_GetDialogueParticipantPriority(&B);
+				return PriorityA < PriorityB;
 			}
 			// Be deterministic
 			return &A < &B;
 		});
 	}
+	UpdateParticipantDispatch();
+}
+
+static bool WantsBatchedVariableRequests(const UClass* Class)
+{
+	// Blueprints which only implement OnDialogueVariableRequested would get an empty OnDialogueVariablesRequested, so
+	// only send them batches if they implement it. Native implementations get the default, which calls the single one.
+	if (Class->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ISUDSParticipant, OnDialogueVariablesRequested)))
+	{
+		return true;
+	}
+	for (const UClass* C = Class; C; C = C->GetSuperClass())
+	{
+		for (const FImplementedInterface& Interface : C->Interfaces)
+		{
+			if (Interface.Class == USUDSParticipant::StaticClass() && !Interface.bImplementedByK2)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void USUDSDialogue::UpdateParticipantDispatch()
+{
+	ParticipantDispatch.SetNum(Participants.Num());
+	for (int i = 0; i < Participants.Num(); ++i)
+	{
+		UObject* P = Participants[i];
+		FParticipantDispatch& Dispatch = ParticipantDispatch[i];
+		Dispatch.Native = Cast<ISUDSNativeParticipant>(P);
+		Dispatch.bIsParticipant = !Dispatch.Native &&
+			IsValid(P) &&
+			P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass());
+		Dispatch.bBatchVariableRequests = Dispatch.bIsParticipant && WantsBatchedVariableRequests(P->GetClass());
+		Dispatch.bIsAsyncProvider = IsValid(P) &&
+			P->GetClass()->ImplementsInterface(USUDSAsyncVariableProvider::StaticClass());
+	}
+	// Who provides what may have changed
+	AsyncVariableProviders.Reset();
 }
 
 void USUDSDialogue::RunUntilNextSpeakerNodeOrEnd(USUDSScriptNode* NextNode, bool bRaiseAtEnd)
 {
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_StepTime);
+	CSV_SCOPED_TIMING_STAT(SUDS, Step);
+	SUDS_COUNT(Steps, 1);
+
+	if (!bResumingAfterAsyncVariables)
+	{
+		// A new step, anything we were waiting for belongs to the old one. Anyone waiting on the old step is told
+		// when this one finishes
+		PendingAsyncVariables.Reset();
+		FetchedAsyncVariables.Reset();
+		AsyncVariableProviders.Reset();
+		++AsyncVariableRequestId;
+		AsyncSuspendedNode = nullptr;
+		RaiseStepVariablesRequested(NextNode);
+	}
+	// Headers are run quietly when initialising & restarting, and always run synchronously
+	const bool bAllowAsyncVariables = bRaiseAtEnd;
+
 	// We run through nodes which don't require a speaker line prompt
 	// E.g. set nodes, select nodes which are all automatically resolved
 	// Starting with this node
+	ResetNodeBudget();
+	if (bAllowAsyncVariables && NextNode && RequestAsyncVariablesForStep(NextNode))
+	{
+		// Suspend until the variables arrive, then we'll start this step again
+		AsyncSuspendedNode = NextNode;
+		bAsyncSuspendedRaiseAtEnd = bRaiseAtEnd;
+		return;
+	}
 	while (NextNode && !IsChoiceOrTextNode(NextNode->GetNodeType()))
 	{
+		// Anything the step needed was asked for up front, this only catches what comes after a return
+		if (bAllowAsyncVariables && RequestAsyncVariables(NextNode))
+		{
+			// Suspend until the variables arrive, then we'll run this node again
+			AsyncSuspendedNode = NextNode;
+			bAsyncSuspendedRaiseAtEnd = bRaiseAtEnd;
+			return;
+		}
+		if (!ConsumeNodeBudget(NextNode, true))
+		{
+			// Stuck in a loop, treat as the end
+			NextNode = nullptr;
+			break;
+		}
 		NextNode = RunNode(NextNode);
 	}
 
@@ -142,6 +524,12 @@ void USUDSDialogue::RunUntilNextSpeakerNodeOrEnd(USUDSScriptNode* NextNode, bool
 	{
 		if (NextNode->GetNodeType() == ESUDSScriptNodeType::Text)
 		{
+			if (bAllowAsyncVariables && RequestAsyncVariables(NextNode))
+			{
+				AsyncSuspendedNode = NextNode;
+				bAsyncSuspendedRaiseAtEnd = bRaiseAtEnd;
+				return;
+			}
 			SetCurrentSpeakerNode(Cast<USUDSScriptNodeText>(NextNode), false);
 		}
 		else
@@ -161,11 +549,357 @@ void USUDSDialogue::RunUntilNextSpeakerNodeOrEnd(USUDSScriptNode* NextNode, bool
 		End(!bRaiseAtEnd);
 	}
 
+	UpdateStateMemory();
+	FulfilAsyncVariableWaiters();
+}
+
+bool USUDSDialogue::HasAsyncVariableProvider() const
+{
+	return ParticipantDispatch.ContainsByPredicate([](const FParticipantDispatch& D) { return D.bIsAsyncProvider; });
+}
+
+bool USUDSDialogue::RequestAsyncVariablesForStep(const USUDSScriptNode* FromNode)
+{
+	// Only bother looking at what the step needs if there's someone to ask
+	if (!HasAsyncVariableProvider())
+	{
+		return false;
+	}
+
+	// Ask for everything down every path to the next speaker line or choice, so we only have to wait once
+	TSet<FName> Names;
+	TSet<const USUDSScriptNode*> Visited;
+	GatherVariablesNeededForStep(FromNode, false, Names, Visited);
+	return RequestAsyncVariables(Names, FromNode->GetSourceLineNo());
+}
+
+bool USUDSDialogue::RequestAsyncVariables(const USUDSScriptNode* Node)
+{
+	// Only bother looking at what the node needs if there's someone to ask
+	if (!HasAsyncVariableProvider())
+	{
+		return false;
+	}
+
+	TSet<FName> Names;
+	GatherVariablesNeededBy(Node, Names);
+	return RequestAsyncVariables(Names, Node->GetSourceLineNo());
+}
+
+bool USUDSDialogue::RequestAsyncVariables(const TSet<FName>& Names, int LineNo)
+{
+	// Work out everything we need first, so all the requests are in flight at once
+	TArray<TPair<FName, UObject*>> Requests;
+	for (const FName& Name : Names)
+	{
+		if (FetchedAsyncVariables.Contains(Name) || PendingAsyncVariables.Contains(Name))
+		{
+			continue;
+		}
+		// Most variables aren't async, only ask providers about each one once per step
+		UObject** Provider = AsyncVariableProviders.Find(Name);
+		if (!Provider)
+		{
+			Provider = &AsyncVariableProviders.Add(Name, nullptr);
+			for (int i = 0; i < Participants.Num(); ++i)
+			{
+				UObject* P = Participants[i];
+				if (P && ParticipantDispatch.IsValidIndex(i) && ParticipantDispatch[i].bIsAsyncProvider &&
+					ISUDSAsyncVariableProvider::Execute_ProvidesDialogueVariableAsync(P, this, Name))
+				{
+					*Provider = P;
+					break;
+				}
+			}
+		}
+		if (*Provider)
+		{
+			Requests.Emplace(Name, *Provider);
+		}
+	}
+
+	if (Requests.IsEmpty())
+	{
+		return false;
+	}
+
+	SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, LineNo);
+	SUDS_COUNT(ParticipantCalls, Requests.Num());
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+	for (const auto& Request : Requests)
+	{
+		PendingAsyncVariables.Add(Request.Key, AsyncVariableRequestId);
+	}
+	// Providers may complete immediately, in which case we don't need to suspend at all
+	bIssuingAsyncVariableRequests = true;
+	for (const auto& Request : Requests)
+	{
+		SUDS_COUNT(VariableRequests, 1);
+		ISUDSAsyncVariableProvider::Execute_OnDialogueAsyncVariableRequested(Request.Value, this, Request.Key, AsyncVariableRequestId);
+	}
+	bIssuingAsyncVariableRequests = false;
+
+	return !PendingAsyncVariables.IsEmpty();
+}
+
+void USUDSDialogue::GatherVariablesNeededBy(const USUDSScriptNode* Node, TSet<FName>& OutNames) const
+{
+	switch (Node->GetNodeType())
+	{
+	case ESUDSScriptNodeType::Select:
+		for (auto& Edge : Node->GetEdges())
+		{
+			OutNames.Append(Edge.GetCondition().GetVariableNames());
+		}
+		break;
+	case ESUDSScriptNodeType::SetVariable:
+		if (const USUDSScriptNodeSet* SetNode = Cast<USUDSScriptNodeSet>(Node))
+		{
+			OutNames.Append(SetNode->GetExpression().GetVariableNames());
+		}
+		break;
+	case ESUDSScriptNodeType::Event:
+		if (const USUDSScriptNodeEvent* EvtNode = Cast<USUDSScriptNodeEvent>(Node))
+		{
+			for (auto& Expr : EvtNode->GetArgs())
+			{
+				OutNames.Append(Expr.GetVariableNames());
+			}
+		}
+		break;
+	case ESUDSScriptNodeType::Text:
+		if (const USUDSScriptNodeText* TextNode = Cast<USUDSScriptNodeText>(Node))
+		{
+			if (TextNode->HasParameters())
+			{
+				OutNames.Append(TextNode->GetParameterNames());
+			}
+			// Choices are worked out as soon as we arrive at the speaker line, so fetch what they need too
+			if (TextNode->MayHaveChoices())
+			{
+				TSet<const USUDSScriptNode*> Visited;
+				for (auto& Edge : TextNode->GetEdges())
+				{
+					GatherVariablesNeededForChoices(Edge.GetTargetNode().Get(), OutNames, Visited);
+				}
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void USUDSDialogue::GatherVariablesNeededForStep(const USUDSScriptNode* Node,
+                                                 bool bIncludePrefetch,
+                                                 TSet<FName>& OutNames,
+                                                 TSet<const USUDSScriptNode*>& Visited) const
+{
+	// Follows the same nodes as RunUntilNextSpeakerNodeOrEnd, but down every path since we don't know yet which will
+	// be taken
+	if (!Node || Visited.Contains(Node))
+	{
+		return;
+	}
+	Visited.Add(Node);
+
+	// For a speaker line this includes what its choices need, since they're worked out as soon as we get there
+	GatherVariablesNeededBy(Node, OutNames);
+	switch (Node->GetNodeType())
+	{
+	case ESUDSScriptNodeType::Text:
+		// The step ends here. When prefetching, the line will want everything up to the line after as soon as we get
+		// there, which was worked out on import
+		if (bIncludePrefetch && bPrefetchVariables)
+		{
+			if (const USUDSScriptNodeText* TextNode = Cast<USUDSScriptNodeText>(Node))
+			{
+				OutNames.Append(TextNode->GetVariablesNeededNext());
+			}
+		}
+		return;
+	case ESUDSScriptNodeType::Choice:
+		// The step ends here
+		return;
+	case ESUDSScriptNodeType::Return:
+		// Where this goes depends on the call stack when we get there, so that's left until then
+		return;
+	case ESUDSScriptNodeType::Gosub:
+		if (const USUDSScriptNodeGosub* GosubNode = Cast<USUDSScriptNodeGosub>(Node))
+		{
+			GatherVariablesNeededForStep(BaseScript->GetNodeByLabel(GosubNode->GetLabelName()), bIncludePrefetch, OutNames, Visited);
+		}
+		break;
+	default:
+		break;
+	}
+	for (auto& Edge : Node->GetEdges())
+	{
+		GatherVariablesNeededForStep(Edge.GetTargetNode().Get(), bIncludePrefetch, OutNames, Visited);
+	}
+}
+
+void USUDSDialogue::GatherVariablesNeededForChoices(const USUDSScriptNode* Node, TSet<FName>& OutNames, TSet<const USUDSScriptNode*>& Visited) const
+{
+	// Follows the same nodes as RunUntilNextChoiceNode & RecurseAppendChoices, but down every path since we don't
+	// know yet which will be taken
+	if (!Node || Visited.Contains(Node))
+	{
+		return;
+	}
+	Visited.Add(Node);
+
+	const ESUDSScriptNodeType Type = Node->GetNodeType();
+	if (Type != ESUDSScriptNodeType::Choice &&
+		Type != ESUDSScriptNodeType::Select &&
+		Type != ESUDSScriptNodeType::SetVariable)
+	{
+		return;
+	}
+
+	GatherVariablesNeededBy(Node, OutNames);
+	for (auto& Edge : Node->GetEdges())
+	{
+		if (Edge.HasParameters())
+		{
+			OutNames.Append(Edge.GetParameterNames());
+		}
+		// Decisions lead to the next step, which will fetch its own variables
+		if (Edge.GetType() != ESUDSEdgeType::Decision)
+		{
+			GatherVariablesNeededForChoices(Edge.GetTargetNode().Get(), OutNames, Visited);
+		}
+	}
+}
+
+void USUDSDialogue::CompleteAsyncVariable(FName Name, const FSUDSValue& Value, int32 RequestId)
+{
+	// A variable of the same name may have been asked for again since, the old value mustn't satisfy that
+	const int32* PendingRequestId = PendingAsyncVariables.Find(Name);
+	if (!PendingRequestId || *PendingRequestId != RequestId)
+	{
+		UE_LOG(LogSUDSDialogue, Verbose, TEXT("Ignoring async variable %s from request %d which is not pending in %s"), *Name.ToString(), RequestId, *GetName());
+		return;
+	}
+
+	PendingAsyncVariables.Remove(Name);
+
+	FetchedAsyncVariables.Add(Name);
+	FName GlobalName;
+	if (USUDSLibrary::IsDialogueVariableGlobal(Name, GlobalName))
+	{
+		SetGlobalVariableImpl(GlobalName, Value, false, CurrentSourceLineNo);
+	}
+	else
+	{
+		SetVariableImpl(Name, Value, false, CurrentSourceLineNo);
+	}
+
+	if (PendingAsyncVariables.IsEmpty() && !bIssuingAsyncVariableRequests && AsyncSuspendedNode)
+	{
+		ResumeAfterAsyncVariables();
+	}
+}
+
+void USUDSDialogue::ResumeAfterAsyncVariables()
+{
+	USUDSScriptNode* Node = AsyncSuspendedNode;
+	AsyncSuspendedNode = nullptr;
+
+	TGuardValue<bool> ResumeGuard(bResumingAfterAsyncVariables, true);
+	RunUntilNextSpeakerNodeOrEnd(Node, bAsyncSuspendedRaiseAtEnd);
+}
+
+void USUDSDialogue::CancelAsyncVariables()
+{
+	PendingAsyncVariables.Reset();
+	++AsyncVariableRequestId;
+	AsyncSuspendedNode = nullptr;
+	FulfilAsyncVariableWaiters();
+}
+
+TFuture<void> USUDSDialogue::WaitForAsyncVariables()
+{
+	if (!IsWaitingForAsyncVariables())
+	{
+		return MakeFulfilledPromise<void>().GetFuture();
+	}
+	return AsyncVariableWaiters.Emplace_GetRef().GetFuture();
+}
+
+void USUDSDialogue::FulfilAsyncVariableWaiters()
+{
+	if (IsWaitingForAsyncVariables() || AsyncVariableWaiters.IsEmpty())
+	{
+		return;
+	}
+	// Continuations may start another step & wait again
+	TArray<TPromise<void>> Waiters = MoveTemp(AsyncVariableWaiters);
+	AsyncVariableWaiters.Reset();
+	for (auto& Waiter : Waiters)
+	{
+		Waiter.SetValue();
+	}
+}
+
+void USUDSDialogue::UpdateStateMemory()
+{
+	// State shared with forks isn't counted by anyone until one of them changes it, so it's never counted twice
+	const int64 NewStateMemory = (VariableState.IsShared() ? 0 : VariableState.Get().GetAllocatedSize()) +
+		(ChoicesTaken.IsShared() ? 0 : ChoicesTaken.Get().GetAllocatedSize()) +
+		(GosubReturnStack.IsShared() ? 0 : GosubReturnStack.Get().GetAllocatedSize());
+	TotalStateMemory.fetch_add(NewStateMemory - StateMemory, std::memory_order_relaxed);
+	StateMemory = NewStateMemory;
+}
+
+bool USUDSDialogue::ConsumeNodeBudget(const USUDSScriptNode* Node, bool bEndsDialogue)
+{
+	RecentLineNos[NodesRunThisStep % NumRecentLines] = Node->GetSourceLineNo();
+	++NodesRunThisStep;
+	if (NodeBudget <= 0 || NodesRunThisStep <= NodeBudget)
+	{
+		return true;
+	}
+
+	// Report the lines we've been going round, oldest first
+	TArray<int32> Lines;
+	for (int i = FMath::Max(0, NodesRunThisStep - NumRecentLines); i < NodesRunThisStep; ++i)
+	{
+		Lines.AddUnique(RecentLineNos[i % NumRecentLines]);
+	}
+	FString LineList;
+	for (const int32 Line : Lines)
+	{
+		LineList.Appendf(TEXT("%s%d"), LineList.IsEmpty() ? TEXT("") : TEXT(", "), Line);
+	}
+	UE_LOG(LogSUDSDialogue,
+	       Error,
+	       TEXT("Error in %s line %d: Ran %d nodes without reaching a speaker line or choice, the script is probably stuck in a loop. %s Most recent lines: %s"),
+	       *BaseScript->GetName(),
+	       Node->GetSourceLineNo(),
+	       NodeBudget,
+	       bEndsDialogue ? TEXT("Ending dialogue.") : TEXT("Giving up looking for choices."),
+	       *LineList);
+	return false;
 }
 
 USUDSScriptNode* USUDSDialogue::RunNode(USUDSScriptNode* Node)
 {
+	SUDS_TRACE_SCOPE(RunNode, BaseScript, Node->GetSourceLineNo());
+	SUDS_COUNT(NodesRun, 1);
 	CurrentSourceLineNo = Node->GetSourceLineNo();
+	if (USUDSScript::IsExecutionStatsEnabled() && !bSilent)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		USUDSScriptNode* NextNode = RunNodeByType(Node);
+		BaseScript->RecordNodeExecution(Node, FPlatformTime::Cycles64() - StartCycles);
+		return NextNode;
+	}
+	return RunNodeByType(Node);
+}
+
+USUDSScriptNode* USUDSDialogue::RunNodeByType(USUDSScriptNode* Node)
+{
 	switch (Node->GetNodeType())
 	{
 	case ESUDSScriptNodeType::Select:
@@ -193,6 +927,7 @@ USUDSScriptNode* USUDSDialogue::RunNode(USUDSScriptNode* Node)
 
 USUDSScriptNode* USUDSDialogue::RunSelectNode(USUDSScriptNode* Node)
 {
+	SUDS_TRACE_SCOPE(RunSelectNode, BaseScript, Node->GetSourceLineNo());
 	// Define internal random selection variable (used in random selects)
 	if (Node->IsRandomSelect())
 	{
@@ -201,19 +936,21 @@ USUDSScriptNode* USUDSDialogue::RunSelectNode(USUDSScriptNode* Node)
 		// to "ChoicesTaken" state but for random text nodes already chosen. For now, keep it simple
 
 		const int OptCount = Node->GetEdgeCount();
-		// Use SRand() so can be seeded if required
-		const int RandChoice = FMath::Min(OptCount-1, FMath::TruncToInt(FMath::SRand() * (float)OptCount));
+		// Use our own stream so can be seeded if required, and isn't affected by other dialogues
+		const int RandChoice = FMath::Min(OptCount-1, FMath::TruncToInt(NextRandomFraction() * (float)OptCount));
 
 		SetVariableInt(FSUDSConstants::RandomItemSelectIndexVarName, RandChoice);
 	}
 	
+	// Participants get every variable any of the conditions might need in one go
+	RaiseConditionVariablesRequested(Node);
 	for (auto& Edge : Node->GetEdges())
 	{
 		if (Edge.GetCondition().IsValid())
 		{
 			// use the first satisfied edge
-			RaiseExpressionVariablesRequested(Edge.GetCondition(), Edge.GetSourceLineNo());
-			const bool bSuccess = Edge.GetCondition().EvaluateBoolean(VariableState, GetGlobalVariables(), BaseScript->GetName());
+			SUDS_COUNT(ExpressionsEvaluated, 1);
+			const bool bSuccess = Edge.GetCondition().EvaluateBoolean(VariableState.Get(), GetGlobalVariables(), BaseScript->GetName());
 #if WITH_EDITOR
 			{
 				FString ExprStr = Edge.GetCondition().GetSourceString();
@@ -243,20 +980,29 @@ USUDSScriptNode* USUDSDialogue::RunEventNode(USUDSScriptNode* Node)
 	{
 		// Build a resolved args list, because we need to evaluate  expressions
 		TArray<FSUDSValue> ArgsResolved;
-		
+
+		// Every argument's variables are asked for together
+		TArray<FName> VarNames;
 		for (auto& Expr : EvtNode->GetArgs())
 		{
-			RaiseExpressionVariablesRequested(Expr, EvtNode->GetSourceLineNo());
-			ArgsResolved.Add(Expr.Evaluate(VariableState, GetGlobalVariables()));
-		}
-		
-		for (const auto P : Participants)
-		{
-			if (P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass()))
+			for (const FName& Name : Expr.GetVariableNames())
 			{
-				ISUDSParticipant::Execute_OnDialogueEvent(P, this, EvtNode->GetEventName(), ArgsResolved);
+				VarNames.AddUnique(Name);
 			}
 		}
+		RaiseVariablesRequested(VarNames, EvtNode->GetSourceLineNo());
+		for (auto& Expr : EvtNode->GetArgs())
+		{
+			SUDS_COUNT(ExpressionsEvaluated, 1);
+			ArgsResolved.Add(Expr.Evaluate(VariableState.Get(), GetGlobalVariables()));
+		}
+		
+		SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, EvtNode->GetSourceLineNo());
+		SUDS_COUNT(ParticipantCalls, 1);
+		SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+		ForEachParticipant(
+			[&](ISUDSNativeParticipant* P) { P->OnDialogueEvent(this, EvtNode->GetEventName(), ArgsResolved); },
+			[&](UObject* P) { ISUDSParticipant::Execute_OnDialogueEvent(P, this, EvtNode->GetEventName(), ArgsResolved); });
 		OnEvent.Broadcast(this, EvtNode->GetEventName(), ArgsResolved);
 #if WITH_EDITOR
 		InternalOnEvent.ExecuteIfBound(this, EvtNode->GetEventName(), ArgsResolved, EvtNode->GetSourceLineNo());
@@ -272,7 +1018,7 @@ USUDSScriptNode* USUDSDialogue::RunGosubNode(USUDSScriptNode* Node)
 		if (auto TargetNode = BaseScript->GetNodeByLabel(GosubNode->GetLabelName()))
 		{
 			// Push this gosub node to the return stack, then jump
-			GosubReturnStack.Push(GosubNode);
+			GosubReturnStack.Edit().Push(GosubNode);
 			return TargetNode;
 		}
 		else
@@ -290,10 +1036,10 @@ USUDSScriptNode* USUDSDialogue::RunGosubNode(USUDSScriptNode* Node)
 
 USUDSScriptNode* USUDSDialogue::RunReturnNode(USUDSScriptNode* Node)
 {
-	if (GosubReturnStack.Num() > 0)
+	if (GosubReturnStack.Get().Num() > 0)
 	{
 		// We return to the next node after the gosub, which temporarily redirected
-		const auto GoSubNode = GosubReturnStack.Pop();
+		const auto GoSubNode = GosubReturnStack.Edit().Pop();
 		return GetNextNode(GoSubNode);
 	}
 	else
@@ -315,11 +1061,12 @@ USUDSScriptNode* USUDSDialogue::RunSetVariableNode(USUDSScriptNode* Node)
 		if (SetNode->GetExpression().IsValid())
 		{
 			RaiseExpressionVariablesRequested(SetNode->GetExpression(), SetNode->GetSourceLineNo());
-			FSUDSValue Value = SetNode->GetExpression().Evaluate(VariableState, GetGlobalVariables());
+			SUDS_COUNT(ExpressionsEvaluated, 1);
+			FSUDSValue Value = SetNode->GetExpression().Evaluate(VariableState.Get(), GetGlobalVariables());
 			FName Identifier;
 			if (USUDSLibrary::IsDialogueVariableGlobal(SetNode->GetIdentifier(), Identifier))
 			{
-				InternalSetGlobalVariable(this->GetWorld(), Identifier, Value, true, SetNode->GetSourceLineNo());
+				SetGlobalVariableImpl(Identifier, Value, true, SetNode->GetSourceLineNo());
 			}
 			else
 			{
@@ -338,55 +1085,194 @@ USUDSScriptNode* USUDSDialogue::RunSetVariableNode(USUDSScriptNode* Node)
 		}
 	}
 
-	// Always one edge
-	return GetNextNode(Node);
-	
+	// Always one edge
+	return GetNextNode(Node);
+	
+}
+
+void USUDSDialogue::RaiseVariableChange(const FName& VarName, const FSUDSValue& Value, bool bFromScript, int LineNo)
+{
+	SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, LineNo);
+	SUDS_COUNT(ParticipantCalls, 1);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+	ForEachParticipant(
+		[&](ISUDSNativeParticipant* P) { P->OnDialogueVariableChanged(this, VarName, Value, bFromScript); },
+		[&](UObject* P) { ISUDSParticipant::Execute_OnDialogueVariableChanged(P, this, VarName, Value, bFromScript); });
+	OnVariableChanged.Broadcast(this, VarName, Value, bFromScript);
+#if WITH_EDITOR
+	if (!bFromScript)
+	{
+		// Script setting is raised in SetNode so we have access to expressions
+		InternalOnSetVarByCode.ExecuteIfBound(this, VarName, Value);
+	}
+#endif
+
+}
+
+void USUDSDialogue::RaiseStepVariablesRequested(const USUDSScriptNode* FromNode)
+{
+	StepRequestedVariables.Reset();
+	if (!bPrefetchStepVariables || !FromNode || (Participants.IsEmpty() && !OnVariableRequested.IsBound()))
+	{
+		return;
+	}
+
+	// Ask for everything down every path to the next speaker line or choice in one go, rather than a batch for each
+	// node as it's run. Anything prefetched for the line we're leaving (see VariablesNeededNext) isn't asked for again
+	TSet<FName> Names;
+	TSet<const USUDSScriptNode*> Visited;
+	GatherVariablesNeededForStep(FromNode, true, Names, Visited);
+	TArray<FName> VarNames;
+	VarNames.Reserve(Names.Num());
+	for (const FName& Name : Names)
+	{
+		if (!IsVariableAlreadyRequested(Name))
+		{
+			VarNames.Add(Name);
+		}
+	}
+	if (!VarNames.IsEmpty())
+	{
+		DispatchVariablesRequested(VarNames, FromNode->GetSourceLineNo());
+	}
+	StepRequestedVariables = MoveTemp(Names);
+}
+
+bool USUDSDialogue::IsVariableAlreadyRequested(const FName& VarName) const
+{
+	return StepRequestedVariables.Contains(VarName) ||
+		(PrefetchedNode && PrefetchedNode->GetVariablesNeededNext().Contains(VarName));
+}
+
+void USUDSDialogue::RaiseVariableRequested(const FName& VarName, int LineNo)
+{
+	if (IsVariableAlreadyRequested(VarName))
+	{
+		return;
+	}
+	// Reuse one array rather than allocating one for every request, unless a participant is asking from inside one
+	if (bSingleVariableRequestInUse)
+	{
+		DispatchVariablesRequested(TArray<FName> { VarName }, LineNo);
+		return;
+	}
+	bSingleVariableRequestInUse = true;
+	SingleVariableRequest.Reset();
+	SingleVariableRequest.Add(VarName);
+	DispatchVariablesRequested(SingleVariableRequest, LineNo);
+	bSingleVariableRequestInUse = false;
+}
+
+void USUDSDialogue::RaiseVariablesRequested(const TArray<FName>& VarNames, int LineNo)
+{
+	if (VarNames.IsEmpty())
+	{
+		return;
+	}
+
+	// Don't ask again for variables which were asked for at the start of this step, or prefetched for the current line
+	if (VarNames.ContainsByPredicate([this](const FName& Name) { return IsVariableAlreadyRequested(Name); }))
+	{
+		const TArray<FName> Remaining = VarNames.FilterByPredicate([this](const FName& Name)
+		{
+			return !IsVariableAlreadyRequested(Name);
+		});
+		if (!Remaining.IsEmpty())
+		{
+			DispatchVariablesRequested(Remaining, LineNo);
+		}
+		return;
+	}
+
+	DispatchVariablesRequested(VarNames, LineNo);
 }
 
-void USUDSDialogue::RaiseVariableChange(const FName& VarName, const FSUDSValue& Value, bool bFromScript, int LineNo)
+void USUDSDialogue::DispatchVariablesRequested(const TArray<FName>& VarNames, int LineNo)
 {
-	for (const auto P : Participants)
+	SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, LineNo);
+	SUDS_COUNT(VariableRequests, VarNames.Num());
+	SUDS_COUNT(ParticipantCalls, 1);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+	// Because variables set by participants should "win", raise event first
+	if (OnVariableRequested.IsBound())
 	{
-		if (P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass()))
+		for (const FName& VarName : VarNames)
 		{
-			ISUDSParticipant::Execute_OnDialogueVariableChanged(P, this, VarName, Value, bFromScript);
+			OnVariableRequested.Broadcast(this, VarName);
 		}
 	}
-	OnVariableChanged.Broadcast(this, VarName, Value, bFromScript);
-#if WITH_EDITOR
-	if (!bFromScript)
+	for (int i = 0; i < Participants.Num(); ++i)
 	{
-		// Script setting is raised in SetNode so we have access to expressions
-		InternalOnSetVarByCode.ExecuteIfBound(this, VarName, Value);
+		// Participant may have been destroyed & nulled by GC, in which case the native pointer is also invalid
+		UObject* P = Participants[i];
+		if (!P || !ParticipantDispatch.IsValidIndex(i))
+			continue;
+
+		const FParticipantDispatch& Dispatch = ParticipantDispatch[i];
+		if (Dispatch.Native)
+		{
+			Dispatch.Native->OnDialogueVariablesRequested(this, VarNames);
+		}
+		else if (Dispatch.bBatchVariableRequests)
+		{
+			ISUDSParticipant::Execute_OnDialogueVariablesRequested(P, this, VarNames);
+		}
+		else if (Dispatch.bIsParticipant)
+		{
+			for (const FName& VarName : VarNames)
+			{
+				ISUDSParticipant::Execute_OnDialogueVariableRequested(P, this, VarName);
+			}
+		}
 	}
-#endif
+}
 
+void USUDSDialogue::RaiseExpressionVariablesRequested(const FSUDSExpression& Expression, int LineNo)
+{
+	RaiseVariablesRequested(Expression.GetVariableNames(), LineNo);
 }
 
-void USUDSDialogue::RaiseVariableRequested(const FName& VarName, int LineNo)
+void USUDSDialogue::RaiseConditionVariablesRequested(const USUDSScriptNode* Node)
 {
-	// Because variables set by participants should "win", raise event first
-	OnVariableRequested.Broadcast(this, VarName);
-	for (const auto P : Participants)
+	TArray<FName> VarNames;
+	for (auto& Edge : Node->GetEdges())
 	{
-		if (P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass()))
+		if (Edge.GetCondition().IsValid())
 		{
-			ISUDSParticipant::Execute_OnDialogueVariableRequested(P, this, VarName);
+			for (const FName& Name : Edge.GetCondition().GetVariableNames())
+			{
+				VarNames.AddUnique(Name);
+			}
 		}
 	}
+	RaiseVariablesRequested(VarNames, Node->GetSourceLineNo());
 }
 
-void USUDSDialogue::RaiseExpressionVariablesRequested(const FSUDSExpression& Expression, int LineNo)
+const TMap<FName, FSUDSValue>& USUDSDialogue::GetGlobalVariables() const
 {
-	for (auto& Var : Expression.GetVariableNames())
+	if (bHasOwnGlobalVariables)
 	{
-		RaiseVariableRequested(Var, LineNo);
+		return OwnGlobalVariables.Get();
 	}
+	return InternalGetGlobalVariables(this->GetWorld());
 }
 
-const TMap<FName, FSUDSValue>& USUDSDialogue::GetGlobalVariables() const
+void USUDSDialogue::SetGlobalVariableImpl(FName Name, const FSUDSValue& Value, bool bFromScript, int LineNo)
 {
-	return InternalGetGlobalVariables(this->GetWorld());
+	if (bSilent)
+	{
+		// Silent forks mustn't change the real globals, so take a copy on first write & use that from then on
+		if (!bHasOwnGlobalVariables)
+		{
+			OwnGlobalVariables.Reset() = InternalGetGlobalVariables(this->GetWorld());
+			bHasOwnGlobalVariables = true;
+		}
+		OwnGlobalVariables.Edit().Add(Name, Value);
+	}
+	else
+	{
+		InternalSetGlobalVariable(this->GetWorld(), Name, Value, bFromScript, LineNo);
+	}
 }
 
 void USUDSDialogue::SetCurrentSpeakerNode(USUDSScriptNodeText* Node, bool bQuietly)
@@ -395,9 +1281,28 @@ void USUDSDialogue::SetCurrentSpeakerNode(USUDSScriptNodeText* Node, bool bQuiet
 
 	CurrentSpeakerDisplayName = FText::GetEmpty();
 	bParamNamesExtracted = false;
+	PrefetchedNode = nullptr;
 	if (Node)
 	{
 		CurrentSourceLineNo = Node->GetSourceLineNo();
+		if (bPrefetchVariables)
+		{
+			// Ask for everything up to the next line now, including what UpdateChoices is about to need. The step
+			// which got us here has usually asked for all of it already
+			const TArray<FName> Remaining = Node->GetVariablesNeededNext().FilterByPredicate([this](const FName& Name)
+			{
+				return !StepRequestedVariables.Contains(Name);
+			});
+			if (!Remaining.IsEmpty())
+			{
+				DispatchVariablesRequested(Remaining, CurrentSourceLineNo);
+			}
+			PrefetchedNode = Node;
+		}
+		if (USUDSScript::IsExecutionStatsEnabled() && !bSilent)
+		{
+			BaseScript->RecordNodeExecution(Node);
+		}
 	}
 	else
 	{
@@ -417,10 +1322,11 @@ void USUDSDialogue::SetCurrentSpeakerNode(USUDSScriptNodeText* Node, bool bQuiet
 
 FText USUDSDialogue::ResolveParameterisedText(const TArray<FName> Params, const FTextFormat& TextFormat, int LineNo)
 {
-	for (const auto& P : Params)
-	{
-		RaiseVariableRequested(P, LineNo);
-	}
+	SUDS_TRACE_SCOPE(ResolveParameterisedText, BaseScript, LineNo);
+	SUDS_COUNT(FormattedTexts, 1);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_FormatTextTime);
+	CSV_SCOPED_TIMING_STAT(SUDS, FormatText);
+	RaiseVariablesRequested(Params, LineNo);
 	// Need to make a temp arg list for compatibility
 	// Also lets us just set the ones we need to
 	FFormatNamedArguments Args;
@@ -429,6 +1335,15 @@ FText USUDSDialogue::ResolveParameterisedText(const TArray<FName> Params, const
 	
 }
 
+TArray<FName> USUDSDialogue::GetVariablesNeededNext() const
+{
+	if (CurrentSpeakerNode)
+	{
+		return CurrentSpeakerNode->GetVariablesNeededNext();
+	}
+	return TArray<FName>();
+}
+
 void USUDSDialogue::GetTextFormatArgs(const TArray<FName>& ArgNames, FFormatNamedArguments& OutArgs) const
 {
 	for (auto& Name : ArgNames)
@@ -436,14 +1351,14 @@ void USUDSDialogue::GetTextFormatArgs(const TArray<FName>& ArgNames, FFormatName
 		FName GlobalName;
 		if (USUDSLibrary::IsDialogueVariableGlobal(Name, GlobalName))
 		{
-			auto& Globals = InternalGetGlobalVariables(this->GetWorld());
+			auto& Globals = GetGlobalVariables();
 			if (const FSUDSValue* Value = Globals.Find(GlobalName))
 			{
 				// Add to format args using name with prefix
 				OutArgs.Add(Name.ToString(), Value->ToFormatArg());
 			}
 		}
-		else if (const FSUDSValue* Value = VariableState.Find(Name))
+		else if (const FSUDSValue* Value = VariableState.Get().Find(Name))
 		{
 			// Use the operator conversion
 			OutArgs.Add(Name.ToString(), Value->ToFormatArg());
@@ -506,7 +1421,7 @@ FText USUDSDialogue::GetSpeakerDisplayName() const
 		// or just the SpeakerID if none specified
 		static const FString SpeakerIDPrefix = "SpeakerName.";
 		FName Key(SpeakerIDPrefix + GetSpeakerID());
-		if (auto Arg = VariableState.Find(Key))
+		if (auto Arg = VariableState.Get().Find(Key))
 		{
 			if (Arg->GetType() == ESUDSValueType::Text)
 			{
@@ -563,6 +1478,7 @@ UDialogueVoice* USUDSDialogue::GetTargetVoice() const
 
 USoundBase* USUDSDialogue::GetSoundForCurrentLine(bool bAllowAnyTarget) const
 {
+	SUDS_TRACE_SCOPE(GetSoundForCurrentLine, BaseScript, CurrentSourceLineNo);
 	// UDialogueWave's contexts have both speakers and targets, but the GetWaveFromContext method is too restrictive
 	// Instead we'll search the contexts ourselves and be more fuzzy
 	if (auto Wave = GetWave())
@@ -703,10 +1619,10 @@ const USUDSScriptNode* USUDSDialogue::WalkToNextChoiceNode(USUDSScriptNode* From
 		if (!bExecute)
 		{
 			// Make a copy of the gosub stack so we can safely explore gosubs
-			TempGosubStack.Append(GosubReturnStack);
+			TempGosubStack.Append(GosubReturnStack.Get());
 		}
 		
-		const auto ResultNode = RecurseWalkToNextChoiceOrTextNode(NextNode, bExecute, bExecute ? GosubReturnStack : TempGosubStack);
+		const auto ResultNode = RecurseWalkToNextChoiceOrTextNode(NextNode, bExecute, bExecute ? GosubReturnStack.Edit() : TempGosubStack);
 		if (ResultNode && ResultNode->GetNodeType() == ESUDSScriptNodeType::Choice)
 		{
 			return ResultNode;
@@ -720,6 +1636,11 @@ USUDSScriptNode* USUDSDialogue::RecurseWalkToNextChoiceOrTextNode(USUDSScriptNod
 	auto NextNode = Node;
 	while (NextNode && !IsChoiceOrTextNode(NextNode->GetNodeType()))
 	{
+		// Running out here only means we don't find a choice, the speaker line is still shown
+		if (!ConsumeNodeBudget(NextNode, false))
+		{
+			return nullptr;
+		}
 		// Special case gosub/return in non-execute mode, since only RunNode will explore them
 		if (!bExecute)
 		{
@@ -785,13 +1706,23 @@ void USUDSDialogue::RecurseAppendChoices(const USUDSScriptNode* Node, TArray<FSU
 	if (!Node)
 		return;
 
+	SUDS_TRACE_SCOPE(RecurseAppendChoices, BaseScript, Node->GetSourceLineNo());
+
 	// We only cascade into choices or selects
 	if(Node->GetNodeType() != ESUDSScriptNodeType::Choice &&
 		Node->GetNodeType() != ESUDSScriptNodeType::Select)
 	{
 		return;
 	}
-	
+
+	if (USUDSScript::IsExecutionStatsEnabled() && !bSilent)
+	{
+		// Conditional choices are evaluated here rather than in RunSelectNode, so count them too
+		BaseScript->RecordNodeExecution(Node);
+	}
+
+	// Selects under choices have conditional edges, ask for everything they need at once
+	RaiseConditionVariablesRequested(Node);
 	for (auto& Edge : Node->GetEdges())
 	{
 		switch (Edge.GetType())
@@ -803,8 +1734,8 @@ void USUDSDialogue::RecurseAppendChoices(const USUDSScriptNode* Node, TArray<FSU
 			// Conditional edges are under selects
 			if (Edge.GetCondition().IsValid())
 			{
-				RaiseExpressionVariablesRequested(Edge.GetCondition(), Edge.GetSourceLineNo());
-				if (Edge.GetCondition().EvaluateBoolean(VariableState, GetGlobalVariables(), BaseScript->GetName()))
+				SUDS_COUNT(ExpressionsEvaluated, 1);
+				if (Edge.GetCondition().EvaluateBoolean(VariableState.Get(), GetGlobalVariables(), BaseScript->GetName()))
 				{
 					RecurseAppendChoices(Edge.GetTargetNode().Get(), OutChoices);
 					// When we choose a path on a select, we don't check the other paths, we can only go down one
@@ -826,6 +1757,9 @@ void USUDSDialogue::RecurseAppendChoices(const USUDSScriptNode* Node, TArray<FSU
 
 void USUDSDialogue::UpdateChoices()
 {
+	SUDS_TRACE_SCOPE(UpdateChoices, BaseScript, CurrentSourceLineNo);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_UpdateChoicesTime);
+	CSV_SCOPED_TIMING_STAT(SUDS, UpdateChoices);
 	CurrentChoices.Reset();
 	CurrentRootChoiceNode = nullptr;
 	if (CurrentSpeakerNode)
@@ -833,8 +1767,10 @@ void USUDSDialogue::UpdateChoices()
 		// If we've either found choices through static checking (on one or other select paths), we look for them now
 		// We also check if we're inside a gosub, since the call site changes whether there may be choices or not
 		if (CurrentSpeakerNode->MayHaveChoices() ||
-			GosubReturnStack.Num() > 0)
+			GosubReturnStack.Get().Num() > 0)
 		{
+			// Finding & running up to the choices is a step of its own
+			ResetNodeBudget();
 			// We MIGHT have a choice; conditionals can result in HasChoices() being true but the current state not actually
 			// taking us to a choice path
 			CurrentRootChoiceNode = FindNextChoiceNode(CurrentSpeakerNode);
@@ -842,6 +1778,7 @@ void USUDSDialogue::UpdateChoices()
 			{
 				// Run any e.g. set nodes between text and choice
 				// These can be set nodes directly under the text and before the first choice, which get run for all choices
+				ResetNodeBudget();
 				RunUntilNextChoiceNode(CurrentSpeakerNode);
 
 				// Once we've found & run up to the root choice, there can be potentially a tree of mixed choice/select nodes
@@ -860,6 +1797,7 @@ void USUDSDialogue::UpdateChoices()
 			}			
 		}
 	}
+	SUDS_COUNT(ChoicesEvaluated, CurrentChoices.Num());
 }
 
 
@@ -907,11 +1845,16 @@ bool USUDSDialogue::HasChoiceIndexBeenTakenPreviously(int Index)
 
 bool USUDSDialogue::HasChoiceBeenTakenPreviously(const FSUDSScriptEdge& Choice)
 {
-	return ChoicesTaken.Contains(Choice.GetTextID());
+	return ChoicesTaken.Get().Contains(Choice.GetTextID());
 }
 
 bool USUDSDialogue::Continue()
 {
+	if (IsWaitingForAsyncVariables())
+	{
+		UE_LOG(LogSUDSDialogue, Warning, TEXT("Ignoring Continue on %s while waiting for async variables"), *GetName());
+		return true;
+	}
 	if (GetNumberOfChoices() == 1)
 	{
 		return Choose(0);		
@@ -921,6 +1864,11 @@ bool USUDSDialogue::Continue()
 
 bool USUDSDialogue::Choose(int Index)
 {
+	if (IsWaitingForAsyncVariables())
+	{
+		UE_LOG(LogSUDSDialogue, Warning, TEXT("Ignoring Choose on %s while waiting for async variables"), *GetName());
+		return true;
+	}
 	if (CurrentChoices.IsValidIndex(Index))
 	{
 		// ONLY run to choice node if there is one!
@@ -928,7 +1876,7 @@ bool USUDSDialogue::Choose(int Index)
 		if (CurrentNodeHasChoices())
 		{
 			const auto& Choice = CurrentChoices[Index]; 
-			ChoicesTaken.Add(Choice.GetTextID());
+			ChoicesTaken.Edit().Add(Choice.GetTextID());
 			
 			RaiseChoiceMade(Index, Choice.GetSourceLineNo());
 			RaiseProceeding();
@@ -961,6 +1909,7 @@ bool USUDSDialogue::IsEnded() const
 void USUDSDialogue::End(bool bQuietly)
 {
 	SetCurrentSpeakerNode(nullptr, bQuietly);
+	CancelAsyncVariables();
 }
 
 int USUDSDialogue::GetCurrentSourceLine() const
@@ -968,6 +1917,52 @@ int USUDSDialogue::GetCurrentSourceLine() const
 	return CurrentSourceLineNo;
 }
 
+USUDSDialogue* USUDSDialogue::Fork(bool bSilentFork)
+{
+	if (IsWaitingForAsyncVariables())
+	{
+		// The rest of the suspended step can only run in this dialogue
+		UE_LOG(LogSUDSDialogue, Warning, TEXT("Cannot fork %s while waiting for async variables"), *GetName());
+		return nullptr;
+	}
+
+	// Same outer so the fork has the same world context. Don't Initialise(), that would run the header again
+	USUDSDialogue* Forked = NewObject<USUDSDialogue>(GetOuter());
+	Forked->BaseScript = BaseScript;
+	Forked->CurrentSpeakerNode = CurrentSpeakerNode;
+	Forked->CurrentRootChoiceNode = CurrentRootChoiceNode;
+	Forked->CurrentChoices = CurrentChoices;
+	Forked->CurrentSourceLineNo = CurrentSourceLineNo;
+	Forked->CurrentSpeakerDisplayName = CurrentSpeakerDisplayName;
+	Forked->CurrentRequestedParamNames = CurrentRequestedParamNames;
+	Forked->bParamNamesExtracted = bParamNamesExtracted;
+	Forked->NodeBudget = NodeBudget;
+	// Same stream state, so the fork picks the same random options this dialogue would
+	Forked->RandomStream = RandomStream;
+	Forked->bRandomStreamUsed = bRandomStreamUsed;
+
+	// Shared, not copied
+	Forked->VariableState = VariableState;
+	Forked->ChoicesTaken = ChoicesTaken;
+	Forked->GosubReturnStack = GosubReturnStack;
+
+	// Forks of silent forks are silent too, since they'd otherwise see globals which were never really set
+	Forked->bSilent = bSilentFork || bSilent;
+	Forked->bHasOwnGlobalVariables = bHasOwnGlobalVariables;
+	Forked->OwnGlobalVariables = OwnGlobalVariables;
+	if (!Forked->bSilent)
+	{
+		Forked->Participants = Participants;
+		Forked->ParticipantDispatch = ParticipantDispatch;
+		Forked->bPrefetchVariables = bPrefetchVariables;
+		Forked->bPrefetchStepVariables = bPrefetchStepVariables;
+		Forked->PrefetchedNode = PrefetchedNode;
+	}
+	Forked->UpdateStateMemory();
+
+	return Forked;
+}
+
 void USUDSDialogue::ResetState(bool bResetVariables, bool bResetPosition, bool bResetVisited)
 {
 	if (bResetVariables)
@@ -985,7 +1980,7 @@ FSUDSDialogueState USUDSDialogue::GetSavedState() const
 		                              : FString();
 
 	TArray<FString> ExportReturnStack;
-	for (auto Node : GosubReturnStack)
+	for (auto Node : GosubReturnStack.Get())
 	{
 		if (auto GN = Cast<USUDSScriptNodeGosub>(Node))
 		{
@@ -993,7 +1988,7 @@ FSUDSDialogueState USUDSDialogue::GetSavedState() const
 		}
 		
 	}
-	return FSUDSDialogueState(CurrentNodeId, VariableState, ChoicesTaken, ExportReturnStack);
+	return FSUDSDialogueState(CurrentNodeId, VariableState.Get(), ChoicesTaken.Get(), ExportReturnStack, TOptional<int32>(RandomStream.GetCurrentSeed()));
 		  
 }
 
@@ -1002,10 +1997,16 @@ void USUDSDialogue::RestoreSavedState(const FSUDSDialogueState& State)
 	// Don't just empty variables
 	// Re-run init to ensure header state is initialised then merge; important for it script is altered since state saved
 	InitVariables();
-	VariableState.Append(State.GetVariables());
-	ChoicesTaken.Empty();
-	ChoicesTaken.Append(State.GetChoicesTaken());
-	GosubReturnStack.Empty();
+	EditVariables().Append(State.GetVariables());
+	InvalidateVariableHandles();
+	// Saves from before the seed was stored keep the stream we'd have started with
+	if (State.HasRandomSeed())
+	{
+		RandomStream.Initialize(State.GetRandomSeed());
+		bRandomStreamUsed = true;
+	}
+	ChoicesTaken.Reset().Append(State.GetChoicesTaken());
+	GosubReturnStack.Reset();
 	for (auto ID : State.GetReturnStack())
 	{
 		USUDSScriptNodeGosub* Node = BaseScript->GetNodeByGosubID(ID);
@@ -1014,9 +2015,11 @@ void USUDSDialogue::RestoreSavedState(const FSUDSDialogueState& State)
 			UE_LOG(LogSUDSDialogue, Error, TEXT("Restore: Can't find Gosub with ID %s, returns referencing it will go to end"), *ID);
 		}
 		// Add anyway, will just go to end
-		GosubReturnStack.Add(Node);
+		GosubReturnStack.Edit().Add(Node);
 	}
 	
+	// Not part of a step, so nothing has been asked for yet
+	StepRequestedVariables.Reset();
 	// If not found this will be null
 	if (!State.GetTextNodeID().IsEmpty())
 	{
@@ -1029,6 +2032,162 @@ void USUDSDialogue::RestoreSavedState(const FSUDSDialogueState& State)
 	}
 }
 
+void USUDSDialogue::GetHeaderDefaultVariables(FSUDSValueMap& OutVars) const
+{
+	// Walk the header without side effects (no events, no variable requests) to find the values it sets
+	// This is what InitVariables() will produce on restore, so anything matching can be left out of a compact save
+	OutVars.Empty();
+	USUDSScriptNode* Node = BaseScript ? BaseScript->GetHeaderNode() : nullptr;
+	while (Node)
+	{
+		switch (Node->GetNodeType())
+		{
+		case ESUDSScriptNodeType::SetVariable:
+			if (auto SetNode = Cast<USUDSScriptNodeSet>(Node))
+			{
+				FName Unused;
+				if (SetNode->GetExpression().IsValid() &&
+					!USUDSLibrary::IsDialogueVariableGlobal(SetNode->GetIdentifier(), Unused))
+				{
+					OutVars.Add(SetNode->GetIdentifier(), SetNode->GetExpression().Evaluate(OutVars, GetGlobalVariables()));
+				}
+			}
+			Node = BaseScript->GetNextNode(Node);
+			break;
+		case ESUDSScriptNodeType::Event:
+			Node = BaseScript->GetNextNode(Node);
+			break;
+		case ESUDSScriptNodeType::Select:
+			{
+				USUDSScriptNode* Next = nullptr;
+				for (auto& Edge : Node->GetEdges())
+				{
+					if (Edge.GetCondition().IsValid() &&
+						Edge.GetCondition().EvaluateBoolean(OutVars, GetGlobalVariables(), BaseScript->GetName()))
+					{
+						Next = Edge.GetTargetNode().Get();
+						break;
+					}
+				}
+				Node = Next;
+				break;
+			}
+		default:
+			Node = nullptr;
+			break;
+		}
+	}
+}
+
+FSUDSCompactDialogueState USUDSDialogue::GetCompactSavedState() const
+{
+	FSUDSValueMap Defaults;
+	GetHeaderDefaultVariables(Defaults);
+
+	TMap<FName, FSUDSValue> Changed;
+	for (auto& Pair : VariableState.Get())
+	{
+		const FSUDSValue* pDefault = Defaults.Find(Pair.Key);
+		if (pDefault && pDefault->GetType() == Pair.Value.GetType())
+		{
+			// Compare floats exactly, the normal equality is tolerant and we want to restore precisely
+			const bool bSame = Pair.Value.GetType() == ESUDSValueType::Float
+				                   ? pDefault->GetFloatValue() == Pair.Value.GetFloatValue()
+				                   : (*pDefault == Pair.Value).GetBooleanValue();
+			if (bSame)
+				continue;
+		}
+		Changed.Add(Pair.Key, Pair.Value);
+	}
+	// Header variables which have since been unset need recording, or the header would bring them back
+	for (auto& Pair : Defaults)
+	{
+		if (!VariableState.Get().Contains(Pair.Key))
+		{
+			Changed.Add(Pair.Key, FSUDSValue());
+		}
+	}
+
+	TArray<uint32> Choices;
+	Choices.Reserve(ChoicesTaken.Get().Num());
+	for (auto& ID : ChoicesTaken.Get())
+	{
+		Choices.Add(USUDSScript::GetIDHash(ID));
+	}
+
+	TArray<uint32> ExportReturnStack;
+	ExportReturnStack.Reserve(GosubReturnStack.Get().Num());
+	for (auto Node : GosubReturnStack.Get())
+	{
+		// Null entries (unresolved on restore) are preserved as 0 so the stack depth is the same
+		ExportReturnStack.Add(Node ? USUDSScript::GetIDHash(Node->GetGosubID()) : 0);
+	}
+
+	const uint32 CurrentNodeHash = CurrentSpeakerNode
+		                               ? USUDSScript::GetIDHash(SUDS_GET_TEXT_KEY(CurrentSpeakerNode->GetText()))
+		                               : 0;
+
+	return FSUDSCompactDialogueState(CurrentNodeHash,
+	                                 MoveTemp(Changed),
+	                                 MoveTemp(Choices),
+	                                 MoveTemp(ExportReturnStack),
+	                                 RandomStream.GetCurrentSeed());
+}
+
+void USUDSDialogue::RestoreCompactSavedState(const FSUDSCompactDialogueState& State)
+{
+	// Header first, then apply the differences on top
+	InitVariables();
+	FSUDSValueMap& Variables = EditVariables();
+	for (auto& Pair : State.GetChangedVariables())
+	{
+		if (Pair.Value.IsEmpty())
+		{
+			Variables.Remove(Pair.Key);
+		}
+		else
+		{
+			Variables.Add(Pair.Key, Pair.Value);
+		}
+	}
+	InvalidateVariableHandles();
+	// Saves from before the seed was stored keep the stream we'd have started with
+	if (State.HasRandomSeed())
+	{
+		RandomStream.Initialize(State.GetRandomSeed());
+		bRandomStreamUsed = true;
+	}
+
+	TSet<FString>& Choices = ChoicesTaken.Reset();
+	Choices.Reserve(State.GetChoicesTaken().Num());
+	for (const uint32 Hash : State.GetChoicesTaken())
+	{
+		FString TextID;
+		if (BaseScript->GetChoiceTextIDByHash(Hash, TextID))
+		{
+			Choices.Add(TextID);
+		}
+		// Choices which no longer exist in the script can be dropped
+	}
+
+	GosubReturnStack.Reset();
+	for (const uint32 Hash : State.GetReturnStack())
+	{
+		USUDSScriptNodeGosub* Node = BaseScript->GetNodeByGosubIDHash(Hash);
+		if (!Node)
+		{
+			UE_LOG(LogSUDSDialogue, Error, TEXT("Restore: Can't find Gosub with ID hash %08x, returns referencing it will go to end"), Hash);
+		}
+		// Add anyway, will just go to end
+		GosubReturnStack.Edit().Add(Node);
+	}
+
+	// Not part of a step, so nothing has been asked for yet
+	StepRequestedVariables.Reset();
+	// If not found this will be null
+	SetCurrentSpeakerNode(BaseScript->GetNodeByTextIDHash(State.GetTextNodeHash()), true);
+}
+
 void USUDSDialogue::Restart(bool bResetState, FName StartLabel, bool bReRunHeader)
 {
 	if (bResetState)
@@ -1036,10 +2195,19 @@ void USUDSDialogue::Restart(bool bResetState, FName StartLabel, bool bReRunHeade
 		ResetState();
 	}
 	// Always reset return stack
-	GosubReturnStack.Empty();
+	GosubReturnStack.Reset();
 	CurrentSourceLineNo = 0;
+	// We're not continuing from the current line, so what was prefetched for it doesn't apply
+	PrefetchedNode = nullptr;
+	StepRequestedVariables.Reset();
 	RaiseStarting(StartLabel);
 
+	if (!bRandomStreamUsed)
+	{
+		// First start, now we know where from
+		InitRandomStream(StartLabel);
+	}
+
 	if (!bResetState && bReRunHeader)
 	{
 		// Run header nodes but don't re-init
@@ -1101,13 +2269,12 @@ TSet<FName> USUDSDialogue::GetParametersInUse()
 
 void USUDSDialogue::RaiseStarting(FName StartLabel)
 {
-	for (const auto P : Participants)
-	{
-		if (P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass()))
-		{
-			ISUDSParticipant::Execute_OnDialogueStarting(P, this, StartLabel);
-		}
-	}
+	SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, CurrentSourceLineNo);
+	SUDS_COUNT(ParticipantCalls, 1);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+	ForEachParticipant(
+		[&](ISUDSNativeParticipant* P) { P->OnDialogueStarting(this, StartLabel); },
+		[&](UObject* P) { ISUDSParticipant::Execute_OnDialogueStarting(P, this, StartLabel); });
 	OnStarting.Broadcast(this, StartLabel);
 #if WITH_EDITOR
 	InternalOnStarting.ExecuteIfBound(this, StartLabel);
@@ -1116,13 +2283,12 @@ void USUDSDialogue::RaiseStarting(FName StartLabel)
 
 void USUDSDialogue::RaiseFinished()
 {
-	for (const auto P : Participants)
-	{
-		if (P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass()))
-		{
-			ISUDSParticipant::Execute_OnDialogueFinished(P, this);
-		}
-	}
+	SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, CurrentSourceLineNo);
+	SUDS_COUNT(ParticipantCalls, 1);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+	ForEachParticipant(
+		[&](ISUDSNativeParticipant* P) { P->OnDialogueFinished(this); },
+		[&](UObject* P) { ISUDSParticipant::Execute_OnDialogueFinished(P, this); });
 	OnFinished.Broadcast(this);
 #if WITH_EDITOR
 	InternalOnFinished.ExecuteIfBound(this);
@@ -1132,13 +2298,12 @@ void USUDSDialogue::RaiseFinished()
 
 void USUDSDialogue::RaiseNewSpeakerLine()
 {
-	for (const auto P : Participants)
-	{
-		if (P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass()))
-		{
-			ISUDSParticipant::Execute_OnDialogueSpeakerLine(P, this);
-		}
-	}
+	SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, CurrentSourceLineNo);
+	SUDS_COUNT(ParticipantCalls, 1);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+	ForEachParticipant(
+		[&](ISUDSNativeParticipant* P) { P->OnDialogueSpeakerLine(this); },
+		[&](UObject* P) { ISUDSParticipant::Execute_OnDialogueSpeakerLine(P, this); });
 	
 	// Event listeners get it after
 	OnSpeakerLine.Broadcast(this);
@@ -1149,13 +2314,12 @@ void USUDSDialogue::RaiseNewSpeakerLine()
 
 void USUDSDialogue::RaiseChoiceMade(int Index, int LineNo)
 {
-	for (const auto P : Participants)
-	{
-		if (P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass()))
-		{
-			ISUDSParticipant::Execute_OnDialogueChoiceMade(P, this, Index);
-		}
-	}
+	SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, LineNo);
+	SUDS_COUNT(ParticipantCalls, 1);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+	ForEachParticipant(
+		[&](ISUDSNativeParticipant* P) { P->OnDialogueChoiceMade(this, Index); },
+		[&](UObject* P) { ISUDSParticipant::Execute_OnDialogueChoiceMade(P, this, Index); });
 	// Event listeners get it after
 	OnChoice.Broadcast(this, Index);
 #if WITH_EDITOR
@@ -1165,13 +2329,12 @@ void USUDSDialogue::RaiseChoiceMade(int Index, int LineNo)
 
 void USUDSDialogue::RaiseProceeding()
 {
-	for (const auto P : Participants)
-	{
-		if (P->GetClass()->ImplementsInterface(USUDSParticipant::StaticClass()))
-		{
-			ISUDSParticipant::Execute_OnDialogueProceeding(P, this);
-		}
-	}
+	SUDS_TRACE_SCOPE(ParticipantDispatch, BaseScript, CurrentSourceLineNo);
+	SUDS_COUNT(ParticipantCalls, 1);
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_ParticipantCallsTime);
+	ForEachParticipant(
+		[&](ISUDSNativeParticipant* P) { P->OnDialogueProceeding(this); },
+		[&](UObject* P) { ISUDSParticipant::Execute_OnDialogueProceeding(P, this); });
 	// Event listeners get it after
 	OnProceeding.Broadcast(this);
 #if WITH_EDITOR
@@ -1179,9 +2342,9 @@ void USUDSDialogue::RaiseProceeding()
 #endif
 }
 
-FText USUDSDialogue::GetVariableText(FName Name) const
+static FText GetVariableTextImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = VariableState.Find(Name))
+	if (Arg)
 	{
 		if (Arg->GetType() == ESUDSValueType::Text)
 		{
@@ -1195,14 +2358,24 @@ FText USUDSDialogue::GetVariableText(FName Name) const
 	return FText();
 }
 
+FText USUDSDialogue::GetVariableText(FName Name) const
+{
+	return GetVariableTextImpl(VariableState.Get().Find(Name), Name);
+}
+
+FText USUDSDialogue::GetVariableText(const FSUDSVariableHandle& Handle) const
+{
+	return GetVariableTextImpl(FindVariable(Handle), Handle.GetName());
+}
+
 void USUDSDialogue::SetVariableInt(FName Name, int32 Value)
 {
 	SetVariable(Name, Value);
 }
 
-int USUDSDialogue::GetVariableInt(FName Name) const
+static int GetVariableIntImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = VariableState.Find(Name))
+	if (Arg)
 	{
 		switch (Arg->GetType())
 		{
@@ -1220,14 +2393,24 @@ int USUDSDialogue::GetVariableInt(FName Name) const
 	return 0;
 }
 
+int USUDSDialogue::GetVariableInt(FName Name) const
+{
+	return GetVariableIntImpl(VariableState.Get().Find(Name), Name);
+}
+
+int USUDSDialogue::GetVariableInt(const FSUDSVariableHandle& Handle) const
+{
+	return GetVariableIntImpl(FindVariable(Handle), Handle.GetName());
+}
+
 void USUDSDialogue::SetVariableFloat(FName Name, float Value)
 {
 	SetVariable(Name, Value);
 }
 
-float USUDSDialogue::GetVariableFloat(FName Name) const
+static float GetVariableFloatImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = VariableState.Find(Name))
+	if (Arg)
 	{
 		switch (Arg->GetType())
 		{
@@ -1244,14 +2427,24 @@ float USUDSDialogue::GetVariableFloat(FName Name) const
 	return 0;
 }
 
+float USUDSDialogue::GetVariableFloat(FName Name) const
+{
+	return GetVariableFloatImpl(VariableState.Get().Find(Name), Name);
+}
+
+float USUDSDialogue::GetVariableFloat(const FSUDSVariableHandle& Handle) const
+{
+	return GetVariableFloatImpl(FindVariable(Handle), Handle.GetName());
+}
+
 void USUDSDialogue::SetVariableGender(FName Name, ETextGender Value)
 {
 	SetVariable(Name, Value);
 }
 
-ETextGender USUDSDialogue::GetVariableGender(FName Name) const
+static ETextGender GetVariableGenderImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = VariableState.Find(Name))
+	if (Arg)
 	{
 		switch (Arg->GetType())
 		{
@@ -1267,15 +2460,25 @@ ETextGender USUDSDialogue::GetVariableGender(FName Name) const
 	return ETextGender::Neuter;
 }
 
+ETextGender USUDSDialogue::GetVariableGender(FName Name) const
+{
+	return GetVariableGenderImpl(VariableState.Get().Find(Name), Name);
+}
+
+ETextGender USUDSDialogue::GetVariableGender(const FSUDSVariableHandle& Handle) const
+{
+	return GetVariableGenderImpl(FindVariable(Handle), Handle.GetName());
+}
+
 void USUDSDialogue::SetVariableBoolean(FName Name, bool Value)
 {
 	// Use explicit FSUDSValue constructor to avoid default int conversion
 	SetVariable(Name, FSUDSValue(Value));
 }
 
-bool USUDSDialogue::GetVariableBoolean(FName Name) const
+static bool GetVariableBooleanImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = VariableState.Find(Name))
+	if (Arg)
 	{
 		switch (Arg->GetType())
 		{
@@ -1293,14 +2496,24 @@ bool USUDSDialogue::GetVariableBoolean(FName Name) const
 	return false;
 }
 
+bool USUDSDialogue::GetVariableBoolean(FName Name) const
+{
+	return GetVariableBooleanImpl(VariableState.Get().Find(Name), Name);
+}
+
+bool USUDSDialogue::GetVariableBoolean(const FSUDSVariableHandle& Handle) const
+{
+	return GetVariableBooleanImpl(FindVariable(Handle), Handle.GetName());
+}
+
 void USUDSDialogue::SetVariableName(FName Name, FName Value)
 {
 	SetVariable(Name, FSUDSValue(Value, false));
 }
 
-FName USUDSDialogue::GetVariableName(FName Name) const
+static FName GetVariableNameImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = VariableState.Find(Name))
+	if (Arg)
 	{
 		if (Arg->GetType() == ESUDSValueType::Name)
 		{
@@ -1314,7 +2527,68 @@ FName USUDSDialogue::GetVariableName(FName Name) const
 	return NAME_None;
 }
 
+FName USUDSDialogue::GetVariableName(FName Name) const
+{
+	return GetVariableNameImpl(VariableState.Get().Find(Name), Name);
+}
+
+FName USUDSDialogue::GetVariableName(const FSUDSVariableHandle& Handle) const
+{
+	return GetVariableNameImpl(FindVariable(Handle), Handle.GetName());
+}
+
 void USUDSDialogue::UnSetVariable(FName Name)
 {
-	VariableState.Remove(Name);
+	EditVariables().Remove(Name);
+	InvalidateVariableHandles();
+}
+
+const FSUDSValue* USUDSDialogue::FindVariable(const FSUDSVariableHandle& Handle) const
+{
+	if (Handle.IsGlobal())
+	{
+		if (bHasOwnGlobalVariables)
+		{
+			return OwnGlobalVariables.Get().Find(Handle.GetName());
+		}
+		if (auto Sub = GetSUDSSubsystem(GetWorld()))
+		{
+			return Sub->FindGlobalVariable(Handle);
+		}
+		return InternalGetGlobalVariables(GetWorld()).Find(Handle.GetName());
+	}
+	return Handle.Find(VariableState.Get(), VariableStateGeneration);
+}
+
+void USUDSDialogue::SetVariable(const FSUDSVariableHandle& Handle, const FSUDSValue& Value)
+{
+	if (Handle.IsGlobal())
+	{
+		if (bSilent)
+		{
+			SetGlobalVariableImpl(Handle.GetName(), Value, false, 0);
+		}
+		else if (auto Sub = GetSUDSSubsystem(GetWorld()))
+		{
+			Sub->SetGlobalVariable(Handle, Value);
+		}
+		else
+		{
+			InternalSetGlobalVariable(GetWorld(), Handle.GetName(), Value, false, 0);
+		}
+	}
+	else
+	{
+		SetVariableImpl(Handle.Find(VariableState.Get(), VariableStateGeneration), Handle.GetName(), Value, false, 0);
+	}
+}
+
+FSUDSValue USUDSDialogue::GetVariable(const FSUDSVariableHandle& Handle) const
+{
+	if (const auto Arg = FindVariable(Handle))
+	{
+		return *Arg;
+	}
+	return FSUDSValue();
 }
+
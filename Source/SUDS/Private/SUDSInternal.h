@@ -37,3 +37,76 @@ inline void InternalSetGlobalVariable(UWorld* WorldContext, FName Name, const FS
 	}
 }
 
+
+// Zig-zag encode so that small negative numbers are also small varints
+inline void InternalSerializePackedInt(FArchive& Ar, int32& Value)
+{
+	uint32 Packed = (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+	Ar.SerializeIntPacked(Packed);
+	if (Ar.IsLoading())
+		Value = static_cast<int32>((Packed >> 1) ^ (~(Packed & 1) + 1));
+}
+
+/// Compact binary serialisation of a value, used by compact & bulk saved state
+/// NameSerializer is called as (FArchive&, FName&) so callers can decide how to store names
+template <typename NameSerializerType>
+void InternalSerializeCompactValue(FArchive& Ar, FSUDSValue& Value, NameSerializerType&& NameSerializer)
+{
+	uint8 TypeAsInt = (uint8)Value.GetType();
+	Ar << TypeAsInt;
+	const ESUDSValueType Type = static_cast<ESUDSValueType>(TypeAsInt);
+
+	switch (Type)
+	{
+	case ESUDSValueType::Int:
+	case ESUDSValueType::Boolean:
+	case ESUDSValueType::Gender:
+		{
+			int32 IntVal = 0;
+			if (Ar.IsSaving())
+			{
+				IntVal = Type == ESUDSValueType::Int ? Value.GetIntValue()
+				       : Type == ESUDSValueType::Boolean ? (Value.GetBooleanValue() ? 1 : 0)
+				       : static_cast<int32>(Value.GetGenderValue());
+			}
+			InternalSerializePackedInt(Ar, IntVal);
+			if (Ar.IsLoading())
+			{
+				Value = Type == ESUDSValueType::Int ? FSUDSValue(IntVal)
+				      : Type == ESUDSValueType::Boolean ? FSUDSValue(IntVal != 0)
+				      : FSUDSValue(static_cast<ETextGender>(IntVal));
+			}
+			break;
+		}
+	case ESUDSValueType::Float:
+		{
+			float FloatVal = Ar.IsSaving() ? Value.GetFloatValue() : 0;
+			Ar << FloatVal;
+			if (Ar.IsLoading())
+				Value = FSUDSValue(FloatVal);
+			break;
+		}
+	case ESUDSValueType::Text:
+		{
+			FText Text = Ar.IsSaving() ? Value.GetTextValue() : FText::GetEmpty();
+			Ar << Text;
+			if (Ar.IsLoading())
+				Value = FSUDSValue(Text);
+			break;
+		}
+	case ESUDSValueType::Name:
+	case ESUDSValueType::Variable:
+		{
+			FName NameVal = Ar.IsSaving() ? Value.GetNameValue() : NAME_None;
+			NameSerializer(Ar, NameVal);
+			if (Ar.IsLoading())
+				Value = FSUDSValue(NameVal, Type == ESUDSValueType::Variable);
+			break;
+		}
+	default:
+	case ESUDSValueType::Empty:
+		if (Ar.IsLoading())
+			Value = FSUDSValue();
+		break;
+	}
+}
@@ -2,4 +2,11 @@
 // Released under the MIT license https://opensource.org/license/MIT/
 #include "SUDSParticipant.h"
 
-
+void ISUDSParticipant::OnDialogueVariablesRequested_Implementation(USUDSDialogue* Dialogue, const TArray<FName>& VariableNames)
+{
+	UObject* Self = _getUObject();
+	for (const FName& Name : VariableNames)
+	{
+		Execute_OnDialogueVariableRequested(Self, Dialogue, Name);
+	}
+}
@@ -3,10 +3,55 @@
 #include "SUDSScript.h"
 
 #include "SUDSScriptNode.h"
+#include "SUDSScriptNodeEvent.h"
 #include "SUDSScriptNodeGosub.h"
+#include "SUDSScriptNodeSet.h"
 #include "SUDSScriptNodeText.h"
 #include "EditorFramework/AssetImportData.h"
 
+/// Lock-free per-node counters, indexed the same as Nodes followed by HeaderNodes (see USUDSScriptNode::GetScriptIndex).
+/// The node list is filled before the counters are published and never changes afterwards, so it can be read from any
+/// thread
+struct FSUDSScriptExecutionCounters
+{
+	struct FCounter
+	{
+		std::atomic<uint64> Count { 0 };
+		std::atomic<uint64> Cycles { 0 };
+	};
+
+	TArray<const USUDSScriptNode*> IndexedNodes;
+	int32 NumBodyNodes = 0;
+	TUniquePtr<FCounter[]> Counters;
+
+	FSUDSScriptExecutionCounters(const TArray<USUDSScriptNode*>& Nodes, const TArray<USUDSScriptNode*>& HeaderNodes)
+	{
+		NumBodyNodes = Nodes.Num();
+		IndexedNodes.Append(Nodes);
+		IndexedNodes.Append(HeaderNodes);
+		Counters = MakeUnique<FCounter[]>(IndexedNodes.Num());
+	}
+};
+
+std::atomic<bool> USUDSScript::bExecutionStatsEnabled { false };
+
+void FSUDSScriptExecutionStats::GetLineStats(TMap<int, FSUDSNodeExecutionStats>& OutLineStats) const
+{
+	for (const auto& NodeStats : Nodes)
+	{
+		if (auto Existing = OutLineStats.Find(NodeStats.SourceLineNo))
+		{
+			// Nodes on the same line are reached together, so the line is as hot as its hottest node
+			Existing->ExecutionCount = FMath::Max(Existing->ExecutionCount, NodeStats.ExecutionCount);
+			Existing->TotalTimeMs += NodeStats.TotalTimeMs;
+		}
+		else
+		{
+			OutLineStats.Add(NodeStats.SourceLineNo, NodeStats);
+		}
+	}
+}
+
 void USUDSScript::StartImport(TArray<USUDSScriptNode*>** ppNodes,
                               TArray<USUDSScriptNode*>** ppHeaderNodes,
                               TMap<FName, int>** ppLabelList,
@@ -36,96 +81,159 @@ USUDSScriptNode* USUDSScript::GetNextNode(const USUDSScriptNode* Node) const
 }
 
 
-#define kChoiceFound 1
-#define kChoiceNotFoundBeforeText -1
-#define kChoiceNotFoundBeforeEnd 0 
+/// Flags for what can follow a node before the next text node
+#define kReachesChoice 1
+#define kReachesEndWithoutText 2
 
 
-bool USUDSScript::DoesAnyPathAfterLeadToChoice(USUDSScriptNode* FromNode)
+uint8 USUDSScript::GetChoiceReachFlags(const USUDSScriptNode* Node, const TMap<const USUDSScriptNode*, uint8>& Flags)
 {
-	// Look for any possible choice following a node (text or gosub)
-	// If it's possible to find a choice in one of the paths ahead, before another text node, the return true
-	// Given that there might be conditionals, not all paths might lead to a choice, but we only care if one of them does
-	// We recurse into conditional paths where they exist until we know.
-	// For a gosub this is looking for the next after a return, not inside the sub
-	USUDSScriptNode* CurrNode = GetNextNode(FromNode);
+	// Running off the end behaves the same as a return, it's up to the caller what happens next
+	if (!Node)
+		return kReachesEndWithoutText;
 
-	return RecurseLookForChoice(CurrNode) == kChoiceFound;
+	const uint8* pFlags = Flags.Find(Node);
+	return pFlags ? *pFlags : 0;
 }
 
-
-int USUDSScript::RecurseLookForChoice(USUDSScriptNode* CurrNode)
+uint8 USUDSScript::EvaluateChoiceReachFlags(const USUDSScriptNode* Node, const TMap<const USUDSScriptNode*, uint8>& Flags) const
 {
-	// Return int so that we can differentiate:
-	// 1  = we found a choice
-	// 0  = we didn't find a choice, but also didn't hit another text node (reached end, or gosub return)
-	// -1 = we hit a text node
-	while (CurrNode)
+	switch (Node->GetNodeType())
 	{
-		switch (CurrNode->GetNodeType())
+	case ESUDSScriptNodeType::Text:
+		// if we hit a text node, there was no choice
+		return 0;
+	case ESUDSScriptNodeType::Choice:
+		return kReachesChoice;
+	case ESUDSScriptNodeType::Select:
 		{
-		case ESUDSScriptNodeType::Text:
-			// if we hit a text node, there was no choice
-			return kChoiceNotFoundBeforeText;
-		case ESUDSScriptNodeType::Choice:
-			// we found a choice
-			return kChoiceFound;
-		case ESUDSScriptNodeType::Select:
+			// Any possible route counts
+			uint8 Result = 0;
+			bool bAnyRoute = false;
+			for (auto& Edge : Node->GetEdges())
 			{
-				// Explore all possible routes
-				int WorstResult = kChoiceNotFoundBeforeEnd;
-				for (auto& Edge : CurrNode->GetEdges())
+				auto TargetNode = Edge.GetTargetNode();
+				if (TargetNode.IsValid())
 				{
-					auto TargetNode = Edge.GetTargetNode();
-					if (TargetNode.IsValid())
-					{
-						const int ConditionalPath = RecurseLookForChoice(TargetNode.Get());
-						if (ConditionalPath == kChoiceFound)
-							return kChoiceFound;
-						WorstResult = FMath::Min(ConditionalPath, WorstResult);
-					}
+					Result |= GetChoiceReachFlags(TargetNode.Get(), Flags);
+					bAnyRoute = true;
 				}
-				return WorstResult;
 			}
-		case ESUDSScriptNodeType::Event:
-		case ESUDSScriptNodeType::SetVariable:
-			CurrNode = GetNextNode(CurrNode); 
-			break;
-		case ESUDSScriptNodeType::Gosub:
-			// When we hit a gosub here we go into it, not after it
-			if (auto GosubNode = Cast<USUDSScriptNodeGosub>(CurrNode))
+			return bAnyRoute ? Result : kReachesEndWithoutText;
+		}
+	case ESUDSScriptNodeType::Event:
+	case ESUDSScriptNodeType::SetVariable:
+		return GetChoiceReachFlags(GetNextNode(Node), Flags);
+	case ESUDSScriptNodeType::Gosub:
+		// When we hit a gosub here we go into it, and only carry on after it if the sub can return without text
+		if (auto GosubNode = Cast<USUDSScriptNodeGosub>(Node))
+		{
+			const uint8 SubFlags = GetChoiceReachFlags(GetNodeByLabel(GosubNode->GetLabelName()), Flags);
+			uint8 Result = SubFlags & kReachesChoice;
+			if (SubFlags & kReachesEndWithoutText)
+			{
+				Result |= GetChoiceReachFlags(GetNextNode(Node), Flags);
+			}
+			return Result;
+		}
+		return 0;
+	default: ;
+	case ESUDSScriptNodeType::Return:
+		// this is when we're exploring a sub for the choice
+		return kReachesEndWithoutText;
+	}
+}
+
+void USUDSScript::FindChoiceReachFlags(TMap<const USUDSScriptNode*, uint8>& OutFlags) const
+{
+	// Work out, for every node, whether a choice can be reached from it before another text node, and whether the end
+	// (or a return) can be. Loops and recursive subs mean a node's answer can depend on itself, so rather than caching
+	// answers part way through a search, we start every node at "nothing reachable" and keep re-evaluating nodes whose
+	// successors changed until nothing does. Flags are only ever added, so this always settles.
+	TMap<const USUDSScriptNode*, TArray<const USUDSScriptNode*>> Dependents;
+	Dependents.Reserve(Nodes.Num());
+	for (auto Node : Nodes)
+	{
+		for (auto& Edge : Node->GetEdges())
+		{
+			if (Edge.GetTargetNode().IsValid())
 			{
-				int SubResult = RecurseLookForChoice(GetNodeByLabel(GosubNode->GetLabelName()));
-				if (SubResult != 0)
-				{
-					// Found definitive result (choice or text) inside sub
-					return SubResult;
-				}
+				Dependents.FindOrAdd(Edge.GetTargetNode().Get()).Add(Node);
+			}
+		}
+		if (auto GosubNode = Cast<USUDSScriptNodeGosub>(Node))
+		{
+			if (const USUDSScriptNode* SubStart = GetNodeByLabel(GosubNode->GetLabelName()))
+			{
+				Dependents.FindOrAdd(SubStart).Add(Node);
 			}
-			// Otherwise, we didn't conclude within the sub, continue following it
-			CurrNode = GetNextNode(CurrNode);
-			break;
-		default: ;
-		case ESUDSScriptNodeType::Return:
-			// this is when we're exploring a sub for the choice
-			return kChoiceNotFoundBeforeEnd; 
-		};
+		}
 	}
 
-	return kChoiceNotFoundBeforeEnd;
+	OutFlags.Reset();
+	OutFlags.Reserve(Nodes.Num());
+	TArray<const USUDSScriptNode*> Pending(Nodes);
+	while (Pending.Num() > 0)
+	{
+		const USUDSScriptNode* Node = Pending.Pop();
+		const uint8 OldFlags = GetChoiceReachFlags(Node, OutFlags);
+		const uint8 NewFlags = OldFlags | EvaluateChoiceReachFlags(Node, OutFlags);
+		if (NewFlags != OldFlags)
+		{
+			OutFlags.Add(Node, NewFlags);
+			if (const auto pDependents = Dependents.Find(Node))
+			{
+				Pending.Append(*pDependents);
+			}
+		}
+	}
+}
+
+bool USUDSScript::DoesAnyPathAfterLeadToChoice(USUDSScriptNode* FromNode, const TMap<const USUDSScriptNode*, uint8>& Flags) const
+{
+	// Look for any possible choice following a node (text or gosub)
+	// If it's possible to find a choice in one of the paths ahead, before another text node, the return true
+	// Given that there might be conditionals, not all paths might lead to a choice, but we only care if one of them does
+	// For a gosub this is looking for the next after a return, not inside the sub
+	return (GetChoiceReachFlags(GetNextNode(FromNode), Flags) & kReachesChoice) != 0;
+}
+
+void USUDSScript::IndexNodes()
+{
+	for (int32 i = 0; i < Nodes.Num(); ++i)
+	{
+		if (Nodes[i])
+		{
+			Nodes[i]->SetScriptIndex(i);
+		}
+	}
+	for (int32 i = 0; i < HeaderNodes.Num(); ++i)
+	{
+		if (HeaderNodes[i])
+		{
+			HeaderNodes[i]->SetScriptIndex(Nodes.Num() + i);
+		}
+	}
 }
 
 void USUDSScript::FinishImport()
 {
+	// Nodes have changed, so any counters refer to the old ones
+	DiscardExecutionCounters();
+	IndexNodes();
+
 	// As an optimisation, make all text/gosub nodes pre-scan their follow-on nodes for choice nodes
 	// We can actually have intermediate nodes, for example set nodes which run for all choices that are placed
 	// between the text and the first choice. Resolve whether they exist now
+	// Reachability is worked out for all nodes at once, so each node is only evaluated a bounded number of times
+	TMap<const USUDSScriptNode*, uint8> ChoiceReachFlags;
+	FindChoiceReachFlags(ChoiceReachFlags);
 	for (auto Node : Nodes)
 	{
 		if (Node->GetNodeType() == ESUDSScriptNodeType::Text ||
 			Node->GetNodeType() == ESUDSScriptNodeType::Gosub)
 		{
-			if (DoesAnyPathAfterLeadToChoice(Node))
+			if (DoesAnyPathAfterLeadToChoice(Node, ChoiceReachFlags))
 			{
 				switch (Node->GetNodeType())
 				{
@@ -150,7 +258,84 @@ void USUDSScript::FinishImport()
 			}
 		}
 	}
-	
+
+	FindVariablesNeededNext();
+}
+
+void USUDSScript::FindVariablesNeededNext()
+{
+	// Work out which variables each speaker line might need before the next one, so that dialogues can ask for them
+	// all in one go rather than as each is used
+	for (auto Node : Nodes)
+	{
+		if (auto TextNode = Cast<USUDSScriptNodeText>(Node))
+		{
+			TSet<FName> Names;
+			TSet<const USUDSScriptNode*> Visited;
+			Names.Append(TextNode->GetParameterNames());
+			for (auto& Edge : TextNode->GetEdges())
+			{
+				GatherVariablesBeforeNextText(Edge.GetTargetNode().Get(), Names, Visited);
+			}
+			TextNode->SetVariablesNeededNext(Names.Array());
+		}
+	}
+	bHasVariablesNeededNext = true;
+}
+
+void USUDSScript::GatherVariablesBeforeNextText(const USUDSScriptNode* Node,
+                                                TSet<FName>& OutNames,
+                                                TSet<const USUDSScriptNode*>& Visited) const
+{
+	if (!Node || Visited.Contains(Node))
+	{
+		return;
+	}
+	Visited.Add(Node);
+
+	switch (Node->GetNodeType())
+	{
+	case ESUDSScriptNodeType::Text:
+	case ESUDSScriptNodeType::Return:
+		// The next line has its own set, and where a return goes depends on the call site
+		return;
+	case ESUDSScriptNodeType::SetVariable:
+		if (auto SetNode = Cast<USUDSScriptNodeSet>(Node))
+		{
+			OutNames.Append(SetNode->GetExpression().GetVariableNames());
+		}
+		break;
+	case ESUDSScriptNodeType::Event:
+		if (auto EvtNode = Cast<USUDSScriptNodeEvent>(Node))
+		{
+			for (auto& Expr : EvtNode->GetArgs())
+			{
+				OutNames.Append(Expr.GetVariableNames());
+			}
+		}
+		break;
+	case ESUDSScriptNodeType::Gosub:
+		if (auto GosubNode = Cast<USUDSScriptNodeGosub>(Node))
+		{
+			GatherVariablesBeforeNextText(GetNodeByLabel(GosubNode->GetLabelName()), OutNames, Visited);
+		}
+		break;
+	default:
+		break;
+	}
+
+	for (auto& Edge : Node->GetEdges())
+	{
+		if (Edge.GetCondition().IsValid())
+		{
+			OutNames.Append(Edge.GetCondition().GetVariableNames());
+		}
+		if (Edge.HasParameters())
+		{
+			OutNames.Append(Edge.GetParameterNames());
+		}
+		GatherVariablesBeforeNextText(Edge.GetTargetNode().Get(), OutNames, Visited);
+	}
 }
 
 USUDSScriptNode* USUDSScript::GetHeaderNode() const
@@ -202,7 +387,7 @@ USUDSScriptNodeGosub* USUDSScript::GetNodeByGosubID(const FString& ID) const
 {
 	for (auto N : Nodes)
 	{
-		if (N->GetNodeType() == ESUDSScriptNodeType::Text)
+		if (N->GetNodeType() == ESUDSScriptNodeType::Gosub)
 		{
 			if (auto GN = Cast<USUDSScriptNodeGosub>(N))
 			{
@@ -216,6 +401,80 @@ USUDSScriptNodeGosub* USUDSScript::GetNodeByGosubID(const FString& ID) const
 	return nullptr;
 }
 
+uint32 USUDSScript::GetIDHash(const FString& ID)
+{
+	// 0 is reserved for "no ID"
+	if (ID.IsEmpty())
+		return 0;
+	const uint32 Hash = FCrc::StrCrc32(*ID);
+	return Hash != 0 ? Hash : 1;
+}
+
+USUDSScriptNodeText* USUDSScript::GetNodeByTextIDHash(uint32 Hash) const
+{
+	if (Hash == 0)
+		return nullptr;
+	
+	for (auto N : Nodes)
+	{
+		if (N->GetNodeType() == ESUDSScriptNodeType::Text)
+		{
+			if (auto TN = Cast<USUDSScriptNodeText>(N))
+			{
+				if (GetIDHash(TN->GetTextID()) == Hash)
+				{
+					return TN;
+				}
+			}
+		}
+	}
+	return nullptr;
+}
+
+USUDSScriptNodeGosub* USUDSScript::GetNodeByGosubIDHash(uint32 Hash) const
+{
+	if (Hash == 0)
+		return nullptr;
+	
+	for (auto N : Nodes)
+	{
+		if (N->GetNodeType() == ESUDSScriptNodeType::Gosub)
+		{
+			if (auto GN = Cast<USUDSScriptNodeGosub>(N))
+			{
+				if (GetIDHash(GN->GetGosubID()) == Hash)
+				{
+					return GN;
+				}
+			}
+		}
+	}
+	return nullptr;
+}
+
+bool USUDSScript::GetChoiceTextIDByHash(uint32 Hash, FString& OutTextID) const
+{
+	if (Hash == 0)
+		return false;
+	
+	for (auto N : Nodes)
+	{
+		if (N->GetNodeType() == ESUDSScriptNodeType::Choice)
+		{
+			for (auto& Edge : N->GetEdges())
+			{
+				const FString TextID = Edge.GetTextID();
+				if (GetIDHash(TextID) == Hash)
+				{
+					OutTextID = TextID;
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
 UDialogueVoice* USUDSScript::GetSpeakerVoice(const FString& SpeakerID) const
 {
 	if (UDialogueVoice* const* pVoice = SpeakerVoices.Find(SpeakerID))
@@ -230,6 +489,119 @@ void USUDSScript::SetSpeakerVoice(const FString& SpeakerID, UDialogueVoice* Voic
 	SpeakerVoices.Add(SpeakerID, Voice);
 }
 
+FSUDSScriptExecutionCounters* USUDSScript::GetExecutionCounters() const
+{
+	FSUDSScriptExecutionCounters* Counters = ExecutionCounters.load(std::memory_order_acquire);
+	if (!Counters)
+	{
+		// Another thread might be doing the same thing, whoever publishes first wins
+		FSUDSScriptExecutionCounters* NewCounters = new FSUDSScriptExecutionCounters(Nodes, HeaderNodes);
+		if (ExecutionCounters.compare_exchange_strong(Counters, NewCounters, std::memory_order_acq_rel))
+		{
+			Counters = NewCounters;
+		}
+		else
+		{
+			delete NewCounters;
+		}
+	}
+	return Counters;
+}
+
+void USUDSScript::DiscardExecutionCounters()
+{
+	check(IsInGameThread());
+	// Dialogues on other threads may still be recording into the old counters, so they're only retired here, and
+	// freed once nothing can be running this script any more
+	if (FSUDSScriptExecutionCounters* Counters = ExecutionCounters.exchange(nullptr, std::memory_order_acq_rel))
+	{
+		RetiredExecutionCounters.Add(Counters);
+	}
+}
+
+void USUDSScript::RecordNodeExecution(const USUDSScriptNode* Node, uint64 Cycles) const
+{
+	const FSUDSScriptExecutionCounters* Counters = GetExecutionCounters();
+	// A node left over from before a reimport can have an index that's now someone else's
+	const int32 Index = Node->GetScriptIndex();
+	if (Counters->IndexedNodes.IsValidIndex(Index) && Counters->IndexedNodes[Index] == Node)
+	{
+		auto& Counter = Counters->Counters[Index];
+		Counter.Count.fetch_add(1, std::memory_order_relaxed);
+		if (Cycles)
+		{
+			Counter.Cycles.fetch_add(Cycles, std::memory_order_relaxed);
+		}
+	}
+}
+
+FSUDSScriptExecutionStats USUDSScript::GetExecutionStats() const
+{
+	FSUDSScriptExecutionStats Stats;
+	if (const FSUDSScriptExecutionCounters* Counters = ExecutionCounters.load(std::memory_order_acquire))
+	{
+		for (int32 i = 0; i < Counters->IndexedNodes.Num(); ++i)
+		{
+			const uint64 Count = Counters->Counters[i].Count.load(std::memory_order_relaxed);
+			if (Count == 0)
+			{
+				continue;
+			}
+			const USUDSScriptNode* Node = Counters->IndexedNodes[i];
+			FSUDSNodeExecutionStats& NodeStats = Stats.Nodes.AddDefaulted_GetRef();
+			NodeStats.SourceLineNo = Node->GetSourceLineNo();
+			NodeStats.NodeType = Node->GetNodeType();
+			NodeStats.bHeader = i >= Counters->NumBodyNodes;
+			NodeStats.ExecutionCount = static_cast<int64>(Count);
+			NodeStats.TotalTimeMs = FPlatformTime::ToMilliseconds64(Counters->Counters[i].Cycles.load(std::memory_order_relaxed));
+		}
+	}
+	return Stats;
+}
+
+void USUDSScript::ResetExecutionStats()
+{
+	// Zero in place rather than discarding, dialogues may be recording on other threads
+	if (FSUDSScriptExecutionCounters* Counters = ExecutionCounters.load(std::memory_order_acquire))
+	{
+		for (int32 i = 0; i < Counters->IndexedNodes.Num(); ++i)
+		{
+			Counters->Counters[i].Count.store(0, std::memory_order_relaxed);
+			Counters->Counters[i].Cycles.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+void USUDSScript::PostLoad()
+{
+	Super::PostLoad();
+	IndexNodes();
+	if (!bHasVariablesNeededNext)
+	{
+		// Imported before this was worked out on import; it only depends on the nodes, so there's no need to reimport
+		for (auto Node : Nodes)
+		{
+			if (Node)
+			{
+				Node->ConditionalPostLoad();
+			}
+		}
+		FindVariablesNeededNext();
+	}
+}
+
+void USUDSScript::BeginDestroy()
+{
+	// Dialogues keep their script alive, so nothing can be recording now
+	delete ExecutionCounters.exchange(nullptr, std::memory_order_acq_rel);
+	for (FSUDSScriptExecutionCounters* Counters : RetiredExecutionCounters)
+	{
+		delete Counters;
+	}
+	RetiredExecutionCounters.Empty();
+	Super::BeginDestroy();
+}
+
 #if WITH_EDITORONLY_DATA
 
 void USUDSScript::PostInitProperties()
@@ -10,6 +10,8 @@ void USUDSScriptNodeText::Init(const FString& InSpeakerID, const FText& InText,
 	TextFormat = Text;
 	SourceLineNo = LineNo;
 	bFormatExtracted = false;
+	bHasChoices = false;
+	VariablesNeededNext.Empty();
 	
 }
 
@@ -1,10 +1,20 @@
 ﻿// Copyright Steve Streeting 2022
 // Released under the MIT license https://opensource.org/license/MIT/
 #include "SUDSSubsystem.h"
+#include "SUDSDialogue.h"
+#include "SUDSInternal.h"
+#include "SUDSScript.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 #include "Sound/SoundConcurrency.h"
 
 DEFINE_LOG_CATEGORY(LogSUDSSubsystem)
 
+DEFINE_STAT(STAT_SUDS_SchedulerTime);
+DEFINE_STAT(STAT_SUDS_ScheduledDialogues);
+DEFINE_STAT(STAT_SUDS_SchedulerAdvances);
+DEFINE_STAT(STAT_SUDS_SchedulerDeferred);
+
 #if WITH_EDITORONLY_DATA
 	TMap<FName, FSUDSValue> USUDSSubsystem::Test_DummyGlobalVariables;
 #endif
@@ -16,10 +26,17 @@ void USUDSSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	// Default to a single voice line being played at once
 	VoiceConcurrency = NewObject<USoundConcurrency>(this);
 	VoiceConcurrency->Concurrency.MaxCount = 1;
+
+	// Vary random per session unless a master seed is set explicitly
+	MasterRandomSeed = static_cast<int32>(FPlatformTime::Cycles());
+	SchedulerRandom.Initialize(MasterRandomSeed);
 }
 
 void USUDSSubsystem::Deinitialize()
 {
+	ScheduledDialogues.Empty();
+	SET_DWORD_STAT(STAT_SUDS_ScheduledDialogues, 0);
+
 	Super::Deinitialize();
 }
 
@@ -63,7 +80,10 @@ const FSoundConcurrencySettings& USUDSSubsystem::GetVoicedLineConcurrencySetting
 void USUDSSubsystem::ResetGlobalState(bool bResetVariables)
 {
 	if (bResetVariables)
+	{
 		GlobalVariableState.Empty();
+		InvalidateGlobalVariableHandles();
+	}
 }
 
 FSUDSGlobalState USUDSSubsystem::GetSavedGlobalState() const
@@ -75,12 +95,543 @@ void USUDSSubsystem::RestoreSavedGlobalState(const FSUDSGlobalState& State)
 {
 	ResetGlobalState();
 	GlobalVariableState.Append(State.GetGlobalVariables());
+	InvalidateGlobalVariableHandles();
 }
 
+void USUDSSubsystem::RegisterDialogue(FName Key, USUDSDialogue* Dialogue)
+{
+	if (!IsValid(Dialogue))
+	{
+		UE_LOG(LogSUDSSubsystem, Error, TEXT("Tried to register invalid dialogue with key %s"), *Key.ToString());
+		return;
+	}
+	RegisteredDialogues.Add(Key, Dialogue);
 
-FText USUDSSubsystem::GetGlobalVariableText(FName Name) const
+	FSUDSDialogueState PendingState;
+	if (PendingDialogueStates.RemoveAndCopyValue(Key, PendingState))
+	{
+		Dialogue->RestoreSavedState(PendingState);
+	}
+}
+
+void USUDSSubsystem::UnregisterDialogue(FName Key)
+{
+	RegisteredDialogues.Remove(Key);
+}
+
+USUDSDialogue* USUDSSubsystem::GetRegisteredDialogue(FName Key) const
+{
+	if (auto pDlg = RegisteredDialogues.Find(Key))
+	{
+		return pDlg->Get();
+	}
+	return nullptr;
+}
+
+void USUDSSubsystem::GetRegisteredDialogues(TMap<FName, USUDSDialogue*>& OutDialogues) const
+{
+	OutDialogues.Empty(RegisteredDialogues.Num());
+	for (auto& Pair : RegisteredDialogues)
+	{
+		if (USUDSDialogue* Dlg = Pair.Value.Get())
+		{
+			OutDialogues.Add(Pair.Key, Dlg);
+		}
+	}
+}
+
+FSUDSScriptExecutionStats USUDSSubsystem::GetScriptExecutionStats(const USUDSScript* Script) const
+{
+	if (IsValid(Script))
+	{
+		return Script->GetExecutionStats();
+	}
+	return FSUDSScriptExecutionStats();
+}
+
+void USUDSSubsystem::GetAllScriptExecutionStats(TMap<const USUDSScript*, FSUDSScriptExecutionStats>& OutStats) const
+{
+	OutStats.Reset();
+	for (TObjectIterator<USUDSScript> It; It; ++It)
+	{
+		FSUDSScriptExecutionStats Stats = It->GetExecutionStats();
+		if (Stats.Nodes.Num() > 0)
+		{
+			OutStats.Add(*It, MoveTemp(Stats));
+		}
+	}
+}
+
+void USUDSSubsystem::ResetAllScriptExecutionStats()
+{
+	for (TObjectIterator<USUDSScript> It; It; ++It)
+	{
+		It->ResetExecutionStats();
+	}
+}
+
+void USUDSSubsystem::ScheduleDialogue(USUDSDialogue* Dialogue, const FSUDSAutoAdvancePolicy& Policy)
+{
+	if (!IsValid(Dialogue))
+	{
+		return;
+	}
+
+	if (Dialogue->IsEnded())
+	{
+		Dialogue->Start();
+	}
+
+	FScheduledDialogue* Entry = ScheduledDialogues.FindByPredicate([Dialogue](const FScheduledDialogue& E)
+	{
+		return E.Dialogue.Get() == Dialogue;
+	});
+	if (!Entry)
+	{
+		Entry = &ScheduledDialogues.AddDefaulted_GetRef();
+		Entry->Dialogue = Dialogue;
+	}
+	Entry->Policy = Policy;
+	Entry->DueTime = SchedulerTime + Policy.LineDelay;
+	Entry->FramesDeferred = 0;
+
+	SET_DWORD_STAT(STAT_SUDS_ScheduledDialogues, ScheduledDialogues.Num());
+}
+
+void USUDSSubsystem::UnscheduleDialogue(USUDSDialogue* Dialogue)
+{
+	if (bSchedulerTicking)
+	{
+		// Can't change the array while it's being processed, invalid entries are removed at the end of the tick
+		for (auto& Entry : ScheduledDialogues)
+		{
+			if (Entry.Dialogue.Get() == Dialogue)
+			{
+				Entry.Dialogue.Reset();
+			}
+		}
+	}
+	else
+	{
+		ScheduledDialogues.RemoveAll([Dialogue](const FScheduledDialogue& E)
+		{
+			return E.Dialogue.Get() == Dialogue;
+		});
+		SET_DWORD_STAT(STAT_SUDS_ScheduledDialogues, ScheduledDialogues.Num());
+	}
+}
+
+bool USUDSSubsystem::IsDialogueScheduled(const USUDSDialogue* Dialogue) const
+{
+	return IsValid(Dialogue) && ScheduledDialogues.ContainsByPredicate([Dialogue](const FScheduledDialogue& E)
+	{
+		return E.Dialogue.Get() == Dialogue;
+	});
+}
+
+FSUDSSchedulerStats USUDSSubsystem::GetSchedulerStats() const
+{
+	FSUDSSchedulerStats Ret = SchedulerStats;
+	Ret.NumScheduled = ScheduledDialogues.Num();
+	return Ret;
+}
+
+bool USUDSSubsystem::AdvanceScheduledDialogue(int32 Index)
+{
+	// Advancing can call out to participants & events which schedule other dialogues, so we can't hold on to a
+	// reference to the entry across calls to the dialogue
+	const FSUDSAutoAdvancePolicy Policy = ScheduledDialogues[Index].Policy;
+	USUDSDialogue* Dialogue = ScheduledDialogues[Index].Dialogue.Get();
+	if (!IsValid(Dialogue))
+	{
+		return false;
+	}
+
+	if (Dialogue->IsEnded())
+	{
+		// Only happens when restarting, or if something else ended the dialogue
+		if (!Policy.bRestartWhenFinished)
+		{
+			return false;
+		}
+		Dialogue->Restart();
+	}
+	else if (Dialogue->IsSimpleContinue())
+	{
+		Dialogue->Continue();
+	}
+	else
+	{
+		const int NumChoices = Dialogue->GetNumberOfChoices();
+		const int Choice = Policy.ChoiceMode == ESUDSAutoChoiceMode::Random ? SchedulerRandom.RandHelper(NumChoices) : 0;
+		Dialogue->Choose(Choice);
+	}
+
+	if (Dialogue->IsEnded() && !Policy.bRestartWhenFinished)
+	{
+		return false;
+	}
+
+	FScheduledDialogue& Entry = ScheduledDialogues[Index];
+	Entry.DueTime = SchedulerTime + Policy.LineDelay;
+	Entry.FramesDeferred = 0;
+	return true;
+}
+
+void USUDSSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SUDS_SchedulerTime);
+
+	SchedulerTime += DeltaTime;
+	const double StartTime = FPlatformTime::Seconds();
+
+	TArray<int32, TInlineAllocator<32>> Due;
+	for (int32 i = 0; i < ScheduledDialogues.Num(); ++i)
+	{
+		const FScheduledDialogue& Entry = ScheduledDialogues[i];
+		// Dialogues waiting for async variables will carry on by themselves, pick them up again afterwards
+		if (Entry.Dialogue.IsValid() && Entry.DueTime <= SchedulerTime && !Entry.Dialogue->IsWaitingForAsyncVariables())
+		{
+			Due.Add(i);
+		}
+	}
+
+	// Higher priority first, but anything that's been deferred gains priority for every frame it's been waiting so
+	// that low priority dialogues can't be starved forever. Ties go to whichever has been due the longest.
+	Due.StableSort([this](int32 A, int32 B)
+	{
+		const FScheduledDialogue& EA = ScheduledDialogues[A];
+		const FScheduledDialogue& EB = ScheduledDialogues[B];
+		const int32 PA = EA.Policy.Priority + EA.FramesDeferred;
+		const int32 PB = EB.Policy.Priority + EB.FramesDeferred;
+		if (PA != PB)
+		{
+			return PA > PB;
+		}
+		return EA.DueTime < EB.DueTime;
+	});
+
+	bSchedulerTicking = true;
+	int32 NumAdvanced = 0;
+	int32 NumDeferred = 0;
+	for (int32 d = 0; d < Due.Num(); ++d)
+	{
+		// Always advance at least one so that progress is made whatever the budget
+		if (NumAdvanced > 0 && (FPlatformTime::Seconds() - StartTime) * 1000.0 >= SchedulerFrameBudgetMs)
+		{
+			NumDeferred = Due.Num() - d;
+			for (; d < Due.Num(); ++d)
+			{
+				FScheduledDialogue& Entry = ScheduledDialogues[Due[d]];
+				++Entry.FramesDeferred;
+				SchedulerStats.MaxFramesDeferred = FMath::Max(SchedulerStats.MaxFramesDeferred, Entry.FramesDeferred);
+			}
+			break;
+		}
+
+		if (!AdvanceScheduledDialogue(Due[d]))
+		{
+			ScheduledDialogues[Due[d]].Dialogue.Reset();
+		}
+		++NumAdvanced;
+	}
+	bSchedulerTicking = false;
+
+	ScheduledDialogues.RemoveAll([](const FScheduledDialogue& E)
+	{
+		return !E.Dialogue.IsValid();
+	});
+
+	SchedulerStats.NumScheduled = ScheduledDialogues.Num();
+	SchedulerStats.NumAdvancedLastFrame = NumAdvanced;
+	SchedulerStats.NumDeferredLastFrame = NumDeferred;
+	SchedulerStats.TotalDeferred += NumDeferred;
+	SchedulerStats.LastFrameTimeMs = static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	SET_DWORD_STAT(STAT_SUDS_ScheduledDialogues, ScheduledDialogues.Num());
+	INC_DWORD_STAT_BY(STAT_SUDS_SchedulerAdvances, NumAdvanced);
+	INC_DWORD_STAT_BY(STAT_SUDS_SchedulerDeferred, NumDeferred);
+	CSV_CUSTOM_STAT(SUDS, SchedulerAdvances, NumAdvanced, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(SUDS, SchedulerDeferred, NumDeferred, ECsvCustomStatOp::Set);
+}
+
+ETickableTickType USUDSSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool USUDSSubsystem::IsTickable() const
+{
+	return !ScheduledDialogues.IsEmpty();
+}
+
+TStatId USUDSSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USUDSSubsystem, STATGROUP_Tickables);
+}
+
+/// Version of the bulk binary layout, bump if it changes
+static constexpr uint8 BulkStateVersion = 3;
+/// First bulk version which includes each dialogue's random seed
+static constexpr uint8 BulkStateRandomSeedVersion = 2;
+/// First bulk version which records whether each dialogue had a random seed to save
+static constexpr uint8 BulkStateHasRandomSeedVersion = 3;
+
+/// Text IDs are case sensitive, so interning must be too (default FString keys are not)
+struct FSUDSCaseSensitiveStringKeyFuncs : TDefaultMapKeyFuncs<FString, int32, false>
+{
+	static FORCEINLINE bool Matches(const FString& A, const FString& B)
+	{
+		return A.Equals(B, ESearchCase::CaseSensitive);
+	}
+	static FORCEINLINE uint32 GetKeyHash(const FString& Key)
+	{
+		return FCrc::StrCrc32(*Key);
+	}
+};
+
+/// Serialize a packed element count. When loading, a count that couldn't fit in the rest of the data, given each
+/// element takes at least MinElementSize bytes, means the data is corrupt; flag an error instead of allocating for it
+static void SerializeBulkCount(FArchive& Ar, uint32& Count, int64 MinElementSize)
+{
+	Ar.SerializeIntPacked(Count);
+	if (Ar.IsLoading() &&
+		(Ar.IsError() || static_cast<int64>(Count) * MinElementSize > Ar.TotalSize() - Ar.Tell()))
+	{
+		Ar.SetError();
+		Count = 0;
+	}
+}
+
+/// Shared string table for bulk state; every string is stored once, and referenced by index
+struct FSUDSBulkStringTable
+{
+	TArray<FString> Strings;
+	TMap<FString, int32, FDefaultSetAllocator, FSUDSCaseSensitiveStringKeyFuncs> Lookup;
+
+	void Serialize(FArchive& Ar, FString& Str)
+	{
+		uint32 Index = 0;
+		if (Ar.IsSaving())
+		{
+			if (const int32* pIdx = Lookup.Find(Str))
+			{
+				Index = *pIdx;
+			}
+			else
+			{
+				Index = Strings.Add(Str);
+				Lookup.Add(Str, Index);
+			}
+		}
+		Ar.SerializeIntPacked(Index);
+		if (Ar.IsLoading())
+		{
+			if (Strings.IsValidIndex(Index))
+			{
+				Str = Strings[Index];
+			}
+			else
+			{
+				Ar.SetError();
+			}
+		}
+	}
+
+	void Serialize(FArchive& Ar, FName& Name)
+	{
+		FString Str = Ar.IsSaving() ? Name.ToString() : FString();
+		Serialize(Ar, Str);
+		if (Ar.IsLoading())
+			Name = FName(Str);
+	}
+
+	void SerializeVariables(FArchive& Ar, TMap<FName, FSUDSValue>& Vars)
+	{
+		auto NameSerializer = [this](FArchive& InAr, FName& Name) { Serialize(InAr, Name); };
+		uint32 Count = Vars.Num();
+		// At least a name index & a value type each
+		SerializeBulkCount(Ar, Count, 2);
+		if (Ar.IsLoading())
+		{
+			Vars.Empty(Count);
+			for (uint32 i = 0; i < Count && !Ar.IsError(); ++i)
+			{
+				FName Name;
+				FSUDSValue Value;
+				Serialize(Ar, Name);
+				InternalSerializeCompactValue(Ar, Value, NameSerializer);
+				Vars.Add(Name, Value);
+			}
+		}
+		else
+		{
+			for (auto& Pair : Vars)
+			{
+				FName Name = Pair.Key;
+				Serialize(Ar, Name);
+				InternalSerializeCompactValue(Ar, Pair.Value, NameSerializer);
+			}
+		}
+	}
+
+	void SerializeStrings(FArchive& Ar, TArray<FString>& InStrings)
+	{
+		uint32 Count = InStrings.Num();
+		SerializeBulkCount(Ar, Count, 1);
+		if (Ar.IsLoading())
+			InStrings.SetNum(Count);
+		for (FString& Str : InStrings)
+		{
+			Serialize(Ar, Str);
+		}
+	}
+};
+
+FSUDSBulkState USUDSSubsystem::GetSavedBulkState() const
+{
+	// Collect states; live dialogues, plus any restored states still waiting for their dialogue to register
+	TMap<FName, FSUDSDialogueState> States = PendingDialogueStates;
+	for (auto& Pair : RegisteredDialogues)
+	{
+		if (const USUDSDialogue* Dlg = Pair.Value.Get())
+		{
+			States.Add(Pair.Key, Dlg->GetSavedState());
+		}
+	}
+
+	// Write the body first so we know all the strings, then write the string table ahead of it
+	FSUDSBulkStringTable StringTable;
+	TArray<uint8> Body;
+	FMemoryWriter BodyWriter(Body);
+
+	TMap<FName, FSUDSValue> Globals = GlobalVariableState;
+	StringTable.SerializeVariables(BodyWriter, Globals);
+
+	uint32 DialogueCount = States.Num();
+	BodyWriter.SerializeIntPacked(DialogueCount);
+	for (auto& Pair : States)
+	{
+		FName Key = Pair.Key;
+		FString TextNodeID = Pair.Value.GetTextNodeID();
+		TMap<FName, FSUDSValue> Vars = Pair.Value.GetVariables();
+		TArray<FString> Choices = Pair.Value.GetChoicesTaken();
+		TArray<FString> ReturnStack = Pair.Value.GetReturnStack();
+		StringTable.Serialize(BodyWriter, Key);
+		StringTable.Serialize(BodyWriter, TextNodeID);
+		StringTable.SerializeVariables(BodyWriter, Vars);
+		StringTable.SerializeStrings(BodyWriter, Choices);
+		StringTable.SerializeStrings(BodyWriter, ReturnStack);
+		// States restored from old saves which haven't reached their dialogue yet don't have one
+		uint8 bHasRandomSeed = Pair.Value.HasRandomSeed() ? 1 : 0;
+		BodyWriter << bHasRandomSeed;
+		if (bHasRandomSeed)
+		{
+			int32 RandomSeed = Pair.Value.GetRandomSeed();
+			BodyWriter << RandomSeed;
+		}
+	}
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	uint8 Version = BulkStateVersion;
+	Writer << Version;
+	uint32 StringCount = StringTable.Strings.Num();
+	Writer.SerializeIntPacked(StringCount);
+	for (FString& Str : StringTable.Strings)
+	{
+		Writer << Str;
+	}
+	Writer.Serialize(Body.GetData(), Body.Num());
+
+	return FSUDSBulkState(MoveTemp(Data));
+}
+
+bool USUDSSubsystem::RestoreSavedBulkState(const FSUDSBulkState& State)
+{
+	if (State.IsEmpty())
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(State.GetData());
+	uint8 Version = 0;
+	Reader << Version;
+	if (Version == 0 || Version > BulkStateVersion)
+	{
+		UE_LOG(LogSUDSSubsystem, Error, TEXT("Unsupported bulk state version %d"), Version);
+		return false;
+	}
+
+	FSUDSBulkStringTable StringTable;
+	uint32 StringCount = 0;
+	// Every string has at least its length
+	SerializeBulkCount(Reader, StringCount, sizeof(int32));
+	StringTable.Strings.SetNum(StringCount);
+	for (FString& Str : StringTable.Strings)
+	{
+		Reader << Str;
+	}
+
+	// Read everything before applying anything, so a bad block doesn't leave us half restored
+	TMap<FName, FSUDSValue> Globals;
+	StringTable.SerializeVariables(Reader, Globals);
+
+	TMap<FName, FSUDSDialogueState> States;
+	uint32 DialogueCount = 0;
+	// Key, text node & 3 counts at least
+	SerializeBulkCount(Reader, DialogueCount, 5);
+	for (uint32 i = 0; i < DialogueCount && !Reader.IsError(); ++i)
+	{
+		FName Key;
+		FString TextNodeID;
+		TMap<FName, FSUDSValue> Vars;
+		TArray<FString> Choices;
+		TArray<FString> ReturnStack;
+		StringTable.Serialize(Reader, Key);
+		StringTable.Serialize(Reader, TextNodeID);
+		StringTable.SerializeVariables(Reader, Vars);
+		StringTable.SerializeStrings(Reader, Choices);
+		StringTable.SerializeStrings(Reader, ReturnStack);
+		uint8 bHasRandomSeed = Version >= BulkStateRandomSeedVersion ? 1 : 0;
+		if (Version >= BulkStateHasRandomSeedVersion)
+		{
+			Reader << bHasRandomSeed;
+		}
+		TOptional<int32> RandomSeed;
+		if (bHasRandomSeed)
+		{
+			Reader << RandomSeed.Emplace();
+		}
+		States.Add(Key, FSUDSDialogueState(TextNodeID, Vars, TSet<FString>(Choices), ReturnStack, RandomSeed));
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogSUDSSubsystem, Error, TEXT("Bulk state data was corrupt, not restoring"));
+		return false;
+	}
+
+	RestoreSavedGlobalState(FSUDSGlobalState(Globals));
+	PendingDialogueStates.Empty();
+	for (auto& Pair : States)
+	{
+		if (USUDSDialogue* Dlg = GetRegisteredDialogue(Pair.Key))
+		{
+			Dlg->RestoreSavedState(Pair.Value);
+		}
+		else
+		{
+			PendingDialogueStates.Add(Pair.Key, MoveTemp(Pair.Value));
+		}
+	}
+	return true;
+}
+
+
+static FText GetGlobalVariableTextImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = GlobalVariableState.Find(Name))
+	if (Arg)
 	{
 		if (Arg->GetType() == ESUDSValueType::Text)
 		{
@@ -94,14 +645,24 @@ FText USUDSSubsystem::GetGlobalVariableText(FName Name) const
 	return FText();
 }
 
+FText USUDSSubsystem::GetGlobalVariableText(FName Name) const
+{
+	return GetGlobalVariableTextImpl(GlobalVariableState.Find(Name), Name);
+}
+
+FText USUDSSubsystem::GetGlobalVariableText(const FSUDSVariableHandle& Handle) const
+{
+	return GetGlobalVariableTextImpl(FindGlobalVariable(Handle), Handle.GetName());
+}
+
 void USUDSSubsystem::SetGlobalVariableInt(FName Name, int32 Value)
 {
 	SetGlobalVariable(Name, Value);
 }
 
-int USUDSSubsystem::GetGlobalVariableInt(FName Name) const
+static int GetGlobalVariableIntImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = GlobalVariableState.Find(Name))
+	if (Arg)
 	{
 		switch (Arg->GetType())
 		{
@@ -119,14 +680,24 @@ int USUDSSubsystem::GetGlobalVariableInt(FName Name) const
 	return 0;
 }
 
+int USUDSSubsystem::GetGlobalVariableInt(FName Name) const
+{
+	return GetGlobalVariableIntImpl(GlobalVariableState.Find(Name), Name);
+}
+
+int USUDSSubsystem::GetGlobalVariableInt(const FSUDSVariableHandle& Handle) const
+{
+	return GetGlobalVariableIntImpl(FindGlobalVariable(Handle), Handle.GetName());
+}
+
 void USUDSSubsystem::SetGlobalVariableFloat(FName Name, float Value)
 {
 	SetGlobalVariable(Name, Value);
 }
 
-float USUDSSubsystem::GetGlobalVariableFloat(FName Name) const
+static float GetGlobalVariableFloatImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = GlobalVariableState.Find(Name))
+	if (Arg)
 	{
 		switch (Arg->GetType())
 		{
@@ -143,14 +714,24 @@ float USUDSSubsystem::GetGlobalVariableFloat(FName Name) const
 	return 0;
 }
 
+float USUDSSubsystem::GetGlobalVariableFloat(FName Name) const
+{
+	return GetGlobalVariableFloatImpl(GlobalVariableState.Find(Name), Name);
+}
+
+float USUDSSubsystem::GetGlobalVariableFloat(const FSUDSVariableHandle& Handle) const
+{
+	return GetGlobalVariableFloatImpl(FindGlobalVariable(Handle), Handle.GetName());
+}
+
 void USUDSSubsystem::SetGlobalVariableGender(FName Name, ETextGender Value)
 {
 	SetGlobalVariable(Name, Value);
 }
 
-ETextGender USUDSSubsystem::GetGlobalVariableGender(FName Name) const
+static ETextGender GetGlobalVariableGenderImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = GlobalVariableState.Find(Name))
+	if (Arg)
 	{
 		switch (Arg->GetType())
 		{
@@ -166,15 +747,25 @@ ETextGender USUDSSubsystem::GetGlobalVariableGender(FName Name) const
 	return ETextGender::Neuter;
 }
 
+ETextGender USUDSSubsystem::GetGlobalVariableGender(FName Name) const
+{
+	return GetGlobalVariableGenderImpl(GlobalVariableState.Find(Name), Name);
+}
+
+ETextGender USUDSSubsystem::GetGlobalVariableGender(const FSUDSVariableHandle& Handle) const
+{
+	return GetGlobalVariableGenderImpl(FindGlobalVariable(Handle), Handle.GetName());
+}
+
 void USUDSSubsystem::SetGlobalVariableBoolean(FName Name, bool Value)
 {
 	// Use explicit FSUDSValue constructor to avoid default int conversion
 	SetGlobalVariable(Name, FSUDSValue(Value));
 }
 
-bool USUDSSubsystem::GetGlobalVariableBoolean(FName Name) const
+static bool GetGlobalVariableBooleanImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = GlobalVariableState.Find(Name))
+	if (Arg)
 	{
 		switch (Arg->GetType())
 		{
@@ -192,14 +783,24 @@ bool USUDSSubsystem::GetGlobalVariableBoolean(FName Name) const
 	return false;
 }
 
+bool USUDSSubsystem::GetGlobalVariableBoolean(FName Name) const
+{
+	return GetGlobalVariableBooleanImpl(GlobalVariableState.Find(Name), Name);
+}
+
+bool USUDSSubsystem::GetGlobalVariableBoolean(const FSUDSVariableHandle& Handle) const
+{
+	return GetGlobalVariableBooleanImpl(FindGlobalVariable(Handle), Handle.GetName());
+}
+
 void USUDSSubsystem::SetGlobalVariableName(FName Name, FName Value)
 {
 	SetGlobalVariable(Name, FSUDSValue(Value, false));
 }
 
-FName USUDSSubsystem::GetGlobalVariableName(FName Name) const
+static FName GetGlobalVariableNameImpl(const FSUDSValue* Arg, FName Name)
 {
-	if (const auto Arg = GlobalVariableState.Find(Name))
+	if (Arg)
 	{
 		if (Arg->GetType() == ESUDSValueType::Name)
 		{
@@ -213,7 +814,18 @@ FName USUDSSubsystem::GetGlobalVariableName(FName Name) const
 	return NAME_None;
 }
 
+FName USUDSSubsystem::GetGlobalVariableName(FName Name) const
+{
+	return GetGlobalVariableNameImpl(GlobalVariableState.Find(Name), Name);
+}
+
+FName USUDSSubsystem::GetGlobalVariableName(const FSUDSVariableHandle& Handle) const
+{
+	return GetGlobalVariableNameImpl(FindGlobalVariable(Handle), Handle.GetName());
+}
+
 void USUDSSubsystem::UnSetGlobalVariable(FName Name)
 {
 	GlobalVariableState.Remove(Name);
+	InvalidateGlobalVariableHandles();
 }
@@ -0,0 +1,16 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#include "SUDSTrace.h"
+
+#if SUDS_TRACE_ENABLED
+
+#include "SUDSScript.h"
+
+UE_TRACE_CHANNEL_DEFINE(SUDSChannel)
+
+FString InternalTraceScopeName(const TCHAR* ScopeName, const USUDSScript* Script, int LineNo)
+{
+	return FString::Printf(TEXT("SUDS::%s %s:%d"), ScopeName, Script ? *Script->GetName() : TEXT(""), LineNo);
+}
+
+#endif
@@ -0,0 +1,39 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+class USUDSScript;
+
+// Dialogue execution can be profiled in Unreal Insights by enabling the "SUDS" trace channel, e.g. -trace=cpu,suds
+// None of this is compiled into shipping builds
+#define SUDS_TRACE_ENABLED (UE_TRACE_ENABLED && CPUPROFILERTRACE_ENABLED && !UE_BUILD_SHIPPING)
+
+#if SUDS_TRACE_ENABLED
+
+UE_TRACE_CHANNEL_EXTERN(SUDSChannel)
+
+/// Build the name of a SUDS CPU scope, "SUDS::<Name> <Script>:<LineNo>"
+FString InternalTraceScopeName(const TCHAR* ScopeName, const USUDSScript* Script, int LineNo);
+
+/// Open a CPU scope named SUDS::<Name> <Script>:<LineNo> for the rest of the enclosing block
+/// The name is only built when the channel is enabled
+#define SUDS_TRACE_SCOPE(Name, Script, LineNo) \
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL( \
+		UE_TRACE_CHANNELEXPR_IS_ENABLED(SUDSChannel) ? *InternalTraceScopeName(TEXT(#Name), Script, LineNo) : TEXT("SUDS::" #Name), \
+		SUDSChannel)
+
+#define SUDS_TRACE_COUNTER_INCREMENT(Counter) TRACE_COUNTER_INCREMENT(Counter)
+#define SUDS_TRACE_COUNTER_ADD(Counter, Amount) TRACE_COUNTER_ADD(Counter, Amount)
+
+#else
+
+#define SUDS_TRACE_SCOPE(Name, Script, LineNo)
+#define SUDS_TRACE_COUNTER_INCREMENT(Counter)
+#define SUDS_TRACE_COUNTER_ADD(Counter, Amount)
+
+#endif
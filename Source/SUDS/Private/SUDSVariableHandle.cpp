@@ -0,0 +1,18 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#include "SUDSVariableHandle.h"
+
+#include "SUDSLibrary.h"
+
+FSUDSVariableHandle::FSUDSVariableHandle(FName InName)
+{
+	// Resolve the global prefix once rather than on every access
+	bGlobal = USUDSLibrary::IsDialogueVariableGlobal(InName, Name);
+}
+
+uint32 FSUDSVariableHandle::NewStoreGeneration()
+{
+	// Start at 1 so that a default handle never matches
+	static int32 LastGeneration = 0;
+	return static_cast<uint32>(FPlatformAtomics::InterlockedIncrement(&LastGeneration));
+}
@@ -12,4 +12,10 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+protected:
+	FDelegateHandle EndFrameHandle;
+
+	/// Report stats which are levels rather than per-frame counts, once per frame
+	static void RecordFrameStats();
 };
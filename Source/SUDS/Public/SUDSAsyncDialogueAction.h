@@ -0,0 +1,62 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "SUDSAsyncDialogueAction.generated.h"
+
+class USUDSDialogue;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnSUDSAsyncDialogueStep, USUDSDialogue*, Dialogue);
+
+/**
+ * Latent versions of the dialogue step functions, which complete once any variables requested from
+ * ISUDSAsyncVariableProvider participants have arrived and the dialogue has reached its next speaker line or the end.
+ * If nothing needed to be waited for, they complete straight away.
+ */
+UCLASS()
+class SUDS_API USUDSAsyncDialogueAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	/// Called when the dialogue has reached a speaker line
+	UPROPERTY(BlueprintAssignable)
+	FOnSUDSAsyncDialogueStep OnSpeakerLine;
+
+	/// Called when the dialogue has reached the end
+	UPROPERTY(BlueprintAssignable)
+	FOnSUDSAsyncDialogueStep OnFinished;
+
+	/// Start the dialogue, waiting for any asynchronously provided variables. See USUDSDialogue::Start
+	UFUNCTION(BlueprintCallable, meta=(BlueprintInternalUseOnly="true"), Category="SUDS|Dialogue")
+	static USUDSAsyncDialogueAction* StartDialogueAsync(USUDSDialogue* Dialogue, FName Label = NAME_None);
+
+	/// Continue the dialogue, waiting for any asynchronously provided variables. See USUDSDialogue::Continue
+	UFUNCTION(BlueprintCallable, meta=(BlueprintInternalUseOnly="true"), Category="SUDS|Dialogue")
+	static USUDSAsyncDialogueAction* ContinueDialogueAsync(USUDSDialogue* Dialogue);
+
+	/// Make a choice, waiting for any asynchronously provided variables. See USUDSDialogue::Choose
+	UFUNCTION(BlueprintCallable, meta=(BlueprintInternalUseOnly="true"), Category="SUDS|Dialogue")
+	static USUDSAsyncDialogueAction* ChooseDialogueAsync(USUDSDialogue* Dialogue, int Index);
+
+	virtual void Activate() override;
+
+protected:
+	enum class EStep : uint8
+	{
+		Start,
+		Continue,
+		Choose
+	};
+
+	UPROPERTY()
+	TObjectPtr<USUDSDialogue> Dialogue;
+	EStep Step = EStep::Continue;
+	FName Label;
+	int ChoiceIndex = 0;
+
+	static USUDSAsyncDialogueAction* Create(USUDSDialogue* Dialogue, EStep Step);
+	void Complete();
+};
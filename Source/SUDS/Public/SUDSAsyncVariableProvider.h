@@ -0,0 +1,68 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "Async/Future.h"
+#include "SUDSValue.h"
+#include "SUDSAsyncVariableProvider.generated.h"
+
+class USUDSDialogue;
+UINTERFACE(MinimalAPI)
+class USUDSAsyncVariableProvider : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+* Interface for participants which supply variables that take time to look up, e.g. from a service.
+* Unlike ISUDSParticipant::OnDialogueVariableRequested, which must set the variable before it returns, an async
+* provider is asked for the value and can supply it whenever it's ready. When a dialogue step needs variables from
+* an async provider which it doesn't have yet, the step is suspended at that point and requests for all of the
+* outstanding variables are made at once; the step carries on when the last one arrives.
+*
+* Add the provider to the dialogue as a participant, like any other. It may also implement ISUDSParticipant.
+*
+* Blueprints should implement OnDialogueAsyncVariableRequested and call CompleteAsyncVariable on the dialogue when the
+* value is available. C++ classes can do the same, or just override RequestDialogueVariableAsync and return a future.
+*/
+class SUDS_API ISUDSAsyncVariableProvider
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	 * Return whether this provider supplies a variable asynchronously. Called when a step needs a variable which
+	 * hasn't already been supplied asynchronously in that step, so should be cheap.
+	 * @param Dialogue The dialogue
+	 * @param VariableName The name of the variable
+	 * @return True if this provider will supply the variable via OnDialogueAsyncVariableRequested
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category="SUDS")
+	bool ProvidesDialogueVariableAsync(USUDSDialogue* Dialogue, FName VariableName);
+
+	/**
+	 * Called to start looking up a variable. When the value is available, call CompleteAsyncVariable on the dialogue
+	 * with it and the request ID; you may do that before returning if you already have it. Must be completed on the
+	 * game thread.
+	 * @param Dialogue The dialogue
+	 * @param VariableName The name of the variable
+	 * @param RequestId Identifies this request, so that a value arriving after the dialogue has moved on is ignored
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category="SUDS")
+	void OnDialogueAsyncVariableRequested(USUDSDialogue* Dialogue, FName VariableName, int32 RequestId);
+
+	/**
+	 * C++ alternative to overriding OnDialogueAsyncVariableRequested; return a future for the variable's value.
+	 * The future can be fulfilled on any thread, the value is passed to the dialogue on the game thread.
+	 * @param Dialogue The dialogue
+	 * @param VariableName The name of the variable
+	 */
+	virtual TFuture<FSUDSValue> RequestDialogueVariableAsync(USUDSDialogue* Dialogue, FName VariableName);
+
+	virtual bool ProvidesDialogueVariableAsync_Implementation(USUDSDialogue* Dialogue, FName VariableName);
+	virtual void OnDialogueAsyncVariableRequested_Implementation(USUDSDialogue* Dialogue, FName VariableName, int32 RequestId);
+
+};
@@ -0,0 +1,54 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Holds a value which is shared between copies of the holder until one of them changes it, at which point that copy
+ * gets a value of its own. Dialogue state is held this way so that forking a dialogue doesn't copy anything up front.
+ * Like dialogues, intended for use on the game thread only.
+ */
+template <typename T>
+class TSUDSCopyOnWrite
+{
+public:
+	TSUDSCopyOnWrite() : Data(MakeShared<T, ESPMode::NotThreadSafe>()) {}
+
+	/// Read the value, never copies
+	const T& Get() const { return *Data; }
+
+	/// Get the value for writing, copying it first if it's shared with any other holder
+	T& Edit()
+	{
+		if (!Data.IsUnique())
+		{
+			Data = MakeShared<T, ESPMode::NotThreadSafe>(*Data);
+		}
+		return *Data;
+	}
+
+	/// Replace the value with an empty one, for writing. Unlike Edit(), never copies a shared value first
+	T& Reset()
+	{
+		if (Data.IsUnique())
+		{
+			*Data = T();
+		}
+		else
+		{
+			Data = MakeShared<T, ESPMode::NotThreadSafe>();
+		}
+		return *Data;
+	}
+
+	/// Get the value for writing without copying it, so the change is seen by every holder. Only for changes which
+	/// apply to all of them, e.g. the garbage collector clearing references to destroyed objects
+	T& EditShared() { return *Data; }
+
+	/// Whether the value is shared with another holder, i.e. whether the next Edit() will copy it
+	bool IsShared() const { return !Data.IsUnique(); }
+
+private:
+	TSharedRef<T, ESPMode::NotThreadSafe> Data;
+};
@@ -0,0 +1,28 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/Guid.h"
+
+/// Custom serialization version for SUDS data saved in archives, e.g. FSUDSDialogueState
+struct SUDS_API FSUDSCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+		/// FSUDSDialogueState includes the dialogue's random seed
+		AddedDialogueRandomSeed = 1,
+		/// FSUDSDialogueState writes its own version into the stream, so archives without custom versions can read it
+		AddedDialogueStateInlineVersion = 2,
+
+		// -----<new versions can be added above this line>-------------------------------------------------
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+
+private:
+	FSUDSCustomVersion() {}
+};
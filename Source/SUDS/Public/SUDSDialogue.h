@@ -3,11 +3,18 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "SUDSCopyOnWrite.h"
 #include "SUDSScriptNode.h"
 #include "SUDSExpression.h"
+#include "SUDSVariableHandle.h"
+#include "Async/Future.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
 #include "UObject/Object.h"
+#include <atomic>
 #include "SUDSDialogue.generated.h"
 
+class ISUDSNativeParticipant;
 class USUDSScriptNodeGosub;
 class USUDSScriptNodeText;
 struct FSUDSScriptEdge;
@@ -42,6 +49,24 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnVariableRequestedEvent, class US
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSUDSDialogue, Verbose, All);
 
+// "stat SUDS" in the console, and the SUDS category in CSV profiles
+DECLARE_STATS_GROUP(TEXT("SUDS"), STATGROUP_SUDS, STATCAT_Advanced);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Dialogue Steps"), STAT_SUDS_StepTime, STATGROUP_SUDS, SUDS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Choices"), STAT_SUDS_UpdateChoicesTime, STATGROUP_SUDS, SUDS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Format Text"), STAT_SUDS_FormatTextTime, STATGROUP_SUDS, SUDS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Participant Calls"), STAT_SUDS_ParticipantCallsTime, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Dialogues"), STAT_SUDS_LiveDialogues, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Steps"), STAT_SUDS_Steps, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nodes Run"), STAT_SUDS_NodesRun, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Choices Evaluated"), STAT_SUDS_ChoicesEvaluated, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Expressions Evaluated"), STAT_SUDS_ExpressionsEvaluated, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Variable Requests"), STAT_SUDS_VariableRequests, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Participant Calls"), STAT_SUDS_ParticipantCalls, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Formatted Texts"), STAT_SUDS_FormattedTexts, STATGROUP_SUDS, SUDS_API);
+/// Approximate, state shared between a dialogue and its forks isn't counted, see USUDSDialogue::GetTotalStateMemory
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Dialogue State"), STAT_SUDS_StateMemory, STATGROUP_SUDS, SUDS_API);
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(SUDS_API, SUDS);
+
 /// Copy of the internal state of a dialogue
 USTRUCT(BlueprintType)
 struct FSUDSDialogueState
@@ -59,6 +84,14 @@ protected:
 
 	UPROPERTY(BlueprintReadOnly, SaveGame, Category="SUDS|Dialogue")
 	TArray<FString> ReturnStack;
+
+	/// Current seed of the dialogue's random stream, so random choices continue the same sequence after restore
+	UPROPERTY(BlueprintReadOnly, SaveGame, Category="SUDS|Dialogue")
+	int32 RandomSeed = 0;
+
+	/// False for states saved before the seed was, in which case RandomSeed is meaningless
+	UPROPERTY(BlueprintReadOnly, SaveGame, Category="SUDS|Dialogue")
+	bool bHasRandomSeed = false;
 	
 public:
 	FSUDSDialogueState() {}
@@ -66,10 +99,13 @@ public:
 	FSUDSDialogueState(const FString& TxtID,
 	                   const TMap<FName, FSUDSValue>& InVars,
 	                   const TSet<FString>& InChoices,
-	                   const TArray<FString>& InReturnStack) : TextNodeID(TxtID),
-	                                                           Variables(InVars),
-	                                                           ChoicesTaken(InChoices.Array()),
-	                                                           ReturnStack(InReturnStack)
+	                   const TArray<FString>& InReturnStack,
+	                   const TOptional<int32>& InRandomSeed = TOptional<int32>()) : TextNodeID(TxtID),
+	                                                                               Variables(InVars),
+	                                                                               ChoicesTaken(InChoices.Array()),
+	                                                                               ReturnStack(InReturnStack),
+	                                                                               RandomSeed(InRandomSeed.Get(0)),
+	                                                                               bHasRandomSeed(InRandomSeed.IsSet())
 	{
 	}
 
@@ -77,6 +113,8 @@ public:
 	const TMap<FName, FSUDSValue>& GetVariables() const { return Variables; }
 	const TArray<FString>& GetChoicesTaken() const { return ChoicesTaken; }
 	const TArray<FString>& GetReturnStack() const { return ReturnStack; }
+	int32 GetRandomSeed() const { return RandomSeed; }
+	bool HasRandomSeed() const { return bHasRandomSeed; }
 
 	SUDS_API friend FArchive& operator<<(FArchive& Ar, FSUDSDialogueState& Value);
 	SUDS_API friend void operator<<(FStructuredArchive::FSlot Slot, FSUDSDialogueState& Value);
@@ -92,6 +130,90 @@ public:
 	}
 	
 };
+
+/**
+ * Compact copy of the internal state of a dialogue, an alternative to FSUDSDialogueState when save size matters.
+ * Only variables whose values differ from those set by the script header are stored, and the current node, choices
+ * taken and return stack are identified by hashes of their IDs rather than the ID strings themselves. The binary
+ * serialisation packs integers as varints.
+ * Because of the hashed IDs, this state can only be restored against the same script it was taken from (edits are
+ * fine so long as Text IDs are written into the source, same as for FSUDSDialogueState).
+ */
+USTRUCT()
+struct FSUDSCompactDialogueState
+{
+	GENERATED_BODY()
+protected:
+	/// Hash of the current text node ID, 0 if there was no current speaker node
+	UPROPERTY(SaveGame)
+	uint32 TextNodeHash = 0;
+
+	/// Variables which differ from the header defaults. An empty value means a header variable was unset.
+	UPROPERTY(SaveGame)
+	TMap<FName, FSUDSValue> ChangedVariables;
+
+	/// Hashes of the text IDs of choices taken
+	UPROPERTY(SaveGame)
+	TArray<uint32> ChoicesTaken;
+
+	/// Hashes of the gosub IDs on the return stack
+	UPROPERTY(SaveGame)
+	TArray<uint32> ReturnStack;
+
+	/// Current seed of the dialogue's random stream
+	UPROPERTY(SaveGame)
+	int32 RandomSeed = 0;
+
+	/// False for states saved before the seed was, in which case RandomSeed is meaningless
+	UPROPERTY(SaveGame)
+	bool bHasRandomSeed = false;
+
+public:
+	FSUDSCompactDialogueState() {}
+
+	FSUDSCompactDialogueState(uint32 InTextNodeHash,
+	                          TMap<FName, FSUDSValue>&& InChangedVars,
+	                          TArray<uint32>&& InChoices,
+	                          TArray<uint32>&& InReturnStack,
+	                          int32 InRandomSeed) : TextNodeHash(InTextNodeHash),
+	                                                ChangedVariables(MoveTemp(InChangedVars)),
+	                                                ChoicesTaken(MoveTemp(InChoices)),
+	                                                ReturnStack(MoveTemp(InReturnStack)),
+	                                                RandomSeed(InRandomSeed),
+	                                                bHasRandomSeed(true)
+	{
+	}
+
+	uint32 GetTextNodeHash() const { return TextNodeHash; }
+	const TMap<FName, FSUDSValue>& GetChangedVariables() const { return ChangedVariables; }
+	const TArray<uint32>& GetChoicesTaken() const { return ChoicesTaken; }
+	const TArray<uint32>& GetReturnStack() const { return ReturnStack; }
+	int32 GetRandomSeed() const { return RandomSeed; }
+	bool HasRandomSeed() const { return bHasRandomSeed; }
+
+	SUDS_API friend FArchive& operator<<(FArchive& Ar, FSUDSCompactDialogueState& Value);
+	SUDS_API friend void operator<<(FStructuredArchive::FSlot Slot, FSUDSCompactDialogueState& Value);
+	bool Serialize(FStructuredArchive::FSlot Slot)
+	{
+		Slot << *this;
+		return true;
+	}
+	bool Serialize(FArchive& Ar)
+	{
+		Ar << *this;
+		return true;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FSUDSCompactDialogueState> : public TStructOpsTypeTraitsBase2<FSUDSCompactDialogueState>
+{
+	enum
+	{
+		WithSerializer = true
+	};
+};
+
 /**
  * A Dialogue is a runtime instance of a Script (the asset on which the dialogue is based)
  * An Dialogue always stops on a speaker line, which may have player choices. It progresses when you call Continue()
@@ -107,6 +229,7 @@ public:
  * Dialogues need to be owned by an object, mainly for garbage collection. It's recommended that you set the owner to
  * one of the NPCs in the dialogue.
  * You can save/restore the state of a dialogue via GetSavedState/RestoreSavedState. 
+ * To look ahead without changing a dialogue, Fork() it and run the fork instead.
  */
 UCLASS(BlueprintType)
 class SUDS_API USUDSDialogue : public UObject
@@ -151,21 +274,75 @@ protected:
 	/// External objects which want to closely participate in the dialogue (not just listen to events)
 	UPROPERTY()
 	TArray<UObject*> Participants;
+
+	/// How to call each participant, resolved when participants change so we don't look up interfaces on every call
+	struct FParticipantDispatch
+	{
+		/// Non-null if the participant is native, in which case we call directly
+		ISUDSNativeParticipant* Native = nullptr;
+		/// Whether the participant implements ISUDSParticipant (called via reflection)
+		bool bIsParticipant = false;
+		/// Whether a reflected participant should be sent OnDialogueVariablesRequested rather than one
+		/// OnDialogueVariableRequested per variable
+		bool bBatchVariableRequests = false;
+		/// Whether the participant implements ISUDSAsyncVariableProvider
+		bool bIsAsyncProvider = false;
+	};
+	/// Parallel to Participants
+	TArray<FParticipantDispatch> ParticipantDispatch;
+
+	/// Call either the native or reflected version of a participant callback on all participants, in order
+	template <typename NativeFuncType, typename ReflectedFuncType>
+	void ForEachParticipant(NativeFuncType&& NativeFunc, ReflectedFuncType&& ReflectedFunc)
+	{
+		for (int i = 0; i < Participants.Num(); ++i)
+		{
+			// Participant may have been destroyed & nulled by GC, in which case the native pointer is also invalid
+			UObject* P = Participants[i];
+			if (!P || !ParticipantDispatch.IsValidIndex(i))
+				continue;
+
+			const FParticipantDispatch& Dispatch = ParticipantDispatch[i];
+			if (Dispatch.Native)
+			{
+				NativeFunc(Dispatch.Native);
+			}
+			else if (Dispatch.bIsParticipant)
+			{
+				ReflectedFunc(P);
+			}
+		}
+	}
 	
 
 	/// All of the dialogue variables
 	/// Dialogue variable state is all held locally. Dialogue participants can retrieve or set values in state.
 	/// All state is saved with the dialogue. Variables can be used as text substitution parameters, conditionals,
 	/// or communication with external state.
+	/// Shared with forks of this dialogue until either side changes it.
 	typedef TMap<FName, FSUDSValue> FSUDSValueMap;
-	FSUDSValueMap VariableState;
+	TSUDSCopyOnWrite<FSUDSValueMap> VariableState;
+	/// Changes whenever variables are added to / removed from VariableState, so handles know to look up again
+	uint32 VariableStateGeneration = FSUDSVariableHandle::NewStoreGeneration();
 
-	/// Stack of Gosub nodes to return to
-	UPROPERTY()
-	TArray<USUDSScriptNodeGosub*> GosubReturnStack;
+	/// Stack of Gosub nodes to return to, shared with forks until changed. Can't be a UPROPERTY, so the nodes are
+	/// reported to the GC in AddReferencedObjects; a reimport can replace BaseScript's nodes while we're using them
+	TSUDSCopyOnWrite<TArray<USUDSScriptNodeGosub*>> GosubReturnStack;
+
+	/// Set of all the TextIDs of choices taken already in this dialogue, shared with forks until changed
+	TSUDSCopyOnWrite<TSet<FString>> ChoicesTaken;
+
+	/// Whether this is a silent fork, see Fork()
+	bool bSilent = false;
+	/// Whether a silent fork has changed global variables, in which case it uses its own copy of them from then on
+	bool bHasOwnGlobalVariables = false;
+	TSUDSCopyOnWrite<FSUDSValueMap> OwnGlobalVariables;
 
-	/// Set of all the TextIDs of choices taken already in this dialogue
-	TSet<FString> ChoicesTaken;
+	/// Random stream used for [random] blocks, separate per dialogue so results are reproducible
+	FRandomStream RandomStream;
+	/// Whether the random stream has been drawn from, seeded explicitly or restored. Until then, starting the
+	/// dialogue re-seeds it for the start label
+	bool bRandomStreamUsed = false;
 
 	TSet<FName> CurrentRequestedParamNames;
 	bool bParamNamesExtracted;
@@ -175,10 +352,55 @@ protected:
 	/// All valid choices
 	TArray<FSUDSScriptEdge> CurrentChoices;
 	int CurrentSourceLineNo;
+	/// Maximum number of nodes to run in one step before assuming the script is stuck in a loop (0 = no limit)
+	int32 NodeBudget = 10000;
+	/// Number of nodes run so far in the current step
+	int32 NodesRunThisStep = 0;
+	/// Whether to request all the variables a speaker line might need next as soon as it's displayed
+	bool bPrefetchVariables = false;
+	/// Whether to request all the variables a step might need at the start of it
+	bool bPrefetchStepVariables = false;
+	/// The speaker line whose variables were prefetched, which don't need requesting again until the next line
+	UPROPERTY()
+	const USUDSScriptNodeText* PrefetchedNode = nullptr;
+	/// Variables participants were asked for at the start of the current step, which aren't asked for again until
+	/// the next step. Only used if bPrefetchStepVariables
+	TSet<FName> StepRequestedVariables;
+	/// Reused for requests of a single variable
+	TArray<FName> SingleVariableRequest;
+	bool bSingleVariableRequestInUse = false;
+	/// Source lines of the most recent nodes run, for diagnostics if the budget runs out
+	static constexpr int32 NumRecentLines = 16;
+	int32 RecentLineNos[NumRecentLines] = {};
+	/// Memory used by this dialogue's state when it was last measured, see UpdateStateMemory
+	int64 StateMemory = 0;
+	bool bCountedAsLive = false;
+
+	/// Variables requested from async providers which haven't arrived yet, with the request ID they were asked for
+	TMap<FName, int32> PendingAsyncVariables;
+	/// Variables which have arrived from async providers during the current step, so aren't requested again
+	TSet<FName> FetchedAsyncVariables;
+	/// The async provider (or null) for each variable the current step has asked about, so each is only checked once
+	TMap<FName, UObject*> AsyncVariableProviders;
+	/// Identifies requests for async variables; changes every step, and on cancelling, so late values are ignored
+	int32 AsyncVariableRequestId = 0;
+	/// The node the current step is suspended at while waiting for async variables
+	UPROPERTY()
+	USUDSScriptNode* AsyncSuspendedNode = nullptr;
+	bool bAsyncSuspendedRaiseAtEnd = false;
+	bool bResumingAfterAsyncVariables = false;
+	bool bIssuingAsyncVariableRequests = false;
+	/// Fulfilled when the current step finishes waiting for async variables
+	TArray<TPromise<void>> AsyncVariableWaiters;
+	static std::atomic<int32> NumLiveDialogues;
+	static std::atomic<int64> TotalStateMemory;
 	static const FText DummyText;
 	static const FString DummyString;
 
 	void InitVariables();
+	void InitRandomStream(FName StartLabel);
+	float NextRandomFraction();
+	void GetHeaderDefaultVariables(FSUDSValueMap& OutVars) const;
 	void RunUntilNextSpeakerNodeOrEnd(USUDSScriptNode* FromNode, bool bRaiseAtEnd);
 	const USUDSScriptNode* WalkToNextChoiceNode(USUDSScriptNode* FromNode, bool bExecute);
 	USUDSScriptNode* RecurseWalkToNextChoiceOrTextNode(USUDSScriptNode* Node, bool bExecute, TArray<USUDSScriptNodeGosub*>& LocalGosubStack);
@@ -186,24 +408,45 @@ protected:
 	const USUDSScriptNode* FindNextChoiceNode(USUDSScriptNode* FromNode);
 	void SetCurrentSpeakerNode(USUDSScriptNodeText* Node, bool bQuietly);
 	void SortParticipants();
+	void UpdateParticipantDispatch();
 	void RaiseStarting(FName StartLabel);
 	void RaiseFinished();
 	void RaiseNewSpeakerLine();
 	void RaiseChoiceMade(int Index, int LineNo);
 	void RaiseProceeding();
 	void RaiseVariableChange(const FName& VarName, const FSUDSValue& Value, bool bFromScript, int LineNo);
+	void RaiseStepVariablesRequested(const USUDSScriptNode* FromNode);
+	bool IsVariableAlreadyRequested(const FName& VarName) const;
 	void RaiseVariableRequested(const FName& VarName, int LineNo);
+	void RaiseVariablesRequested(const TArray<FName>& VarNames, int LineNo);
+	void DispatchVariablesRequested(const TArray<FName>& VarNames, int LineNo);
 	void RaiseExpressionVariablesRequested(const FSUDSExpression& Expression, int LineNo);
+	void RaiseConditionVariablesRequested(const USUDSScriptNode* Node);
 	const TMap<FName, FSUDSValue>& GetGlobalVariables() const;
+	void SetGlobalVariableImpl(FName Name, const FSUDSValue& Value, bool bFromScript, int LineNo);
 
 	USUDSScriptNode* GetNextNode(USUDSScriptNode* Node);
 	bool IsChoiceOrTextNode(ESUDSScriptNodeType Type);
+	void ResetNodeBudget() { NodesRunThisStep = 0; }
+	void UpdateStateMemory();
+	bool ConsumeNodeBudget(const USUDSScriptNode* Node, bool bEndsDialogue);
 	USUDSScriptNode* RunNode(USUDSScriptNode* Node);
+	USUDSScriptNode* RunNodeByType(USUDSScriptNode* Node);
 	USUDSScriptNode* RunSelectNode(USUDSScriptNode* Node);
 	USUDSScriptNode* RunSetVariableNode(USUDSScriptNode* Node);
 	USUDSScriptNode* RunEventNode(USUDSScriptNode* Node);
 	USUDSScriptNode* RunGosubNode(USUDSScriptNode* Node);
 	USUDSScriptNode* RunReturnNode(USUDSScriptNode* Node);
+	bool HasAsyncVariableProvider() const;
+	bool RequestAsyncVariablesForStep(const USUDSScriptNode* FromNode);
+	bool RequestAsyncVariables(const USUDSScriptNode* Node);
+	bool RequestAsyncVariables(const TSet<FName>& Names, int LineNo);
+	void GatherVariablesNeededBy(const USUDSScriptNode* Node, TSet<FName>& OutNames) const;
+	void GatherVariablesNeededForStep(const USUDSScriptNode* Node, bool bIncludePrefetch, TSet<FName>& OutNames, TSet<const USUDSScriptNode*>& Visited) const;
+	void GatherVariablesNeededForChoices(const USUDSScriptNode* Node, TSet<FName>& OutNames, TSet<const USUDSScriptNode*>& Visited) const;
+	void CancelAsyncVariables();
+	void ResumeAfterAsyncVariables();
+	void FulfilAsyncVariableWaiters();
 	void UpdateChoices();
 	void RecurseAppendChoices(const USUDSScriptNode* Node, TArray<FSUDSScriptEdge>& OutChoices);
 	USoundBase* GetSoundForCurrentLine(bool bAllowAnyTarget) const;
@@ -215,15 +458,40 @@ protected:
 	bool CurrentNodeHasChoices() const;
 	void SetVariableImpl(FName Name, const FSUDSValue& Value, bool bFromScript, int LineNo)
 	{
-		const FSUDSValue OldValue = GetVariable(Name);
-		if (!IsVariableSet(Name) ||
-			(OldValue != Value).GetBooleanValue())
+		SetVariableImpl(VariableState.Get().Find(Name), Name, Value, bFromScript, LineNo);
+	}
+	void SetVariableImpl(const FSUDSValue* OldValue, FName Name, const FSUDSValue& Value, bool bFromScript, int LineNo)
+	{
+		if (!OldValue)
+		{
+			EditVariables().Add(Name, Value);
+			InvalidateVariableHandles();
+			RaiseVariableChange(Name, Value, bFromScript, LineNo);
+		}
+		else if ((*OldValue != Value).GetBooleanValue())
 		{
-			VariableState.Add(Name, Value);
+			// Assign in place rather than Add, which can reallocate & invalidate handles
+			// If the variables are shared with a fork, editing copies them so the value has to be found again
+			FSUDSValue* Target = VariableState.IsShared()
+				                     ? EditVariables().Find(Name)
+				                     : const_cast<FSUDSValue*>(OldValue);
+			*Target = Value;
 			RaiseVariableChange(Name, Value, bFromScript, LineNo);
 		}
 		
 	}
+	/// Get the variables for writing, copying them first if they're shared with a fork
+	FSUDSValueMap& EditVariables()
+	{
+		if (VariableState.IsShared())
+		{
+			// Handles may have cached pointers into the shared copy
+			InvalidateVariableHandles();
+		}
+		return VariableState.Edit();
+	}
+	void InvalidateVariableHandles() { VariableStateGeneration = FSUDSVariableHandle::NewStoreGeneration(); }
+	const FSUDSValue* FindVariable(const FSUDSVariableHandle& Handle) const;
 
 public:
 	USUDSDialogue();
@@ -231,6 +499,15 @@ public:
 	// {
 	//		UE_LOG(LogTemp, Warning, TEXT("*********** Destroyed Dialogue!"));
 	// }
+	virtual void BeginDestroy() override;
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
+	/// Number of dialogues which currently exist
+	static int32 GetNumLiveDialogues() { return NumLiveDialogues.load(std::memory_order_relaxed); }
+	/// Approximate memory used by the variables, choices taken & return stacks of all dialogues, in bytes. State which
+	/// a fork still shares with its original isn't included
+	static int64 GetTotalStateMemory() { return TotalStateMemory.load(std::memory_order_relaxed); }
+
 	void Initialise(const USUDSScript* Script);
 	
 	/// Get the script asset this dialogue is based on
@@ -430,6 +707,50 @@ public:
 	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
 	void End(bool bQuietly);
 
+	/**
+	 * Whether the dialogue is part way through a step, waiting for variables from ISUDSAsyncVariableProvider
+	 * participants. While waiting, the previous speaker line is still current, and calls to Continue / Choose are
+	 * ignored. Once everything has arrived the step carries on and raises the usual events.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="SUDS|Dialogue")
+	bool IsWaitingForAsyncVariables() const { return AsyncSuspendedNode != nullptr; }
+
+	/**
+	 * Supply the value of a variable which was requested from an ISUDSAsyncVariableProvider. Values which weren't
+	 * requested, or which belong to a request from an earlier step or one that was cancelled by the dialogue being
+	 * restarted or ended, are ignored.
+	 * @param Name The name of the variable
+	 * @param Value The value of the variable
+	 * @param RequestId The request ID passed to ISUDSAsyncVariableProvider::OnDialogueAsyncVariableRequested
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	void CompleteAsyncVariable(FName Name, const FSUDSValue& Value, int32 RequestId);
+
+	/**
+	 * Get a future which is fulfilled once the dialogue is no longer waiting for async variables, i.e. when it has
+	 * reached the next speaker line or the end. If it isn't waiting, the future is already fulfilled.
+	 * From Blueprints, use the latent "Continue Dialogue Async" etc. nodes instead.
+	 */
+	TFuture<void> WaitForAsyncVariables();
+
+	/**
+	 * Create a copy of this dialogue at its current position, which can be run forwards (e.g. to see which line and
+	 * variable changes would follow a choice) without affecting this dialogue. The fork shares this dialogue's
+	 * variables, choices taken and gosub stack until one side changes them, so forks are cheap to create.
+	 * A fork has its own event delegates, which start unbound, and isn't scheduled by the subsystem.
+	 * @param bSilentFork If true (the default), the fork has no participants, doesn't record execution stats, and any
+	 *   global variables it sets are kept to itself rather than changing the real globals. If false, the fork has the
+	 *   same participants as this dialogue, which will be called as it runs, and sets globals as normal. Forks of a
+	 *   silent fork are always silent.
+	 * @return The fork, or null if this dialogue is part way through a step waiting for async variables
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	USUDSDialogue* Fork(bool bSilentFork = true);
+
+	/// Whether this is a silent fork of another dialogue, see Fork()
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="SUDS|Dialogue")
+	bool IsSilent() const { return bSilent; }
+
 	/// Get the source line number of the current position of the dialogue (returns 0 if not applicable)
 	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
 	int GetCurrentSourceLine() const;
@@ -479,7 +800,83 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
 	void RestoreSavedState(const FSUDSDialogueState& State);
+
+	/** Retrieve a compact copy of the state of this dialogue.
+	 *  Like GetSavedState(), but only variables which differ from the values set by the script header are included,
+	 *  and IDs are stored as hashes. Use this when you have a lot of dialogues to save and want to keep size down.
+	 *  @return A compact copy of the current state of this dialogue, to be restored with RestoreCompactSavedState()
+	 */
+	FSUDSCompactDialogueState GetCompactSavedState() const;
+
+	/** Restore the state of this dialogue from a compact saved state.
+	 *  The same notes apply as for RestoreSavedState().
+	 *  @param State Dialogue state that you previously retrieved from GetCompactSavedState().
+	 */
+	void RestoreCompactSavedState(const FSUDSCompactDialogueState& State);
 	
+	/**
+	 * Re-seed the random stream used by [random] blocks in this dialogue.
+	 * By default each dialogue is seeded from the subsystem's master random seed combined with the script's package,
+	 * the path of the dialogue's owner and the label the dialogue is first started from, so you only need this if you
+	 * want to control one dialogue specifically, e.g. if its owner is spawned and so has a different name each time.
+	 * The stream is included in saved state.
+	 * @param Seed The new seed
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	void SetRandomSeed(int32 Seed);
+
+	/// Get the random stream used by [random] blocks in this dialogue
+	const FRandomStream& GetRandomStream() const { return RandomStream; }
+
+	/**
+	 * Set the maximum number of nodes (sets, selects, events etc) which can be run in one step of the dialogue, i.e.
+	 * between one speaker line or choice and the next. If a script runs more than this it's assumed to be stuck in a
+	 * loop; the dialogue logs the lines involved and ends, rather than stalling the game thread forever.
+	 * @param MaxNodes The maximum number of nodes per step, or 0 for no limit. The default is 10000.
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	void SetNodeBudget(int32 MaxNodes) { NodeBudget = FMath::Max(0, MaxNodes); }
+
+	/// Get the maximum number of nodes which can be run in one step of the dialogue, see SetNodeBudget
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="SUDS|Dialogue")
+	int32 GetNodeBudget() const { return NodeBudget; }
+
+	/**
+	 * Set whether to prefetch variables. When enabled, as soon as a speaker line is displayed participants are asked
+	 * in one OnDialogueVariablesRequested call for every variable that might be used before the next speaker line
+	 * (see GetVariablesNeededNext), and aren't asked for those variables again until then. This is most useful with
+	 * participants which supply variables in batches. Off by default, so variables are requested just before use.
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	void SetPrefetchVariables(bool bPrefetch) { bPrefetchVariables = bPrefetch; }
+
+	/// Get whether variables are prefetched when a speaker line is displayed, see SetPrefetchVariables
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="SUDS|Dialogue")
+	bool GetPrefetchVariables() const { return bPrefetchVariables; }
+
+	/**
+	 * Set whether to prefetch the variables for each step. When enabled, at the start of each step (Start, Continue
+	 * or Choose) participants are asked in one OnDialogueVariablesRequested call for every variable the step might
+	 * use on any path up to the next speaker line or choice, and aren't asked for those variables again during the
+	 * step. This means fewer, larger batches, but a variable which changes part way through the step (e.g. because
+	 * of an event or a [set]) isn't asked for again before it's used. Off by default, so variables are requested just
+	 * before use.
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	void SetPrefetchStepVariables(bool bPrefetch) { bPrefetchStepVariables = bPrefetch; }
+
+	/// Get whether variables are prefetched at the start of each step, see SetPrefetchStepVariables
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="SUDS|Dialogue")
+	bool GetPrefetchStepVariables() const { return bPrefetchStepVariables; }
+
+	/**
+	 * Get every variable which might be used from the current speaker line up to the next one: parameters in the
+	 * text & choices, conditions, set expressions and event arguments. This is worked out from all possible paths
+	 * when the script is imported, so may include variables which aren't needed in the current state.
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	TArray<FName> GetVariablesNeededNext() const;
+
 	/// Get the set of text parameters that are actually being asked for in the current state of the dialogue.
 	/// This will include parameters in the text, and parameters in any current choices being displayed.
 	/// Use this if you want to be more specific about what parameters you supply when ISUDSParticipant::UpdateDialogueParameters
@@ -503,7 +900,7 @@ public:
 	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
 	FSUDSValue GetVariable(FName Name) const
 	{
-		if (const auto Arg = VariableState.Find(Name))
+		if (const auto Arg = VariableState.Get().Find(Name))
 		{
 			return *Arg;
 		}
@@ -513,12 +910,12 @@ public:
 	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
 	bool IsVariableSet(FName Name) const
 	{
-		return VariableState.Contains(Name);
+		return VariableState.Get().Contains(Name);
 	}
 
 	/// Get all variables
 	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
-	const TMap<FName, FSUDSValue>& GetVariables() const { return VariableState; }
+	const TMap<FName, FSUDSValue>& GetVariables() const { return VariableState.Get(); }
 	
 	/**
 	 * Set a text dialogue variable
@@ -629,6 +1026,30 @@ public:
 	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
 	void UnSetVariable(FName Name);
 
+	/**
+	 * Create a handle for fast repeated access to a variable from C++. See FSUDSVariableHandle.
+	 * @param Name The name of the variable. Use the "global." prefix for global variables, in which case the handle
+	 * functions below will access the global variable instead.
+	 */
+	static FSUDSVariableHandle GetVariableHandle(FName Name) { return FSUDSVariableHandle(Name); }
+
+	/// Handle versions of the variable functions, see FSUDSVariableHandle.
+	void SetVariable(const FSUDSVariableHandle& Handle, const FSUDSValue& Value);
+	FSUDSValue GetVariable(const FSUDSVariableHandle& Handle) const;
+	bool IsVariableSet(const FSUDSVariableHandle& Handle) const { return FindVariable(Handle) != nullptr; }
+	void SetVariableText(const FSUDSVariableHandle& Handle, FText Value) { SetVariable(Handle, Value); }
+	FText GetVariableText(const FSUDSVariableHandle& Handle) const;
+	void SetVariableInt(const FSUDSVariableHandle& Handle, int32 Value) { SetVariable(Handle, Value); }
+	int GetVariableInt(const FSUDSVariableHandle& Handle) const;
+	void SetVariableFloat(const FSUDSVariableHandle& Handle, float Value) { SetVariable(Handle, Value); }
+	float GetVariableFloat(const FSUDSVariableHandle& Handle) const;
+	void SetVariableGender(const FSUDSVariableHandle& Handle, ETextGender Value) { SetVariable(Handle, Value); }
+	ETextGender GetVariableGender(const FSUDSVariableHandle& Handle) const;
+	void SetVariableBoolean(const FSUDSVariableHandle& Handle, bool Value) { SetVariable(Handle, FSUDSValue(Value)); }
+	bool GetVariableBoolean(const FSUDSVariableHandle& Handle) const;
+	void SetVariableName(const FSUDSVariableHandle& Handle, FName Value) { SetVariable(Handle, FSUDSValue(Value, false)); }
+	FName GetVariableName(const FSUDSVariableHandle& Handle) const;
+
 #if WITH_EDITOR
 	FOnDialogueSpeakerLineInternal InternalOnSpeakerLine;
 	FOnDialogueChoiceInternal InternalOnChoice;
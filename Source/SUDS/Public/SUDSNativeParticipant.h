@@ -0,0 +1,67 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "SUDSValue.h"
+#include "SUDSNativeParticipant.generated.h"
+
+class USUDSDialogue;
+UINTERFACE(MinimalAPI, meta=(CannotImplementInterfaceInBlueprint))
+class USUDSNativeParticipant : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+* C++ only equivalent of ISUDSParticipant.
+* Participants implementing ISUDSParticipant are called via the reflection system (Execute_*), which is necessary for
+* Blueprints but adds overhead for classes that are entirely native. Implement this interface instead on C++ participants
+* and the dialogue will call them via direct virtual calls. This is detected once when participants are added.
+* See ISUDSParticipant for the meaning of each callback; they are identical. If an object implements both interfaces,
+* only this one is used.
+*/
+class SUDS_API ISUDSNativeParticipant
+{
+	GENERATED_BODY()
+
+public:
+
+	/// See ISUDSParticipant::OnDialogueStarting
+	virtual void OnDialogueStarting(USUDSDialogue* Dialogue, FName AtLabel) = 0;
+
+	/// See ISUDSParticipant::OnDialogueFinished
+	virtual void OnDialogueFinished(USUDSDialogue* Dialogue) = 0;
+
+	/// See ISUDSParticipant::OnDialogueSpeakerLine
+	virtual void OnDialogueSpeakerLine(USUDSDialogue* Dialogue) = 0;
+
+	/// See ISUDSParticipant::OnDialogueChoiceMade
+	virtual void OnDialogueChoiceMade(USUDSDialogue* Dialogue, int ChoiceIndex) = 0;
+
+	/// See ISUDSParticipant::OnDialogueProceeding
+	virtual void OnDialogueProceeding(USUDSDialogue* Dialogue) = 0;
+
+	/// See ISUDSParticipant::OnDialogueEvent
+	virtual void OnDialogueEvent(USUDSDialogue* Dialogue, FName EventName, const TArray<FSUDSValue>& Arguments) = 0;
+
+	/// See ISUDSParticipant::OnDialogueVariableChanged
+	virtual void OnDialogueVariableChanged(USUDSDialogue* Dialogue, FName VariableName, const FSUDSValue& Value, bool bFromScript) = 0;
+
+	/// See ISUDSParticipant::OnDialogueVariableRequested
+	virtual void OnDialogueVariableRequested(USUDSDialogue* Dialogue, FName VariableName) = 0;
+
+	/// See ISUDSParticipant::OnDialogueVariablesRequested. By default calls OnDialogueVariableRequested for each.
+	virtual void OnDialogueVariablesRequested(USUDSDialogue* Dialogue, const TArray<FName>& VariableNames)
+	{
+		for (const FName& Name : VariableNames)
+		{
+			OnDialogueVariableRequested(Dialogue, Name);
+		}
+	}
+
+	/// See ISUDSParticipant::GetDialogueParticipantPriority
+	virtual int GetDialogueParticipantPriority() const = 0;
+
+};
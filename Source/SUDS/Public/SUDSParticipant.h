@@ -113,6 +113,17 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category="SUDS")
 	void OnDialogueVariableRequested(USUDSDialogue* Dialogue, FName VariableName);
+
+	/**
+	 * Called with all of the variables the dialogue script is about to use together, e.g. every condition on a
+	 * select, or every parameter in a line of text. Implement this instead of OnDialogueVariableRequested if it's
+	 * cheaper for you to supply several variables at once. By default, calls OnDialogueVariableRequested for each.
+	 * @param Dialogue The dialogue instance
+	 * @param VariableNames The names of the variables which are about to be used
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category="SUDS")
+	void OnDialogueVariablesRequested(USUDSDialogue* Dialogue, const TArray<FName>& VariableNames);
+	virtual void OnDialogueVariablesRequested_Implementation(USUDSDialogue* Dialogue, const TArray<FName>& VariableNames);
 	
 	/**
 	 * Return the priority of this participant (default 0).
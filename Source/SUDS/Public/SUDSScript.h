@@ -3,13 +3,57 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "SUDSScriptNode.h"
 #include "Sound/DialogueVoice.h"
 #include "UObject/Object.h"
+#include <atomic>
 #include "SUDSScript.generated.h"
 
-class USUDSScriptNode;
 class USUDSScriptNodeText;
 class USUDSScriptNodeGosub;
+struct FSUDSScriptExecutionCounters;
+
+/// How many times one node of a script has been run, see USUDSScript::GetExecutionStats
+USTRUCT(BlueprintType)
+struct SUDS_API FSUDSNodeExecutionStats
+{
+	GENERATED_BODY()
+
+	/// The line number in the script that this node came from
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	int SourceLineNo = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	ESUDSScriptNodeType NodeType = ESUDSScriptNodeType::Text;
+
+	/// Whether the node is in the script header
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	bool bHeader = false;
+
+	/// Number of times the node was run / reached, across all dialogues using the script
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	int64 ExecutionCount = 0;
+
+	/// Total time spent running the node across all dialogues, in milliseconds. Text & choice nodes are only reached,
+	/// not run, so they don't record any time
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	double TotalTimeMs = 0;
+};
+
+/// Snapshot of the execution counts of a script, see USUDSScript::GetExecutionStats
+USTRUCT(BlueprintType)
+struct SUDS_API FSUDSScriptExecutionStats
+{
+	GENERATED_BODY()
+
+	/// Stats for every node which has been run at least once, in node order
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	TArray<FSUDSNodeExecutionStats> Nodes;
+
+	/// Combine the node stats by source line, for when several nodes come from the same line (e.g. a choice & its text)
+	void GetLineStats(TMap<int, FSUDSNodeExecutionStats>& OutLineStats) const;
+};
+
 /**
  * A single SUDS script asset.
  */
@@ -35,6 +79,11 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Category="SUDS")
 	TMap<FName, int> HeaderLabelList;
 
+	/// Whether speaker lines have had their VariablesNeededNext worked out. Scripts imported before that existed
+	/// don't, so it's done when they're loaded
+	UPROPERTY()
+	bool bHasVariablesNeededNext = false;
+
 	/// Array of all speaker IDs found in this script
 	UPROPERTY(BlueprintReadOnly, VisibleDefaultsOnly, Category="SUDS")
 	TArray<FString> Speakers;
@@ -43,8 +92,23 @@ protected:
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category="SUDS")
 	TMap<FString, UDialogueVoice*> SpeakerVoices;
 
-	bool DoesAnyPathAfterLeadToChoice(USUDSScriptNode* FromNode);
-	int RecurseLookForChoice(USUDSScriptNode* CurrNode);
+	static uint8 GetChoiceReachFlags(const USUDSScriptNode* Node, const TMap<const USUDSScriptNode*, uint8>& Flags);
+	uint8 EvaluateChoiceReachFlags(const USUDSScriptNode* Node, const TMap<const USUDSScriptNode*, uint8>& Flags) const;
+	void FindChoiceReachFlags(TMap<const USUDSScriptNode*, uint8>& OutFlags) const;
+	bool DoesAnyPathAfterLeadToChoice(USUDSScriptNode* FromNode, const TMap<const USUDSScriptNode*, uint8>& Flags) const;
+	void GatherVariablesBeforeNextText(const USUDSScriptNode* Node, TSet<FName>& OutNames, TSet<const USUDSScriptNode*>& Visited) const;
+
+	/// Whether any script is collecting execution stats
+	static std::atomic<bool> bExecutionStatsEnabled;
+	/// Execution counters, created the first time a node is recorded, see RecordNodeExecution
+	mutable std::atomic<FSUDSScriptExecutionCounters*> ExecutionCounters { nullptr };
+	/// Counters replaced by a reimport, kept until the script is destroyed since other threads may still be using them
+	TArray<FSUDSScriptExecutionCounters*> RetiredExecutionCounters;
+	FSUDSScriptExecutionCounters* GetExecutionCounters() const;
+	/// Stop using the current counters. Game thread only
+	void DiscardExecutionCounters();
+	void IndexNodes();
+	void FindVariablesNeededNext();
 	
 public:
 	void StartImport(TArray<USUDSScriptNode*>** Nodes,
@@ -83,6 +147,15 @@ public:
 	UFUNCTION(BlueprintCallable, Category="SUDS")
 	USUDSScriptNodeGosub* GetNodeByGosubID(const FString& ID) const;
 
+	/// Get the hash used to identify a text, choice or gosub ID in compact saved state
+	static uint32 GetIDHash(const FString& ID);
+	/// Try to find a speaker node by the hash of its text ID
+	USUDSScriptNodeText* GetNodeByTextIDHash(uint32 Hash) const;
+	/// Try to find a gosub node by the hash of its gosub ID
+	USUDSScriptNodeGosub* GetNodeByGosubIDHash(uint32 Hash) const;
+	/// Try to find the text ID of a choice from its hash, returns true if found
+	bool GetChoiceTextIDByHash(uint32 Hash, FString& OutTextID) const;
+
 
 	/// Get the list of speakers
 	const TArray<FString>& GetSpeakers() const { return Speakers; }
@@ -94,10 +167,42 @@ public:
 	void SetSpeakerVoice(const FString& SpeakerID, UDialogueVoice* Voice);
 	const TMap<FString, UDialogueVoice*> GetSpeakerVoices() const  { return SpeakerVoices; }
 
+	/**
+	 * Turn collection of execution stats on or off for all scripts. When on, every node which dialogues run or reach
+	 * is counted, along with the time spent running it, so you can see which parts of your scripts are hot.
+	 * Off by default; when off, the only cost is checking this flag.
+	 */
+	static void SetExecutionStatsEnabled(bool bEnabled) { bExecutionStatsEnabled.store(bEnabled, std::memory_order_relaxed); }
+	static bool IsExecutionStatsEnabled() { return bExecutionStatsEnabled.load(std::memory_order_relaxed); }
+
+	/// Count a node of this script being run / reached. Safe to call from any thread, doesn't lock
+	void RecordNodeExecution(const USUDSScriptNode* Node, uint64 Cycles = 0) const;
+
+	/// Get a snapshot of how many times each node of this script has been run since stats were enabled or reset
+	UFUNCTION(BlueprintCallable, Category="SUDS")
+	FSUDSScriptExecutionStats GetExecutionStats() const;
+
+	/// Reset the execution stats of this script to zero
+	UFUNCTION(BlueprintCallable, Category="SUDS")
+	void ResetExecutionStats();
+
+	// UObject interface
+	virtual void PostLoad() override;
+	virtual void BeginDestroy() override;
+	// End of UObject interface
+
 #if WITH_EDITORONLY_DATA
 	// Import data for this 
 	UPROPERTY(VisibleAnywhere, Instanced, Category=ImportSettings)
 	TObjectPtr<class UAssetImportData> AssetImportData;
+
+	/// Identifies the source, importer version & settings this script was imported with, so unchanged scripts can skip reimport
+	UPROPERTY()
+	FString ImportCacheKey;
+
+	/// Hash of the script section each entry in Nodes came from, so that unchanged sections can be re-used on reimport
+	UPROPERTY()
+	TArray<uint64> NodeSectionHashes;
 	
 	// UObject interface
 	virtual void PostInitProperties() override;
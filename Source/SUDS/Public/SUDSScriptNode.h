@@ -52,6 +52,9 @@ protected:
 	/// The line number in the script that this node came from
 	UPROPERTY(BlueprintReadOnly, Category="SUDS")
 	int SourceLineNo;
+	/// Where this node is in its script's Nodes followed by HeaderNodes, so its execution counter can be found
+	/// without a lookup. Set by the script on import & load
+	int32 ScriptIndex = INDEX_NONE;
 
 
 public:
@@ -60,8 +63,12 @@ public:
 	ESUDSScriptNodeType GetNodeType() const { return NodeType; }
 	const TArray<FSUDSScriptEdge>& GetEdges() const { return Edges; }
 	int GetSourceLineNo() const { return SourceLineNo; }
+	int32 GetScriptIndex() const { return ScriptIndex; }
+	void SetScriptIndex(int32 Index) { ScriptIndex = Index; }
 
 	void AddEdge(const FSUDSScriptEdge& NewEdge);
+	/// Remove all edges, used when a node is re-used by a later import
+	void ResetEdges() { Edges.Reset(); }
 	void InitChoice(int LineNo);
 	void InitSelect(int LineNo);
 	void InitReturn(int LineNo);
@@ -37,6 +37,7 @@ public:
 		LabelName = FName(Label);
 		GosubID = ID;
 		SourceLineNo = LineNo;
+		bHasChoices = false;
 	}
 	FName GetLabelName() const { return LabelName; }
 	const FString& GetGosubID() const { return GosubID; }
@@ -37,6 +37,12 @@ protected:
 	/// This flag is to let us know to look for choices, but if conditionals apply we may not find any using actual dialogue state.
 	UPROPERTY(BlueprintReadOnly, Category="SUDS")
 	bool bHasChoices = false;
+
+	/// All the variables which may be used while this line is displayed and on the way to the next speaker line:
+	/// text parameters on this line & its choices, conditions, set expressions and event arguments. Calculated on
+	/// import from every path, so some may not be needed in the current state.
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	TArray<FName> VariablesNeededNext;
 	
 	mutable bool bFormatExtracted = false; 
 	mutable TArray<FName> ParameterNames;
@@ -61,4 +67,8 @@ public:
 
 	void NotifyMayHaveChoices() { bHasChoices = true; }
 
+	/// Get every variable which may be used between this line and the next speaker line, see VariablesNeededNext
+	const TArray<FName>& GetVariablesNeededNext() const { return VariablesNeededNext; }
+	void SetVariablesNeededNext(TArray<FName>&& Names) { VariablesNeededNext = MoveTemp(Names); }
+
 };
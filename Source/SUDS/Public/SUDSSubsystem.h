@@ -3,8 +3,12 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "SUDSDialogue.h"
+#include "SUDSScript.h"
 #include "SUDSValue.h"
+#include "SUDSVariableHandle.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
 #include "Engine/World.h"
 #include "Engine/GameInstance.h"
 #include "SUDSSubsystem.generated.h"
@@ -15,6 +19,11 @@ class USoundConcurrency;
 struct FSoundConcurrencySettings;
 DECLARE_LOG_CATEGORY_EXTERN(LogSUDSSubsystem, Log, All);
 
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Scheduler"), STAT_SUDS_SchedulerTime, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Scheduled Dialogues"), STAT_SUDS_ScheduledDialogues, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Scheduler Advances"), STAT_SUDS_SchedulerAdvances, STATGROUP_SUDS, SUDS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Scheduler Deferred Advances"), STAT_SUDS_SchedulerDeferred, STATGROUP_SUDS, SUDS_API);
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnGlobalVariableChangedEvent, FName, VariableName, const FSUDSValue&, Value, bool, bFromScript);
 
 /// Copy of the global state of the system
@@ -50,11 +59,97 @@ public:
 	
 };
 
+/**
+ * Combined state of all registered dialogues plus global state, see USUDSSubsystem::GetSavedBulkState.
+ * Variable names, text IDs and dialogue keys are only stored once and referenced by index, so this is much smaller
+ * than saving each FSUDSDialogueState separately when you have many dialogues.
+ */
+USTRUCT(BlueprintType)
+struct FSUDSBulkState
+{
+	GENERATED_BODY()
+protected:
+	UPROPERTY(SaveGame)
+	TArray<uint8> Data;
+
+public:
+	FSUDSBulkState() {}
+	FSUDSBulkState(TArray<uint8>&& InData) : Data(MoveTemp(InData)) {}
+
+	const TArray<uint8>& GetData() const { return Data; }
+	bool IsEmpty() const { return Data.IsEmpty(); }
+};
+
+/// How the scheduler picks a choice when a scheduled dialogue reaches one
+UENUM(BlueprintType)
+enum class ESUDSAutoChoiceMode : uint8
+{
+	/// Always take the first choice
+	First,
+	/// Pick a choice at random
+	Random
+};
+
+/// How a dialogue should be advanced by the subsystem's scheduler, see USUDSSubsystem::ScheduleDialogue
+USTRUCT(BlueprintType)
+struct FSUDSAutoAdvancePolicy
+{
+	GENERATED_BODY()
+
+	/// Time to stay on each speaker line before advancing, in seconds
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="SUDS")
+	float LineDelay = 3.0f;
+
+	/// What to do when a speaker line has choices
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="SUDS")
+	ESUDSAutoChoiceMode ChoiceMode = ESUDSAutoChoiceMode::Random;
+
+	/// When there isn't time to advance every dialogue which is due in one frame, those with a higher priority go first
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="SUDS")
+	int32 Priority = 0;
+
+	/// Whether to restart the dialogue when it finishes, rather than removing it from the scheduler
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="SUDS")
+	bool bRestartWhenFinished = false;
+};
+
+/// Statistics about the work done by the subsystem's scheduler, see USUDSSubsystem::GetSchedulerStats
+USTRUCT(BlueprintType)
+struct FSUDSSchedulerStats
+{
+	GENERATED_BODY()
+
+	/// Number of dialogues currently scheduled
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	int32 NumScheduled = 0;
+
+	/// Number of dialogues advanced in the last frame
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	int32 NumAdvancedLastFrame = 0;
+
+	/// Number of dialogues which were due to advance in the last frame, but were put off until a later frame because
+	/// the frame budget had been used up
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	int32 NumDeferredLastFrame = 0;
+
+	/// Total number of times an advance has been put off to a later frame
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	int64 TotalDeferred = 0;
+
+	/// The most consecutive frames any one dialogue has had to wait past when it was due
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	int32 MaxFramesDeferred = 0;
+
+	/// Time spent advancing dialogues in the last frame, in milliseconds
+	UPROPERTY(BlueprintReadOnly, Category="SUDS")
+	float LastFrameTimeMs = 0;
+};
+
 /**
  * 
  */
 UCLASS()
-class SUDS_API USUDSSubsystem : public UGameInstanceSubsystem
+class SUDS_API USUDSSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
 {
 	GENERATED_BODY()
 
@@ -72,17 +167,62 @@ protected:
 	
 	/// Global variable state
 	TMap<FName, FSUDSValue> GlobalVariableState;
+	/// Changes whenever variables are added to / removed from GlobalVariableState, so handles know to look up again
+	uint32 GlobalVariableStateGeneration = FSUDSVariableHandle::NewStoreGeneration();
+
+	/// Seed which all dialogue random streams are derived from
+	int32 MasterRandomSeed = 0;
+
+	/// Dialogues registered for bulk save / restore, by key
+	TMap<FName, TWeakObjectPtr<USUDSDialogue>> RegisteredDialogues;
+
+	/// Dialogue states from a bulk restore which didn't have a registered dialogue yet; applied on registration
+	TMap<FName, FSUDSDialogueState> PendingDialogueStates;
+
+	struct FScheduledDialogue
+	{
+		TWeakObjectPtr<USUDSDialogue> Dialogue;
+		FSUDSAutoAdvancePolicy Policy;
+		/// Scheduler time at which this dialogue should next advance
+		double DueTime = 0;
+		/// Number of frames this dialogue has been due but not advanced
+		int32 FramesDeferred = 0;
+	};
+	/// Dialogues being advanced by the scheduler
+	TArray<FScheduledDialogue> ScheduledDialogues;
+	/// Time the scheduler has been ticked for, in seconds
+	double SchedulerTime = 0;
+	/// Maximum time to spend advancing scheduled dialogues each frame, in milliseconds
+	float SchedulerFrameBudgetMs = 1.0f;
+	/// True while the scheduler is advancing dialogues, which may schedule / unschedule others
+	bool bSchedulerTicking = false;
+	FSUDSSchedulerStats SchedulerStats;
+	/// Used to pick random choices in scheduled dialogues
+	FRandomStream SchedulerRandom;
+
+	/// Advance one scheduled dialogue, returns false if it should be removed from the scheduler
+	bool AdvanceScheduledDialogue(int32 Index);
 	
 	void SetGlobalVariableImpl(FName Name, const FSUDSValue& Value, bool bFromScript, int LineNo)
 	{
-		const FSUDSValue OldValue = GetGlobalVariable(Name);
-		if (!IsGlobalVariableSet(Name) ||
-			(OldValue != Value).GetBooleanValue())
+		SetGlobalVariableImpl(GlobalVariableState.Find(Name), Name, Value, bFromScript, LineNo);
+	}	
+	void SetGlobalVariableImpl(FSUDSValue* OldValue, FName Name, const FSUDSValue& Value, bool bFromScript, int LineNo)
+	{
+		if (!OldValue)
 		{
 			GlobalVariableState.Add(Name, Value);
+			InvalidateGlobalVariableHandles();
 			OnGlobalVariableChanged.Broadcast(Name, Value, bFromScript);
 		}
-	}	
+		else if ((*OldValue != Value).GetBooleanValue())
+		{
+			// Assign in place rather than Add, which can reallocate & invalidate handles
+			*OldValue = Value;
+			OnGlobalVariableChanged.Broadcast(Name, Value, bFromScript);
+		}
+	}
+	void InvalidateGlobalVariableHandles() { GlobalVariableStateGeneration = FSUDSVariableHandle::NewStoreGeneration(); }
 
 public:
 	/**
@@ -115,6 +255,23 @@ public:
 	USoundConcurrency* GetVoicedLineConcurrency() const { return VoiceConcurrency; }
 
 
+	/**
+	 * Set the master random seed. Each dialogue created after this derives its own random stream (used for [random]
+	 * blocks) from this seed combined with the identity of the dialogue, so setting this to a known value makes
+	 * random selections reproducible. Defaults to a different value every session.
+	 * @param Seed The new master seed
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Settings")
+	void SetMasterRandomSeed(int32 Seed)
+	{
+		MasterRandomSeed = Seed;
+		SchedulerRandom.Initialize(Seed);
+	}
+
+	/// Get the master random seed which dialogue random streams are derived from
+	UFUNCTION(BlueprintCallable, Category="SUDS|Settings")
+	int32 GetMasterRandomSeed() const { return MasterRandomSeed; }
+
 	/**
 	 * Reset the global state of the system.
 	 * @param bResetVariables If true, resets all variable state
@@ -136,6 +293,108 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
 	void RestoreSavedGlobalState(const FSUDSGlobalState& State);
+
+	/**
+	 * Register a dialogue so that its state is included in GetSavedBulkState / RestoreSavedBulkState.
+	 * If a bulk restore has already happened which included state for this key, the dialogue is restored immediately.
+	 * Dialogues are held weakly, so you don't have to unregister them when they're destroyed.
+	 * @param Key Identifier for this dialogue which must be the same across save / load, e.g. the NPC name
+	 * @param Dialogue The dialogue to register
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	void RegisterDialogue(FName Key, USUDSDialogue* Dialogue);
+
+	/// Stop including a dialogue in bulk state
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	void UnregisterDialogue(FName Key);
+
+	/// Get a registered dialogue by key, or null if not registered / no longer alive
+	UFUNCTION(BlueprintCallable, Category="SUDS|Dialogue")
+	USUDSDialogue* GetRegisteredDialogue(FName Key) const;
+
+	/// Get the keys & dialogues of all live registered dialogues
+	void GetRegisteredDialogues(TMap<FName, USUDSDialogue*>& OutDialogues) const;
+
+	/** Retrieve the state of all registered dialogues plus the global state, in a single compact block.
+	 *  Strings which appear many times, such as variable names and text IDs, are only stored once.
+	 *  @return A copy of the state of everything, which can be serialised with your save data.
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Global State")
+	FSUDSBulkState GetSavedBulkState() const;
+
+	/** Restore global state and the state of all registered dialogues from a previous GetSavedBulkState.
+	 *  Any dialogue states which don't currently have a registered dialogue are kept and restored when a dialogue is
+	 *  registered with the same key.
+	 *  @param State State that you previously retrieved from GetSavedBulkState()
+	 *  @return Whether the state could be read
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Global State")
+	bool RestoreSavedBulkState(const FSUDSBulkState& State);
+
+	/**
+	 * Have this subsystem advance a dialogue automatically, e.g. for ambient conversations & barks. Rather than each
+	 * dialogue being advanced by its own timer, which can result in many of them advancing in the same frame, the
+	 * scheduler advances those which are due within a time budget each frame, putting the rest off to the next frame.
+	 * If the dialogue isn't running it's started. Dialogues are held weakly, and removed from the scheduler when
+	 * they finish unless the policy says to restart them.
+	 * @param Dialogue The dialogue to advance
+	 * @param Policy How & when to advance the dialogue. If the dialogue is already scheduled, this replaces its policy
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Scheduler")
+	void ScheduleDialogue(USUDSDialogue* Dialogue, const FSUDSAutoAdvancePolicy& Policy);
+
+	/// Stop the scheduler advancing a dialogue
+	UFUNCTION(BlueprintCallable, Category="SUDS|Scheduler")
+	void UnscheduleDialogue(USUDSDialogue* Dialogue);
+
+	/// Whether a dialogue is being advanced by the scheduler
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="SUDS|Scheduler")
+	bool IsDialogueScheduled(const USUDSDialogue* Dialogue) const;
+
+	/**
+	 * Set the maximum time the scheduler spends advancing dialogues each frame. At least one dialogue is always
+	 * advanced when any are due, so that progress is made however small the budget.
+	 * @param Milliseconds The budget in milliseconds
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Scheduler")
+	void SetSchedulerFrameBudget(float Milliseconds) { SchedulerFrameBudgetMs = FMath::Max(0.0f, Milliseconds); }
+
+	/// Get the maximum time the scheduler spends advancing dialogues each frame, in milliseconds
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="SUDS|Scheduler")
+	float GetSchedulerFrameBudget() const { return SchedulerFrameBudgetMs; }
+
+	/// Get statistics about the scheduler, including how much work has been deferred because of the frame budget
+	UFUNCTION(BlueprintCallable, Category="SUDS|Scheduler")
+	FSUDSSchedulerStats GetSchedulerStats() const;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/**
+	 * Turn on or off counting how many times each node of every script is run, and how long it takes. Counts are
+	 * accumulated per script across all dialogues, so you can find the hot parts of your scripts. Off by default.
+	 */
+	UFUNCTION(BlueprintCallable, Category="SUDS|Profiling")
+	void SetScriptExecutionStatsEnabled(bool bEnabled) { USUDSScript::SetExecutionStatsEnabled(bEnabled); }
+
+	/// Whether script execution stats are being collected
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="SUDS|Profiling")
+	bool IsScriptExecutionStatsEnabled() const { return USUDSScript::IsExecutionStatsEnabled(); }
+
+	/// Get a snapshot of the execution stats of one script
+	UFUNCTION(BlueprintCallable, Category="SUDS|Profiling")
+	FSUDSScriptExecutionStats GetScriptExecutionStats(const USUDSScript* Script) const;
+
+	/// Get a snapshot of the execution stats of every loaded script which has run any nodes
+	void GetAllScriptExecutionStats(TMap<const USUDSScript*, FSUDSScriptExecutionStats>& OutStats) const;
+
+	/// Reset the execution stats of every loaded script to zero
+	UFUNCTION(BlueprintCallable, Category="SUDS|Profiling")
+	void ResetAllScriptExecutionStats();
 	
 	/// Set a global variable
 	/// This is mostly only useful if you happen to already have a general purpose FSUDSValue.
@@ -281,6 +540,44 @@ public:
 	UFUNCTION(BlueprintCallable, Category="SUDS|Global Variables")
 	void UnSetGlobalVariable(FName Name);
 
+	/**
+	 * Create a handle for fast repeated access to a global variable from C++. See FSUDSVariableHandle.
+	 * @param Name The name of the variable. The "global." prefix is optional here.
+	 */
+	static FSUDSVariableHandle GetGlobalVariableHandle(FName Name) { return FSUDSVariableHandle(Name); }
+
+	/// Handle versions of the global variable functions, see FSUDSVariableHandle.
+	/// These always access global variables, whether or not the handle was created with the "global." prefix.
+	const FSUDSValue* FindGlobalVariable(const FSUDSVariableHandle& Handle) const
+	{
+		return Handle.Find(GlobalVariableState, GlobalVariableStateGeneration);
+	}
+	void SetGlobalVariable(const FSUDSVariableHandle& Handle, const FSUDSValue& Value)
+	{
+		SetGlobalVariableImpl(Handle.Find(GlobalVariableState, GlobalVariableStateGeneration), Handle.GetName(), Value, false, 0);
+	}
+	FSUDSValue GetGlobalVariable(const FSUDSVariableHandle& Handle) const
+	{
+		if (const auto Arg = FindGlobalVariable(Handle))
+		{
+			return *Arg;
+		}
+		return FSUDSValue();
+	}
+	bool IsGlobalVariableSet(const FSUDSVariableHandle& Handle) const { return FindGlobalVariable(Handle) != nullptr; }
+	void SetGlobalVariableText(const FSUDSVariableHandle& Handle, FText Value) { SetGlobalVariable(Handle, Value); }
+	FText GetGlobalVariableText(const FSUDSVariableHandle& Handle) const;
+	void SetGlobalVariableInt(const FSUDSVariableHandle& Handle, int32 Value) { SetGlobalVariable(Handle, Value); }
+	int GetGlobalVariableInt(const FSUDSVariableHandle& Handle) const;
+	void SetGlobalVariableFloat(const FSUDSVariableHandle& Handle, float Value) { SetGlobalVariable(Handle, Value); }
+	float GetGlobalVariableFloat(const FSUDSVariableHandle& Handle) const;
+	void SetGlobalVariableGender(const FSUDSVariableHandle& Handle, ETextGender Value) { SetGlobalVariable(Handle, Value); }
+	ETextGender GetGlobalVariableGender(const FSUDSVariableHandle& Handle) const;
+	void SetGlobalVariableBoolean(const FSUDSVariableHandle& Handle, bool Value) { SetGlobalVariable(Handle, FSUDSValue(Value)); }
+	bool GetGlobalVariableBoolean(const FSUDSVariableHandle& Handle) const;
+	void SetGlobalVariableName(const FSUDSVariableHandle& Handle, FName Value) { SetGlobalVariable(Handle, FSUDSValue(Value, false)); }
+	FName GetGlobalVariableName(const FSUDSVariableHandle& Handle) const;
+
 #if WITH_EDITORONLY_DATA
 	/// Only for use by tests / editor tools when real subsystem isn't running
 	static TMap<FName, FSUDSValue> Test_DummyGlobalVariables;
@@ -0,0 +1,55 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SUDSValue.h"
+
+/**
+ * A pre-resolved reference to a variable, for C++ code which reads or writes the same variables very often.
+ * Create one up front with the variable name (using the "global." prefix for global variables, as in scripts), then
+ * pass it to the handle overloads of the variable functions on USUDSDialogue or USUDSSubsystem. Lookups are cached,
+ * and only repeated when the set of variables in the store changes (e.g. a new variable is set, or the dialogue is
+ * restarted or restored), so the handle remains valid across all of those. Setting a variable via a handle raises
+ * the same change notifications as setting it by name.
+ * Handles can be shared between dialogues, but are intended to be used from the game thread only.
+ */
+struct SUDS_API FSUDSVariableHandle
+{
+public:
+	FSUDSVariableHandle() {}
+	explicit FSUDSVariableHandle(FName InName);
+
+	/// Get the name of the variable, without any "global." prefix
+	FName GetName() const { return Name; }
+	/// Whether this handle refers to a global variable
+	bool IsGlobal() const { return bGlobal; }
+	bool IsValid() const { return !Name.IsNone(); }
+
+	/// Find the value in a variable store, re-using the previous lookup if the store hasn't changed since
+	/// StoreGeneration is the value maintained by the store via NewStoreGeneration
+	FSUDSValue* Find(TMap<FName, FSUDSValue>& Store, uint32 StoreGeneration) const
+	{
+		if (CachedGeneration != StoreGeneration)
+		{
+			CachedValue = Store.Find(Name);
+			CachedGeneration = StoreGeneration;
+		}
+		return CachedValue;
+	}
+	const FSUDSValue* Find(const TMap<FName, FSUDSValue>& Store, uint32 StoreGeneration) const
+	{
+		return Find(const_cast<TMap<FName, FSUDSValue>&>(Store), StoreGeneration);
+	}
+
+	/// Variable stores must call this to get a new generation whenever variables are added or removed, which
+	/// invalidates cached lookups. Generations are unique across all stores so handles can be used with any store.
+	static uint32 NewStoreGeneration();
+
+protected:
+	FName Name;
+	bool bGlobal = false;
+
+	mutable FSUDSValue* CachedValue = nullptr;
+	mutable uint32 CachedGeneration = 0;
+};
@@ -2,6 +2,7 @@
 // Released under the MIT license https://opensource.org/license/MIT/
 #include "SUDSEditorScriptTools.h"
 
+#include "SUDSEditorSettings.h"
 #include "SUDSMessageLogger.h"
 #include "SUDSScript.h"
 #include "SUDSScriptImporter.h"
@@ -14,17 +15,10 @@
 
 void FSUDSEditorScriptTools::WriteBackTextIDs(USUDSScript* Script, FSUDSMessageLogger& Logger)
 {
-	const auto& SrcData = Script->AssetImportData->SourceData; 
-	if (SrcData.SourceFiles.Num() == 1)
+	const FString SourceFile = GetSourceFilename(Script);
+	if (!SourceFile.IsEmpty())
 	{
 		TArray<FString> Lines;
-		FString SourceFile =  SrcData.SourceFiles[0].RelativeFilename;
-		auto Package = Script->GetPackage();
-		if (FPaths::IsRelative(SourceFile) && Package)
-		{
-			FString PackagePath = FPackageName::LongPackageNameToFilename(FPackageName::GetLongPackagePath(Package->GetPathName()));
-			SourceFile = FPaths::ConvertRelativePathToFull(PackagePath, SourceFile);
-		}
 		if (FFileHelper::LoadFileToStringArray(Lines, *SourceFile))
 		{
 			const int PrevErrs = Logger.NumErrors();
@@ -105,6 +99,51 @@ void FSUDSEditorScriptTools::WriteBackTextIDs(USUDSScript* Script, FSUDSMessageL
 	}
 }
 
+void FSUDSEditorScriptTools::AnalyseScript(USUDSScript* Script, FSUDSMessageLogger& Logger)
+{
+	const FString SourceFile = GetSourceFilename(Script);
+	if (SourceFile.IsEmpty())
+	{
+		Logger.AddMessage(EMessageSeverity::Error,
+		                  FText::FromString(
+			                  FString::Printf(TEXT("No source files associated with asset %s"), *Script->GetName())));
+		return;
+	}
+
+	FSUDSScriptImporter Importer;
+	if (Importer.ImportFromFile(SourceFile, Script->GetName(), &Logger, false))
+	{
+		// Importing already logged the analysis, just summarise
+		FSUDSScriptAnalysis Analysis;
+		Importer.AnalyseScript(Analysis, GetDefault<USUDSEditorSettings>()->VariablesProvidedByGame);
+		Logger.AddMessage(EMessageSeverity::Info,
+		                  FText::FromString(FString::Printf(
+			                  TEXT("Analysed %s: %d unreachable speaker lines, %d unused labels, %d variables never read, %d variables never set"),
+			                  *Script->GetName(),
+			                  Analysis.UnreachableSpeakerLines.Num(),
+			                  Analysis.UnusedLabels.Num(),
+			                  Analysis.UnreadVariables.Num(),
+			                  Analysis.UnsetVariables.Num())));
+	}
+}
+
+FString FSUDSEditorScriptTools::GetSourceFilename(const USUDSScript* Script)
+{
+	const auto& SrcData = Script->AssetImportData->SourceData; 
+	if (SrcData.SourceFiles.Num() != 1)
+	{
+		return FString();
+	}
+	FString SourceFile = SrcData.SourceFiles[0].RelativeFilename;
+	auto Package = Script->GetPackage();
+	if (FPaths::IsRelative(SourceFile) && Package)
+	{
+		FString PackagePath = FPackageName::LongPackageNameToFilename(FPackageName::GetLongPackagePath(Package->GetPathName()));
+		SourceFile = FPaths::ConvertRelativePathToFull(PackagePath, SourceFile);
+	}
+	return SourceFile;
+}
+
 bool FSUDSEditorScriptTools::WriteBackTextIDsFromNodes(const TArray<USUDSScriptNode*> Nodes, TArray<FString>& Lines, const FString& NameForErrors, FSUDSMessageLogger& Logger)
 {
 	bool bAnyChanges = false;
@@ -14,6 +14,7 @@
 #include "SUDSScriptNodeText.h"
 #include "SUDSSubsystem.h"
 #include "Framework/Text/SlateTextRun.h"
+#include "Misc/FileHelper.h"
 #include "Widgets/Input/SMultiLineEditableTextBox.h"
 #include "Widgets/Input/SNumericEntryBox.h"
 #include "Toolkits/AssetEditorToolkit.h"
@@ -60,7 +61,7 @@ void FSUDSEditorToolkit::InitEditor(const TArray<UObject*>& InObjects)
 
 		ReimportDelegateHandle = FReimportManager::Instance()->OnPostReimport().AddRaw(this, &FSUDSEditorToolkit::OnPostReimport);		
 
-		const TSharedRef<FTabManager::FLayout> Layout = FTabManager::NewLayout("SUDSEditorLayout_v3")
+		const TSharedRef<FTabManager::FLayout> Layout = FTabManager::NewLayout("SUDSEditorLayout_v4")
 			->AddArea
 			(
 				FTabManager::NewPrimaryArea()->SetOrientation(Orient_Horizontal)
@@ -87,6 +88,8 @@ void FSUDSEditorToolkit::InitEditor(const TArray<UObject*>& InObjects)
 							FTabManager::NewStack()
 							->SetSizeCoefficient(0.4f)
 							->AddTab("SUDSLogTab", ETabState::OpenedTab)
+							->AddTab("SUDSHeatmapTab", ETabState::OpenedTab)
+							->SetForegroundTab(FName("SUDSLogTab"))
 						)
 					)
 					->Split
@@ -301,6 +304,87 @@ void FSUDSEditorToolkit::RegisterTabSpawners(const TSharedRef<FTabManager>& InTa
 	.SetDisplayName(INVTEXT("Trace Log"))
 	.SetGroup(WorkspaceMenuCategory.ToSharedRef());	
 
+	InTabManager->RegisterTabSpawner("SUDSHeatmapTab", FOnSpawnTab::CreateLambda([this](const FSpawnTabArgs&)
+	{
+		HeatmapListView = SNew(SListView<TSharedPtr<FSUDSEditorOutputRow>>)
+#if ENGINE_MINOR_VERSION < 5
+				.ItemHeight(24)
+#endif
+				.SelectionMode(ESelectionMode::None)
+				.ListItemsSource(&HeatmapRows)
+				.OnGenerateRow(this, &FSUDSEditorToolkit::OnGenerateRowForOutput)
+				.HeaderRow(
+					SNew(SHeaderRow)
+					+ SHeaderRow::Column("PrefixHeader")
+					.FillSized(PrefixColumnWidth)
+					[
+						SNew( STextBlock )
+						.Text( INVTEXT("Line / Count") )
+					]
+					+ SHeaderRow::Column("LineHeader")
+					.FillWidth(1.0f)
+					[
+						SNew( STextBlock )
+						.Text( INVTEXT("Source") )
+					]
+				);
+
+		UpdateHeatmap();
+
+		return SNew(SDockTab)
+		[
+			SNew(SVerticalBox)
+			+ SVerticalBox::Slot()
+			.VAlign(VAlign_Top)
+			.AutoHeight()
+			[
+				SNew(SHorizontalBox)
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				.VAlign(VAlign_Center)
+				.Padding(10, 2, 5, 2)
+				[
+					SNew(SCheckBox)
+					.ToolTipText(INVTEXT("Count how many times each line of every script is run, by any dialogue including this one"))
+					.IsChecked(this, &FSUDSEditorToolkit::GetRecordStatsCheckState)
+					.OnCheckStateChanged(this, &FSUDSEditorToolkit::OnRecordStatsCheckStateChanged)
+					[
+						SNew(STextBlock)
+						.Text(INVTEXT("Record Execution Counts"))
+					]
+				]
+				+ SHorizontalBox::Slot()
+				.HAlign(HAlign_Right)
+				.Padding(2)
+				[
+					SNew(SButton)
+					.Text(INVTEXT("Refresh"))
+					.OnClicked_Lambda([this]()
+					{
+						UpdateHeatmap();
+						return FReply::Handled();
+					})
+				]
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				.Padding(2)
+				[
+					SNew(SButton)
+					.Text(INVTEXT("Reset"))
+					.OnClicked(this, &FSUDSEditorToolkit::ResetStatsClicked)
+				]
+			]
+			+ SVerticalBox::Slot()
+			.FillHeight(1.0)
+			[
+				HeatmapListView.ToSharedRef()
+			]
+		];
+
+	}))
+	.SetDisplayName(INVTEXT("Line Heatmap"))
+	.SetGroup(WorkspaceMenuCategory.ToSharedRef());	
+
 
 	// Set up the toolbar
 	FSUDSToolbarCommands::Register();
@@ -325,6 +409,9 @@ void FSUDSEditorToolkit::RegisterTabSpawners(const TSharedRef<FTabManager>& InTa
 	GetToolkitCommands()->MapAction(FSUDSToolbarCommands::Get().GenerateVOAssets,
 		FExecuteAction::CreateSP(this, &FSUDSEditorToolkit::GenerateVOAssets),
 		FCanExecuteAction());
+	GetToolkitCommands()->MapAction(FSUDSToolbarCommands::Get().AnalyseScript,
+		FExecuteAction::CreateSP(this, &FSUDSEditorToolkit::AnalyseScript),
+		FCanExecuteAction());
 
 	//RegenerateMenusAndToolbars();
 		
@@ -402,6 +489,16 @@ void FSUDSEditorToolkit::ExtendToolbar(FToolBarBuilder& ToolbarBuilder, TWeakPtr
 				FEditorStyle::GetStyleSetName(),
 #endif
 				TEXT("Icons.Toolbar.Export")));
+
+		ToolbarBuilder.AddToolBarButton(FSUDSToolbarCommands::Get().AnalyseScript,
+			NAME_None, TAttribute<FText>(), TAttribute<FText>(),
+			FSlateIcon(
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION > 0
+				FAppStyle::GetAppStyleSetName(),
+#else
+				FEditorStyle::GetStyleSetName(),
+#endif
+				TEXT("Icons.Search")));
 		
 	}
 	ToolbarBuilder.EndSection();
@@ -612,6 +709,88 @@ void FSUDSEditorToolkit::UpdateOutput()
 {
 	OutputListView->RequestListRefresh();
 	OutputListView->ScrollToBottom();
+	if (USUDSScript::IsExecutionStatsEnabled())
+	{
+		UpdateHeatmap();
+	}
+}
+
+void FSUDSEditorToolkit::UpdateHeatmap()
+{
+	if (!HeatmapListView.IsValid() || !IsValid(Script))
+	{
+		return;
+	}
+
+	if (HeatmapSourceLines.IsEmpty())
+	{
+		const FString SourceFile = FSUDSEditorScriptTools::GetSourceFilename(Script);
+		if (SourceFile.IsEmpty() || !FFileHelper::LoadFileToStringArray(HeatmapSourceLines, *SourceFile))
+		{
+			HeatmapRows.Empty();
+			HeatmapRows.Add(MakeShareable(new FSUDSEditorOutputRow(FText::GetEmpty(),
+				INVTEXT("Source file for this script could not be found"),
+				FSlateColor::UseForeground(), FSlateColor::UseForeground(), RowBgColour1)));
+			HeatmapListView->RequestListRefresh();
+			return;
+		}
+	}
+
+	TMap<int, FSUDSNodeExecutionStats> LineStats;
+	Script->GetExecutionStats().GetLineStats(LineStats);
+	int64 MaxCount = 1;
+	for (const auto& Pair : LineStats)
+	{
+		MaxCount = FMath::Max(MaxCount, Pair.Value.ExecutionCount);
+	}
+
+	HeatmapRows.Empty(HeatmapSourceLines.Num());
+	for (int i = 0; i < HeatmapSourceLines.Num(); ++i)
+	{
+		// Source line numbers start at 1
+		const int LineNo = i + 1;
+		FText Prefix = FText::AsNumber(LineNo);
+		FText Line = FText::FromString(HeatmapSourceLines[i]);
+		FSlateColor BgColour = RowBgColour1;
+		if (const FSUDSNodeExecutionStats* Stats = LineStats.Find(LineNo))
+		{
+			Prefix = FText::Format(INVTEXT("{0}   x{1}"), LineNo, Stats->ExecutionCount);
+			if (Stats->TotalTimeMs > 0)
+			{
+				Line = FText::Format(INVTEXT("{0}   ({1} ms)"), Line, FText::AsNumber(Stats->TotalTimeMs));
+			}
+			// Log scale so that lines run a few times still stand out next to very hot ones
+			const float Heat = FMath::LogX(static_cast<float>(MaxCount + 1), static_cast<float>(Stats->ExecutionCount + 1));
+			BgColour = FLinearColor::LerpUsingHSV(RowBgColour1.GetSpecifiedColor(), HeatmapHotColour, Heat);
+		}
+		HeatmapRows.Add(MakeShareable(new FSUDSEditorOutputRow(Prefix,
+			Line,
+			FSlateColor::UseForeground(),
+			FSlateColor::UseForeground(),
+			BgColour)));
+	}
+	HeatmapListView->RequestListRefresh();
+}
+
+ECheckBoxState FSUDSEditorToolkit::GetRecordStatsCheckState() const
+{
+	return USUDSScript::IsExecutionStatsEnabled() ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+}
+
+void FSUDSEditorToolkit::OnRecordStatsCheckStateChanged(ECheckBoxState NewState)
+{
+	USUDSScript::SetExecutionStatsEnabled(NewState == ECheckBoxState::Checked);
+	UpdateHeatmap();
+}
+
+FReply FSUDSEditorToolkit::ResetStatsClicked()
+{
+	if (IsValid(Script))
+	{
+		Script->ResetExecutionStats();
+	}
+	UpdateHeatmap();
+	return FReply::Handled();
 }
 
 void FSUDSEditorToolkit::UpdateChoiceButtons()
@@ -1029,6 +1208,8 @@ void FSUDSEditorToolkit::OnPostReimport(UObject* Object, bool bSuccess)
 		// Destroy any dialogue instance, will not be valid post-import
 		DestroyDialogue();
 		Clear();
+		HeatmapSourceLines.Empty();
+		UpdateHeatmap();
 	}
 }
 
@@ -1154,6 +1335,13 @@ void FSUDSEditorToolkit::GenerateVOAssets()
 	
 }
 
+void FSUDSEditorToolkit::AnalyseScript()
+{
+	FSUDSMessageLogger::ClearMessages();
+	FSUDSMessageLogger Logger;
+	FSUDSEditorScriptTools::AnalyseScript(Script, Logger);
+}
+
 void SSUDSEditorVariableItem::Construct(const FArguments& InArgs, const TSharedRef<STableViewBase>& InOwnerTableView)
 {
 	InitialWidth = InArgs._InitialWidth;
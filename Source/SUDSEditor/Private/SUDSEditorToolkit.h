@@ -42,6 +42,7 @@ public:
 		UI_COMMAND(StartDialogue, "Start Dialogue", "Start/restart dialogue", EUserInterfaceActionType::Button, FInputChord());
 		UI_COMMAND(WriteBackTextIDs, "Write String Keys", "Write string keys back to script source to stabilise for localisation / voice asset links", EUserInterfaceActionType::Button, FInputChord());
 		UI_COMMAND(GenerateVOAssets, "Generate Voice Assets", "Generate DialogueVoice and DialogueWave assets for VO", EUserInterfaceActionType::Button, FInputChord());
+		UI_COMMAND(AnalyseScript, "Analyse Script", "Look for unreachable speaker lines, unused labels and variables which are never read or never set", EUserInterfaceActionType::Button, FInputChord());
 	}
 
 public:
@@ -49,6 +50,7 @@ public:
 	TSharedPtr<FUICommandInfo> StartDialogue;
 	TSharedPtr<FUICommandInfo> WriteBackTextIDs;
 	TSharedPtr<FUICommandInfo> GenerateVOAssets;
+	TSharedPtr<FUICommandInfo> AnalyseScript;
 };
 
 
@@ -278,6 +280,10 @@ private:
 	TArray<TSharedPtr<FSUDSEditorVariableRow>> VariableRows;
 	TSharedPtr<SSUDSTraceLog> TraceLog;
 	TMap<FName, FSUDSValue> ManualOverrideVariables;
+	TSharedPtr<SListView<TSharedPtr<FSUDSEditorOutputRow>>> HeatmapListView;
+	TArray<TSharedPtr<FSUDSEditorOutputRow>> HeatmapRows;
+	/// Source of the script, loaded when the heatmap is first shown
+	TArray<FString> HeatmapSourceLines;
 
 	const FSlateColor SpeakerColour = FLinearColor(1.0f, 1.0f, 0.6f, 1.0f);
 	const FSlateColor ChoiceColour = FLinearColor(0.4f, 1.0f, 0.4f, 1.0f);
@@ -289,6 +295,7 @@ private:
 	const FSlateColor SelectColour = FLinearColor(1.0f, 0.0f, 0.5f, 1.0f);
 	const FSlateColor RowBgColour1 = FLinearColor(0.15f, 0.15f, 0.15f, 1.0f);
 	const FSlateColor RowBgColour2 = FLinearColor(0.3f, 0.3f, 0.3f, 1.0f);
+	const FLinearColor HeatmapHotColour = FLinearColor(0.8f, 0.2f, 0.0f, 1.0f);
 
 	void ExtendToolbar(FToolBarBuilder& ToolbarBuilder, TWeakPtr<SDockTab> Tab);
 	TSharedRef<class SWidget> GetStartLabelMenu();
@@ -306,6 +313,10 @@ private:
 	void AddTraceLogRow(const FName& Category, int SourceLineNo, const FString& Message);
 
 	void AddDialogueStep(const FName& Category, int SourceLineNo, const FText& Description, const FText& Prefix);
+	void UpdateHeatmap();
+	ECheckBoxState GetRecordStatsCheckState() const;
+	void OnRecordStatsCheckStateChanged(ECheckBoxState NewState);
+	FReply ResetStatsClicked();
 
 	void OnDialogueChoice(USUDSDialogue* Dialogue, int ChoiceIndex, int LineNo);
 	void OnDialogueEvent(USUDSDialogue* Dialogue, FName EventName, const TArray<FSUDSValue>& Args, int LineNo);
@@ -328,6 +339,7 @@ private:
 	void Clear();
 	void WriteBackTextIDs();
 	void GenerateVOAssets();
+	void AnalyseScript();
 
 };
 
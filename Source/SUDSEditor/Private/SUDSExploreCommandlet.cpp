@@ -0,0 +1,167 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#include "SUDSExploreCommandlet.h"
+
+#include "SUDSEditor.h"
+#include "SUDSPathExplorer.h"
+#include "SUDSScript.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+
+USUDSExploreCommandlet::USUDSExploreCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USUDSExploreCommandlet::Main(const FString& Params)
+{
+	FString Path = TEXT("/Game");
+	FString ReportFile;
+	FParse::Value(*Params, TEXT("Path="), Path);
+	FParse::Value(*Params, TEXT("Report="), ReportFile);
+	FSUDSPathExplorer Explorer;
+	FParse::Value(*Params, TEXT("MaxStates="), Explorer.MaxStatesPerScript);
+	FParse::Value(*Params, TEXT("Threads="), Explorer.NumWorkers);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	AssetRegistry.SearchAllAssets(true);
+	FARFilter Filter;
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION > 0
+	Filter.ClassPaths.Add(USUDSScript::StaticClass()->GetClassPathName());
+#else
+	Filter.ClassNames.Add(USUDSScript::StaticClass()->GetFName());
+#endif
+	Filter.PackagePaths.Add(FName(*Path));
+	Filter.bRecursivePaths = true;
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+	Assets.Sort([](const FAssetData& A, const FAssetData& B)
+	{
+		return A.PackageName.LexicalLess(B.PackageName);
+	});
+
+	// Loading has to happen on the game thread, exploring doesn't
+	TArray<const USUDSScript*> Scripts;
+	for (const FAssetData& Asset : Assets)
+	{
+		if (const USUDSScript* Script = Cast<USUDSScript>(Asset.GetAsset()))
+		{
+			Scripts.Add(Script);
+		}
+		else
+		{
+			UE_LOG(LogSUDSEditor, Error, TEXT("SUDSExplore: failed to load %s"), *Asset.PackageName.ToString());
+		}
+	}
+	const double LoadEndTime = FPlatformTime::Seconds();
+
+	TArray<FSUDSExploreResult> Results;
+	Explorer.Explore(Scripts, Results);
+	const double EndTime = FPlatformTime::Seconds();
+
+	// Summary
+	int NumWithProblems = 0;
+	int64 TotalStates = 0;
+	int64 MaxStates = 0;
+	FString Report;
+	auto Json = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Report);
+	auto WriteLines = [&Json](const TCHAR* Name, const TArray<int>& Lines)
+	{
+		Json->WriteArrayStart(Name);
+		for (const int Line : Lines)
+		{
+			Json->WriteValue(Line);
+		}
+		Json->WriteArrayEnd();
+	};
+	auto WriteIssues = [&Json](const TCHAR* Name, const TArray<FSUDSExploreIssue>& Issues)
+	{
+		Json->WriteArrayStart(Name);
+		for (const auto& Issue : Issues)
+		{
+			Json->WriteObjectStart();
+			Json->WriteValue(TEXT("line"), Issue.SourceLineNo);
+			Json->WriteValue(TEXT("text"), Issue.Description);
+			Json->WriteObjectEnd();
+		}
+		Json->WriteArrayEnd();
+	};
+	Json->WriteObjectStart();
+	Json->WriteArrayStart(TEXT("scripts"));
+	for (const auto& Result : Results)
+	{
+		const FString ScriptName = Result.Script->GetPathName();
+		if (Result.HasProblems())
+		{
+			++NumWithProblems;
+		}
+		TotalStates += Result.NumStates;
+		MaxStates = FMath::Max(MaxStates, Result.NumStates);
+
+		for (const int Line : Result.UnreachedSpeakerLines)
+		{
+			UE_LOG(LogSUDSEditor, Warning, TEXT("%s: Line %d: Speaker line can never be reached"), *ScriptName, Line);
+		}
+		for (const int Line : Result.UnreachedChoices)
+		{
+			UE_LOG(LogSUDSEditor, Warning, TEXT("%s: Line %d: Choice is never available"), *ScriptName, Line);
+		}
+		for (const auto& Issue : Result.DeadEnds)
+		{
+			UE_LOG(LogSUDSEditor, Error, TEXT("%s: Line %d: Dead end: %s"), *ScriptName, Issue.SourceLineNo, *Issue.Description);
+		}
+		for (const auto& Issue : Result.Loops)
+		{
+			UE_LOG(LogSUDSEditor, Error, TEXT("%s: Line %d: Loop: %s"), *ScriptName, Issue.SourceLineNo, *Issue.Description);
+		}
+		if (Result.bTruncated)
+		{
+			UE_LOG(LogSUDSEditor, Warning, TEXT("%s: more than %lld states, not fully explored"), *ScriptName, Explorer.MaxStatesPerScript);
+		}
+
+		Json->WriteObjectStart();
+		Json->WriteValue(TEXT("asset"), ScriptName);
+		Json->WriteValue(TEXT("startPoints"), Result.NumStartPoints);
+		Json->WriteValue(TEXT("states"), Result.NumStates);
+		Json->WriteValue(TEXT("truncated"), Result.bTruncated);
+		Json->WriteValue(TEXT("speakerLines"), Result.NumSpeakerLines);
+		Json->WriteValue(TEXT("speakerLineCoverage"), Result.GetSpeakerLineCoverage());
+		WriteLines(TEXT("unreachedSpeakerLines"), Result.UnreachedSpeakerLines);
+		Json->WriteValue(TEXT("choices"), Result.NumChoices);
+		Json->WriteValue(TEXT("choiceCoverage"), Result.GetChoiceCoverage());
+		WriteLines(TEXT("unreachedChoices"), Result.UnreachedChoices);
+		WriteIssues(TEXT("deadEnds"), Result.DeadEnds);
+		WriteIssues(TEXT("loops"), Result.Loops);
+		Json->WriteObjectEnd();
+	}
+	Json->WriteArrayEnd();
+	Json->WriteValue(TEXT("numScripts"), Results.Num());
+	Json->WriteValue(TEXT("numWithProblems"), NumWithProblems);
+	Json->WriteValue(TEXT("totalStates"), TotalStates);
+	Json->WriteValue(TEXT("maxStates"), MaxStates);
+	Json->WriteValue(TEXT("loadMs"), (LoadEndTime - StartTime) * 1000.0);
+	Json->WriteValue(TEXT("exploreMs"), (EndTime - LoadEndTime) * 1000.0);
+	Json->WriteValue(TEXT("totalMs"), (EndTime - StartTime) * 1000.0);
+	Json->WriteObjectEnd();
+	Json->Close();
+
+	if (ReportFile.IsEmpty())
+	{
+		UE_LOG(LogSUDSEditor, Display, TEXT("%s"), *Report);
+	}
+	else if (!FFileHelper::SaveStringToFile(Report, *ReportFile, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogSUDSEditor, Error, TEXT("SUDSExplore: failed to write report to %s"), *ReportFile);
+	}
+
+	UE_LOG(LogSUDSEditor, Display, TEXT("SUDSExplore: %d scripts, %d with problems, %lld states (largest %lld) in %.2fs"),
+	       Results.Num(), NumWithProblems, TotalStates, MaxStates, EndTime - StartTime);
+
+	return NumWithProblems > 0 ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#include "SUDSImportCache.h"
+
+#include "SUDSEditorSettings.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "Logging/TokenizedMessage.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+/// Identifies a cache entry file; changes if the layout of the entry changes
+static const uint32 CacheEntryMagic = 0x53554443; // "SUDC"
+
+FString FSUDSImportCache::MakeKey(const FMD5Hash& SourceHash, const FString& PackagePath)
+{
+	FMD5 MD5;
+	MD5.Update(SourceHash.GetBytes(), SourceHash.GetSize());
+	MD5.Update(reinterpret_cast<const uint8*>(&FSUDSScriptImporter::ImporterVersion), sizeof(FSUDSScriptImporter::ImporterVersion));
+	const FString& Settings = GetSettingsString();
+	MD5.Update(reinterpret_cast<const uint8*>(*Settings), Settings.Len() * sizeof(TCHAR));
+	MD5.Update(reinterpret_cast<const uint8*>(*PackagePath), PackagePath.Len() * sizeof(TCHAR));
+
+	FMD5Hash Hash;
+	Hash.Set(MD5);
+	return LexToString(Hash);
+}
+
+FString FSUDSImportCache::MakeKeyForFile(const FString& Filename, const FString& PackagePath)
+{
+	const FMD5Hash FileHash = FMD5Hash::HashFile(*Filename);
+	if (!FileHash.IsValid())
+	{
+		return FString();
+	}
+	return MakeKey(FileHash, PackagePath);
+}
+
+bool FSUDSImportCache::IsUpToDate(const USUDSScript* Script, const FString& Key)
+{
+#if WITH_EDITORONLY_DATA
+	return Script && !Key.IsEmpty() && Script->ImportCacheKey == Key;
+#else
+	return false;
+#endif
+}
+
+const FString& FSUDSImportCache::GetSettingsString()
+{
+	// Settings can be changed in the editor at any time, so this has to be rebuilt every time. It's cheap compared to
+	// an import.
+	static thread_local FString Settings;
+	Settings.Reset();
+	const UClass* Class = USUDSEditorSettings::StaticClass();
+	const USUDSEditorSettings* Defaults = GetDefault<USUDSEditorSettings>();
+	for (TFieldIterator<FProperty> It(Class); It; ++It)
+	{
+		if (It->HasAnyPropertyFlags(CPF_Config))
+		{
+			Settings.Append(It->GetName());
+			Settings.AppendChar(TEXT('='));
+			It->ExportTextItem_InContainer(Settings, Defaults, nullptr, nullptr, PPF_None);
+			Settings.AppendChar(TEXT(';'));
+		}
+	}
+	return Settings;
+}
+
+FString FSUDSImportCache::GetEntryFilename(const FString& CacheDir, const FString& Key)
+{
+	// Spread entries over subdirectories so that large shared caches don't end up with one enormous directory
+	return CacheDir / Key.Left(2) / Key + TEXT(".sudcache");
+}
+
+bool FSUDSImportCache::Load(const FString& CacheDir, const FString& Key, FSUDSScriptImporter& Importer, FSUDSMessageLogger* Logger)
+{
+	if (CacheDir.IsEmpty() || Key.IsEmpty())
+	{
+		return false;
+	}
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *GetEntryFilename(CacheDir, Key), FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	FObjectAndNameAsStringProxyArchive Ar(Reader, false);
+	uint32 Magic = 0;
+	int32 Version = 0;
+	Ar << Magic;
+	Ar << Version;
+	if (Magic != CacheEntryMagic || Version != FSUDSScriptImporter::ImporterVersion)
+	{
+		return false;
+	}
+
+	TArray<uint8> Severities;
+	TArray<FString> Messages;
+	Ar << Severities;
+	Ar << Messages;
+	Importer.SerializeParsedState(Ar);
+	if (Ar.IsError() || Severities.Num() != Messages.Num())
+	{
+		return false;
+	}
+
+	if (Logger)
+	{
+		for (int i = 0; i < Messages.Num(); ++i)
+		{
+			Logger->AddMessage(static_cast<EMessageSeverity::Type>(Severities[i]), FText::FromString(Messages[i]));
+		}
+	}
+	return true;
+}
+
+bool FSUDSImportCache::Save(const FString& CacheDir, const FString& Key, FSUDSScriptImporter& Importer, const FSUDSMessageLogger* Logger)
+{
+	if (CacheDir.IsEmpty() || Key.IsEmpty())
+	{
+		return false;
+	}
+
+	TArray<uint8> Severities;
+	TArray<FString> Messages;
+	if (Logger)
+	{
+		for (const auto& Msg : Logger->GetErrorMessages())
+		{
+			Severities.Add(static_cast<uint8>(Msg->GetSeverity()));
+			Messages.Add(Msg->ToText().ToString());
+		}
+	}
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	FObjectAndNameAsStringProxyArchive Ar(Writer, false);
+	uint32 Magic = CacheEntryMagic;
+	int32 Version = FSUDSScriptImporter::ImporterVersion;
+	Ar << Magic;
+	Ar << Version;
+	Ar << Severities;
+	Ar << Messages;
+	Importer.SerializeParsedState(Ar);
+
+	// Write to a temp file and move it into place, so that other machines sharing the cache never see a partial entry
+	const FString Filename = GetEntryFilename(CacheDir, Key);
+	const FString TempFilename = FPaths::CreateTempFilename(*FPaths::GetPath(Filename), TEXT("SUDS"), TEXT(".tmp"));
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempFilename))
+	{
+		return false;
+	}
+	if (!IFileManager::Get().Move(*Filename, *TempFilename, true, true, false, true))
+	{
+		IFileManager::Get().Delete(*TempFilename, false, false, true);
+		return false;
+	}
+	return true;
+}
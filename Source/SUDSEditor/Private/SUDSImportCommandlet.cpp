@@ -0,0 +1,261 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#include "SUDSImportCommandlet.h"
+
+#include "FileHelpers.h"
+#include "ObjectTools.h"
+#include "PackageTools.h"
+#include "SUDSEditor.h"
+#include "SUDSImportCache.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptFactory.h"
+#include "SUDSScriptImporter.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Async/ParallelFor.h"
+#include "Logging/TokenizedMessage.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+
+/// Everything we need to know about one script as it goes through the import
+struct FSUDSCommandletScript
+{
+	FString Filename;
+	FString PackageName;
+	FString AssetName;
+	FSUDSScriptImporter Importer;
+	FSUDSMessageLogger Logger{false};
+	FMD5Hash Hash;
+	FString CacheKey;
+	bool bUpToDate = false;
+	bool bFromCache = false;
+	bool bParsed = false;
+	bool bCreated = false;
+	double ParseSeconds = 0;
+	double CreateSeconds = 0;
+};
+
+USUDSImportCommandlet::USUDSImportCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USUDSImportCommandlet::Main(const FString& Params)
+{
+	FString SourceDir;
+	FString DestPath;
+	FString ReportFile;
+	if (!FParse::Value(*Params, TEXT("Source="), SourceDir) || !FPaths::DirectoryExists(SourceDir))
+	{
+		UE_LOG(LogSUDSEditor, Error, TEXT("SUDSImport: -Source=<dir> must be an existing directory"));
+		return 1;
+	}
+	const bool bValidateOnly = FParse::Param(*Params, TEXT("ValidateOnly"));
+	const bool bSave = !FParse::Param(*Params, TEXT("NoSave"));
+	const bool bForce = FParse::Param(*Params, TEXT("Force"));
+	if (!FParse::Value(*Params, TEXT("Dest="), DestPath) && !bValidateOnly)
+	{
+		UE_LOG(LogSUDSEditor, Error, TEXT("SUDSImport: -Dest=<content path> is required unless -ValidateOnly is used"));
+		return 1;
+	}
+	FParse::Value(*Params, TEXT("Report="), ReportFile);
+	FString CacheDir;
+	FParse::Value(*Params, TEXT("Cache="), CacheDir);
+
+	FPaths::NormalizeDirectoryName(SourceDir);
+	const double StartTime = FPlatformTime::Seconds();
+
+	TArray<FString> Files;
+	IFileManager::Get().FindFilesRecursive(Files, *SourceDir, TEXT("*.sud"), true, false);
+	Files.Sort();
+
+	TArray<TUniquePtr<FSUDSCommandletScript>> Scripts;
+	Scripts.Reserve(Files.Num());
+	for (const FString& File : Files)
+	{
+		auto S = MakeUnique<FSUDSCommandletScript>();
+		S->Filename = File;
+		S->AssetName = ObjectTools::SanitizeObjectName(FPaths::GetBaseFilename(File));
+		// Preserve the directory structure under the source dir
+		FString RelativeDir = FPaths::GetPath(File);
+		FPaths::MakePathRelativeTo(RelativeDir, *(SourceDir / TEXT("")));
+		S->PackageName = UPackageTools::SanitizePackageName(DestPath / RelativeDir / S->AssetName);
+		Scripts.Add(MoveTemp(S));
+	}
+
+	// Hash sources for the import cache
+	ParallelFor(Scripts.Num(), [&Scripts](int32 Index)
+	{
+		FSUDSCommandletScript& S = *Scripts[Index];
+		S.Hash = FMD5Hash::HashFile(*S.Filename);
+		if (S.Hash.IsValid())
+		{
+			S.CacheKey = FSUDSImportCache::MakeKey(S.Hash, FPackageName::GetLongPackagePath(S.PackageName));
+		}
+	});
+
+	// Existing assets which were imported from the same source with the same settings don't need importing again
+	if (!bValidateOnly && !bForce)
+	{
+		for (auto& S : Scripts)
+		{
+			if (FPackageName::DoesPackageExist(S->PackageName))
+			{
+				const FString ObjectPath = S->PackageName + TEXT(".") + S->AssetName;
+				const USUDSScript* Existing = LoadObject<USUDSScript>(nullptr, *ObjectPath, nullptr, LOAD_NoWarn | LOAD_Quiet);
+				S->bUpToDate = FSUDSImportCache::IsUpToDate(Existing, S->CacheKey);
+			}
+		}
+	}
+
+	// Parsing & validation only touch each importer's own state, so can run on all cores
+	ParallelFor(Scripts.Num(), [&Scripts, &CacheDir](int32 Index)
+	{
+		FSUDSCommandletScript& S = *Scripts[Index];
+		if (S.bUpToDate)
+		{
+			return;
+		}
+		const double ParseStart = FPlatformTime::Seconds();
+		S.bFromCache = FSUDSImportCache::Load(CacheDir, S.CacheKey, S.Importer, &S.Logger);
+		if (S.bFromCache)
+		{
+			S.bParsed = true;
+		}
+		else
+		{
+			S.bParsed = S.Importer.ImportFromFile(S.Filename, FPaths::GetBaseFilename(S.Filename), &S.Logger, false);
+			if (S.bParsed)
+			{
+				FSUDSImportCache::Save(CacheDir, S.CacheKey, S.Importer, &S.Logger);
+			}
+		}
+		S.ParseSeconds = FPlatformTime::Seconds() - ParseStart;
+	});
+	const double ParseEndTime = FPlatformTime::Seconds();
+
+	// Creating objects & string tables must happen on the game thread
+	if (!bValidateOnly)
+	{
+		USUDSScriptFactory* Factory = NewObject<USUDSScriptFactory>();
+		for (auto& S : Scripts)
+		{
+			if (!S->bParsed || S->bUpToDate)
+			{
+				continue;
+			}
+			const double CreateStart = FPlatformTime::Seconds();
+			UPackage* Package = CreatePackage(*S->PackageName);
+			Package->FullyLoad();
+			if (USUDSScript* Script = Factory->CreateScriptFromImporter(S->Importer,
+			                                                            Package,
+			                                                            FName(S->AssetName),
+			                                                            RF_Public | RF_Standalone | RF_Transactional,
+			                                                            S->Filename,
+			                                                            S->Hash,
+			                                                            &S->Logger))
+			{
+				FAssetRegistryModule::AssetCreated(Script);
+				Package->MarkPackageDirty();
+				S->bCreated = true;
+			}
+			S->CreateSeconds = FPlatformTime::Seconds() - CreateStart;
+		}
+	}
+	const double CreateEndTime = FPlatformTime::Seconds();
+
+	if (bSave && !bValidateOnly)
+	{
+		// Includes string tables created in their own packages
+		TArray<UPackage*> DirtyPackages;
+		FEditorFileUtils::GetDirtyContentPackages(DirtyPackages);
+		UEditorLoadingAndSavingUtils::SavePackages(DirtyPackages, true);
+	}
+	const double EndTime = FPlatformTime::Seconds();
+
+	// Summary
+	int NumFailed = 0;
+	int TotalErrors = 0;
+	int TotalWarnings = 0;
+	FString Report;
+	auto Json = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Report);
+	Json->WriteObjectStart();
+	Json->WriteArrayStart(TEXT("scripts"));
+	for (auto& S : Scripts)
+	{
+		const bool bSuccess = S->bUpToDate || (S->bParsed && (bValidateOnly || S->bCreated));
+		if (!bSuccess)
+		{
+			++NumFailed;
+		}
+
+		Json->WriteObjectStart();
+		Json->WriteValue(TEXT("file"), S->Filename);
+		if (!bValidateOnly)
+		{
+			Json->WriteValue(TEXT("asset"), S->PackageName);
+		}
+		Json->WriteValue(TEXT("success"), bSuccess);
+		Json->WriteValue(TEXT("upToDate"), S->bUpToDate);
+		Json->WriteValue(TEXT("fromCache"), S->bFromCache);
+		Json->WriteValue(TEXT("parseMs"), S->ParseSeconds * 1000.0);
+		Json->WriteValue(TEXT("createMs"), S->CreateSeconds * 1000.0);
+		Json->WriteArrayStart(TEXT("messages"));
+		for (const auto& Msg : S->Logger.GetErrorMessages())
+		{
+			const FString Text = Msg->ToText().ToString();
+			const TCHAR* Severity = TEXT("info");
+			switch (Msg->GetSeverity())
+			{
+			case EMessageSeverity::Error:
+				Severity = TEXT("error");
+				++TotalErrors;
+				UE_LOG(LogSUDSEditor, Error, TEXT("%s"), *Text);
+				break;
+			case EMessageSeverity::Warning:
+			case EMessageSeverity::PerformanceWarning:
+				Severity = TEXT("warning");
+				++TotalWarnings;
+				UE_LOG(LogSUDSEditor, Warning, TEXT("%s"), *Text);
+				break;
+			default:
+				UE_LOG(LogSUDSEditor, Display, TEXT("%s"), *Text);
+				break;
+			}
+			Json->WriteObjectStart();
+			Json->WriteValue(TEXT("severity"), Severity);
+			Json->WriteValue(TEXT("text"), Text);
+			Json->WriteObjectEnd();
+		}
+		Json->WriteArrayEnd();
+		Json->WriteObjectEnd();
+	}
+	Json->WriteArrayEnd();
+	Json->WriteValue(TEXT("numScripts"), Scripts.Num());
+	Json->WriteValue(TEXT("numFailed"), NumFailed);
+	Json->WriteValue(TEXT("numErrors"), TotalErrors);
+	Json->WriteValue(TEXT("numWarnings"), TotalWarnings);
+	Json->WriteValue(TEXT("parseMs"), (ParseEndTime - StartTime) * 1000.0);
+	Json->WriteValue(TEXT("createMs"), (CreateEndTime - ParseEndTime) * 1000.0);
+	Json->WriteValue(TEXT("saveMs"), (EndTime - CreateEndTime) * 1000.0);
+	Json->WriteValue(TEXT("totalMs"), (EndTime - StartTime) * 1000.0);
+	Json->WriteObjectEnd();
+	Json->Close();
+
+	if (ReportFile.IsEmpty())
+	{
+		UE_LOG(LogSUDSEditor, Display, TEXT("%s"), *Report);
+	}
+	else if (!FFileHelper::SaveStringToFile(Report, *ReportFile, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogSUDSEditor, Error, TEXT("SUDSImport: failed to write report to %s"), *ReportFile);
+	}
+
+	UE_LOG(LogSUDSEditor, Display, TEXT("SUDSImport: %d scripts, %d failed, %d errors, %d warnings in %.2fs"),
+	       Scripts.Num(), NumFailed, TotalErrors, TotalWarnings, EndTime - StartTime);
+
+	return NumFailed > 0 ? 1 : 0;
+}
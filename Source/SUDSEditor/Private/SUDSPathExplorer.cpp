@@ -0,0 +1,848 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#include "SUDSPathExplorer.h"
+
+#include "SUDSCommon.h"
+#include "SUDSLibrary.h"
+#include "SUDSScript.h"
+#include "SUDSScriptNode.h"
+#include "SUDSScriptNodeGosub.h"
+#include "SUDSScriptNodeSet.h"
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+#include <atomic>
+
+namespace SUDSPathExplorer
+{
+	/// The state of a dialogue at one point on a path
+	struct FState
+	{
+		int32 ScriptIndex = 0;
+		/// The speaker line this state is at, or the node to start running from for start points
+		const USUDSScriptNode* Node = nullptr;
+		bool bStartPoint = false;
+		TMap<FName, FSUDSValue> Variables;
+		TMap<FName, FSUDSValue> GlobalVariables;
+		/// Variables (global ones with their prefix) which a [set] in the body has given a known value on this path.
+		/// Any others could have any value, since the game can override header values and set globals itself
+		TSet<FName> DeterminedVariables;
+		TArray<const USUDSScriptNodeGosub*> GosubStack;
+		/// Sorted hashes of the text IDs of choices taken
+		TArray<uint32> ChoicesTaken;
+	};
+
+	/// An explored speaker line state, and where it can go next
+	struct FStateRecord
+	{
+		uint64 Hash = 0;
+		const USUDSScriptNode* Node = nullptr;
+		TArray<uint64> Successors;
+		/// Whether some path from here ends, or stops at a problem which has been reported already
+		bool bCanEnd = false;
+	};
+
+	/// What one worker found in one script
+	struct FScriptFindings
+	{
+		TSet<const USUDSScriptNode*> LinesReached;
+		TSet<const FSUDSScriptEdge*> ChoicesReached;
+		TMap<int, FString> DeadEnds;
+		TMap<int, FString> Loops;
+		TArray<FStateRecord> States;
+		/// Number of paths which stopped at a dead end or loop, already reported above
+		int64 NumPathsStopped = 0;
+	};
+
+	struct FScriptRun
+	{
+		const USUDSScript* Script = nullptr;
+		std::atomic<int64> NumStates { 0 };
+		std::atomic<bool> bTruncated { false };
+	};
+
+	/// A worker's queue of states to explore. The owner pushes & pops at the back, so it explores depth first which
+	/// keeps queues short; other workers steal from the front, which is nearer the root so likely has more work under it
+	struct FWorkerQueue
+	{
+		FCriticalSection Lock;
+		TArray<FState> States;
+	};
+
+	/// Hashes of states seen so far, split into shards so workers rarely wait on each other
+	struct FVisitedShard
+	{
+		FCriticalSection Lock;
+		TSet<uint64> Hashes;
+	};
+
+	static uint64 Mix(uint64 X)
+	{
+		// SplitMix64 finaliser
+		X ^= X >> 30;
+		X *= 0xBF58476D1CE4E5B9ull;
+		X ^= X >> 27;
+		X *= 0x94D049BB133111EBull;
+		X ^= X >> 31;
+		return X;
+	}
+
+	static uint64 HashValue(const FSUDSValue& Value)
+	{
+		uint64 Bits = 0;
+		switch (Value.GetType())
+		{
+		case ESUDSValueType::Int:
+			Bits = static_cast<uint32>(Value.GetIntValue());
+			break;
+		case ESUDSValueType::Float:
+			{
+				const float FloatVal = Value.GetFloatValue();
+				uint32 FloatBits;
+				FMemory::Memcpy(&FloatBits, &FloatVal, sizeof(float));
+				Bits = FloatBits;
+				break;
+			}
+		case ESUDSValueType::Boolean:
+			Bits = Value.GetBooleanValue() ? 1 : 0;
+			break;
+		case ESUDSValueType::Gender:
+			Bits = static_cast<uint64>(Value.GetGenderValue());
+			break;
+		case ESUDSValueType::Text:
+			Bits = GetTypeHash(Value.GetTextValue().ToString());
+			break;
+		case ESUDSValueType::Name:
+		case ESUDSValueType::Variable:
+			Bits = GetTypeHash(Value.GetNameValue());
+			break;
+		default:
+		case ESUDSValueType::Empty:
+			break;
+		}
+		return Mix(Bits ^ (static_cast<uint64>(Value.GetType()) << 56));
+	}
+
+	static uint64 HashVariables(const TMap<FName, FSUDSValue>& Variables)
+	{
+		// Order independent, since the same variables can be set in a different order on different paths
+		uint64 Sum = 0;
+		for (auto& Pair : Variables)
+		{
+			Sum += Mix(HashValue(Pair.Value) + GetTypeHash(Pair.Key) * 0x9E3779B97F4A7C15ull);
+		}
+		return Sum;
+	}
+
+	static uint64 HashNames(const TSet<FName>& Names)
+	{
+		// Order independent, same as variables
+		uint64 Sum = 0;
+		for (const FName& Name : Names)
+		{
+			Sum += Mix(GetTypeHash(Name) * 0x9E3779B97F4A7C15ull);
+		}
+		return Sum;
+	}
+
+	static uint64 HashState(const FState& State)
+	{
+		uint64 Hash = Mix(static_cast<uint64>(State.ScriptIndex) + 1);
+		Hash = Mix(Hash ^ reinterpret_cast<UPTRINT>(State.Node));
+		Hash = Mix(Hash ^ HashVariables(State.Variables));
+		Hash = Mix(Hash ^ (HashVariables(State.GlobalVariables) + 1));
+		Hash = Mix(Hash ^ (HashNames(State.DeterminedVariables) + 2));
+		for (const auto Gosub : State.GosubStack)
+		{
+			Hash = Mix(Hash ^ reinterpret_cast<UPTRINT>(Gosub));
+		}
+		Hash = Mix(Hash + State.GosubStack.Num());
+		for (const uint32 Choice : State.ChoicesTaken)
+		{
+			Hash = Mix(Hash ^ Choice);
+		}
+		return Hash;
+	}
+
+	class FExploration
+	{
+	public:
+		FExploration(const FSUDSPathExplorer& InSettings, const TArray<const USUDSScript*>& Scripts, int32 InNumWorkers)
+			: Settings(InSettings), NumWorkers(InNumWorkers)
+		{
+			for (const USUDSScript* Script : Scripts)
+			{
+				auto Run = MakeUnique<FScriptRun>();
+				Run->Script = Script;
+				Runs.Add(MoveTemp(Run));
+			}
+			Queues = MakeUnique<FWorkerQueue[]>(NumWorkers);
+			Findings.SetNum(NumWorkers);
+			for (auto& WorkerFindings : Findings)
+			{
+				WorkerFindings.SetNum(Scripts.Num());
+			}
+		}
+
+		void Run();
+		void GetResults(TArray<FSUDSExploreResult>& OutResults) const;
+
+	protected:
+		static constexpr int32 NumVisitedShards = 64;
+
+		const FSUDSPathExplorer& Settings;
+		const int32 NumWorkers;
+		TArray<TUniquePtr<FScriptRun>> Runs;
+		TUniquePtr<FWorkerQueue[]> Queues;
+		FVisitedShard VisitedShards[NumVisitedShards];
+		/// States queued but not yet fully explored, across all workers; when this is 0, we're done
+		std::atomic<int64> Outstanding { 0 };
+		/// Indexed by worker, then script
+		TArray<TArray<FScriptFindings>> Findings;
+
+		static bool IsUndetermined(const FSUDSExpression& Expression, const FState& State);
+		void AddStartPoints(int32 ScriptIndex, int32& NextQueue);
+		void RunWorker(int32 WorkerIndex);
+		bool PopOrSteal(int32 WorkerIndex, FState& OutState);
+		void Push(int32 WorkerIndex, FState&& State);
+		bool TryVisit(uint64 Hash);
+		void ExploreState(int32 WorkerIndex, FState& State);
+
+		template <typename CallbackType>
+		void RunUntilSpeakerLine(const USUDSScriptNode* FromNode,
+		                         FState&& FromState,
+		                         bool bStopAtChoice,
+		                         FScriptFindings& Found,
+		                         CallbackType&& Callback) const;
+		void RunSelect(const USUDSScriptNode* Node, const FState& State, TArray<const USUDSScriptNode*>& OutTargets) const;
+		void AppendChoices(const USUDSScriptNode* Node, const FState& State, TArray<const FSUDSScriptEdge*>& OutChoices) const;
+		void FindLoops(const TArray<const FStateRecord*>& States, TMap<int, FString>& OutLoops) const;
+	};
+
+	template <typename CallbackType>
+	void FExploration::RunUntilSpeakerLine(const USUDSScriptNode* FromNode,
+	                                       FState&& FromState,
+	                                       bool bStopAtChoice,
+	                                       FScriptFindings& Found,
+	                                       CallbackType&& Callback) const
+	{
+		// Mirrors USUDSDialogue::RunUntilNextSpeakerNodeOrEnd, except that random selects take every option, each as
+		// a separate branch. Calls back with the speaker line (or choice, if bStopAtChoice) reached, or null for the end
+		struct FBranch
+		{
+			const USUDSScriptNode* Node;
+			FState State;
+			int32 NodesRun;
+		};
+		const USUDSScript* Script = Runs[FromState.ScriptIndex]->Script;
+		TArray<FBranch> Branches;
+		Branches.Add(FBranch { FromNode, MoveTemp(FromState), 0 });
+		while (Branches.Num() > 0)
+		{
+			FBranch Branch = Branches.Pop();
+			const USUDSScriptNode* Node = Branch.Node;
+			bool bAbandoned = false;
+			while (Node &&
+				Node->GetNodeType() != ESUDSScriptNodeType::Text &&
+				Node->GetNodeType() != ESUDSScriptNodeType::Choice)
+			{
+				if (Settings.NodeBudget > 0 && ++Branch.NodesRun > Settings.NodeBudget)
+				{
+					Found.Loops.FindOrAdd(Node->GetSourceLineNo(),
+					                      FString::Printf(TEXT("Runs more than %d nodes without reaching a speaker line"), Settings.NodeBudget));
+					++Found.NumPathsStopped;
+					bAbandoned = true;
+					break;
+				}
+
+				switch (Node->GetNodeType())
+				{
+				case ESUDSScriptNodeType::Select:
+					{
+						TArray<const USUDSScriptNode*> Targets;
+						if (Node->IsRandomSelect())
+						{
+							// Every option is a separate path
+							for (int i = Node->GetEdgeCount() - 1; i > 0; --i)
+							{
+								FState OptionState = Branch.State;
+								OptionState.Variables.Add(FSUDSConstants::RandomItemSelectIndexVarName, FSUDSValue(i));
+								Targets.Reset();
+								RunSelect(Node, OptionState, Targets);
+								// Only the select reads this, leaving it in would make otherwise identical states differ
+								OptionState.Variables.Remove(FSUDSConstants::RandomItemSelectIndexVarName);
+								for (const USUDSScriptNode* Target : Targets)
+								{
+									Branches.Add(FBranch { Target, OptionState, Branch.NodesRun });
+								}
+							}
+							Targets.Reset();
+							Branch.State.Variables.Add(FSUDSConstants::RandomItemSelectIndexVarName, FSUDSValue(0));
+							RunSelect(Node, Branch.State, Targets);
+							Branch.State.Variables.Remove(FSUDSConstants::RandomItemSelectIndexVarName);
+						}
+						else
+						{
+							RunSelect(Node, Branch.State, Targets);
+						}
+						// More than one target if the conditions read variables which could have any value
+						for (int i = Targets.Num() - 1; i > 0; --i)
+						{
+							Branches.Add(FBranch { Targets[i], Branch.State, Branch.NodesRun });
+						}
+						Node = Targets[0];
+						break;
+					}
+				case ESUDSScriptNodeType::SetVariable:
+					if (const USUDSScriptNodeSet* SetNode = Cast<USUDSScriptNodeSet>(Node))
+					{
+						if (SetNode->GetExpression().IsValid())
+						{
+							FName GlobalName;
+							const bool bGlobal = USUDSLibrary::IsDialogueVariableGlobal(SetNode->GetIdentifier(), GlobalName);
+							TMap<FName, FSUDSValue>& Variables = bGlobal ? Branch.State.GlobalVariables : Branch.State.Variables;
+							const FName& Name = bGlobal ? GlobalName : SetNode->GetIdentifier();
+							if (IsUndetermined(SetNode->GetExpression(), Branch.State))
+							{
+								// Could be anything, so the value doesn't matter & leaving it in would only make
+								// otherwise identical states differ
+								Branch.State.DeterminedVariables.Remove(SetNode->GetIdentifier());
+								Variables.Remove(Name);
+							}
+							else
+							{
+								Branch.State.DeterminedVariables.Add(SetNode->GetIdentifier());
+								Variables.Add(Name, SetNode->GetExpression().Evaluate(Branch.State.Variables, Branch.State.GlobalVariables));
+							}
+						}
+					}
+					Node = Script->GetNextNode(Node);
+					break;
+				case ESUDSScriptNodeType::Gosub:
+					{
+						const USUDSScriptNodeGosub* GosubNode = Cast<USUDSScriptNodeGosub>(Node);
+						const USUDSScriptNode* Target = GosubNode ? Script->GetNodeByLabel(GosubNode->GetLabelName()) : nullptr;
+						if (Target)
+						{
+							Branch.State.GosubStack.Push(GosubNode);
+							Node = Target;
+						}
+						else
+						{
+							// The dialogue logs an error & carries on
+							Node = Script->GetNextNode(Node);
+						}
+						break;
+					}
+				case ESUDSScriptNodeType::Return:
+					if (Branch.State.GosubStack.Num() > 0)
+					{
+						Node = Script->GetNextNode(Branch.State.GosubStack.Pop());
+					}
+					else
+					{
+						Found.DeadEnds.FindOrAdd(Node->GetSourceLineNo(), TEXT("[return] with no [gosub] to return to"));
+						++Found.NumPathsStopped;
+						bAbandoned = true;
+					}
+					break;
+				default:
+				case ESUDSScriptNodeType::Event:
+					Node = Script->GetNextNode(Node);
+					break;
+				}
+				if (bAbandoned)
+				{
+					break;
+				}
+			}
+
+			if (bAbandoned)
+			{
+				continue;
+			}
+			if (Node && Node->GetNodeType() == ESUDSScriptNodeType::Choice && !bStopAtChoice)
+			{
+				// The dialogue can't show choices without a speaker line first
+				Found.DeadEnds.FindOrAdd(Node->GetSourceLineNo(), TEXT("Choice reached without a speaker line before it"));
+				++Found.NumPathsStopped;
+				continue;
+			}
+			Callback(Node, Branch.State);
+		}
+	}
+
+	bool FExploration::IsUndetermined(const FSUDSExpression& Expression, const FState& State)
+	{
+		// Anything not set on this path could have been set by the game or participants
+		for (const FName& Name : Expression.GetVariableNames())
+		{
+			if (Name != FSUDSConstants::RandomItemSelectIndexVarName && !State.DeterminedVariables.Contains(Name))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void FExploration::RunSelect(const USUDSScriptNode* Node, const FState& State, TArray<const USUDSScriptNode*>& OutTargets) const
+	{
+		// Same as USUDSDialogue::RunSelectNode, first satisfied edge or the end. Undetermined conditions could go
+		// either way, so their edge is a target but we carry on to the ones after it as well
+		const FString& ScriptName = Runs[State.ScriptIndex]->Script->GetName();
+		for (auto& Edge : Node->GetEdges())
+		{
+			if (!Edge.GetCondition().IsValid())
+			{
+				continue;
+			}
+			if (IsUndetermined(Edge.GetCondition(), State))
+			{
+				OutTargets.AddUnique(Edge.GetTargetNode().Get());
+			}
+			else if (Edge.GetCondition().EvaluateBoolean(State.Variables, State.GlobalVariables, ScriptName))
+			{
+				OutTargets.AddUnique(Edge.GetTargetNode().Get());
+				return;
+			}
+		}
+		OutTargets.AddUnique(nullptr);
+	}
+
+	void FExploration::AppendChoices(const USUDSScriptNode* Node, const FState& State, TArray<const FSUDSScriptEdge*>& OutChoices) const
+	{
+		// Same as USUDSDialogue::RecurseAppendChoices
+		if (!Node)
+		{
+			return;
+		}
+		const FString& ScriptName = Runs[State.ScriptIndex]->Script->GetName();
+		for (auto& Edge : Node->GetEdges())
+		{
+			switch (Edge.GetType())
+			{
+			case ESUDSEdgeType::Decision:
+				OutChoices.Add(&Edge);
+				break;
+			case ESUDSEdgeType::Condition:
+				if (!Edge.GetCondition().IsValid())
+				{
+					break;
+				}
+				if (IsUndetermined(Edge.GetCondition(), State))
+				{
+					// Might be shown, so offer these choices as well as any from the conditions after it
+					AppendChoices(Edge.GetTargetNode().Get(), State, OutChoices);
+				}
+				else if (Edge.GetCondition().EvaluateBoolean(State.Variables, State.GlobalVariables, ScriptName))
+				{
+					AppendChoices(Edge.GetTargetNode().Get(), State, OutChoices);
+					return;
+				}
+				break;
+			case ESUDSEdgeType::Chained:
+				AppendChoices(Edge.GetTargetNode().Get(), State, OutChoices);
+				break;
+			default:
+			case ESUDSEdgeType::Continue:
+				break;
+			}
+		}
+	}
+
+	void FExploration::AddStartPoints(int32 ScriptIndex, int32& NextQueue)
+	{
+		const USUDSScript* Script = Runs[ScriptIndex]->Script;
+		if (!Script || !Script->GetFirstNode())
+		{
+			return;
+		}
+
+		// The header can have random options too, so there may be more than one state to start with
+		TArray<FState> HeaderStates;
+		FState Initial;
+		Initial.ScriptIndex = ScriptIndex;
+		RunUntilSpeakerLine(Script->GetHeaderNode(),
+		                    MoveTemp(Initial),
+		                    false,
+		                    Findings[0][ScriptIndex],
+		                    [&HeaderStates](const USUDSScriptNode* Reached, FState& State)
+		                    {
+			                    // Headers have no speaker lines, so run to the end. Their values are only defaults, which
+			                    // the game can override before starting
+			                    State.DeterminedVariables.Reset();
+			                    HeaderStates.Add(MoveTemp(State));
+		                    });
+
+		TArray<const USUDSScriptNode*> StartNodes;
+		StartNodes.Add(Script->GetFirstNode());
+		for (auto& Pair : Script->GetLabelList())
+		{
+			// Same as USUDSDialogue::Restart, labels which go straight to a choice can't be started from
+			const USUDSScriptNode* Node = Script->GetNodeByLabel(Pair.Key);
+			if (Node && Node->GetNodeType() != ESUDSScriptNodeType::Choice)
+			{
+				StartNodes.AddUnique(Node);
+			}
+		}
+
+		for (const USUDSScriptNode* StartNode : StartNodes)
+		{
+			for (const FState& HeaderState : HeaderStates)
+			{
+				FState Start = HeaderState;
+				Start.Node = StartNode;
+				Start.bStartPoint = true;
+				Push(NextQueue, MoveTemp(Start));
+				NextQueue = (NextQueue + 1) % NumWorkers;
+			}
+		}
+	}
+
+	void FExploration::Push(int32 WorkerIndex, FState&& State)
+	{
+		Outstanding.fetch_add(1, std::memory_order_relaxed);
+		FWorkerQueue& Queue = Queues[WorkerIndex];
+		FScopeLock Lock(&Queue.Lock);
+		Queue.States.Add(MoveTemp(State));
+	}
+
+	bool FExploration::PopOrSteal(int32 WorkerIndex, FState& OutState)
+	{
+		{
+			FWorkerQueue& Own = Queues[WorkerIndex];
+			FScopeLock Lock(&Own.Lock);
+			if (Own.States.Num() > 0)
+			{
+				OutState = Own.States.Pop();
+				return true;
+			}
+		}
+
+		for (int32 Offset = 1; Offset < NumWorkers; ++Offset)
+		{
+			FWorkerQueue& Victim = Queues[(WorkerIndex + Offset) % NumWorkers];
+			TArray<FState> Stolen;
+			{
+				FScopeLock Lock(&Victim.Lock);
+				if (Victim.States.Num() == 0)
+				{
+					continue;
+				}
+				// Take half, from the oldest end
+				const int32 NumToSteal = FMath::Max(1, Victim.States.Num() / 2);
+				Stolen.Reserve(NumToSteal);
+				for (int32 i = 0; i < NumToSteal; ++i)
+				{
+					Stolen.Add(MoveTemp(Victim.States[i]));
+				}
+				Victim.States.RemoveAt(0, NumToSteal);
+			}
+			OutState = Stolen.Pop();
+			if (Stolen.Num() > 0)
+			{
+				FWorkerQueue& Own = Queues[WorkerIndex];
+				FScopeLock Lock(&Own.Lock);
+				Own.States.Append(MoveTemp(Stolen));
+			}
+			return true;
+		}
+		return false;
+	}
+
+	bool FExploration::TryVisit(uint64 Hash)
+	{
+		FVisitedShard& Shard = VisitedShards[Hash >> 58];
+		FScopeLock Lock(&Shard.Lock);
+		bool bAlreadyVisited = false;
+		Shard.Hashes.Add(Hash, &bAlreadyVisited);
+		return !bAlreadyVisited;
+	}
+
+	void FExploration::Run()
+	{
+		int32 NextQueue = 0;
+		for (int32 i = 0; i < Runs.Num(); ++i)
+		{
+			AddStartPoints(i, NextQueue);
+		}
+
+		ParallelFor(NumWorkers, [this](int32 WorkerIndex)
+		{
+			RunWorker(WorkerIndex);
+		}, NumWorkers == 1);
+	}
+
+	void FExploration::RunWorker(int32 WorkerIndex)
+	{
+		FState State;
+		while (true)
+		{
+			if (PopOrSteal(WorkerIndex, State))
+			{
+				ExploreState(WorkerIndex, State);
+				// Anything this state led to has already been queued
+				Outstanding.fetch_sub(1, std::memory_order_acq_rel);
+			}
+			else if (Outstanding.load(std::memory_order_acquire) == 0)
+			{
+				break;
+			}
+			else
+			{
+				// Others are still working & may queue more
+				FPlatformProcess::Yield();
+			}
+		}
+	}
+
+	void FExploration::ExploreState(int32 WorkerIndex, FState& State)
+	{
+		const int32 ScriptIndex = State.ScriptIndex;
+		FScriptRun& Run = *Runs[ScriptIndex];
+		FScriptFindings& Found = Findings[WorkerIndex][ScriptIndex];
+
+		FStateRecord Record;
+		// Queue a speaker line state reached from this one, unless it's been seen already
+		auto AddSuccessor = [&](const USUDSScriptNode* Reached, FState& Next)
+		{
+			if (!Reached)
+			{
+				Record.bCanEnd = true;
+				return;
+			}
+			Next.Node = Reached;
+			Next.bStartPoint = false;
+			const uint64 Hash = HashState(Next);
+			Record.Successors.Add(Hash);
+			if (TryVisit(Hash))
+			{
+				if (Run.NumStates.fetch_add(1, std::memory_order_relaxed) < Settings.MaxStatesPerScript)
+				{
+					Push(WorkerIndex, MoveTemp(Next));
+				}
+				else
+				{
+					Run.bTruncated.store(true, std::memory_order_relaxed);
+				}
+			}
+		};
+
+		if (State.bStartPoint)
+		{
+			// Not a state of its own, just leads to the first speaker lines
+			const USUDSScriptNode* StartNode = State.Node;
+			RunUntilSpeakerLine(StartNode, MoveTemp(State), false, Found, AddSuccessor);
+			return;
+		}
+
+		const USUDSScriptNode* Line = State.Node;
+		Found.LinesReached.Add(Line);
+		Record.Hash = HashState(State);
+		Record.Node = Line;
+		const int64 NumPathsStoppedBefore = Found.NumPathsStopped;
+
+		// Same as the dialogue, run on to any choices, then take each one
+		const USUDSScript* Script = Run.Script;
+		RunUntilSpeakerLine(Script->GetNextNode(Line),
+		                    MoveTemp(State),
+		                    true,
+		                    Found,
+		                    [&](const USUDSScriptNode* Reached, FState& AtChoice)
+		                    {
+			                    if (!Reached || Reached->GetNodeType() != ESUDSScriptNodeType::Choice)
+			                    {
+				                    AddSuccessor(Reached, AtChoice);
+				                    return;
+			                    }
+
+			                    TArray<const FSUDSScriptEdge*> Choices;
+			                    AppendChoices(Reached, AtChoice, Choices);
+			                    if (Choices.Num() == 0)
+			                    {
+				                    Found.DeadEnds.FindOrAdd(Line->GetSourceLineNo(), TEXT("No choices are available after this line"));
+				                    ++Found.NumPathsStopped;
+				                    return;
+			                    }
+			                    for (const FSUDSScriptEdge* Choice : Choices)
+			                    {
+				                    Found.ChoicesReached.Add(Choice);
+				                    FState Next = AtChoice;
+				                    const uint32 ChoiceHash = USUDSScript::GetIDHash(Choice->GetTextID());
+				                    const int32 Index = Algo::LowerBound(Next.ChoicesTaken, ChoiceHash);
+				                    if (!Next.ChoicesTaken.IsValidIndex(Index) || Next.ChoicesTaken[Index] != ChoiceHash)
+				                    {
+					                    Next.ChoicesTaken.Insert(ChoiceHash, Index);
+				                    }
+				                    RunUntilSpeakerLine(Choice->GetTargetNode().Get(), MoveTemp(Next), false, Found, AddSuccessor);
+			                    }
+		                    });
+
+		// Don't report a loop as well as the problem it stopped at
+		Record.bCanEnd |= Found.NumPathsStopped != NumPathsStoppedBefore;
+		Found.States.Add(MoveTemp(Record));
+	}
+
+	void FExploration::FindLoops(const TArray<const FStateRecord*>& States, TMap<int, FString>& OutLoops) const
+	{
+		// Work backwards from every state which can reach the end; anything left over is stuck in a loop
+		TMap<uint64, int32> IndexByHash;
+		IndexByHash.Reserve(States.Num());
+		for (int32 i = 0; i < States.Num(); ++i)
+		{
+			IndexByHash.Add(States[i]->Hash, i);
+		}
+
+		TArray<TArray<int32>> Predecessors;
+		Predecessors.SetNum(States.Num());
+		TBitArray<> CanEnd(false, States.Num());
+		TArray<int32> Pending;
+		for (int32 i = 0; i < States.Num(); ++i)
+		{
+			bool bCanEnd = States[i]->bCanEnd;
+			for (const uint64 Successor : States[i]->Successors)
+			{
+				if (const int32* SuccessorIndex = IndexByHash.Find(Successor))
+				{
+					Predecessors[*SuccessorIndex].Add(i);
+				}
+				else
+				{
+					// Not explored because we hit the state limit; give it the benefit of the doubt
+					bCanEnd = true;
+				}
+			}
+			if (bCanEnd)
+			{
+				CanEnd[i] = true;
+				Pending.Add(i);
+			}
+		}
+		while (Pending.Num() > 0)
+		{
+			const int32 Index = Pending.Pop();
+			for (const int32 Predecessor : Predecessors[Index])
+			{
+				if (!CanEnd[Predecessor])
+				{
+					CanEnd[Predecessor] = true;
+					Pending.Add(Predecessor);
+				}
+			}
+		}
+
+		for (int32 i = 0; i < States.Num(); ++i)
+		{
+			if (!CanEnd[i])
+			{
+				OutLoops.FindOrAdd(States[i]->Node->GetSourceLineNo(), TEXT("Can loop forever, the end of the dialogue can't be reached from here"));
+			}
+		}
+	}
+
+	void FExploration::GetResults(TArray<FSUDSExploreResult>& OutResults) const
+	{
+		OutResults.SetNum(Runs.Num());
+		for (int32 ScriptIndex = 0; ScriptIndex < Runs.Num(); ++ScriptIndex)
+		{
+			const FScriptRun& Run = *Runs[ScriptIndex];
+			FSUDSExploreResult& Result = OutResults[ScriptIndex];
+			Result = FSUDSExploreResult();
+			Result.Script = Run.Script;
+			if (!Run.Script)
+			{
+				continue;
+			}
+			Result.bTruncated = Run.bTruncated.load();
+
+			TSet<const USUDSScriptNode*> LinesReached;
+			TSet<const FSUDSScriptEdge*> ChoicesReached;
+			TMap<int, FString> DeadEnds;
+			TMap<int, FString> Loops;
+			TArray<const FStateRecord*> States;
+			for (const auto& WorkerFindings : Findings)
+			{
+				const FScriptFindings& Found = WorkerFindings[ScriptIndex];
+				LinesReached.Append(Found.LinesReached);
+				ChoicesReached.Append(Found.ChoicesReached);
+				for (auto& Pair : Found.DeadEnds)
+				{
+					DeadEnds.FindOrAdd(Pair.Key, Pair.Value);
+				}
+				for (auto& Pair : Found.Loops)
+				{
+					Loops.FindOrAdd(Pair.Key, Pair.Value);
+				}
+				for (const FStateRecord& Record : Found.States)
+				{
+					States.Add(&Record);
+				}
+			}
+			Result.NumStates = States.Num();
+
+			// Loops round speaker lines can only be told apart from long paths if we saw everything
+			if (!Result.bTruncated)
+			{
+				FindLoops(States, Loops);
+			}
+
+			TSet<const USUDSScriptNode*> StartNodes;
+			StartNodes.Add(Run.Script->GetFirstNode());
+			for (auto& Pair : Run.Script->GetLabelList())
+			{
+				const USUDSScriptNode* Node = Run.Script->GetNodeByLabel(Pair.Key);
+				if (Node && Node->GetNodeType() != ESUDSScriptNodeType::Choice)
+				{
+					StartNodes.Add(Node);
+				}
+			}
+			Result.NumStartPoints = StartNodes.Num();
+
+			for (const USUDSScriptNode* Node : Run.Script->GetNodes())
+			{
+				if (Node->GetNodeType() == ESUDSScriptNodeType::Text)
+				{
+					++Result.NumSpeakerLines;
+					if (!LinesReached.Contains(Node))
+					{
+						Result.UnreachedSpeakerLines.Add(Node->GetSourceLineNo());
+					}
+				}
+				for (auto& Edge : Node->GetEdges())
+				{
+					if (Edge.GetType() == ESUDSEdgeType::Decision)
+					{
+						++Result.NumChoices;
+						if (!ChoicesReached.Contains(&Edge))
+						{
+							Result.UnreachedChoices.Add(Edge.GetSourceLineNo());
+						}
+					}
+				}
+			}
+			Result.UnreachedSpeakerLines.Sort();
+			Result.UnreachedChoices.Sort();
+
+			DeadEnds.KeySort(TLess<int>());
+			for (auto& Pair : DeadEnds)
+			{
+				Result.DeadEnds.Add(FSUDSExploreIssue(Pair.Key, Pair.Value));
+			}
+			Loops.KeySort(TLess<int>());
+			for (auto& Pair : Loops)
+			{
+				Result.Loops.Add(FSUDSExploreIssue(Pair.Key, Pair.Value));
+			}
+		}
+	}
+}
+
+void FSUDSPathExplorer::Explore(const TArray<const USUDSScript*>& Scripts, TArray<FSUDSExploreResult>& OutResults) const
+{
+	const int32 Workers = NumWorkers > 0
+		                      ? NumWorkers
+		                      : FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	// Large, so keep it off the stack
+	const auto Exploration = MakeUnique<SUDSPathExplorer::FExploration>(*this, Scripts, Workers);
+	Exploration->Run();
+	Exploration->GetResults(OutResults);
+}
@@ -5,6 +5,7 @@
 #include "PackageTools.h"
 #include "SUDSEditorSettings.h"
 #include "SUDSEditorVoiceOverTools.h"
+#include "SUDSImportCache.h"
 #include "SUDSMessageLogger.h"
 #include "SUDSScript.h"
 #include "AssetRegistry/AssetRegistryModule.h"
@@ -24,6 +25,37 @@ USUDSScriptFactory::USUDSScriptFactory()
 	Formats.Add(TEXT("sud;SUDS Script File"));
 }
 
+UObject* USUDSScriptFactory::FactoryCreateFile(UClass* InClass,
+	UObject* InParent,
+	FName InName,
+	EObjectFlags Flags,
+	const FString& Filename,
+	const TCHAR* Parms,
+	FFeedbackContext* Warn,
+	bool& bOutOperationCanceled)
+{
+	Flags |= RF_Transactional;
+	FSUDSMessageLogger::ClearMessages();
+	FSUDSMessageLogger Logger;
+
+	USUDSScript* Result = nullptr;
+
+	GEditor->GetEditorSubsystem<UImportSubsystem>()->BroadcastAssetPreImport(this, InClass, InParent, InName, *FPaths::GetExtension(Filename));
+
+	const FString NameForErrors(InName.ToString());
+
+	// Parse straight from the file rather than loading it all into a string first
+	FMD5Hash Hash;
+	if (Importer.ImportFromFile(Filename, NameForErrors, &Logger, false, &Hash))
+	{
+		Result = CreateScriptFromImporter(Importer, InParent, InName, Flags, Filename, Hash, &Logger);
+	}
+
+	GEditor->GetEditorSubsystem<UImportSubsystem>()->BroadcastAssetPostImport(this, Result);
+
+	return Result;
+}
+
 UObject* USUDSScriptFactory::FactoryCreateText(UClass* InClass,
 	UObject* InParent,
 	FName InName,
@@ -42,34 +74,21 @@ UObject* USUDSScriptFactory::FactoryCreateText(UClass* InClass,
 
 	GEditor->GetEditorSubsystem<UImportSubsystem>()->BroadcastAssetPreImport(this, InClass, InParent, InName, Type);
 	
-	const FString FactoryCurrentFilename = UFactory::GetCurrentFilename();
-	FString CurrentSourcePath;
-	FString FilenameNoExtension;
-	FString UnusedExtension;
-	FPaths::Split(FactoryCurrentFilename, CurrentSourcePath, FilenameNoExtension, UnusedExtension);
-	const FString LongPackagePath = FPackageName::GetLongPackagePath(InParent->GetOutermost()->GetPathName());
-	
 	const FString NameForErrors(InName.ToString());
 
 	// Now parse this using utility
 	if(Importer.ImportFromBuffer(Buffer, BufferEnd - Buffer, NameForErrors, &Logger, false))
 	{
-		
-		// Populate with data
-		Result = NewObject<USUDSScript>(InParent, InName, Flags);
-		UStringTable* StringTable = CreateStringTable(InParent, InName, Result, Flags, &Logger);
-		Importer.PopulateAsset(Result, StringTable);
-		
-		// Register source info
-		const FMD5Hash Hash = FSUDSScriptImporter::CalculateHash(Buffer, BufferEnd - Buffer);
-		Result->AssetImportData->Update(FactoryCurrentFilename, Hash);
-
-		// VO assets at import time?
-		if (ShouldGenerateVoiceAssets(LongPackagePath))
+		// Hash the file itself rather than the buffer, same as FactoryCreateFile & reimports, so that the import cache
+		// key matches theirs. The buffer has been decoded into TCHARs so its hash would never match
+		const FString& SourceFilename = UFactory::GetCurrentFilename();
+		FMD5Hash Hash = SourceFilename.IsEmpty() ? FMD5Hash() : FMD5Hash::HashFile(*SourceFilename);
+		if (!Hash.IsValid())
 		{
-			FSUDSEditorVoiceOverTools::GenerateAssets(Result, Flags, &Logger);
+			// Not from a file we can read, e.g. pasted text
+			Hash = FSUDSScriptImporter::CalculateHash(Buffer, BufferEnd - Buffer);
 		}
-
+		Result = CreateScriptFromImporter(Importer, InParent, InName, Flags, SourceFilename, Hash, &Logger);
 	}
 
 	GEditor->GetEditorSubsystem<UImportSubsystem>()->BroadcastAssetPostImport(this, Result);
@@ -77,6 +96,38 @@ UObject* USUDSScriptFactory::FactoryCreateText(UClass* InClass,
 	return Result;
 }
 
+USUDSScript* USUDSScriptFactory::CreateScriptFromImporter(FSUDSScriptImporter& FromImporter,
+	UObject* InParent,
+	FName InName,
+	EObjectFlags Flags,
+	const FString& SourceFilename,
+	const FMD5Hash& Hash,
+	FSUDSMessageLogger* Logger)
+{
+	const FString LongPackagePath = FPackageName::GetLongPackagePath(InParent->GetOutermost()->GetPathName());
+
+	// If we're re-importing, NewObject will re-use the existing script object. Its nodes are left alone, so capture
+	// them first so that any which haven't changed can be re-used
+	const FSUDSPreviousImport Previous(FindObject<USUDSScript>(InParent, *InName.ToString()));
+
+	// Populate with data
+	USUDSScript* Result = NewObject<USUDSScript>(InParent, InName, Flags);
+	UStringTable* StringTable = CreateStringTable(InParent, InName, Result, Flags, Logger);
+	FromImporter.PopulateAsset(Result, StringTable, &Previous);
+	
+	// Register source info
+	Result->AssetImportData->Update(SourceFilename, Hash);
+	Result->ImportCacheKey = FSUDSImportCache::MakeKey(Hash, LongPackagePath);
+
+	// VO assets at import time?
+	if (ShouldGenerateVoiceAssets(LongPackagePath))
+	{
+		FSUDSEditorVoiceOverTools::GenerateAssets(Result, Flags, Logger);
+	}
+
+	return Result;
+}
+
 bool USUDSScriptFactory::ShouldGenerateVoiceAssets(const FString& PackagePath) const
 {
 	if (auto Settings = GetDefault<USUDSEditorSettings>())
@@ -111,8 +162,8 @@ UStringTable* USUDSScriptFactory::CreateStringTable(UObject* ScriptParent, FName
 				{
 					if (Assets[0].GetAsset()->IsA(UStringTable::StaticClass()))
 					{
+						// Entries no longer used are removed after import, so unchanged entries don't have to be re-added
 						Table = Cast<UStringTable>(Assets[0].GetAsset());
-						Table->GetMutableStringTable()->ClearSourceStrings();
 					}
 					else
 					{
@@ -169,7 +220,12 @@ UStringTable* USUDSScriptFactory::CreateStringTable(UObject* ScriptParent, FName
 		}
 		
 		// Default route, create string table inside script package
-		Table = NewObject<UStringTable>(ScriptParent, StringTableName, Flags);
+		// Re-use the existing one if re-importing; as above, unused entries are removed after import
+		Table = FindObject<UStringTable>(ScriptParent, *StringTableName.ToString());
+		if (!Table)
+		{
+			Table = NewObject<UStringTable>(ScriptParent, StringTableName, Flags);
+		}
 
 	}
 		
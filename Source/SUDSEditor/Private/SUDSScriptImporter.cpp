@@ -4,6 +4,7 @@
 
 #include "SUDSEditorSettings.h"
 #include "SUDSExpression.h"
+#include "SUDSLibrary.h"
 #include "SUDSMessageLogger.h"
 #include "SUDSScript.h"
 #include "SUDSScriptNode.h"
@@ -11,102 +12,518 @@
 #include "SUDSScriptNodeGosub.h"
 #include "SUDSScriptNodeSet.h"
 #include "SUDSScriptNodeText.h"
-#include "Internationalization/Regex.h"
 #include "Internationalization/StringTable.h"
 #include "Internationalization/StringTableCore.h"
+#include "Hash/CityHash.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#if PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif
 
 class USUDSEditorSettings;
 const FString FSUDSScriptImporter::EndGotoLabel = "end";
 const FString FSUDSScriptImporter::TreePathSeparator = "/";
+const int32 FSUDSScriptImporter::ImporterVersion = 4;
 
 DEFINE_LOG_CATEGORY(LogSUDSImporter)
 
+// Line matching helpers
+// These are hand-written equivalents of the regular expressions we used to use for each line type, so that we can
+// work on FStringView directly, rather than compiling a pattern and copying every line we test into an FString.
+// Comments give the pattern each one is equivalent to. Like the regexes, all literals are case-sensitive.
 
-bool FSUDSScriptImporter::ImportFromBuffer(const TCHAR *Start, int32 Length, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent)
+static bool IsWordChar(TCHAR C)
 {
-	static const TCHAR* LineEndings[] =
-	{				
-		TEXT("\r\n"),
-		TEXT("\r"),
-		TEXT("\n"),	
-	};
-	constexpr int32 NumDelims = UE_ARRAY_COUNT(LineEndings);
+	return FChar::IsAlnum(C) || C == TEXT('_');
+}
 
-	int LineNumber = 1;
+static int32 SkipWhitespace(const FStringView& Str, int32 Pos)
+{
+	while (Pos < Str.Len() && FChar::IsWhitespace(Str[Pos]))
+		++Pos;
+	return Pos;
+}
+
+static int32 SkipNonWhitespace(const FStringView& Str, int32 Pos)
+{
+	while (Pos < Str.Len() && !FChar::IsWhitespace(Str[Pos]))
+		++Pos;
+	return Pos;
+}
+
+static int32 SkipWordChars(const FStringView& Str, int32 Pos)
+{
+	while (Pos < Str.Len() && IsWordChar(Str[Pos]))
+		++Pos;
+	return Pos;
+}
+
+static bool MatchAt(const FStringView& Str, int32 Pos, const FStringView& Literal)
+{
+	return Pos <= Str.Len() && Str.Mid(Pos).StartsWith(Literal, ESearchCase::CaseSensitive);
+}
+
+/// Get the keyword at the start of a [command] line, e.g. "set" from "[set x 1]". Empty if there isn't one.
+static FStringView GetCommandKeyword(const FStringView& Line)
+{
+	int32 End = 1;
+	while (End < Line.Len() && FChar::IsAlpha(Line[End]))
+		++End;
+	return Line.Mid(1, End - 1);
+}
+
+/// ^\[Keyword\s+(.+)\]$
+static bool MatchCommandWithArgs(const FStringView& Line, const FStringView& Keyword, FStringView& OutArgs)
+{
+	if (Line.Len() < Keyword.Len() + 4 ||
+		Line[0] != TEXT('[') ||
+		Line[Line.Len() - 1] != TEXT(']') ||
+		!MatchAt(Line, 1, Keyword))
+	{
+		return false;
+	}
+	const FStringView Inner = Line.Mid(1 + Keyword.Len(), Line.Len() - Keyword.Len() - 2);
+	const int32 ArgStart = SkipWhitespace(Inner, 0);
+	if (ArgStart == 0)
+		return false;
+	if (ArgStart < Inner.Len())
+	{
+		OutArgs = Inner.Mid(ArgStart);
+		return true;
+	}
+	// All whitespace; the regex would backtrack to give the last whitespace char to the args
+	if (Inner.Len() >= 2)
+	{
+		OutArgs = Inner.Right(1);
+		return true;
+	}
+	return false;
+}
+
+/// ^\[Keyword\s+(\S+)\s+(?:=\s+)?([^\]]+)\]$
+static bool MatchAssignmentCommand(const FStringView& Line, const FStringView& Keyword, FStringView& OutName, FStringView& OutExpr)
+{
+	if (Line.Len() < Keyword.Len() + 2 ||
+		Line[0] != TEXT('[') ||
+		Line[Line.Len() - 1] != TEXT(']') ||
+		!MatchAt(Line, 1, Keyword))
+	{
+		return false;
+	}
+	const FStringView Inner = Line.Mid(1 + Keyword.Len(), Line.Len() - Keyword.Len() - 2);
+	const int32 NameStart = SkipWhitespace(Inner, 0);
+	if (NameStart == 0)
+		return false;
+	const int32 NameEnd = SkipNonWhitespace(Inner, NameStart);
+	if (NameEnd == NameStart)
+		return false;
+	const int32 ExprStart = SkipWhitespace(Inner, NameEnd);
+	if (ExprStart == NameEnd)
+		return false;
+	
+	OutName = Inner.Mid(NameStart, NameEnd - NameStart);
+	if (ExprStart == Inner.Len())
+	{
+		// Only whitespace after the name; matches if there's enough to give one char back to the expression
+		if (ExprStart - NameEnd < 2)
+			return false;
+		OutExpr = Inner.Mid(ExprStart - 1);
+		return true;
+	}
+
+	const FStringView Rest = Inner.Mid(ExprStart);
+	int32 Unused;
+	if (Rest.FindChar(TEXT(']'), Unused))
+		return false;
+
+	OutExpr = Rest;
+	if (Rest[0] == TEXT('='))
+	{
+		// Optional "=" must be followed by whitespace
+		const int32 AfterEquals = SkipWhitespace(Rest, 1);
+		if (AfterEquals > 1)
+		{
+			if (AfterEquals < Rest.Len())
+			{
+				OutExpr = Rest.Mid(AfterEquals);
+			}
+			else if (AfterEquals > 2)
+			{
+				OutExpr = Rest.Mid(AfterEquals - 1);
+			}
+		}
+	}
+	return true;
+}
+
+/// ^\[go[ ]?Suffix\s+(\w+)\s*\]$
+static bool MatchGoCommand(const FStringView& Line, const FStringView& Suffix, FStringView& OutLabel)
+{
+	if (!MatchAt(Line, 0, TEXT("[go")))
+		return false;
+	int32 Pos = 3;
+	if (Pos < Line.Len() && Line[Pos] == TEXT(' '))
+		++Pos;
+	if (!MatchAt(Line, Pos, Suffix))
+		return false;
+	Pos += Suffix.Len();
+	const int32 LabelStart = SkipWhitespace(Line, Pos);
+	if (LabelStart == Pos)
+		return false;
+	const int32 LabelEnd = SkipWordChars(Line, LabelStart);
+	if (LabelEnd == LabelStart)
+		return false;
+	const int32 Close = SkipWhitespace(Line, LabelEnd);
+	if (Close != Line.Len() - 1 || Line[Close] != TEXT(']'))
+		return false;
+	
+	OutLabel = Line.Mid(LabelStart, LabelEnd - LabelStart);
+	return true;
+}
+
+/// ^\[event\s+([\w\.]+)([^\]]*)\]$ or ^\[\s*([\w\.]+)([^\]]*)\]$ if not looking for the event literal
+static bool MatchEventCommand(const FStringView& Line, bool bLookForEventLiteral, FStringView& OutName, FStringView& OutArgs)
+{
+	if (Line.Len() < 3 ||
+		Line[0] != TEXT('[') ||
+		Line[Line.Len() - 1] != TEXT(']'))
+	{
+		return false;
+	}
+	const FStringView Inner = Line.Mid(1, Line.Len() - 2);
+	int32 NameStart = 0;
+	if (bLookForEventLiteral)
+	{
+		static const FStringView EventLiteral(TEXT("event"));
+		if (!MatchAt(Inner, 0, EventLiteral))
+			return false;
+		NameStart = SkipWhitespace(Inner, EventLiteral.Len());
+		if (NameStart == EventLiteral.Len())
+			return false;
+	}
+	else
+	{
+		NameStart = SkipWhitespace(Inner, 0);
+	}
+	int32 NameEnd = NameStart;
+	while (NameEnd < Inner.Len() && (IsWordChar(Inner[NameEnd]) || Inner[NameEnd] == TEXT('.')))
+		++NameEnd;
+	if (NameEnd == NameStart)
+		return false;
+
+	int32 Unused;
+	OutArgs = Inner.Mid(NameEnd);
+	if (OutArgs.FindChar(TEXT(']'), Unused))
+		return false;
+	
+	OutName = Inner.Mid(NameStart, NameEnd - NameStart);
+	return true;
+}
+
+/// Split event arguments, equivalent to repeatedly finding ((\"[^\"]*\"|[^,\"]+))
+static void SplitEventArgs(const FStringView& AllArgs, TArray<FStringView>& OutArgs)
+{
+	int32 Pos = 0;
+	while (Pos < AllArgs.Len())
+	{
+		const TCHAR C = AllArgs[Pos];
+		if (C == TEXT('"'))
+		{
+			int32 CloseQuote;
+			if (AllArgs.Mid(Pos + 1).FindChar(TEXT('"'), CloseQuote))
+			{
+				OutArgs.Add(AllArgs.Mid(Pos, CloseQuote + 2));
+				Pos += CloseQuote + 2;
+			}
+			else
+			{
+				// Unterminated quote is skipped
+				++Pos;
+			}
+		}
+		else if (C == TEXT(','))
+		{
+			++Pos;
+		}
+		else
+		{
+			int32 End = Pos;
+			while (End < AllArgs.Len() && AllArgs[End] != TEXT(',') && AllArgs[End] != TEXT('"'))
+				++End;
+			OutArgs.Add(AllArgs.Mid(Pos, End - Pos));
+			Pos = End;
+		}
+	}
+}
+
+/// ^(\S+)\:\s*(.+)$
+static bool MatchSpeakerLine(const FStringView& Line, FStringView& OutSpeaker, FStringView& OutText)
+{
+	// Greedy match means we use the last colon in the first word which still leaves some text after it
+	const int32 WordEnd = SkipNonWhitespace(Line, 0);
+	for (int32 ColonPos = WordEnd - 1; ColonPos > 0; --ColonPos)
+	{
+		if (Line[ColonPos] == TEXT(':'))
+		{
+			const int32 TextStart = SkipWhitespace(Line, ColonPos + 1);
+			if (TextStart < Line.Len())
+			{
+				OutSpeaker = Line.Left(ColonPos);
+				OutText = Line.Mid(TextStart);
+				return true;
+			}
+			if (TextStart > ColonPos + 1)
+			{
+				OutSpeaker = Line.Left(ColonPos);
+				OutText = Line.Mid(TextStart - 1);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/// First occurrence of (\@Prefix([0-9a-fA-F]+)\@)
+static bool FindHexID(const FStringView& Str, const FStringView& Prefix, int32& OutStart, FStringView& OutID, FStringView& OutHex)
+{
+	for (int32 i = 0; i < Str.Len(); ++i)
+	{
+		if (Str[i] != TEXT('@') || !MatchAt(Str, i + 1, Prefix))
+			continue;
+
+		const int32 HexStart = i + 1 + Prefix.Len();
+		int32 HexEnd = HexStart;
+		while (HexEnd < Str.Len() && FChar::IsHexDigit(Str[HexEnd]))
+			++HexEnd;
+		if (HexEnd > HexStart && HexEnd < Str.Len() && Str[HexEnd] == TEXT('@'))
+		{
+			OutStart = i;
+			OutID = Str.Mid(i, HexEnd + 1 - i);
+			OutHex = Str.Mid(HexStart, HexEnd - HexStart);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void FSUDSScriptImporter::StartImport()
+{
 	HeaderTree.Reset();
 	BodyTree.Reset();
+	Test_ImportSearchSteps = 0;
 	PersistentMetadata.Empty();
 	TransientMetadata.Empty();
 	bHeaderDone = false;
 	bHeaderInProgress = false;
 	bTooLateForHeader = false;
-	bool bImportedOK = true;
 	ChoiceUniqueId = 0;
 	TextIDHighestNumber = 0;
 	bOverrideGenerateSpeakerLineForChoice.Reset();
 	OverrideChoiceSpeakerID.Reset();
 	ReferencedSpeakers.Empty();
-	if (Start)
-	{
-		int32 SubstringBeginIndex = 0;
-
-		// Iterate through string.
-		for(int32 i = 0; i < Length;)
-		{
-			int32 SubstringEndIndex = INDEX_NONE;
-			int32 DelimiterLength = 0;
+}
 
-			// Attempt each delimiter.
-			for(int32 DelimIndex = 0; DelimIndex < NumDelims; ++DelimIndex)
-			{
-				DelimiterLength = FCString::Strlen(LineEndings[DelimIndex]);
+bool FSUDSScriptImporter::FinishImport(bool bImportedOK, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent)
+{
+	ConnectRemainingNodes(HeaderTree, NameForErrors, Logger, bSilent);
+	ConnectRemainingNodes(BodyTree, NameForErrors, Logger, bSilent);
+	GenerateTextIDs(HeaderTree);
+	GenerateTextIDs(BodyTree);
 
-				// If we found a delimiter...
-				if (FCString::Strncmp(Start + i, LineEndings[DelimIndex], DelimiterLength) == 0)
-				{
-					// Mark the end of the substring.
-					SubstringEndIndex = i;
-					break;
-				}
-			}
+	const bool bOK = PostImportSanityCheck(NameForErrors, Logger, bSilent) && bImportedOK;
+	if (bOK)
+	{
+		const USUDSEditorSettings* Settings = GetDefault<USUDSEditorSettings>();
+		FSUDSScriptAnalysis Analysis;
+		AnalyseScript(Analysis, Settings->VariablesProvidedByGame);
+		if (!bSilent)
+		{
+			LogAnalysis(Analysis, NameForErrors, Logger);
+		}
+		if (Settings->bStripUnreachableLines && Analysis.NumUnreachableNodes > 0)
+		{
+			StripUnreachableNodes(BodyTree, Analysis.ReachableNodes);
+		}
+	}
+	return bOK;
+}
 
-			if (SubstringEndIndex != INDEX_NONE)
+bool FSUDSScriptImporter::ImportFromBuffer(const TCHAR *Start, int32 Length, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent)
+{
+	int LineNumber = 1;
+	bool bImportedOK = true;
+	StartImport();
+	if (Start)
+	{
+		// Line endings can be \r\n, \r or \n
+		const TCHAR* LineStart = Start;
+		const TCHAR* const End = Start + Length;
+		for (const TCHAR* P = Start; P < End; ++P)
+		{
+			if (*P == TEXT('\n') || *P == TEXT('\r'))
 			{
-				const int32 SubstringLength = SubstringEndIndex - SubstringBeginIndex;
-				FStringView Line = FStringView(Start + SubstringBeginIndex, SubstringLength);
+				const FStringView Line(LineStart, UE_PTRDIFF_TO_INT32(P - LineStart));
 				if (!ParseLine(Line, LineNumber++, NameForErrors, Logger, bSilent))
 				{
 					// Abort, error
 					bImportedOK = false;
 					break;
 				}
-				
-				
-				// Next substring begins at the end of the discovered delimiter.
-				SubstringBeginIndex = SubstringEndIndex + DelimiterLength;
-				i = SubstringBeginIndex;
-			}
-			else
-			{
-				++i;
+				if (*P == TEXT('\r') && P + 1 < End && P[1] == TEXT('\n'))
+				{
+					++P;
+				}
+				LineStart = P + 1;
 			}
 		}
 
 		// Add any remaining characters after the last delimiter.
-		const int32 SubstringLength = Length - SubstringBeginIndex;
-		const FStringView Line = FStringView(Start + SubstringBeginIndex, SubstringLength);
-		bImportedOK = ParseLine(Line, LineNumber++, NameForErrors, Logger, bSilent) && bImportedOK;
+		if (bImportedOK)
+		{
+			const FStringView Line(LineStart, UE_PTRDIFF_TO_INT32(End - LineStart));
+			bImportedOK = ParseLine(Line, LineNumber++, NameForErrors, Logger, bSilent);
+		}
 	}
 
-	ConnectRemainingNodes(HeaderTree, NameForErrors, Logger, bSilent);
-	ConnectRemainingNodes(BodyTree, NameForErrors, Logger, bSilent);
-	GenerateTextIDs(HeaderTree);
-	GenerateTextIDs(BodyTree);
+	return FinishImport(bImportedOK, NameForErrors, Logger, bSilent);
+	
+}
 
-	bImportedOK = PostImportSanityCheck(NameForErrors, Logger, bSilent) && bImportedOK;
+/// Find the next CR or LF in a byte range, or End if there isn't one
+static const uint8* FindNextLineEnding(const uint8* P, const uint8* End)
+{
+#if PLATFORM_CPU_X86_FAMILY
+	// Test 16 bytes at a time; UTF-8 continuation bytes never match so this is safe on multi-byte chars
+	const __m128i CR = _mm_set1_epi8('\r');
+	const __m128i LF = _mm_set1_epi8('\n');
+	while (End - P >= 16)
+	{
+		const __m128i Chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(P));
+		const uint32 Mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(Chunk, CR), _mm_cmpeq_epi8(Chunk, LF)));
+		if (Mask)
+		{
+			return P + FMath::CountTrailingZeros(Mask);
+		}
+		P += 16;
+	}
+#endif
+	while (P < End && *P != '\r' && *P != '\n')
+	{
+		++P;
+	}
+	return P;
+}
 
-	return bImportedOK;
-	
+bool FSUDSScriptImporter::ImportFromUTF8Buffer(const uint8* Start, int64 Length, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent)
+{
+	int LineNumber = 1;
+	bool bImportedOK = true;
+	StartImport();
+
+	const uint8* const End = Start + Length;
+	// Skip UTF-8 BOM
+	if (Length >= 3 && Start[0] == 0xEF && Start[1] == 0xBB && Start[2] == 0xBF)
+	{
+		Start += 3;
+	}
+
+	const uint8* LineStart = Start;
+	while (true)
+	{
+		const uint8* LineEnd = FindNextLineEnding(LineStart, End);
+		// Only this line is converted, and short lines use the converter's inline storage so don't allocate
+		const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(LineStart), UE_PTRDIFF_TO_INT32(LineEnd - LineStart));
+		const FStringView Line(Converted.Get(), Converted.Length());
+		if (!ParseLine(Line, LineNumber++, NameForErrors, Logger, bSilent))
+		{
+			// Abort, error
+			bImportedOK = false;
+			break;
+		}
+		if (LineEnd == End)
+		{
+			// Last line, which is parsed even if empty just like ImportFromBuffer
+			break;
+		}
+		if (*LineEnd == '\r' && LineEnd + 1 < End && LineEnd[1] == '\n')
+		{
+			++LineEnd;
+		}
+		LineStart = LineEnd + 1;
+	}
+
+	return FinishImport(bImportedOK, NameForErrors, Logger, bSilent);
+}
+
+bool FSUDSScriptImporter::ImportFromFile(const FString& Filename, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent, FMD5Hash* OutHash)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const int64 FileSize = PlatformFile.FileSize(*Filename);
+	if (FileSize < 0)
+	{
+		if (!bSilent)
+			Logger->Logf(ELogVerbosity::Error, TEXT("Failed to open %s"), *Filename);
+		return false;
+	}
+
+	// Map the file if we can, otherwise fall back on reading it
+	TUniquePtr<IMappedFileHandle> MappedHandle;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> FileBytes;
+	const uint8* Data = nullptr;
+	int64 DataLen = 0;
+	if (FileSize > 0)
+	{
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 3
+		FOpenMappedResult OpenResult = PlatformFile.OpenMappedEx(*Filename);
+		if (OpenResult.HasValue())
+		{
+			MappedHandle = OpenResult.StealValue();
+		}
+#else
+		MappedHandle.Reset(PlatformFile.OpenMapped(*Filename));
+#endif
+		if (MappedHandle.IsValid())
+		{
+			MappedRegion.Reset(MappedHandle->MapRegion(0, FileSize));
+		}
+		if (MappedRegion.IsValid())
+		{
+			Data = MappedRegion->GetMappedPtr();
+			DataLen = MappedRegion->GetMappedSize();
+		}
+		else if (FFileHelper::LoadFileToArray(FileBytes, *Filename))
+		{
+			Data = FileBytes.GetData();
+			DataLen = FileBytes.Num();
+		}
+		else
+		{
+			if (!bSilent)
+				Logger->Logf(ELogVerbosity::Error, TEXT("Failed to read %s"), *Filename);
+			return false;
+		}
+	}
+
+	if (OutHash)
+	{
+		FMD5 MD5;
+		MD5.Update(Data, DataLen);
+		OutHash->Set(MD5);
+	}
+
+	// UTF-16 files are unusual for scripts; convert those the slow way
+	if (DataLen >= 2 && ((Data[0] == 0xFF && Data[1] == 0xFE) || (Data[0] == 0xFE && Data[1] == 0xFF)))
+	{
+		FString Contents;
+		FFileHelper::BufferToString(Contents, Data, DataLen);
+		return ImportFromBuffer(*Contents, Contents.Len(), NameForErrors, Logger, bSilent);
+	}
+
+	return ImportFromUTF8Buffer(Data, DataLen, NameForErrors, Logger, bSilent);
 }
 
 bool FSUDSScriptImporter::ParseLine(const FStringView& Line, int LineNo, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent)
@@ -189,19 +606,33 @@ bool FSUDSScriptImporter::ParseCommentMetadataLine(const FStringView& Line,
 	//   - The same key is set again (can be set to blank to reset to empty)
 	//   - A line that is more outdented than the source of the key is encountered
 
-	FString LineStr(Line);
-	const FRegexPattern MetaPattern(TEXT("^#([\\=\\+])\\s*(?:(\\S*)\\s*:\\s*)?(.*)$"));
-	FRegexMatcher MetaRegex(MetaPattern, LineStr);
-	if (MetaRegex.FindNext())
+	// Equivalent to ^#([\=\+])\s*(?:(\S*)\s*:\s*)?(.*)$
+	if (Line.Len() >= 2 && Line[0] == TEXT('#') && (Line[1] == TEXT('=') || Line[1] == TEXT('+')))
 	{
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: META  : %s"), LineNo, IndentLevel, *FString(Line));
 
-		const bool bIsPersistent = MetaRegex.GetCaptureGroup(1) == "+";
-		// There is no "count" of capture groups, test highest to detect if key used
-		FString KeyStr = MetaRegex.GetCaptureGroup(2);
-		const FName Key = FName(KeyStr.IsEmpty() ? "Comment" :KeyStr);
-		const FString Value = MetaRegex.GetCaptureGroup(3).TrimStartAndEnd();
+		const bool bIsPersistent = Line[1] == TEXT('+');
+		const FStringView Rest = Line.Mid(SkipWhitespace(Line, 2));
+		// Key is optional; greedy match means the whole first word if followed by a colon, otherwise up to the
+		// last colon within the first word
+		FStringView KeyStr;
+		FStringView ValueStr = Rest;
+		const int32 WordEnd = SkipNonWhitespace(Rest, 0);
+		const int32 AfterWord = SkipWhitespace(Rest, WordEnd);
+		int32 ColonPos = INDEX_NONE;
+		if (AfterWord < Rest.Len() && Rest[AfterWord] == TEXT(':'))
+		{
+			KeyStr = Rest.Left(WordEnd);
+			ValueStr = Rest.Mid(AfterWord + 1);
+		}
+		else if (Rest.Left(WordEnd).FindLastChar(TEXT(':'), ColonPos))
+		{
+			KeyStr = Rest.Left(ColonPos);
+			ValueStr = Rest.Mid(ColonPos + 1);
+		}
+		const FName Key = KeyStr.IsEmpty() ? FName("Comment") : FName(KeyStr);
+		const FString Value(ValueStr.TrimStartAndEnd());
 
 		if (bIsPersistent)
 		{
@@ -305,9 +736,11 @@ bool FSUDSScriptImporter::ParseHeaderLine(const FStringView& Line, int IndentLev
 	// We ignore every other type of line
 	if (Line.StartsWith(TEXT('[')))
 	{
-		bool bParsed = ParseSetLine(Line, HeaderTree, 0, LineNo, NameForErrors, Logger, bSilent);
-		if (!bParsed)
-			bParsed = ParseImportSettingLine(Line, HeaderTree, 0, LineNo, NameForErrors, Logger, bSilent);;
+		const FStringView Keyword = GetCommandKeyword(Line);
+		if (Keyword.Equals(TEXT("set"), ESearchCase::CaseSensitive))
+			ParseSetLine(Line, HeaderTree, 0, LineNo, NameForErrors, Logger, bSilent);
+		else if (Keyword.Equals(TEXT("importsetting"), ESearchCase::CaseSensitive))
+			ParseImportSettingLine(Line, HeaderTree, 0, LineNo, NameForErrors, Logger, bSilent);
 	}
 	
 	return true;
@@ -353,20 +786,33 @@ bool FSUDSScriptImporter::ParseBodyLine(const FStringView& Line,
 	}
 	else if (Line.StartsWith(TEXT('[')))
 	{
-		bool bParsed = ParseConditionalLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
-		if (!bParsed)
+		// Only try the parser(s) which can match the command keyword
+		// Keywords are case-sensitive, anything else may still be an event without the event literal
+		bool bParsed = false;
+		const FStringView Keyword = GetCommandKeyword(Line);
+		auto IsKeyword = [&Keyword](const TCHAR* Str) { return Keyword.Equals(Str, ESearchCase::CaseSensitive); };
+		if (IsKeyword(TEXT("if")) || IsKeyword(TEXT("elseif")) || IsKeyword(TEXT("else")) || IsKeyword(TEXT("endif")))
+			bParsed = ParseConditionalLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
+		else if (IsKeyword(TEXT("goto")))
 			bParsed = ParseGotoLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
-		if (!bParsed)
+		else if (IsKeyword(TEXT("gosub")))
+			bParsed = ParseGosubLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
+		else if (IsKeyword(TEXT("go")))
+		{
+			// "go to" or "go sub"
+			bParsed = ParseGotoLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
+			if (!bParsed)
+				bParsed = ParseGosubLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
+		}
+		else if (IsKeyword(TEXT("set")))
 			bParsed = ParseSetLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
-		if (!bParsed)
+		else if (IsKeyword(TEXT("event")))
 			bParsed = ParseEventLine(Line, BodyTree, IndentLevel, LineNo, true, NameForErrors, Logger, bSilent);
-		if (!bParsed)
-			bParsed = ParseGosubLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
-		if (!bParsed)
+		else if (IsKeyword(TEXT("return")))
 			bParsed = ParseReturnLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
-		if (!bParsed)
+		else if (IsKeyword(TEXT("importsetting")))
 			bParsed = ParseImportSettingLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
-		if (!bParsed)
+		else if (IsKeyword(TEXT("random")) || IsKeyword(TEXT("or")) || IsKeyword(TEXT("endrandom")))
 			bParsed = ParseRandomLine(Line, BodyTree, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
 
 		if(!bParsed)
@@ -410,22 +856,87 @@ bool FSUDSScriptImporter::IsLastNodeOfType(const FSUDSScriptImporter::ParsedTree
 
 int FSUDSScriptImporter::FindLastChoiceNode(const ParsedTree& Tree, int IndentLevel)
 {
-	int Ret = FindLastChoiceNode(Tree, IndentLevel,Tree.Nodes.Num() - 1, GetCurrentTreeConditionalPath(Tree));
-	// if (Ret == -1)
-	// {
-	// 	// Fallback to try to find from previous text
-	// 	auto& Ctx = Tree.IndentLevelStack.Top();
-	// 	
-	// 	if (Tree.Nodes.IsValidIndex(Ctx.LastTextNodeIdx))
-	// 	{
-	// 		return FindChoiceAfterTextNode(Tree, Ctx.LastTextNodeIdx);
-	// 	}
-	// }
-	return Ret;
-}
+	// Find the most recent choice node which has the same or higher indent and the same condition state as current
+	// But not if there's a parent text node after it on that path
+	// Note: the choice has to be on exactly the same conditional path, NOT containing it. We don't want to skip over an
+	// intervening select node
+	// note that we allow indents < as well as ==
+	// This is so that if you choose to aesthetically indent choices it still works
+	const int ConditionPathID = GetCurrentTreeConditionalPathID(Tree);
+	const int ChoiceIdx = FindRecentNode(Tree, Tree.RecentChoiceNodes, ConditionPathID, IndentLevel);
+	if (ChoiceIdx == -1)
+	{
+		return -1;
+	}
 
-int FSUDSScriptImporter::FindChoiceAfterTextNode(const FSUDSScriptImporter::ParsedTree& Tree, int TextNodeIdx)
-{
+	Tree.PathPrefixIDs.Reset();
+	GetTreePathPrefixIDs(Tree, ConditionPathID, Tree.PathPrefixBuffer, Tree.PathPrefixIDs);
+	for (const int PrefixID : Tree.PathPrefixIDs)
+	{
+		if (FindRecentNode(Tree, Tree.RecentTextNodes, PrefixID, IndentLevel) > ChoiceIdx)
+		{
+			// We hit a parent text node, we can't go back any further
+			return -1;
+		}
+	}
+	return ChoiceIdx;
+}
+
+int FSUDSScriptImporter::FindRecentNode(const ParsedTree& Tree, const TMap<int, TArray<int>>& RecentNodes, int PathID, int IndentLevel)
+{
+	// Most recent node on the path with the same or lower indent. Indents increase towards the top of the stack
+	if (const auto* pStack = RecentNodes.Find(PathID))
+	{
+		for (int i = pStack->Num() - 1; i >= 0; --i)
+		{
+			++Test_ImportSearchSteps;
+			const int NodeIdx = (*pStack)[i];
+			if (Tree.Nodes[NodeIdx].OriginalIndent <= IndentLevel)
+			{
+				return NodeIdx;
+			}
+		}
+	}
+	return -1;
+}
+
+void FSUDSScriptImporter::AddRecentNode(ParsedTree& Tree, int NodeIdx)
+{
+	const auto& Node = Tree.Nodes[NodeIdx];
+	TMap<int, TArray<int>>* RecentNodes;
+	if (Node.NodeType == ESUDSParsedNodeType::Choice)
+	{
+		RecentNodes = &Tree.RecentChoiceNodes;
+	}
+	else if (Node.NodeType == ESUDSParsedNodeType::Text)
+	{
+		RecentNodes = &Tree.RecentTextNodes;
+	}
+	else
+	{
+		return;
+	}
+	auto& Stack = RecentNodes->FindOrAdd(Node.ConditionalPathID);
+	// Anything with the same or higher indent will never be found again now
+	while (Stack.Num() > 0 && Tree.Nodes[Stack.Top()].OriginalIndent >= Node.OriginalIndent)
+	{
+		Stack.Pop();
+	}
+	Stack.Push(NodeIdx);
+}
+
+void FSUDSScriptImporter::RebuildRecentNodes(ParsedTree& Tree)
+{
+	Tree.RecentChoiceNodes.Reset();
+	Tree.RecentTextNodes.Reset();
+	for (int i = 0; i < Tree.Nodes.Num(); ++i)
+	{
+		AddRecentNode(Tree, i);
+	}
+}
+
+int FSUDSScriptImporter::FindChoiceAfterTextNode(const FSUDSScriptImporter::ParsedTree& Tree, int TextNodeIdx)
+{
 	const auto& TextNode = Tree.Nodes[TextNodeIdx];
 	if (TextNode.Edges.Num() == 1 && Tree.Nodes.IsValidIndex(TextNode.Edges[0].TargetNodeIdx))
 	{
@@ -462,37 +973,6 @@ int FSUDSScriptImporter::FindChoiceAfterTextNode(const FSUDSScriptImporter::Pars
 }
 
 
-int FSUDSScriptImporter::FindLastChoiceNode(const ParsedTree& Tree, int IndentLevel, int FromIndex, const FString& ConditionPath)
-{
-	// Scan backwards from end of tree looking for a choice node which has the same or higher indent and condition state as current
-	// But abort if we hit text nodes on that path
-
-	for (int i = FromIndex; i >= 0; --i)
-	{
-		auto& Node = Tree.Nodes[i];
-
-		if (ConditionPath.StartsWith(Node.ConditionalPath) &&
-			Node.NodeType == ESUDSParsedNodeType::Text &&
-			Node.OriginalIndent <= IndentLevel)
-		{
-			// We hit a parent text node, we can't go back any further
-			return -1;
-		}
-		// Only consider nodes on the same conditional path
-		// Note: NOT containing the conditional path. We don't want to skip over an intervening select node
-		if (ConditionPath == Node.ConditionalPath)
-		{
-			// note that we allow indents < as well as ==
-			// This is so that if you choose to aesthetically indent choices it still works
-			if (Node.NodeType == ESUDSParsedNodeType::Choice && Node.OriginalIndent <= IndentLevel)
-			{
-				return i;
-			}
-		}
-	}
-	return -1;
-}
-
 bool FSUDSScriptImporter::ParseChoiceLine(const FStringView& Line,
                                           FSUDSScriptImporter::ParsedTree& Tree,
                                           int IndentLevel,
@@ -671,6 +1151,8 @@ void FSUDSScriptImporter::EnsureChoiceNodeExistsAboveSelect(ParsedTree& Tree, in
 	NewChoice.ParentNodeIdx = SelectNode.ParentNodeIdx;
 	NewChoice.ChoicePath = SelectNode.ChoicePath;
 	NewChoice.ConditionalPath = SelectNode.ConditionalPath;
+	NewChoice.ChoicePathID = SelectNode.ChoicePathID;
+	NewChoice.ConditionalPathID = SelectNode.ConditionalPathID;
 
 	// Now for every other node after this, we have to fix up indexes that are >= InsertIdx
 	// We don't fix up anything before, because we want things that pointed forward to the select to now point at the choice
@@ -708,6 +1190,9 @@ void FSUDSScriptImporter::EnsureChoiceNodeExistsAboveSelect(ParsedTree& Tree, in
 	// Fixup edge in progress
 	if (Tree.EdgeInProgressNodeIdx >= InsertIdx)
 		++Tree.EdgeInProgressNodeIdx;
+	// Recent nodes have all moved, and there's a new choice in the middle. This only happens once per group of choices
+	// which starts with a conditional one, and we've just fixed up every node anyway
+	RebuildRecentNodes(Tree);
 
 
 	// Manually change the select node parent index afterwards (if we change it before it'll get adjusted again)
@@ -747,6 +1232,7 @@ bool FSUDSScriptImporter::ParseElseLine(const FStringView& Line,
 			// equivalent, when they in fact originate from different if's
 			// ID by select node index
 			Block.ConditionPathElement = FString::Printf(TEXT("else-%d"), Block.SelectNodeIdx);
+			UpdateConditionalPath(Tree, Tree.CurrentConditionalBlockIdx);
 			const int NodeIdx = Block.SelectNodeIdx;
 				
 			auto& SelectNode = Tree.Nodes[NodeIdx];
@@ -837,6 +1323,7 @@ bool FSUDSScriptImporter::ParseIfLine(const FStringView& Line,
 			
 	Tree.CurrentConditionalBlockIdx = Tree.ConditionalBlocks.Add(
 		ConditionalContext(NewNodeIdx, Tree.CurrentConditionalBlockIdx, EConditionalStage::IfStage, ConditionStr));
+	UpdateConditionalPath(Tree, Tree.CurrentConditionalBlockIdx);
 	
 	return true;
 	
@@ -868,6 +1355,7 @@ bool FSUDSScriptImporter::ParseElseIfLine(const FStringView& Line,
 			// it's also the negation of the original "if". This is to prevent multiple sibling
 			// elseifs merging if they contain the same condition but are attached to different ifs
 			Block.ConditionPathElement = FString::Printf(TEXT("elseif-%d %s"), Block.SelectNodeIdx, *ConditionStr);
+			UpdateConditionalPath(Tree, Tree.CurrentConditionalBlockIdx);
 			const int NodeIdx = Block.SelectNodeIdx;
 				
 			auto& SelectOrChoiceNode = Tree.Nodes[NodeIdx];
@@ -924,24 +1412,14 @@ bool FSUDSScriptImporter::ParseConditionalLine(const FStringView& Line,
 	}
 	else
 	{
-		const FString LineStr(Line);
-		const FRegexPattern IfPattern(TEXT("^\\[if\\s+(.+)\\]$"));
-		FRegexMatcher IfRegex(IfPattern, LineStr);
-		if (IfRegex.FindNext())
+		FStringView ConditionStr;
+		if (MatchCommandWithArgs(Line, TEXT("if"), ConditionStr))
 		{
-			const FString ConditionStr = IfRegex.GetCaptureGroup(1);
-			return ParseIfLine(Line, Tree, ConditionStr, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
+			return ParseIfLine(Line, Tree, FString(ConditionStr), IndentLevel, LineNo, NameForErrors, Logger, bSilent);
 		}
-		else
+		else if (MatchCommandWithArgs(Line, TEXT("elseif"), ConditionStr))
 		{
-			const FRegexPattern ElseIfPattern(TEXT("^\\[elseif\\s+(.+)\\]$"));
-			FRegexMatcher ElseIfRegex(ElseIfPattern, LineStr);
-			if (ElseIfRegex.FindNext())
-			{
-				const FString ConditionStr = ElseIfRegex.GetCaptureGroup(1);
-				return ParseElseIfLine(Line, Tree, ConditionStr, IndentLevel, LineNo, NameForErrors, Logger, bSilent);
-
-			}
+			return ParseElseIfLine(Line, Tree, FString(ConditionStr), IndentLevel, LineNo, NameForErrors, Logger, bSilent);
 		}
 	}
 		
@@ -1015,6 +1493,7 @@ bool FSUDSScriptImporter::ParseBeginRandomLine(const FStringView& Line,
 			
 	Tree.CurrentConditionalBlockIdx = Tree.ConditionalBlocks.Add(
 		ConditionalContext(NewNodeIdx, Tree.CurrentConditionalBlockIdx, EConditionalStage::RandomStage, ConditionStr));
+	UpdateConditionalPath(Tree, Tree.CurrentConditionalBlockIdx);
 	
 	return true;
 	
@@ -1050,6 +1529,7 @@ bool FSUDSScriptImporter::ParseRandomOptionLine(const FStringView& Line,
 			auto& SelectOrChoiceNode = Tree.Nodes[NodeIdx];
 			// Generate condition based on auto-generated random item choice
 			Block.ConditionPathElement = FString::Printf(TEXT("{%hs} == %d"), SUDS_RANDOMITEM_VAR, SelectOrChoiceNode.Edges.Num());
+			UpdateConditionalPath(Tree, Tree.CurrentConditionalBlockIdx);
 			const int EdgeIdx = SelectOrChoiceNode.Edges.Add(FSUDSParsedEdge(NodeIdx, -1, LineNo));
 			auto E = &SelectOrChoiceNode.Edges[EdgeIdx];
 			{
@@ -1139,15 +1619,15 @@ bool FSUDSScriptImporter::ParseGotoLabelLine(const FStringView& Line,
 {
 	// We've already established that line starts with ':'
 	// There should not be any spaces in the label
-	const FString LineStr(Line);
-	const FRegexPattern LabelPattern(TEXT("^\\:\\s*(\\w+)$"));
-	FRegexMatcher LabelRegex(LabelPattern, LineStr);
-	if (LabelRegex.FindNext())
+	// Equivalent to ^\:\s*(\w+)$
+	const int32 LabelStart = SkipWhitespace(Line, 1);
+	const int32 LabelEnd = SkipWordChars(Line, LabelStart);
+	if (LabelEnd > LabelStart && LabelEnd == Line.Len())
 	{
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: LABEL : %s"), LineNo, IndentLevel, *FString(Line));
 		// lowercase goto labels so case insensitive
-		FString Label = LabelRegex.GetCaptureGroup(1).ToLower();
+		FString Label = FString(Line.Mid(LabelStart)).ToLower();
 		if (Label == EndGotoLabel)
 		{
 			if (!bSilent)
@@ -1177,17 +1657,14 @@ bool FSUDSScriptImporter::ParseGotoLine(const FStringView& Line,
                                         FSUDSMessageLogger* Logger, 
                                         bool bSilent)
 {
-	// Unfortunately FRegexMatcher doesn't support FStringView
-	const FString LineStr(Line);
 	// Allow both 'goto' and 'go to'
-	const FRegexPattern GotoPattern(TEXT("^\\[go[ ]?to\\s+(\\w+)\\s*\\]$"));
-	FRegexMatcher GotoRegex(GotoPattern, LineStr);
-	if (GotoRegex.FindNext())
+	FStringView LabelView;
+	if (MatchGoCommand(Line, TEXT("to"), LabelView))
 	{
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: GOTO  : %s"), LineNo, IndentLevel, *FString(Line));
 		// lower case label so case insensitive
-		const FString Label = GotoRegex.GetCaptureGroup(1).ToLower();
+		const FString Label = FString(LabelView).ToLower();
 		// note that we do NOT try to resolve the goto label here, to allow forward jumps.
 		const auto& Ctx = Tree.IndentLevelStack.Top();
 		// A goto is an edge from the current node to another node
@@ -1218,17 +1695,14 @@ bool FSUDSScriptImporter::ParseGosubLine(const FStringView& InLine,
 	// If this is a continuation line, we shouldn't generate one, but we need to trim it off if it's there
 	bool bFoundID = RetrieveAndRemoveGosubID(Line, GosubID);
 	
-	// Unfortunately FRegexMatcher doesn't support FStringView
-	const FString LineStr(Line);
 	// Allow both 'gosub' and 'go sub'
-	const FRegexPattern GosubPattern(TEXT("^\\[go[ ]?sub\\s+(\\w+)\\s*\\]$"));
-	FRegexMatcher GosubRegex(GosubPattern, LineStr);
-	if (GosubRegex.FindNext())
+	FStringView LabelView;
+	if (MatchGoCommand(Line, TEXT("sub"), LabelView))
 	{
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: GOSUB  : %s"), LineNo, IndentLevel, *FString(Line));
 		// lower case label so case insensitive
-		const FString Label = GosubRegex.GetCaptureGroup(1).ToLower();
+		const FString Label = FString(LabelView).ToLower();
 
 		// You CANNOT "gosub end"
 		if (Label == EndGotoLabel)
@@ -1259,11 +1733,11 @@ bool FSUDSScriptImporter::ParseReturnLine(const FStringView& Line,
 	FSUDSMessageLogger* Logger,
 	bool bSilent)
 {
-	// Unfortunately FRegexMatcher doesn't support FStringView
-	const FString LineStr(Line);
-	const FRegexPattern ReturnPattern(TEXT("^\\[return\\s*\\]$"));
-	FRegexMatcher ReturnRegex(ReturnPattern, LineStr);
-	if (ReturnRegex.FindNext())
+	// Equivalent to ^\[return\s*\]$
+	static const FStringView ReturnLiteral(TEXT("[return"));
+	if (MatchAt(Line, 0, ReturnLiteral) &&
+		SkipWhitespace(Line, ReturnLiteral.Len()) == Line.Len() - 1 &&
+		Line[Line.Len() - 1] == TEXT(']'))
 	{
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: RETURN  : %s"), LineNo, IndentLevel, *FString(Line));
@@ -1289,20 +1763,17 @@ bool FSUDSScriptImporter::ParseSetLine(const FStringView& InLine,
 	// TextID may be blank after this, that's OK - we fix at the end once we know what IDs are used
 	RetrieveAndRemoveTextID(Line, TextID);
 	
-	// Unfortunately FRegexMatcher doesn't support FStringView
-	const FString LineStr(Line);
 	// Accept forms:
 	// [set Var Expression]
 	// [set Var = Expression] (more readable in the case of non-trivial expressions)
-	const FRegexPattern SetPattern(TEXT("^\\[set\\s+(\\S+)\\s+(?:=\\s+)?([^\\]]+)\\]$"));
-	FRegexMatcher SetRegex(SetPattern, LineStr);
-	if (SetRegex.FindNext())
+	FStringView NameView, ExprView;
+	if (MatchAssignmentCommand(Line, TEXT("set"), NameView, ExprView))
 	{
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: SET   : %s"), LineNo, IndentLevel, *FString(Line));
 
-		FString Name = SetRegex.GetCaptureGroup(1);
-		FString ExprStr = SetRegex.GetCaptureGroup(2).TrimStartAndEnd(); // trim because capture accepts spaces in quotes
+		FString Name(NameView);
+		FString ExprStr(ExprView.TrimStartAndEnd()); // trim because capture accepts spaces in quotes
 
 		FSUDSExpression Expr;
 		{
@@ -1337,17 +1808,14 @@ bool FSUDSScriptImporter::ParseImportSettingLine(const FStringView& Line,
 	FSUDSMessageLogger* Logger,
 	bool bSilent)
 {
-	// Unfortunately FRegexMatcher doesn't support FStringView
-	const FString LineStr(Line);
-	const FRegexPattern ImportSetPattern(TEXT("^\\[importsetting\\s+(\\S+)\\s+(?:=\\s+)?([^\\]]+)\\]$"));
-	FRegexMatcher ImportSetRegex(ImportSetPattern, LineStr);
-	if (ImportSetRegex.FindNext())
+	FStringView NameView, ExprView;
+	if (MatchAssignmentCommand(Line, TEXT("importsetting"), NameView, ExprView))
 	{
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: IMPORTSETTING: %s"), LineNo, IndentLevel, *FString(Line));
 
-		const FString Name = ImportSetRegex.GetCaptureGroup(1);
-		const FString ExprStr = ImportSetRegex.GetCaptureGroup(2).TrimStartAndEnd(); // trim because capture accepts spaces in quotes
+		const FString Name(NameView);
+		const FString ExprStr(ExprView.TrimStartAndEnd()); // trim because capture accepts spaces in quotes
 		
 		FSUDSExpression Expr;
 		{
@@ -1424,31 +1892,24 @@ bool FSUDSScriptImporter::ParseEventLine(const FStringView& Line,
                                          FSUDSMessageLogger* Logger,
                                          bool bSilent)
 {
-	const FString LineStr(Line);
-	const FRegexPattern EventPattern(TEXT("^\\[event\\s+([\\w\\.]+)([^\\]]*)\\]$"));
-	const FRegexPattern EventPatternNoLiteral(TEXT("^\\[\\s*([\\w\\.]+)([^\\]]*)\\]$"));
-	
-	FRegexMatcher EventRegex(bLookForEventLiteral ? EventPattern : EventPatternNoLiteral, LineStr);
-	if (EventRegex.FindNext())
+	FStringView NameView, ArgsView;
+	if (MatchEventCommand(Line, bLookForEventLiteral, NameView, ArgsView))
 	{
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: EVENT : %s"), LineNo, IndentLevel, *FString(Line));
 
 		FSUDSParsedNode Node(ESUDSParsedNodeType::Event, IndentLevel, LineNo);
 		
-		Node.Identifier = EventRegex.GetCaptureGroup(1);
+		Node.Identifier = FString(NameView);
 
-		if (EventRegex.GetCaptureGroupBeginning(2) != INDEX_NONE)
 		{
-			// Has arguments, all lumped together
-			// Capture using a sub-regex which can detect quoted strings, split by commas			
-			FString AllArgs = EventRegex.GetCaptureGroup(2).TrimStartAndEnd();
-			const FRegexPattern ArgPattern(TEXT("((\\\"[^\\\"]*\\\"|[^,\\\"]+))"));
-			FRegexMatcher ArgRegex(ArgPattern, AllArgs);
-			while (ArgRegex.FindNext())
+			// Arguments are all lumped together, split by commas but allowing for quoted strings
+			TArray<FStringView> ArgViews;
+			SplitEventArgs(ArgsView.TrimStartAndEnd(), ArgViews);
+			for (const FStringView& ArgView : ArgViews)
 			{
 				// then process the quote
-				FString ArgStr = ArgRegex.GetCaptureGroup(1).TrimStartAndEnd();
+				FString ArgStr(ArgView.TrimStartAndEnd());
 				if (ArgStr.Len() == 0)
 					continue;
 				
@@ -1494,14 +1955,12 @@ bool FSUDSScriptImporter::ParseTextLine(const FStringView& InLine,
 	// TextID may be blank after this, that's OK - we fix at the end once we know what IDs are used
 	RetrieveAndRemoveTextID(Line, TextID);
 	
-	const FString LineStr(Line);
-	const FRegexPattern SpeakerPattern(TEXT("^(\\S+)\\:\\s*(.+)$"));
-	FRegexMatcher SpeakerRegex(SpeakerPattern, LineStr);
-	if (SpeakerRegex.FindNext())
+	FStringView SpeakerView, TextView;
+	if (MatchSpeakerLine(Line, SpeakerView, TextView))
 	{
 		// OK this is a speaker line, in which case this is a new text node
-		const FString Speaker = SpeakerRegex.GetCaptureGroup(1);
-		const FString Text = SpeakerRegex.GetCaptureGroup(2);
+		const FString Speaker(SpeakerView);
+		const FString Text(TextView);
 		if (!bSilent)
 			UE_LOG(LogSUDSImporter, VeryVerbose, TEXT("%3d:%2d: TEXT  : %s"), LineNo, IndentLevel, *FString(Line));
 		// New text node
@@ -1522,7 +1981,8 @@ bool FSUDSScriptImporter::ParseTextLine(const FStringView& InLine,
 		auto& Node = Tree.Nodes[Ctx.LastNodeIdx];
 		if (Node.NodeType == ESUDSParsedNodeType::Text)
 		{
-			Node.Text.Appendf(TEXT("\n%s"), *LineStr);
+			Node.Text.AppendChar(TEXT('\n'));
+			Node.Text.Append(Line.GetData(), Line.Len());
 		}
 		else
 		{
@@ -1554,19 +2014,18 @@ bool FSUDSScriptImporter::RetrieveAndRemoveTextID(FStringView& InOutLine, FStrin
 
 bool FSUDSScriptImporter::RetrieveTextIDFromLine(FStringView& InOutLine, FString& OutTextID, int& OutNumber)
 {
-	const FString LineStr(InOutLine);
-	const FRegexPattern TextIDPattern(TEXT("(\\@([0-9a-fA-F]+)\\@)"));
-	FRegexMatcher TextIDRegex(TextIDPattern, LineStr);
-	if (TextIDRegex.FindNext())
+	int32 IDStart;
+	FStringView IDView, HexView;
+	if (FindHexID(InOutLine, FStringView(), IDStart, IDView, HexView))
 	{
-		OutTextID = TextIDRegex.GetCaptureGroup(1);
+		OutTextID = FString(IDView);
 		// Chop the incoming string to the left of the TextID
-		InOutLine = InOutLine.Left(TextIDRegex.GetCaptureGroupBeginning(1));
+		InOutLine = InOutLine.Left(IDStart);
 		// Also trim right
 		InOutLine = InOutLine.TrimEnd();
 		// FDefaultValueHelper::ParseInt requires an "0x" prefix but we're not using that
 		// Plus does extra checking we don't need
-		OutNumber = FCString::Strtoi(*TextIDRegex.GetCaptureGroup(2), nullptr, 16);
+		OutNumber = FCString::Strtoi(*FString(HexView), nullptr, 16);
 		return true;
 	}
 
@@ -1591,19 +2050,18 @@ bool FSUDSScriptImporter::RetrieveAndRemoveGosubID(FStringView& InOutLine, FStri
 
 bool FSUDSScriptImporter::RetrieveGosubIDFromLine(FStringView& InOutLine, FString& OutID, int& OutNumber)
 {
-	const FString LineStr(InOutLine);
-	const FRegexPattern IDPattern(TEXT("(\\@GS([0-9a-fA-F]+)\\@)"));
-	FRegexMatcher IDRegex(IDPattern, LineStr);
-	if (IDRegex.FindNext())
+	int32 IDStart;
+	FStringView IDView, HexView;
+	if (FindHexID(InOutLine, TEXT("GS"), IDStart, IDView, HexView))
 	{
-		OutID = IDRegex.GetCaptureGroup(1);
+		OutID = FString(IDView);
 		// Chop the incoming string to the left of the TextID
-		InOutLine = InOutLine.Left(IDRegex.GetCaptureGroupBeginning(1));
+		InOutLine = InOutLine.Left(IDStart);
 		// Also trim right
 		InOutLine = InOutLine.TrimEnd();
 		// FDefaultValueHelper::ParseInt requires an "0x" prefix but we're not using that
 		// Plus does extra checking we don't need
-		OutNumber = FCString::Strtoi(*IDRegex.GetCaptureGroup(2), nullptr, 16);
+		OutNumber = FCString::Strtoi(*FString(HexView), nullptr, 16);
 		return true;
 	}
 
@@ -1619,7 +2077,7 @@ FString FSUDSScriptImporter::GenerateTextID()
 	return FString::Printf(TEXT("@%04x@"), ++TextIDHighestNumber);
 }
 
-FString FSUDSScriptImporter::GetCurrentTreePath(const FSUDSScriptImporter::ParsedTree& Tree)
+const FString& FSUDSScriptImporter::GetCurrentTreePath(const FSUDSScriptImporter::ParsedTree& Tree)
 {
 	// This is just a path of all the choice / select nodes AND their edges leading to this point, for fallthrough
 	// * Choice (/C000/)
@@ -1628,35 +2086,90 @@ FString FSUDSScriptImporter::GetCurrentTreePath(const FSUDSScriptImporter::Parse
 	// * Choice (/C002/C003/)
 	//		Do NOT fallthrough to here
 	// Fallthrough to here instead (/)
+	// Each indent level stores its full path when pushed, so this doesn't need building every time
 
-	FStringBuilderBase B;
-	for (auto Indent : Tree.IndentLevelStack)
-	{
-		B.Appendf(TEXT("%s%s"), *Indent.PathEntry, *TreePathSeparator);
-	}
-	return B.ToString();
+	return Tree.IndentLevelStack.Top().Path;
+}
+
+int FSUDSScriptImporter::GetCurrentTreePathID(const FSUDSScriptImporter::ParsedTree& Tree)
+{
+	return Tree.IndentLevelStack.Top().PathID;
 }
 
-FString FSUDSScriptImporter::GetCurrentTreeConditionalPath(const FSUDSScriptImporter::ParsedTree& Tree)
+const FString& FSUDSScriptImporter::GetCurrentTreeConditionalPath(const FSUDSScriptImporter::ParsedTree& Tree)
 {
 	// Like GetCurrentTreePath, but for conditional blocks
 	// Cannot fall through to blocks that aren't on the same conditional path
-	FStringBuilderBase B;
-	int BlockIdx = Tree.CurrentConditionalBlockIdx;
-	B.Append("/");
-	// work backwards, hence prepend
-	while (BlockIdx != -1)
-	{
-		const FString& ConditionStr = Tree.ConditionalBlocks[BlockIdx].ConditionPathElement;
-		// Note: add the "/" even if ConditionStr is empty, because it means it's an else level
-		// Not including it can cause an if block to fall through to its own else
-		B.Prepend(FString::Printf(TEXT("%s%s"), *TreePathSeparator, *ConditionStr));
-		BlockIdx = Tree.ConditionalBlocks[BlockIdx].PreviousBlockIdx;
-	}
-	return B.ToString();
+	if (Tree.ConditionalBlocks.IsValidIndex(Tree.CurrentConditionalBlockIdx))
+	{
+		return Tree.ConditionalBlocks[Tree.CurrentConditionalBlockIdx].Path;
+	}
+	return TreePathSeparator;
 	
 }
 
+int FSUDSScriptImporter::GetCurrentTreeConditionalPathID(const FSUDSScriptImporter::ParsedTree& Tree)
+{
+	if (Tree.ConditionalBlocks.IsValidIndex(Tree.CurrentConditionalBlockIdx))
+	{
+		return Tree.ConditionalBlocks[Tree.CurrentConditionalBlockIdx].PathID;
+	}
+	// Outside of any conditional the path is the same as the root choice path, which is always interned first
+	const int* pID = Tree.PathIDs.Find(TreePathSeparator);
+	return pID ? *pID : -1;
+}
+
+void FSUDSScriptImporter::UpdateConditionalPath(FSUDSScriptImporter::ParsedTree& Tree, int BlockIdx)
+{
+	// Called whenever a block is created or its condition changes. Only the current block ever changes, so there are
+	// never any nested blocks whose paths would need updating too
+	auto& Block = Tree.ConditionalBlocks[BlockIdx];
+	// Note: add the "/" even if ConditionStr is empty, because it means it's an else level
+	// Not including it can cause an if block to fall through to its own else
+	const FString& ParentPath = Tree.ConditionalBlocks.IsValidIndex(Block.PreviousBlockIdx)
+		                            ? Tree.ConditionalBlocks[Block.PreviousBlockIdx].Path
+		                            : TreePathSeparator;
+	Block.Path = ParentPath + Block.ConditionPathElement + TreePathSeparator;
+	Block.PathID = InternTreePath(Tree, Block.Path);
+}
+
+int FSUDSScriptImporter::InternTreePath(FSUDSScriptImporter::ParsedTree& Tree, const FString& Path)
+{
+	if (const int* pID = Tree.PathIDs.Find(Path))
+	{
+		return *pID;
+	}
+	const int ID = Tree.Paths.Add(Path);
+	Tree.PathIDs.Add(Path, ID);
+	return ID;
+}
+
+void FSUDSScriptImporter::GetTreePathPrefixIDs(const FSUDSScriptImporter::ParsedTree& Tree,
+                                                int PathID,
+                                                FString& Buffer,
+                                                TArray<int>& OutPrefixIDs)
+{
+	if (!Tree.Paths.IsValidIndex(PathID))
+	{
+		return;
+	}
+	// Every path ends with a separator, so prefixes which are paths can only end at one
+	const FString& Path = Tree.Paths[PathID];
+	const TCHAR Separator = TreePathSeparator[0];
+	for (int Len = 1; Len <= Path.Len(); ++Len)
+	{
+		if (Path[Len - 1] == Separator)
+		{
+			Buffer.Reset();
+			Buffer.AppendChars(*Path, Len);
+			if (const int* pPrefixID = Tree.PathIDs.Find(Buffer))
+			{
+				OutPrefixIDs.Add(*pPrefixID);
+			}
+		}
+	}
+}
+
 void FSUDSScriptImporter::SetFallthroughForNewNode(FSUDSScriptImporter::ParsedTree& Tree, FSUDSParsedNode& NewNode)
 {
 	// Choice nodes are allowed to be falled through to now
@@ -1698,6 +2211,9 @@ int FSUDSScriptImporter::AppendNode(FSUDSScriptImporter::ParsedTree& Tree, const
 	auto& NewNode = Tree.Nodes[NewIndex];
 	NewNode.ChoicePath = GetCurrentTreePath(Tree);
 	NewNode.ConditionalPath = GetCurrentTreeConditionalPath(Tree);
+	NewNode.ChoicePathID = GetCurrentTreePathID(Tree);
+	NewNode.ConditionalPathID = GetCurrentTreeConditionalPathID(Tree);
+	AddRecentNode(Tree, NewIndex);
 
 	// Use pending edge if present; that could be because this is under a choice node, or a condition
 	if (auto E = GetEdgeInProgress(Tree))
@@ -1772,7 +2288,7 @@ bool FSUDSScriptImporter::SelectNodeIsMissingElsePath(const FSUDSScriptImporter:
 		// While so that we can follow nested selects to first resolved
 		while (Tree.Nodes.IsValidIndex(NextIdx))
 		{
-			auto N = Tree.Nodes[NextIdx];
+			const auto& N = Tree.Nodes[NextIdx];
 			if (N.NodeType == ESUDSParsedNodeType::Select)
 			{
 				// Nested select, cascade down
@@ -1809,7 +2325,11 @@ void FSUDSScriptImporter::PopIndent(FSUDSScriptImporter::ParsedTree& Tree)
 
 void FSUDSScriptImporter::PushIndent(FSUDSScriptImporter::ParsedTree& Tree, int NodeIdx, int Indent, const FString& Path)
 {
-	Tree.IndentLevelStack.Push(IndentContext(NodeIdx, Indent, Path));
+	IndentContext Ctx(NodeIdx, Indent, Path);
+	// Store the full path so that it doesn't need to be rebuilt from the whole stack for every node
+	Ctx.Path = Tree.IndentLevelStack.IsEmpty() ? Path + TreePathSeparator : Tree.IndentLevelStack.Top().Path + Path + TreePathSeparator;
+	Ctx.PathID = InternTreePath(Tree, Ctx.Path);
+	Tree.IndentLevelStack.Push(MoveTemp(Ctx));
 
 }
 
@@ -1856,6 +2376,10 @@ void FSUDSScriptImporter::ConnectRemainingNodes(FSUDSScriptImporter::ParsedTree&
 	Tree.AliasedGotoLabels.Reset();
 	
 
+	// Where every node would fall through to, if it needs to. Adding edges doesn't change this so it can be done up-front
+	TArray<int> FallthroughIndices;
+	FindFallthroughNodeIndices(Tree, FallthroughIndices);
+
 	// We go through top-to-bottom, which is the order of lines in the file as well
 	// We don't need to cascade for this
 	for (int i = 0; i < Tree.Nodes.Num(); ++i)
@@ -1889,7 +2413,7 @@ void FSUDSScriptImporter::ConnectRemainingNodes(FSUDSScriptImporter::ParsedTree&
 				// Find the next node which is at a higher indent level than this
 				// For a select node missing else, treat the indent as 1 inward, since it's really falling through from a nested part of the select
 				const int IndentLessThan = bIsSelectNodeMissingElse ? Node.OriginalIndent + 1 : Node.OriginalIndent;
-				const auto FallthroughIdx = FindFallthroughNodeIndex(Tree, i+1, Node.ChoicePath, Node.ConditionalPath);
+				const auto FallthroughIdx = FallthroughIndices[i];
 				if (Tree.Nodes.IsValidIndex(FallthroughIdx))
 				{
 					Node.Edges.Add(FSUDSParsedEdge(i, FallthroughIdx, Node.SourceLineNo));
@@ -1907,7 +2431,7 @@ void FSUDSScriptImporter::ConnectRemainingNodes(FSUDSScriptImporter::ParsedTree&
 				if (!Tree.Nodes.IsValidIndex(Edge.TargetNodeIdx))
 				{
 					// Usually this is a choice line without anything under it, or a condition with nothing in it
-					const auto FallthroughIdx = FindFallthroughNodeIndex(Tree, i+1, Node.ChoicePath, Node.ConditionalPath);
+					const auto FallthroughIdx = FallthroughIndices[i];
 					if (Tree.Nodes.IsValidIndex(FallthroughIdx))
 					{
 						Edge.TargetNodeIdx = FallthroughIdx;
@@ -1985,6 +2509,10 @@ void FSUDSScriptImporter::GenerateTextIDs(ParsedTree& Tree)
 bool FSUDSScriptImporter::PostImportSanityCheck(const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent)
 {
 	bool bOK = true;
+	// Many choices can lead to the same part of the script, so results are shared between all of them
+	ChoicePathCheckState CheckState;
+	CheckState.Terminals.Init(ChoicePathCheckState::Unresolved, BodyTree.Nodes.Num());
+	CheckState.SelectResults.Init(ChoicePathCheckState::NotChecked, BodyTree.Nodes.Num());
 	for (int i = 0; i < BodyTree.Nodes.Num(); ++i)
 	{
 		auto& Node = BodyTree.Nodes[i];
@@ -1992,9 +2520,10 @@ bool FSUDSScriptImporter::PostImportSanityCheck(const FString& NameForErrors, FS
 		if (Node.NodeType == ESUDSParsedNodeType::Choice)
 		{
 			// Check all of them so we can report all errors, rather than early-out
-			bOK = ChoiceNodeCheckPaths(Node, NameForErrors, Logger, bSilent) && bOK;
+			bOK = ChoiceNodeCheckPaths(Node, CheckState, NameForErrors, Logger, bSilent) && bOK;
 		}
 	}
+	bOK = CheckForTextlessLoops(NameForErrors, Logger, bSilent) && bOK;
 	// check for unfinished conditional blocks
 	if (BodyTree.ConditionalBlocks.IsValidIndex(BodyTree.CurrentConditionalBlockIdx))
 	{
@@ -2026,118 +2555,849 @@ bool FSUDSScriptImporter::PostImportSanityCheck(const FString& NameForErrors, FS
 							 SelectNode->SourceLineNo,
 							 *BlockEndDesc);
 		}
-		
+		
+	}
+	return bOK;
+}
+
+bool FSUDSScriptImporter::IsTextlessLoopNode(const FSUDSParsedNode& Node)
+{
+	// Speaker lines & choices hand control back to the game, so a loop through them can't hang
+	return Node.NodeType != ESUDSParsedNodeType::Text && Node.NodeType != ESUDSParsedNodeType::Choice;
+}
+
+void FSUDSScriptImporter::GetTextlessSuccessors(int NodeIdx,
+                                                const TMap<FString, TextlessSubExits>& SubExits,
+                                                TArray<int>& OutSuccessors,
+                                                bool& bOutCanLeave)
+{
+	// Nodes which can run straight after this one without showing any text. Anything else (text, choices, the end
+	// or a return to somewhere else) means this node can leave a loop
+	OutSuccessors.Reset();
+	bOutCanLeave = false;
+	auto AddSuccessor = [&](int TargetIdx)
+	{
+		if (BodyTree.Nodes.IsValidIndex(TargetIdx) && IsTextlessLoopNode(BodyTree.Nodes[TargetIdx]))
+		{
+			OutSuccessors.AddUnique(TargetIdx);
+		}
+		else
+		{
+			bOutCanLeave = true;
+		}
+	};
+
+	const auto& Node = BodyTree.Nodes[NodeIdx];
+	switch (Node.NodeType)
+	{
+	case ESUDSParsedNodeType::Goto:
+		AddSuccessor(GetGotoTargetNodeIndex(BodyTree, Node.Identifier));
+		break;
+	case ESUDSParsedNodeType::Gosub:
+		{
+			// The sub always comes back here if it returns, so going into it doesn't leave anything by itself; what
+			// matters is whether it can get to text without returning, and whether we carry on after it
+			const TextlessSubExits* pExits = SubExits.Find(Node.Identifier);
+			if (!pExits || pExits->bMayLeave)
+			{
+				bOutCanLeave = true;
+			}
+			if (pExits && pExits->bMayReturn)
+			{
+				for (const auto& Edge : Node.Edges)
+				{
+					AddSuccessor(Edge.TargetNodeIdx);
+				}
+				if (Node.Edges.IsEmpty())
+				{
+					bOutCanLeave = true;
+				}
+			}
+			break;
+		}
+	case ESUDSParsedNodeType::Return:
+		bOutCanLeave = true;
+		break;
+	default:
+		// Sets, events & selects
+		for (const auto& Edge : Node.Edges)
+		{
+			AddSuccessor(Edge.TargetNodeIdx);
+		}
+		if (Node.Edges.IsEmpty())
+		{
+			bOutCanLeave = true;
+		}
+		break;
+	}
+}
+
+void FSUDSScriptImporter::FindTextlessSubExits(TMap<FString, TextlessSubExits>& OutSubExits)
+{
+	// Subs can call other subs, or themselves, so we can't always know how one finishes before walking it. Instead we
+	// start by assuming no sub can finish at all, and keep walking every sub with what we know so far until nothing
+	// changes. Exits are only ever added, so this always settles
+	OutSubExits.Reset();
+	for (const auto& Node : BodyTree.Nodes)
+	{
+		if (Node.NodeType == ESUDSParsedNodeType::Gosub)
+		{
+			OutSubExits.FindOrAdd(Node.Identifier);
+		}
+	}
+
+	TBitArray<> Visited;
+	TArray<int> Stack;
+	TArray<int> Successors;
+	bool bChanged = true;
+	while (bChanged)
+	{
+		bChanged = false;
+		for (auto& Pair : OutSubExits)
+		{
+			TextlessSubExits Exits;
+			Visited.Init(false, BodyTree.Nodes.Num());
+			const int StartIdx = GetGotoTargetNodeIndex(BodyTree, Pair.Key);
+			if (BodyTree.Nodes.IsValidIndex(StartIdx) && IsTextlessLoopNode(BodyTree.Nodes[StartIdx]))
+			{
+				Stack.Push(StartIdx);
+				Visited[StartIdx] = true;
+			}
+			else
+			{
+				Exits.bMayLeave = true;
+			}
+			while (!Stack.IsEmpty())
+			{
+				const int Idx = Stack.Pop();
+				if (BodyTree.Nodes[Idx].NodeType == ESUDSParsedNodeType::Return)
+				{
+					Exits.bMayReturn = true;
+					continue;
+				}
+				bool bCanLeave;
+				GetTextlessSuccessors(Idx, OutSubExits, Successors, bCanLeave);
+				Exits.bMayLeave = Exits.bMayLeave || bCanLeave;
+				for (const int Next : Successors)
+				{
+					if (!Visited[Next])
+					{
+						Visited[Next] = true;
+						Stack.Push(Next);
+					}
+				}
+			}
+
+			if ((Exits.bMayReturn && !Pair.Value.bMayReturn) || (Exits.bMayLeave && !Pair.Value.bMayLeave))
+			{
+				Pair.Value.bMayReturn = Pair.Value.bMayReturn || Exits.bMayReturn;
+				Pair.Value.bMayLeave = Pair.Value.bMayLeave || Exits.bMayLeave;
+				bChanged = true;
+			}
+		}
+	}
+}
+
+bool FSUDSScriptImporter::CheckForTextlessLoops(const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent)
+{
+	// A loop made only of sets, selects, events, gotos & gosubs never hands control back to the game. If nothing in
+	// the loop can leave it, the dialogue would hang as soon as it got there, so that's an error. Loops which can only
+	// be left depending on conditions are legitimate (e.g. counting loops), but can still hang, so are warned about.
+	// We find loops as strongly connected components of the graph of nodes which can follow each other without text
+	// (Tarjan's algorithm, iterative so that long scripts can't overflow the stack)
+	// Gosubs are followed into the sub too, so that recursion is found, but that call edge never counts as a way out
+	// since the sub either comes back (matched to its call site) or gets to text, which its exits tell us about
+	const int NumNodes = BodyTree.Nodes.Num();
+	TMap<FString, TextlessSubExits> SubExits;
+	FindTextlessSubExits(SubExits);
+	TArray<TArray<int>> Successors;
+	TArray<int> CallTargets;
+	TBitArray<> CanLeave(false, NumNodes);
+	Successors.SetNum(NumNodes);
+	CallTargets.Init(-1, NumNodes);
+	for (int i = 0; i < NumNodes; ++i)
+	{
+		const auto& Node = BodyTree.Nodes[i];
+		if (IsTextlessLoopNode(Node))
+		{
+			bool bCanLeave;
+			GetTextlessSuccessors(i, SubExits, Successors[i], bCanLeave);
+			CanLeave[i] = bCanLeave;
+			if (Node.NodeType == ESUDSParsedNodeType::Gosub)
+			{
+				const int SubIdx = GetGotoTargetNodeIndex(BodyTree, Node.Identifier);
+				if (BodyTree.Nodes.IsValidIndex(SubIdx) && IsTextlessLoopNode(BodyTree.Nodes[SubIdx]))
+				{
+					Successors[i].AddUnique(SubIdx);
+					CallTargets[i] = SubIdx;
+				}
+			}
+		}
+	}
+
+	struct FFrame
+	{
+		int NodeIdx;
+		int NextSuccessor;
+	};
+	TArray<int> Index;
+	TArray<int> LowLink;
+	Index.Init(-1, NumNodes);
+	LowLink.Init(-1, NumNodes);
+	TBitArray<> OnStack(false, NumNodes);
+	TBitArray<> InComponent(false, NumNodes);
+	TArray<int> Stack;
+	TArray<FFrame> CallStack;
+	int Counter = 0;
+	bool bOK = true;
+
+	for (int Root = 0; Root < NumNodes; ++Root)
+	{
+		if (Index[Root] != -1 || !IsTextlessLoopNode(BodyTree.Nodes[Root]))
+		{
+			continue;
+		}
+
+		Index[Root] = LowLink[Root] = Counter++;
+		Stack.Push(Root);
+		OnStack[Root] = true;
+		CallStack.Push(FFrame { Root, 0 });
+		while (!CallStack.IsEmpty())
+		{
+			FFrame& Frame = CallStack.Last();
+			const int V = Frame.NodeIdx;
+			if (Frame.NextSuccessor < Successors[V].Num())
+			{
+				const int W = Successors[V][Frame.NextSuccessor++];
+				if (Index[W] == -1)
+				{
+					Index[W] = LowLink[W] = Counter++;
+					Stack.Push(W);
+					OnStack[W] = true;
+					CallStack.Push(FFrame { W, 0 });
+				}
+				else if (OnStack[W])
+				{
+					LowLink[V] = FMath::Min(LowLink[V], Index[W]);
+				}
+				continue;
+			}
+
+			CallStack.Pop();
+			if (!CallStack.IsEmpty())
+			{
+				const int Parent = CallStack.Last().NodeIdx;
+				LowLink[Parent] = FMath::Min(LowLink[Parent], LowLink[V]);
+			}
+			if (LowLink[V] != Index[V])
+			{
+				continue;
+			}
+
+			// V is the root of a component, pop it off
+			TArray<int> Component;
+			int W;
+			do
+			{
+				W = Stack.Pop();
+				OnStack[W] = false;
+				Component.Add(W);
+			}
+			while (W != V);
+
+			if (Component.Num() == 1 && !Successors[V].Contains(V))
+			{
+				// Not a loop
+				continue;
+			}
+
+			for (const int NodeIdx : Component)
+			{
+				InComponent[NodeIdx] = true;
+			}
+			bool bComponentCanLeave = false;
+			TArray<int> Lines;
+			for (const int NodeIdx : Component)
+			{
+				bComponentCanLeave = bComponentCanLeave || CanLeave[NodeIdx];
+				for (const int Next : Successors[NodeIdx])
+				{
+					if (Next != CallTargets[NodeIdx])
+					{
+						bComponentCanLeave = bComponentCanLeave || !InComponent[Next];
+					}
+				}
+				Lines.AddUnique(BodyTree.Nodes[NodeIdx].SourceLineNo);
+			}
+			for (const int NodeIdx : Component)
+			{
+				InComponent[NodeIdx] = false;
+			}
+			Lines.Sort();
+			FString LineList;
+			for (const int Line : Lines)
+			{
+				LineList.Appendf(TEXT("%s%d"), LineList.IsEmpty() ? TEXT("") : TEXT(", "), Line);
+			}
+
+			if (!bComponentCanLeave)
+			{
+				bOK = false;
+				if (!bSilent)
+				{
+					Logger->Logf(ELogVerbosity::Error,
+					             TEXT("Error in %s line %d: Lines %s loop forever without a speaker line or choice, the dialogue would never finish"),
+					             *NameForErrors,
+					             Lines[0],
+					             *LineList);
+				}
+			}
+			else if (!bSilent)
+			{
+				Logger->Logf(ELogVerbosity::Warning,
+				             TEXT("Warning in %s line %d: Lines %s can loop without a speaker line or choice, depending on conditions. Make sure the loop always ends"),
+				             *NameForErrors,
+				             Lines[0],
+				             *LineList);
+			}
+		}
+	}
+
+	return bOK;
+}
+
+void FSUDSScriptImporter::AnalyseScript(FSUDSScriptAnalysis& OutAnalysis, const TArray<FName>& ProvidedVariables)
+{
+	OutAnalysis = FSUDSScriptAnalysis();
+	const int NumNodes = BodyTree.Nodes.Num();
+
+	// Reachability; the start of the script and every label are entry points, since dialogue can be started from
+	// any label
+	TArray<TArray<int>> Successors;
+	BuildControlFlowGraph(Successors);
+	OutAnalysis.ReachableNodes.Init(false, NumNodes);
+	TArray<int> Stack;
+	auto Visit = [&](int NodeIdx)
+	{
+		if (BodyTree.Nodes.IsValidIndex(NodeIdx) && !OutAnalysis.ReachableNodes[NodeIdx])
+		{
+			OutAnalysis.ReachableNodes[NodeIdx] = true;
+			Stack.Push(NodeIdx);
+		}
+	};
+	Visit(0);
+	for (const auto& Pair : BodyTree.GotoLabelList)
+	{
+		Visit(Pair.Value);
+	}
+	while (!Stack.IsEmpty())
+	{
+		const int NodeIdx = Stack.Pop();
+		for (const int Next : Successors[NodeIdx])
+		{
+			Visit(Next);
+		}
+	}
+
+	// Labels which are used by gotos & gosubs
+	TSet<FString> UsedLabels;
+	for (const auto& Node : BodyTree.Nodes)
+	{
+		if (Node.NodeType == ESUDSParsedNodeType::Goto || Node.NodeType == ESUDSParsedNodeType::Gosub)
+		{
+			UsedLabels.Add(Node.Identifier);
+		}
+	}
+
+	for (int i = 0; i < NumNodes; ++i)
+	{
+		const auto& Node = BodyTree.Nodes[i];
+		if (!OutAnalysis.ReachableNodes[i])
+		{
+			++OutAnalysis.NumUnreachableNodes;
+			if (Node.NodeType == ESUDSParsedNodeType::Text)
+			{
+				OutAnalysis.UnreachableSpeakerLines.Add(FSUDSScriptAnalysisItem(Node.Identifier, Node.SourceLineNo));
+			}
+		}
+	}
+	for (const auto& Pair : BodyTree.GotoLabelList)
+	{
+		if (!UsedLabels.Contains(Pair.Key) && BodyTree.Nodes.IsValidIndex(Pair.Value))
+		{
+			OutAnalysis.UnusedLabels.Add(FSUDSScriptAnalysisItem(Pair.Key, BodyTree.Nodes[Pair.Value].SourceLineNo));
+		}
+	}
+	OutAnalysis.UnusedLabels.Sort([](const FSUDSScriptAnalysisItem& A, const FSUDSScriptAnalysisItem& B)
+	{
+		return A.SourceLineNo < B.SourceLineNo;
+	});
+
+	AnalyseVariables(OutAnalysis, ProvidedVariables);
+}
+
+void FSUDSScriptImporter::BuildControlFlowGraph(TArray<TArray<int>>& OutSuccessors)
+{
+	const int NumNodes = BodyTree.Nodes.Num();
+	OutSuccessors.Reset();
+	OutSuccessors.SetNum(NumNodes);
+	TMap<FString, TArray<int>> SubReturns;
+	FindSubReturns(SubReturns);
+
+	for (int i = 0; i < NumNodes; ++i)
+	{
+		const auto& Node = BodyTree.Nodes[i];
+		switch (Node.NodeType)
+		{
+		case ESUDSParsedNodeType::Goto:
+			{
+				const int TargetIdx = GetGotoTargetNodeIndex(BodyTree, Node.Identifier);
+				if (BodyTree.Nodes.IsValidIndex(TargetIdx))
+				{
+					OutSuccessors[i].Add(TargetIdx);
+				}
+				break;
+			}
+		case ESUDSParsedNodeType::Gosub:
+			{
+				// The call edge goes into the sub; the nodes after the gosub are only reached by the sub's returns
+				const int TargetIdx = GetGotoTargetNodeIndex(BodyTree, Node.Identifier);
+				if (BodyTree.Nodes.IsValidIndex(TargetIdx))
+				{
+					OutSuccessors[i].Add(TargetIdx);
+					for (const int ReturnIdx : SubReturns.FindChecked(Node.Identifier))
+					{
+						for (const auto& Edge : Node.Edges)
+						{
+							if (BodyTree.Nodes.IsValidIndex(Edge.TargetNodeIdx))
+							{
+								OutSuccessors[ReturnIdx].AddUnique(Edge.TargetNodeIdx);
+							}
+						}
+					}
+				}
+				else
+				{
+					// Sub couldn't be resolved, so be conservative and assume it returns
+					for (const auto& Edge : Node.Edges)
+					{
+						if (BodyTree.Nodes.IsValidIndex(Edge.TargetNodeIdx))
+						{
+							OutSuccessors[i].AddUnique(Edge.TargetNodeIdx);
+						}
+					}
+				}
+				break;
+			}
+		case ESUDSParsedNodeType::Return:
+			// Edges are added by the gosubs which can return here
+			break;
+		default:
+			for (const auto& Edge : Node.Edges)
+			{
+				if (BodyTree.Nodes.IsValidIndex(Edge.TargetNodeIdx))
+				{
+					OutSuccessors[i].AddUnique(Edge.TargetNodeIdx);
+				}
+			}
+			break;
+		}
+	}
+}
+
+void FSUDSScriptImporter::FindSubReturns(TMap<FString, TArray<int>>& OutSubReturns)
+{
+	// Subs can call other subs, or themselves, and whether a sub can get to its own returns depends on whether the
+	// subs it calls can return. So start by assuming no sub returns, and keep walking every sub with what we know so
+	// far until nothing changes. Returns are only ever added, so this always settles
+	OutSubReturns.Reset();
+	for (const auto& Node : BodyTree.Nodes)
+	{
+		if (Node.NodeType == ESUDSParsedNodeType::Gosub)
+		{
+			OutSubReturns.FindOrAdd(Node.Identifier);
+		}
+	}
+
+	TBitArray<> Visited;
+	TArray<int> Stack;
+	auto Visit = [&](int NodeIdx)
+	{
+		if (BodyTree.Nodes.IsValidIndex(NodeIdx) && !Visited[NodeIdx])
+		{
+			Visited[NodeIdx] = true;
+			Stack.Push(NodeIdx);
+		}
+	};
+	bool bChanged = true;
+	while (bChanged)
+	{
+		bChanged = false;
+		for (auto& Pair : OutSubReturns)
+		{
+			// Walk the sub without entering nested gosubs; they continue to the following node if they can return
+			Visited.Init(false, BodyTree.Nodes.Num());
+			Visit(GetGotoTargetNodeIndex(BodyTree, Pair.Key));
+			while (!Stack.IsEmpty())
+			{
+				const int NodeIdx = Stack.Pop();
+				const auto& Node = BodyTree.Nodes[NodeIdx];
+				switch (Node.NodeType)
+				{
+				case ESUDSParsedNodeType::Return:
+					if (!Pair.Value.Contains(NodeIdx))
+					{
+						Pair.Value.Add(NodeIdx);
+						bChanged = true;
+					}
+					break;
+				case ESUDSParsedNodeType::Goto:
+					Visit(GetGotoTargetNodeIndex(BodyTree, Node.Identifier));
+					break;
+				case ESUDSParsedNodeType::Gosub:
+					if (GetGotoTargetNodeIndex(BodyTree, Node.Identifier) == -1 || !OutSubReturns.FindChecked(Node.Identifier).IsEmpty())
+					{
+						for (const auto& Edge : Node.Edges)
+						{
+							Visit(Edge.TargetNodeIdx);
+						}
+					}
+					break;
+				default:
+					for (const auto& Edge : Node.Edges)
+					{
+						Visit(Edge.TargetNodeIdx);
+					}
+					break;
+				}
+			}
+		}
+	}
+}
+
+void FSUDSScriptImporter::AnalyseVariables(FSUDSScriptAnalysis& OutAnalysis, const TArray<FName>& ProvidedVariables) const
+{
+	// First line each variable is set / read on
+	TMap<FName, int> SetLines;
+	TMap<FName, int> ReadLines;
+	auto AddVariable = [](TMap<FName, int>& Lines, const FName& Name, int LineNo)
+	{
+		// Global variables are shared with other scripts, so can't be judged from this one
+		FName LocalName;
+		if (!USUDSLibrary::IsDialogueVariableGlobal(Name, LocalName))
+		{
+			int& FirstLine = Lines.FindOrAdd(Name, LineNo);
+			FirstLine = FMath::Min(FirstLine, LineNo);
+		}
+	};
+	auto AddExpression = [&](const FSUDSExpression& Expr, int LineNo)
+	{
+		for (const FName& Name : Expr.GetVariableNames())
+		{
+			AddVariable(ReadLines, Name, LineNo);
+		}
+	};
+	auto AddText = [&](const FString& Text, int LineNo)
+	{
+		if (Text.Contains(TEXT("{")))
+		{
+			TArray<FString> Params;
+			FTextFormat(FText::FromString(Text)).GetFormatArgumentNames(Params);
+			for (const FString& Param : Params)
+			{
+				AddVariable(ReadLines, FName(Param), LineNo);
+			}
+		}
+	};
+
+	for (const ParsedTree* Tree : { &HeaderTree, &BodyTree })
+	{
+		for (const auto& Node : Tree->Nodes)
+		{
+			switch (Node.NodeType)
+			{
+			case ESUDSParsedNodeType::SetVariable:
+				AddVariable(SetLines, FName(Node.Identifier), Node.SourceLineNo);
+				AddExpression(Node.Expression, Node.SourceLineNo);
+				break;
+			case ESUDSParsedNodeType::Text:
+				AddText(Node.Text, Node.SourceLineNo);
+				break;
+			case ESUDSParsedNodeType::Event:
+				for (const auto& Arg : Node.EventArgs)
+				{
+					AddExpression(Arg, Node.SourceLineNo);
+				}
+				break;
+			default:
+				break;
+			}
+			for (const auto& Edge : Node.Edges)
+			{
+				AddText(Edge.Text, Edge.SourceLineNo);
+				AddExpression(Edge.ConditionExpression, Edge.SourceLineNo);
+			}
+		}
+	}
+
+	for (const auto& Pair : SetLines)
+	{
+		if (!ReadLines.Contains(Pair.Key))
+		{
+			OutAnalysis.UnreadVariables.Add(FSUDSScriptAnalysisItem(Pair.Key.ToString(), Pair.Value));
+		}
+	}
+	for (const auto& Pair : ReadLines)
+	{
+		if (!SetLines.Contains(Pair.Key) && !ProvidedVariables.Contains(Pair.Key))
+		{
+			OutAnalysis.UnsetVariables.Add(FSUDSScriptAnalysisItem(Pair.Key.ToString(), Pair.Value));
+		}
+	}
+	auto ByLine = [](const FSUDSScriptAnalysisItem& A, const FSUDSScriptAnalysisItem& B)
+	{
+		return A.SourceLineNo < B.SourceLineNo;
+	};
+	OutAnalysis.UnreadVariables.Sort(ByLine);
+	OutAnalysis.UnsetVariables.Sort(ByLine);
+}
+
+void FSUDSScriptImporter::LogAnalysis(const FSUDSScriptAnalysis& Analysis, const FString& NameForErrors, FSUDSMessageLogger* Logger)
+{
+	for (const auto& Item : Analysis.UnreachableSpeakerLines)
+	{
+		Logger->Logf(ELogVerbosity::Warning,
+		             TEXT("Warning in %s line %d: Speaker line for '%s' can never be reached"),
+		             *NameForErrors,
+		             Item.SourceLineNo,
+		             *Item.Name);
+	}
+	for (const auto& Item : Analysis.UnusedLabels)
+	{
+		Logger->Logf(ELogVerbosity::Display,
+		             TEXT("Note in %s line %d: Label '%s' is not used by any goto or gosub, so is only useful for starting dialogue from code"),
+		             *NameForErrors,
+		             Item.SourceLineNo,
+		             *Item.Name);
+	}
+	for (const auto& Item : Analysis.UnreadVariables)
+	{
+		Logger->Logf(ELogVerbosity::Display,
+		             TEXT("Note in %s line %d: Variable '%s' is set but never read by this script"),
+		             *NameForErrors,
+		             Item.SourceLineNo,
+		             *Item.Name);
+	}
+	for (const auto& Item : Analysis.UnsetVariables)
+	{
+		Logger->Logf(ELogVerbosity::Display,
+		             TEXT("Note in %s line %d: Variable '%s' is read but never set by this script"),
+		             *NameForErrors,
+		             Item.SourceLineNo,
+		             *Item.Name);
+	}
+}
+
+void FSUDSScriptImporter::StripUnreachableNodes(ParsedTree& Tree, const TBitArray<>& ReachableNodes)
+{
+	TArray<int> IndexRemap;
+	IndexRemap.SetNumUninitialized(Tree.Nodes.Num());
+	TArray<FSUDSParsedNode> Kept;
+	for (int i = 0; i < Tree.Nodes.Num(); ++i)
+	{
+		if (ReachableNodes[i])
+		{
+			IndexRemap[i] = Kept.Num();
+			Kept.Add(MoveTemp(Tree.Nodes[i]));
+		}
+		else
+		{
+			IndexRemap[i] = -1;
+		}
 	}
-	return bOK;
+
+	auto Remap = [&IndexRemap](int Idx)
+	{
+		return IndexRemap.IsValidIndex(Idx) ? IndexRemap[Idx] : -1;
+	};
+	for (auto& Node : Kept)
+	{
+		Node.ParentNodeIdx = Remap(Node.ParentNodeIdx);
+		for (auto& Edge : Node.Edges)
+		{
+			// The only reachable nodes with edges to unreachable ones are gosubs to subs which never return, and
+			// those edges can never be followed so they might as well go to the end
+			Edge.SourceNodeIdx = Remap(Edge.SourceNodeIdx);
+			Edge.TargetNodeIdx = Remap(Edge.TargetNodeIdx);
+		}
+	}
+	// Labels are entry points so are always reachable
+	for (auto& Pair : Tree.GotoLabelList)
+	{
+		Pair.Value = Remap(Pair.Value);
+	}
+	Tree.Nodes = MoveTemp(Kept);
 }
 
 bool FSUDSScriptImporter::ChoiceNodeCheckPaths(const FSUDSParsedNode& ChoiceNode,
+                                               ChoicePathCheckState& State,
                                                const FString& NameForErrors,
                                                FSUDSMessageLogger* Logger,
                                                bool bSilent)
-{
-	return RecurseChoiceNodeCheckPaths(ChoiceNode, ChoiceNode, NameForErrors, Logger, bSilent);
-}
-
-bool FSUDSScriptImporter::RecurseChoiceNodeCheckPaths(const FSUDSParsedNode& OrigChoiceNode,
-	const FSUDSParsedNode& CurrChoiceNode,
-	const FString& NameForErrors,
-	FSUDSMessageLogger* Logger,
-	bool bSilent)
 {
 	bool bOK = true;
-	for (const auto& Edge: CurrChoiceNode.Edges)
+	for (const auto& Edge: ChoiceNode.Edges)
 	{
 		// We want to make sure that every choice path leads to a speaker line, before it leads to another choice
 		// A choice that leads directly to another choice can't be properly represented in dialogue; choices have to
 		// be anchored by speaker lines so proceeding to another choice directly after a choice is made is wrong
 		// Usually this will be caused by a bad goto but could also be just bad nesting
 		// Every path has to lead to a speaker node before a choice
-		bOK = RecurseChoiceNodeCheckPaths(OrigChoiceNode, Edge, NameForErrors, Logger, bSilent) && bOK;
+		bOK = ChoiceEdgeCheckPaths(Edge, State, NameForErrors, Logger, bSilent) && bOK;
 	}
 	return bOK;
 }
 
-bool FSUDSScriptImporter::RecurseChoiceNodeCheckPaths(const FSUDSParsedNode& ChoiceNode, const FSUDSParsedEdge& Edge,
-                                                      const FString& NameForErrors,
-                                                      FSUDSMessageLogger* Logger,
-                                                      bool bSilent)
+bool FSUDSScriptImporter::ChoiceEdgeCheckPaths(const FSUDSParsedEdge& Edge,
+                                               ChoicePathCheckState& State,
+                                               const FString& NameForErrors,
+                                               FSUDSMessageLogger* Logger,
+                                               bool bSilent)
+{
+	const int TerminalIdx = FindChoicePathTerminal(Edge.TargetNodeIdx, State);
+	const FSUDSParsedNode* TargetNode = GetNode(TerminalIdx);
+	if (!TargetNode)
+	{
+		// Reached the end
+		return true;
+	}
+	
+	switch (TargetNode->NodeType)
+	{
+	case ESUDSParsedNodeType::Choice:
+		// Definitely not ok, we found a choice node before a speaker node
+		Logger->Logf(ELogVerbosity::Error,
+		             TEXT(
+			             "%s: Choice '%s' on line %d needs a speaker line between it and the next choice at line %d. Choices MUST show another speaker line before the next choice."),
+		             *NameForErrors,
+		             *Edge.Text,
+		             Edge.SourceLineNo,
+		             TargetNode->SourceLineNo);
+		return false;
+	case ESUDSParsedNodeType::Select:
+		// Recurse selects & randoms; but in this case we can have nested choices underneath
+		return SelectNodeCheckPaths(TerminalIdx, State, NameForErrors, Logger, bSilent);
+	case ESUDSParsedNodeType::Text:
+		// We're OK, found a speaker line
+	case ESUDSParsedNodeType::Gosub:
+	case ESUDSParsedNodeType::Return:
+		// We can't really check the gosub/return statically, this will be a runtime error
+	default:
+		return true;
+	}
+}
+
+bool FSUDSScriptImporter::SelectNodeCheckPaths(int SelectNodeIdx,
+                                               ChoicePathCheckState& State,
+                                               const FString& NameForErrors,
+                                               FSUDSMessageLogger* Logger,
+                                               bool bSilent)
 {
-	const FSUDSParsedNode* TargetNode = GetNode(Edge.TargetNodeIdx);
-	while (TargetNode)
+	// Every choice leading to a select gets the same answer, so only check (and report errors for) each select once
+	switch (State.SelectResults[SelectNodeIdx])
+	{
+	case ChoicePathCheckState::CheckedOK:
+		return true;
+	case ChoicePathCheckState::CheckedBad:
+		return false;
+	case ChoicePathCheckState::Checking:
+		// We've looped back to a select we're already checking, its other paths are being checked already
+		return true;
+	default:
+		break;
+	}
+
+	State.SelectResults[SelectNodeIdx] = ChoicePathCheckState::Checking;
+	bool bOK = true;
+	for (const auto& SelEdge : BodyTree.Nodes[SelectNodeIdx].Edges)
 	{
-		switch (TargetNode->NodeType)
+		++Test_ImportSearchSteps;
+		const auto SelTarget = GetNode(SelEdge.TargetNodeIdx);
+		if (SelTarget)
 		{
-		case ESUDSParsedNodeType::Text:
-			// We're OK, found a speaker line
-			return true;
-		case ESUDSParsedNodeType::Choice:
-			// Definitely not ok, we found a choice node before a speaker node
-			Logger->Logf(ELogVerbosity::Error,
-			             TEXT(
-				             "%s: Choice '%s' on line %d needs a speaker line between it and the next choice at line %d. Choices MUST show another speaker line before the next choice."),
-			             *NameForErrors,
-			             *Edge.Text,
-			             Edge.SourceLineNo,
-			             TargetNode->SourceLineNo);
-			return false;
-		case ESUDSParsedNodeType::Select:
-			{
-				// Recurse selects & randoms; but in this case we can have nested choices underneath
-				bool bOK = true;
-				for (const auto& SelEdge : TargetNode->Edges)
-				{
-					const auto SelTarget = GetNode(SelEdge.TargetNodeIdx);
-					if (SelTarget)
-					{
-						if (SelTarget->NodeType == ESUDSParsedNodeType::Choice)
-						{
-							// First level of nested choices is OK; they will be combined with the original choice
-							// We don't need to recurse here since this choice will itself
-						}
-						else
-						{
-							bOK = RecurseChoiceNodeCheckPaths(ChoiceNode, SelEdge, NameForErrors, Logger, bSilent);
-						}
-					}
-				}
-				return bOK;
-			}
-		case ESUDSParsedNodeType::SetVariable:
-		case ESUDSParsedNodeType::Event:
-			// Continue (linear)
-			if (TargetNode->Edges.Num() > 0)
+			if (SelTarget->NodeType == ESUDSParsedNodeType::Choice)
 			{
-				TargetNode = GetNode(TargetNode->Edges[0].TargetNodeIdx);
+				// First level of nested choices is OK; they will be combined with the original choice
+				// We don't need to recurse here since this choice will itself
 			}
 			else
 			{
-				// This can happen if the event is the last line, but also nested in a choice
-				return true;
+				bOK = ChoiceEdgeCheckPaths(SelEdge, State, NameForErrors, Logger, bSilent) && bOK;
 			}
+		}
+	}
+	State.SelectResults[SelectNodeIdx] = bOK ? ChoicePathCheckState::CheckedOK : ChoicePathCheckState::CheckedBad;
+	return bOK;
+}
+
+int FSUDSScriptImporter::FindChoicePathTerminal(int NodeIdx, ChoicePathCheckState& State)
+{
+	// Skip over nodes which just continue linearly (set, event, goto) to the node which decides whether the path is
+	// OK. Every node we pass through gets the same answer, so long linear runs & chains of gotos are only followed once
+	// Gosubs aren't followed (see ChoiceEdgeCheckPaths), so a node's answer never depends on how we got to it
+	TArray<int, TInlineAllocator<16>> Passed;
+	int Result = -1;
+	int Idx = NodeIdx;
+	while (BodyTree.Nodes.IsValidIndex(Idx))
+	{
+		++Test_ImportSearchSteps;
+		const int Cached = State.Terminals[Idx];
+		if (Cached == ChoicePathCheckState::InProgress)
+		{
+			// Looped back on ourselves without reaching anything else, treat as the end
+			break;
+		}
+		if (Cached != ChoicePathCheckState::Unresolved)
+		{
+			Result = Cached;
+			break;
+		}
+
+		const auto& Node = BodyTree.Nodes[Idx];
+		if (Node.NodeType == ESUDSParsedNodeType::SetVariable ||
+			Node.NodeType == ESUDSParsedNodeType::Event)
+		{
+			State.Terminals[Idx] = ChoicePathCheckState::InProgress;
+			Passed.Add(Idx);
+			// No edges can happen if the event is the last line, but also nested in a choice; that's the end
+			Idx = Node.Edges.Num() > 0 ? Node.Edges[0].TargetNodeIdx : -1;
+		}
+		else if (Node.NodeType == ESUDSParsedNodeType::Goto)
+		{
+			State.Terminals[Idx] = ChoicePathCheckState::InProgress;
+			Passed.Add(Idx);
+			// Follow the goto (if end, will result in -1)
+			Idx = GetGotoTargetNodeIndex(BodyTree, Node.Identifier);
+		}
+		else
+		{
+			State.Terminals[Idx] = Idx;
+			Result = Idx;
 			break;
-		case ESUDSParsedNodeType::Gosub:
-		case ESUDSParsedNodeType::Return:
-			// We can't really check the gosub/return statically, this will be a runtime error
-			return true;
-		case ESUDSParsedNodeType::Goto:
-			{
-				// Follow the goto (if end, will result in null)
-				const int GotoIdx = GetGotoTargetNodeIndex(BodyTree, TargetNode->Identifier);
-				TargetNode = GetNode(GotoIdx);
-				break;
-			}
 		}
 	}
 
-	return true;
+	for (const int PassedIdx : Passed)
+	{
+		State.Terminals[PassedIdx] = Result;
+	}
+	return Result;
 }
 
-int FSUDSScriptImporter::FindFallthroughNodeIndex(FSUDSScriptImporter::ParsedTree& Tree,
-                                                  int StartNodeIndex,
-                                                  const FString& FromChoicePath,
-                                                  const FString& FromConditionalPath)
+void FSUDSScriptImporter::FindFallthroughNodeIndices(const FSUDSScriptImporter::ParsedTree& Tree, TArray<int>& OutFallthroughIndices)
 {
+	// For every node, find the first node after it which it can fall through to, or -1 if there isn't one
+	//
 	// In order to be a valid fallthrough, also needs to be on the same choice (or select) path
 	// E.g. it's possible to have:
 	// 
@@ -2172,23 +3432,60 @@ int FSUDSScriptImporter::FindFallthroughNodeIndex(FSUDSScriptImporter::ParsedTre
 	//  - Point T3 is on / which is a subset of /C1 so OK
 
 	// We'll form these paths just from node indexes rather than C1/C2 etc. Nesting can be for a choice or a select
-	for (int i = StartNodeIndex; i < Tree.Nodes.Num(); ++i)
+	//
+	// Scanning forwards from every node is quadratic on long scripts, so instead we go backwards, keeping the nearest
+	// valid fallthrough target for each combination of choice & conditional path. A node's fallthrough is then the
+	// nearest of those whose paths are both prefixes of its own, and there are only as many prefixes as the path is deep.
+	//
+	// We used to require that the target's OriginalIndent < IndentLessThan here
+	// However, this is actually not needed, since indentation only controls association with choice paths, otherwise
+	// it's irrelevant. And we already check that things only fall through if they're on the same choice/conditional
+	// path (or a superset of it). 
+
+	// Every interned path which is a prefix of each path (including itself)
+	TArray<TArray<int>> PathPrefixes;
+	PathPrefixes.SetNum(Tree.Paths.Num());
+	FString PrefixBuffer;
+	for (int PathID = 0; PathID < Tree.Paths.Num(); ++PathID)
+	{
+		GetTreePathPrefixIDs(Tree, PathID, PrefixBuffer, PathPrefixes[PathID]);
+	}
+
+	OutFallthroughIndices.Init(-1, Tree.Nodes.Num());
+	// Nearest fallthrough target after the current node, keyed on choice path ID & conditional path ID
+	TMap<uint64, int> NextTargets;
+	auto MakeKey = [](int ChoicePathID, int ConditionalPathID)
+	{
+		return (static_cast<uint64>(ChoicePathID) << 32) | static_cast<uint32>(ConditionalPathID);
+	};
+	for (int i = Tree.Nodes.Num() - 1; i >= 0; --i)
 	{
-		auto N = Tree.Nodes[i];
-		// We used to require that N.OriginalIndent < IndentLessThan here
-		// However, this is actually not needed, since indentation only controls association with choice paths, otherwise
-		// it's irrelevant. And we already check that things only fall through if they're on the same choice/conditional
-		// path (or a superset of it). 
-		if (N.AllowFallthrough &&
-			FromChoicePath.StartsWith(N.ChoicePath) &&
-			FromConditionalPath.StartsWith(N.ConditionalPath))
+		const auto& N = Tree.Nodes[i];
+		if (!PathPrefixes.IsValidIndex(N.ChoicePathID) || !PathPrefixes.IsValidIndex(N.ConditionalPathID))
 		{
-			return i;
+			continue;
 		}
-		
-	}
 
-	return -1;
+		int Best = -1;
+		for (const int ChoicePrefixID : PathPrefixes[N.ChoicePathID])
+		{
+			for (const int CondPrefixID : PathPrefixes[N.ConditionalPathID])
+			{
+				++Test_ImportSearchSteps;
+				const int* pIdx = NextTargets.Find(MakeKey(ChoicePrefixID, CondPrefixID));
+				if (pIdx && (Best == -1 || *pIdx < Best))
+				{
+					Best = *pIdx;
+				}
+			}
+		}
+		OutFallthroughIndices[i] = Best;
+
+		if (N.AllowFallthrough)
+		{
+			NextTargets.Add(MakeKey(N.ChoicePathID, N.ConditionalPathID), i);
+		}
+	}
 }
 
 const FSUDSParsedNode* FSUDSScriptImporter::GetNode(const FSUDSScriptImporter::ParsedTree& Tree, int Index)
@@ -2235,7 +3532,16 @@ int FSUDSScriptImporter::GetGotoTargetNodeIndex(const ParsedTree& Tree, const FS
 	
 }
 
-void FSUDSScriptImporter::PopulateAsset(USUDSScript* Asset, UStringTable* StringTable)
+FSUDSPreviousImport::FSUDSPreviousImport(const USUDSScript* Script)
+{
+	if (Script)
+	{
+		Nodes = Script->GetNodes();
+		SectionHashes = Script->NodeSectionHashes;
+	}
+}
+
+void FSUDSScriptImporter::PopulateAsset(USUDSScript* Asset, UStringTable* StringTable, const FSUDSPreviousImport* Previous)
 {
 	// This is only called if the parsing was successful
 	// Populate the runtime asset
@@ -2248,12 +3554,263 @@ void FSUDSScriptImporter::PopulateAsset(USUDSScript* Asset, UStringTable* String
 
 	pOutSpeakers->Append(ReferencedSpeakers);
 
-	PopulateAssetFromTree(Asset, HeaderTree, pOutHeaderNodes, pOutHeaderLabels, StringTable);
-	PopulateAssetFromTree(Asset, BodyTree, pOutNodes, pOutLabels, StringTable);
+	// The header is small so is always re-created
+	TSet<FString> StringKeys;
+	Asset->NodeSectionHashes.Reset();
+	PopulateAssetFromTree(Asset, HeaderTree, pOutHeaderNodes, pOutHeaderLabels, StringTable, nullptr, nullptr, StringKeys);
+	PopulateAssetFromTree(Asset, BodyTree, pOutNodes, pOutLabels, StringTable, Previous, &Asset->NodeSectionHashes, StringKeys);
+
+	// The string table may be from a previous import, in which case remove any entries which are no longer used
+	TArray<FString> UnusedKeys;
+	StringTable->GetStringTable()->EnumerateSourceStrings([&](const FString& Key, const FString&)
+	{
+		if (!StringKeys.Contains(Key))
+		{
+			UnusedKeys.Add(Key);
+		}
+		return true;
+	});
+	for (const FString& Key : UnusedKeys)
+	{
+		StringTable->GetMutableStringTable()->RemoveSourceString(Key);
+	}
 
 	Asset->FinishImport();
 }
 
+void FSUDSScriptImporter::CalculateSectionHashes(const ParsedTree& Tree, TArray<uint64>& OutNodeSectionHashes)
+{
+	auto HashString = [](const FString& Str, uint64 Seed)
+	{
+		return CityHash64WithSeed(reinterpret_cast<const char*>(*Str), Str.Len() * sizeof(TCHAR), Seed);
+	};
+	auto HashMetadata = [&HashString](const TMap<FName, FString>& Metadata, uint64 Seed)
+	{
+		for (auto& Pair : Metadata)
+		{
+			Seed = HashString(Pair.Key.ToString(), Seed);
+			Seed = HashString(Pair.Value, Seed);
+		}
+		return Seed;
+	};
+
+	// Labels are included so that identical sections don't merge
+	TMap<int, TArray<FString>> SectionLabels;
+	for (auto& Pair : Tree.GotoLabelList)
+	{
+		SectionLabels.FindOrAdd(Pair.Value).Add(Pair.Key);
+	}
+	for (auto& Pair : SectionLabels)
+	{
+		Pair.Value.Sort();
+	}
+
+	OutNodeSectionHashes.SetNumUninitialized(Tree.Nodes.Num());
+	int SectionStart = 0;
+	uint64 Hash = 0;
+	for (int i = 0; i <= Tree.Nodes.Num(); ++i)
+	{
+		const TArray<FString>* Labels = SectionLabels.Find(i);
+		if (i == Tree.Nodes.Num() || (Labels && i > 0))
+		{
+			// End of section
+			for (int j = SectionStart; j < i; ++j)
+			{
+				OutNodeSectionHashes[j] = Hash;
+			}
+			SectionStart = i;
+			Hash = 0;
+		}
+		if (i == Tree.Nodes.Num())
+		{
+			break;
+		}
+
+		if (Labels)
+		{
+			for (const FString& Label : *Labels)
+			{
+				Hash = HashString(Label, Hash);
+			}
+		}
+		const FSUDSParsedNode& Node = Tree.Nodes[i];
+		const uint8 NodeType = static_cast<uint8>(Node.NodeType);
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&NodeType), sizeof(NodeType), Hash);
+		Hash = HashString(Node.Identifier, Hash);
+		Hash = HashString(Node.Text, Hash);
+		Hash = HashString(Node.TextID, Hash);
+		Hash = HashMetadata(Node.TextMetadata, Hash);
+		Hash = HashString(Node.Expression.GetSourceString(), Hash);
+		for (auto& Arg : Node.EventArgs)
+		{
+			Hash = HashString(Arg.GetSourceString(), Hash);
+		}
+		for (auto& Edge : Node.Edges)
+		{
+			Hash = HashString(Edge.Text, Hash);
+			Hash = HashString(Edge.TextID, Hash);
+			Hash = HashMetadata(Edge.TextMetadata, Hash);
+		}
+	}
+}
+
+/// Re-use a node from a previous import if it's exactly the right class, otherwise create a new one
+template <typename T>
+static T* ReuseOrCreateNode(USUDSScript* Asset, USUDSScriptNode* Previous)
+{
+	if (Previous && Previous->GetClass() == T::StaticClass() && Previous->GetOuter() == Asset)
+	{
+		Previous->ResetEdges();
+		return static_cast<T*>(Previous);
+	}
+	return NewObject<T>(Asset);
+}
+
+/// Set a string table entry's source string, unless it already has it
+static void UpdateStringTableSource(UStringTable* StringTable, const FString& Key, const FString& Text)
+{
+	FString Existing;
+	if (!StringTable->GetStringTable()->GetSourceString(Key, Existing) || !Existing.Equals(Text, ESearchCase::CaseSensitive))
+	{
+		StringTable->GetMutableStringTable()->SetSourceString(Key, Text);
+	}
+}
+
+/**
+ * Set a string table entry and its metadata, unless it's already exactly that. Entries from unchanged sections
+ * usually are, but not if the table is new since the last import, e.g. it was deleted or moved to / from its own package
+ */
+static void UpdateStringTableEntry(UStringTable* StringTable,
+                                   const FString& Key,
+                                   const FString& Text,
+                                   const FString& Speaker,
+                                   const TMap<FName, FString>& Metadata)
+{
+	static const FName SpeakerMetaId("Speaker");
+	const FStringTableConstRef Table = StringTable->GetStringTable();
+	FString Existing;
+	bool bUpToDate = Table->GetSourceString(Key, Existing) && Existing.Equals(Text, ESearchCase::CaseSensitive);
+	if (bUpToDate)
+	{
+		const int32 NumExpected = Metadata.Num() + (Metadata.Contains(SpeakerMetaId) ? 0 : 1);
+		int32 NumExisting = 0;
+		Table->EnumerateMetaData(Key, [&](FName Id, const FString& Value)
+		{
+			++NumExisting;
+			const FString* Expected = Metadata.Find(Id);
+			if (!Expected && Id == SpeakerMetaId)
+			{
+				Expected = &Speaker;
+			}
+			bUpToDate = Expected && Expected->Equals(Value, ESearchCase::CaseSensitive);
+			return bUpToDate;
+		});
+		bUpToDate = bUpToDate && NumExisting == NumExpected;
+	}
+	if (bUpToDate)
+	{
+		return;
+	}
+
+	const FStringTableRef MutableTable = StringTable->GetMutableStringTable();
+	MutableTable->ClearMetaData(Key);
+	MutableTable->SetSourceString(Key, Text);
+	// Always include speaker metadata
+	MutableTable->SetMetaData(Key, SpeakerMetaId, Speaker);
+	// Other metadata
+	for (auto& Pair : Metadata)
+	{
+		MutableTable->SetMetaData(Key, Pair.Key, Pair.Value);
+	}
+}
+
+static void SerializeParsedExpression(FArchive& Ar, FSUDSExpression& Expr)
+{
+	FSUDSExpression::StaticStruct()->SerializeItem(Ar, &Expr, nullptr);
+}
+
+static void SerializeParsedEdge(FArchive& Ar, FSUDSParsedEdge& Edge)
+{
+	Ar << Edge.Text;
+	Ar << Edge.TextID;
+	Ar << Edge.TextMetadata;
+	Ar << Edge.SourceLineNo;
+	SerializeParsedExpression(Ar, Edge.ConditionExpression);
+	Ar << Edge.SourceNodeIdx;
+	Ar << Edge.TargetNodeIdx;
+}
+
+static void SerializeParsedNode(FArchive& Ar, FSUDSParsedNode& Node)
+{
+	uint8 NodeType = static_cast<uint8>(Node.NodeType);
+	Ar << NodeType;
+	Node.NodeType = static_cast<ESUDSParsedNodeType>(NodeType);
+	Ar << Node.OriginalIndent;
+	Ar << Node.Identifier;
+	Ar << Node.Text;
+	Ar << Node.TextID;
+	Ar << Node.TextMetadata;
+	SerializeParsedExpression(Ar, Node.Expression);
+	int32 NumArgs = Node.EventArgs.Num();
+	Ar << NumArgs;
+	Node.EventArgs.SetNum(NumArgs);
+	for (auto& Arg : Node.EventArgs)
+	{
+		SerializeParsedExpression(Ar, Arg);
+	}
+	Ar << Node.Labels;
+	int32 NumEdges = Node.Edges.Num();
+	Ar << NumEdges;
+	if (Ar.IsLoading())
+	{
+		Node.Edges.Reset(NumEdges);
+		for (int32 i = 0; i < NumEdges; ++i)
+		{
+			Node.Edges.Emplace(-1);
+		}
+	}
+	for (auto& Edge : Node.Edges)
+	{
+		SerializeParsedEdge(Ar, Edge);
+	}
+	Ar << Node.SourceLineNo;
+	Ar << Node.AllowFallthrough;
+	Ar << Node.ChoicePath;
+	Ar << Node.ConditionalPath;
+	Ar << Node.ParentNodeIdx;
+}
+
+void FSUDSScriptImporter::SerializeParsedTree(FArchive& Ar, ParsedTree& Tree)
+{
+	int32 NumNodes = Tree.Nodes.Num();
+	Ar << NumNodes;
+	if (Ar.IsLoading())
+	{
+		Tree.Reset();
+		Tree.Nodes.Reserve(NumNodes);
+		for (int32 i = 0; i < NumNodes; ++i)
+		{
+			Tree.Nodes.Emplace(ESUDSParsedNodeType::Text, 0, 0);
+		}
+	}
+	for (auto& Node : Tree.Nodes)
+	{
+		SerializeParsedNode(Ar, Node);
+	}
+	Ar << Tree.GotoLabelList;
+}
+
+void FSUDSScriptImporter::SerializeParsedState(FArchive& Ar)
+{
+	if (Ar.IsLoading())
+	{
+		StartImport();
+	}
+	SerializeParsedTree(Ar, HeaderTree);
+	SerializeParsedTree(Ar, BodyTree);
+	Ar << ReferencedSpeakers;
+}
+
 FMD5Hash FSUDSScriptImporter::CalculateHash(const TCHAR* Buffer, int32 Len)
 {
 	FMD5Hash Hash;
@@ -2270,15 +3827,75 @@ void FSUDSScriptImporter::PopulateAssetFromTree(USUDSScript* Asset,
                                                 const FSUDSScriptImporter::ParsedTree& Tree,
                                                 TArray<USUDSScriptNode*>* pOutNodes,
                                                 TMap<FName, int>* pOutLabels,
-                                                UStringTable* StringTable)
+                                                UStringTable* StringTable,
+                                                const FSUDSPreviousImport* Previous,
+                                                TArray<uint64>* pOutSectionHashes,
+                                                TSet<FString>& OutStringKeys)
 {
 	if (pOutNodes && pOutLabels)
 	{
+		TArray<uint64> SectionHashes;
+		CalculateSectionHashes(Tree, SectionHashes);
+
+		// Find where each section of the previous import starts, so we can find ones which are the same
+		TMap<uint64, int> PreviousSectionStarts;
+		if (Previous && Previous->SectionHashes.Num() == Previous->Nodes.Num())
+		{
+			for (int i = 0; i < Previous->SectionHashes.Num(); ++i)
+			{
+				if (i == 0 || Previous->SectionHashes[i] != Previous->SectionHashes[i - 1])
+				{
+					PreviousSectionStarts.Add(Previous->SectionHashes[i], i);
+				}
+			}
+		}
+		// Index of the next node to re-use from the previous import, or -1 if this section is new / changed
+		int ReuseIdx = -1;
+		
 		TArray<int> IndexRemap;
 		int OutIndex = 0;
 		// First pass, create all the nodes
-		for (const auto& InNode : Tree.Nodes)
+		for (int i = 0; i < Tree.Nodes.Num(); ++i)
 		{
+			const FSUDSParsedNode& InNode = Tree.Nodes[i];
+			const uint64 SectionHash = SectionHashes[i];
+			if (i == 0 || SectionHash != SectionHashes[i - 1])
+			{
+				// Start of section; can only re-use if the previous section was the same length
+				ReuseIdx = -1;
+				if (const int* pStart = PreviousSectionStarts.Find(SectionHash))
+				{
+					int NumNodes = 0;
+					for (int j = i; j < Tree.Nodes.Num() && SectionHashes[j] == SectionHash; ++j)
+					{
+						if (Tree.Nodes[j].NodeType != ESUDSParsedNodeType::Goto)
+						{
+							++NumNodes;
+						}
+					}
+					int NumPrevious = 0;
+					for (int j = *pStart; j < Previous->SectionHashes.Num() && Previous->SectionHashes[j] == SectionHash; ++j)
+					{
+						++NumPrevious;
+					}
+					if (NumNodes == NumPrevious)
+					{
+						ReuseIdx = *pStart;
+						// Only use once
+						PreviousSectionStarts.Remove(SectionHash);
+					}
+				}
+			}
+			USUDSScriptNode* PreviousNode = nullptr;
+			if (ReuseIdx >= 0 && InNode.NodeType != ESUDSParsedNodeType::Goto)
+			{
+				PreviousNode = Previous->Nodes[ReuseIdx++];
+				if (PreviousNode && PreviousNode->GetOuter() != Asset)
+				{
+					PreviousNode = nullptr;
+				}
+			}
+
 			// Gotos are dealt with in the node that references them, so ignore them
 			// We're going to be removing Goto nodes in the parse structure, because they were useful while parsing
 			// (letting you fallthrough to a goto node) but in the final runtime we just want them to be edges
@@ -2297,42 +3914,37 @@ void FSUDSScriptImporter::PopulateAssetFromTree(USUDSScript* Asset,
 				{
 				case ESUDSParsedNodeType::Text:
 					{
-						StringTable->GetMutableStringTable()->SetSourceString(InNode.TextID, InNode.Text);
-						// Always include speaker metadata
-						StringTable->GetMutableStringTable()->SetMetaData(InNode.TextID, FName("Speaker"), InNode.Identifier);
-						// Other metadata
-						for (auto Pair : InNode.TextMetadata)
-						{
-							StringTable->GetMutableStringTable()->SetMetaData(InNode.TextID, Pair.Key, Pair.Value);	
-						}
+						OutStringKeys.Add(InNode.TextID);
+						UpdateStringTableEntry(StringTable, InNode.TextID, InNode.Text, InNode.Identifier, InNode.TextMetadata);
 						
-						auto TextNode = NewObject<USUDSScriptNodeText>(Asset);
+						auto TextNode = ReuseOrCreateNode<USUDSScriptNodeText>(Asset, PreviousNode);
 						TextNode->Init(InNode.Identifier, FText::FromStringTable (StringTable->GetStringTableId(), InNode.TextID), InNode.SourceLineNo);
 						Node = TextNode;
 						break;
 					}
 				case ESUDSParsedNodeType::Choice:
 					{
-						auto ChoiceNode = NewObject<USUDSScriptNode>(Asset);
+						auto ChoiceNode = ReuseOrCreateNode<USUDSScriptNode>(Asset, PreviousNode);
 						ChoiceNode->InitChoice(InNode.SourceLineNo);
 						Node = ChoiceNode;
 						break;
 					}
 				case ESUDSParsedNodeType::Select:
 					{
-						auto SelectNode = NewObject<USUDSScriptNode>(Asset);
+						auto SelectNode = ReuseOrCreateNode<USUDSScriptNode>(Asset, PreviousNode);
 						SelectNode->InitSelect(InNode.SourceLineNo);
 						Node = SelectNode;
 						break;
 					}
 				case ESUDSParsedNodeType::SetVariable:
 					{
-						auto SetNode = NewObject<USUDSScriptNodeSet>(Asset);
+						auto SetNode = ReuseOrCreateNode<USUDSScriptNodeSet>(Asset, PreviousNode);
 						// For text literals, re-point to string table
 						FSUDSExpression Expr = InNode.Expression;
 						if (Expr.IsTextLiteral())
 						{
-							StringTable->GetMutableStringTable()->SetSourceString(InNode.TextID, Expr.GetTextLiteralValue().ToString());
+							OutStringKeys.Add(InNode.TextID);
+							UpdateStringTableSource(StringTable, InNode.TextID, Expr.GetTextLiteralValue().ToString());
 							Expr.SetTextLiteralValue(FText::FromStringTable (StringTable->GetStringTableId(), InNode.TextID));
 						}
 						SetNode->Init(InNode.Identifier, Expr, InNode.SourceLineNo);
@@ -2341,7 +3953,7 @@ void FSUDSScriptImporter::PopulateAssetFromTree(USUDSScript* Asset,
 					}
 				case ESUDSParsedNodeType::Event:
 					{
-						auto EvtNode = NewObject<USUDSScriptNodeEvent>(Asset);
+						auto EvtNode = ReuseOrCreateNode<USUDSScriptNodeEvent>(Asset, PreviousNode);
 						EvtNode->Init(InNode.Identifier, InNode.EventArgs, InNode.SourceLineNo);
 						Node = EvtNode;
 						break;
@@ -2349,14 +3961,14 @@ void FSUDSScriptImporter::PopulateAssetFromTree(USUDSScript* Asset,
 				case ESUDSParsedNodeType::Gosub:
 					{
 						// Validate gosub label at this point
-						auto GosubNode = NewObject<USUDSScriptNodeGosub>(Asset);
+						auto GosubNode = ReuseOrCreateNode<USUDSScriptNodeGosub>(Asset, PreviousNode);
 						GosubNode->Init(InNode.Identifier, InNode.TextID, InNode.SourceLineNo);
 						Node = GosubNode;
 						break;
 					}
 				case ESUDSParsedNodeType::Return:
 					{
-						auto ReturnNode = NewObject<USUDSScriptNode>(Asset);
+						auto ReturnNode = ReuseOrCreateNode<USUDSScriptNode>(Asset, PreviousNode);
 						ReturnNode->InitReturn(InNode.SourceLineNo);
 						Node = ReturnNode;
 						break;
@@ -2368,6 +3980,10 @@ void FSUDSScriptImporter::PopulateAssetFromTree(USUDSScript* Asset,
 				}
 
 				pOutNodes->Add(Node);
+				if (pOutSectionHashes)
+				{
+					pOutSectionHashes->Add(SectionHash);
+				}
 
 			}
 		}
@@ -2460,16 +4076,11 @@ void FSUDSScriptImporter::PopulateAssetFromTree(USUDSScript* Asset,
 
 						if (!InEdge.TextID.IsEmpty() && !InEdge.Text.IsEmpty())
 						{
-							StringTable->GetMutableStringTable()->SetSourceString(InEdge.TextID, InEdge.Text);
-							NewEdge.SetText(FText::FromStringTable(StringTable->GetStringTableId(), InEdge.TextID));
-							// Always include speaker metadata, always the player in a choice
+							OutStringKeys.Add(InEdge.TextID);
+							// Speaker is always the player in a choice
 							// Identify that it's a choice so translators know that there may be more limited space
-							StringTable->GetMutableStringTable()->SetMetaData(InEdge.TextID, FName("Speaker"), "Player (Choice)");
-							// Other metadata
-							for (auto Pair : InEdge.TextMetadata)
-							{
-								StringTable->GetMutableStringTable()->SetMetaData(InEdge.TextID, Pair.Key, Pair.Value);	
-							}
+							UpdateStringTableEntry(StringTable, InEdge.TextID, InEdge.Text, TEXT("Player (Choice)"), InEdge.TextMetadata);
+							NewEdge.SetText(FText::FromStringTable(StringTable->GetStringTableId(), InEdge.TextID));
 						}
 
 						Node->AddEdge(NewEdge);
@@ -3,6 +3,7 @@
 #include "SUDSScriptReimportFactory.h"
 
 #include "SUDSEditor.h"
+#include "SUDSImportCache.h"
 #include "SUDSMessageLogger.h"
 #include "SUDSScript.h"
 #include "SUDSScriptNodeText.h"
@@ -53,6 +54,17 @@ EReimportResult::Type USUDSScriptReimportFactory::Reimport(UObject* Obj)
 		return EReimportResult::Failed;
 	}
 
+	// If neither the source nor anything else which affects the import has changed, there's nothing to do.
+	// Only for automatic reimports though; if the user asked, they may want to repair the asset or pick up something
+	// the key doesn't cover, so always do it
+	const FString LongPackagePath = FPackageName::GetLongPackagePath(Script->GetOutermost()->GetPathName());
+	if (IsAutomatedReimport() &&
+		FSUDSImportCache::IsUpToDate(Script, FSUDSImportCache::MakeKeyForFile(Filename, LongPackagePath)))
+	{
+		UE_LOG(LogSUDSEditor, Log, TEXT("%s is unchanged, skipping reimport"), *Filename);
+		return EReimportResult::Succeeded;
+	}
+
 	// When a new script is created, it actually lives at the same address as the incoming one. UE must re-use objects
 	// when you put them back at the same outer & asset name?
 	// This means if we want to preserve anything from the previously imported object, such as generated VO asset links,
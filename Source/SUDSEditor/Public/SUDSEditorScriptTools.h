@@ -17,6 +17,10 @@ public:
 	static bool WriteBackTextID(const FText& AssetText, int LineNo, TArray<FString>& Lines, const FString& NameForErrors, FSUDSMessageLogger& Logger);
 	static bool WriteBackGosubID(const FString& GosubID, int LineNo, TArray<FString>& Lines, const FString& NameForErrors, FSUDSMessageLogger& Logger);
 	static bool TextIDCheckMatch(const FText& AssetText, const FString& SourceLine);
+	/// Re-parse a script's source and log the results of analysing its control flow & variable use
+	static void AnalyseScript(USUDSScript* Script, FSUDSMessageLogger& Logger);
+	/// Get the full path of the source file a script was imported from, or an empty string if there isn't one
+	static FString GetSourceFilename(const USUDSScript* Script);
 
 	
 };
@@ -67,6 +67,12 @@ public:
 	UPROPERTY(config, EditAnywhere, Category = "Assets", AdvancedDisplay, meta = (Tooltip = "Whether the event syntax of [EventName ...] is allowed"))
 	bool bAllowEventsWithoutEventLiteral = false;
 
+	UPROPERTY(config, EditAnywhere, Category = "Analysis", meta = (Tooltip = "Variables which are set by game code or participants rather than by scripts, so script analysis doesn't report them as being read but never set"))
+	TArray<FName> VariablesProvidedByGame;
+
+	UPROPERTY(config, EditAnywhere, Category = "Analysis", meta = (Tooltip = "Whether to leave lines which can never be reached out of imported scripts, which reduces the size of the script and its string table (requires script re-import)"))
+	bool bStripUnreachableLines = false;
+
 
 	USUDSEditorSettings() {}
 
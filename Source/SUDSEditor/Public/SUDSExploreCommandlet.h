@@ -0,0 +1,32 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SUDSExploreCommandlet.generated.h"
+
+/**
+ * Explores every path through imported scripts, reporting speaker lines & choices which can never be reached, paths
+ * which stop without reaching the end, and loops which never end. See FSUDSPathExplorer.
+ *
+ * Usage:
+ *   UnrealEditor-Cmd YourProject.uproject -run=SUDSExplore [-Path=/Game/Dialogue] [-Report=<file.json>] [-MaxStates=<n>] [-Threads=<n>]
+ *
+ * -Path         Content path to search (recursively) for scripts, default /Game
+ * -Report       If supplied, a JSON summary of coverage and problems is written here. Otherwise it's written to the log
+ * -MaxStates    Maximum number of distinct states to explore per script, default 1000000
+ * -Threads      Number of worker threads, default is all cores
+ *
+ * Returns 0 if every script is fully covered with no dead ends or loops, 1 otherwise.
+ */
+UCLASS()
+class SUDSEDITOR_API USUDSExploreCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USUDSExploreCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
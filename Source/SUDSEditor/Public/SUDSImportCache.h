@@ -0,0 +1,53 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FSUDSScriptImporter;
+class USUDSScript;
+struct FSUDSMessageLogger;
+
+/**
+ * Cache of script import results, so that unchanged scripts don't need to be imported again.
+ * Entries are keyed on the hash of the source file, the importer version, the editor settings which affect import, and
+ * the destination package path (which decides whether VO assets are generated).
+ * Scripts record the key they were last imported with, so a reimport can be skipped entirely if the key is the same.
+ * Parse results can also be stored in a directory, which may be shared between machines, so batch imports only need
+ * to parse scripts which nobody has imported before.
+ */
+class SUDSEDITOR_API FSUDSImportCache
+{
+public:
+	/// Make a cache key from the hash of the source and the package path the script is being imported into
+	static FString MakeKey(const FMD5Hash& SourceHash, const FString& PackagePath);
+	/// Make a cache key by hashing a source file
+	static FString MakeKeyForFile(const FString& Filename, const FString& PackagePath);
+
+	/// Whether a script was last imported with the same cache key, i.e. importing again would change nothing
+	static bool IsUpToDate(const USUDSScript* Script, const FString& Key);
+
+	/**
+	 * Try to restore parse results from a cache directory.
+	 * @param CacheDir The cache directory
+	 * @param Key The cache key
+	 * @param Importer Importer to restore the results into
+	 * @param Logger Receives any messages which were logged when the script was originally parsed
+	 * @return True if there was a valid entry for this key
+	 */
+	static bool Load(const FString& CacheDir, const FString& Key, FSUDSScriptImporter& Importer, FSUDSMessageLogger* Logger);
+
+	/**
+	 * Store the parse results of a successful import in a cache directory.
+	 * @param CacheDir The cache directory
+	 * @param Key The cache key
+	 * @param Importer Importer which has successfully imported a script
+	 * @param Logger The messages from the import, which are stored so they can be repeated
+	 * @return Whether the entry was written
+	 */
+	static bool Save(const FString& CacheDir, const FString& Key, FSUDSScriptImporter& Importer, const FSUDSMessageLogger* Logger);
+
+protected:
+	static FString GetEntryFilename(const FString& CacheDir, const FString& Key);
+	static const FString& GetSettingsString();
+};
@@ -0,0 +1,39 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SUDSImportCommandlet.generated.h"
+
+/**
+ * Imports a whole directory tree of .sud scripts without needing the editor UI.
+ * Parsing & validation of scripts runs in parallel; creating the assets & string tables happens afterwards on the
+ * game thread, one script at a time.
+ *
+ * Usage:
+ *   UnrealEditor-Cmd YourProject.uproject -run=SUDSImport -Source=<dir> -Dest=/Game/Dialogue [-Report=<file.json>] [-Cache=<dir>] [-ValidateOnly] [-NoSave] [-Force]
+ *
+ * -Source       Directory to search (recursively) for .sud files
+ * -Dest         Content path to place the imported assets under; subdirectories of Source are preserved
+ * -Report       If supplied, a JSON summary of errors and timings is written here. Otherwise it's written to the log
+ * -Cache        Directory (may be shared between machines) to store & reuse parse results in, see FSUDSImportCache
+ * -ValidateOnly Parse & validate the scripts but don't create any assets
+ * -NoSave       Create the assets but don't save the packages
+ * -Force        Import every script, even if its existing asset is up to date
+ *
+ * Scripts whose existing asset was imported from the same source with the same settings are skipped, unless -Force
+ * is used.
+ *
+ * Returns 0 if all scripts imported without errors, 1 otherwise.
+ */
+UCLASS()
+class SUDSEDITOR_API USUDSImportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USUDSImportCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
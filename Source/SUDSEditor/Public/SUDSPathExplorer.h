@@ -0,0 +1,82 @@
+﻿// Copyright Steve Streeting 2022
+// Released under the MIT license https://opensource.org/license/MIT/
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USUDSScript;
+
+/// A problem found by FSUDSPathExplorer, and the line it relates to
+struct SUDSEDITOR_API FSUDSExploreIssue
+{
+	int SourceLineNo = 0;
+	FString Description;
+
+	FSUDSExploreIssue() {}
+	FSUDSExploreIssue(int LineNo, const FString& InDescription) : SourceLineNo(LineNo), Description(InDescription) {}
+};
+
+/// The results of exploring every path through one script
+struct SUDSEDITOR_API FSUDSExploreResult
+{
+	const USUDSScript* Script = nullptr;
+	/// Number of places exploration started from: the start of the script, plus every label which leads to a speaker line
+	int32 NumStartPoints = 0;
+	/// Number of distinct states the dialogue can be in at a speaker line. This is the size of the state space
+	int64 NumStates = 0;
+	/// True if the state space was bigger than the limit, in which case exploration stopped early and loops aren't reported
+	bool bTruncated = false;
+
+	int32 NumSpeakerLines = 0;
+	/// Source lines of speaker lines which no path reached
+	TArray<int> UnreachedSpeakerLines;
+	int32 NumChoices = 0;
+	/// Source lines of choices which were never available
+	TArray<int> UnreachedChoices;
+	/// Places where a path stops without reaching the end of the dialogue
+	TArray<FSUDSExploreIssue> DeadEnds;
+	/// Places where a path can loop forever, either without ever reaching a speaker line, or round speaker lines from
+	/// which the end of the dialogue can never be reached
+	TArray<FSUDSExploreIssue> Loops;
+
+	float GetSpeakerLineCoverage() const
+	{
+		return NumSpeakerLines > 0 ? 1.0f - static_cast<float>(UnreachedSpeakerLines.Num()) / NumSpeakerLines : 1.0f;
+	}
+	float GetChoiceCoverage() const
+	{
+		return NumChoices > 0 ? 1.0f - static_cast<float>(UnreachedChoices.Num()) / NumChoices : 1.0f;
+	}
+	bool HasProblems() const { return UnreachedSpeakerLines.Num() > 0 || DeadEnds.Num() > 0 || Loops.Num() > 0; }
+};
+
+/**
+ * Explores every path through scripts, to check that every line can be reached and every path ends.
+ * Starting from the beginning and from every label, each choice and each random option is taken in turn. The state of
+ * the dialogue at each speaker line (the line, variables, global variables, gosub return stack and choices taken so
+ * far) is hashed, and states which have been seen before aren't explored again, so loops in the script don't go on
+ * forever.
+ * Variables only have a known value once a [set] in the body of the script has given them one on that path. Until then
+ * they could have any value, since the game or participants can supply them, override header defaults before starting,
+ * and set globals; conditions which read them are taken both ways, and a [set] from them leaves its target unknown too.
+ * Exploration is spread over all cores: each worker explores depth first from its own queue of states, and workers
+ * which run out of work steal from the others. All the scripts are explored at once, so one large script doesn't
+ * leave the other cores idle.
+ */
+class SUDSEDITOR_API FSUDSPathExplorer
+{
+public:
+	/// Maximum number of distinct states to explore in one script before giving up on it
+	int64 MaxStatesPerScript = 1000000;
+	/// Maximum number of nodes to run between one speaker line and the next before assuming the path loops forever
+	int32 NodeBudget = 10000;
+	/// Number of workers, 0 to use all cores
+	int32 NumWorkers = 0;
+
+	/**
+	 * Explore all paths through a set of scripts. Scripts must stay loaded and unchanged while this runs.
+	 * @param Scripts The scripts to explore
+	 * @param OutResults Receives one result per script, in the same order
+	 */
+	void Explore(const TArray<const USUDSScript*>& Scripts, TArray<FSUDSExploreResult>& OutResults) const;
+};
@@ -18,7 +18,24 @@ class SUDSEDITOR_API USUDSScriptFactory : public UFactory
 
 public:
 	USUDSScriptFactory();
+
+	/// Create the script asset & string table from an importer which has successfully parsed a script
+	USUDSScript* CreateScriptFromImporter(FSUDSScriptImporter& FromImporter,
+	                                      UObject* InParent,
+	                                      FName InName,
+	                                      EObjectFlags Flags,
+	                                      const FString& SourceFilename,
+	                                      const FMD5Hash& Hash,
+	                                      FSUDSMessageLogger* Logger);
 protected:
+	virtual UObject* FactoryCreateFile(UClass* InClass,
+	                                   UObject* InParent,
+	                                   FName InName,
+	                                   EObjectFlags Flags,
+	                                   const FString& Filename,
+	                                   const TCHAR* Parms,
+	                                   FFeedbackContext* Warn,
+	                                   bool& bOutOperationCanceled) override;
 	virtual UObject* FactoryCreateText(UClass* InClass,
 	                                   UObject* InParent,
 	                                   FName InName,
@@ -109,6 +109,9 @@ public:
 	// Path hierarchy of select nodes leading to this node, of the form "/S002/S006" etc, not including this node index
 	// This helps us identify valid fallthroughs
 	FString ConditionalPath;
+	/// Interned IDs of ChoicePath and ConditionalPath within the tree, so they can be compared cheaply while parsing
+	int ChoicePathID = -1;
+	int ConditionalPathID = -1;
 
 	/// Although multiple edges can lead here, this index is for the auto-connected parent (may be nothing)
 	int ParentNodeIdx = -1;
@@ -169,11 +172,83 @@ public:
 	{
 	}
 };
+/// The nodes from an earlier import of a script, which can be re-used where a section of the script hasn't changed
+struct SUDSEDITOR_API FSUDSPreviousImport
+{
+	TArray<class USUDSScriptNode*> Nodes;
+	TArray<uint64> SectionHashes;
+
+	FSUDSPreviousImport() {}
+	/// Capture the nodes of a script before it is re-imported
+	explicit FSUDSPreviousImport(const USUDSScript* Script);
+};
+
+/// Something found by FSUDSScriptImporter::AnalyseScript, and the line it relates to
+struct SUDSEDITOR_API FSUDSScriptAnalysisItem
+{
+	/// Speaker ID, label or variable name
+	FString Name;
+	int SourceLineNo;
+
+	FSUDSScriptAnalysisItem(const FString& InName, int LineNo) : Name(InName), SourceLineNo(LineNo) {}
+};
+
+/// Results of statically analysing the control flow & variable use of an imported script
+struct SUDSEDITOR_API FSUDSScriptAnalysis
+{
+	/// Speaker lines which can't be reached from the start of the script or from any label
+	TArray<FSUDSScriptAnalysisItem> UnreachableSpeakerLines;
+	/// Labels which no goto or gosub uses. These can still be used to start dialogue from code
+	TArray<FSUDSScriptAnalysisItem> UnusedLabels;
+	/// Variables which are set but never read by the script (the line is the first place they're set)
+	TArray<FSUDSScriptAnalysisItem> UnreadVariables;
+	/// Variables which are read but never set by the script or provided by the game (the line is the first read)
+	TArray<FSUDSScriptAnalysisItem> UnsetVariables;
+	/// Whether each node in the body can be reached
+	TBitArray<> ReachableNodes;
+	int NumUnreachableNodes = 0;
+};
+
 class SUDSEDITOR_API FSUDSScriptImporter
 {
 public:
 	bool ImportFromBuffer(const TCHAR* Buffer, int32 Len, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
-	void PopulateAsset(USUDSScript* Asset, UStringTable* StringTable);
+	/**
+	 * Import a script directly from a file. The file is memory mapped where the platform supports it and lines are
+	 * found by scanning the UTF-8 bytes, so only one line at a time is ever converted to TCHAR.
+	 * @param Filename The source .sud file
+	 * @param NameForErrors Name to use when logging errors
+	 * @param Logger Logger for messages
+	 * @param bSilent Whether to suppress messages
+	 * @param OutHash Optional; if supplied, receives the MD5 hash of the file contents
+	 * @return Whether the import was successful
+	 */
+	bool ImportFromFile(const FString& Filename, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent, FMD5Hash* OutHash = nullptr);
+	/**
+	 * Populate a script asset from the results of a successful import.
+	 * @param Asset The asset to populate
+	 * @param StringTable The string table for the asset's text
+	 * @param Previous Optionally, the nodes of a previous import of this script. Nodes in sections of the script (split
+	 *   at labels) which haven't changed are re-used rather than re-created, and their string table entries are left
+	 *   alone. In that case the string table should be the one from the previous import, not a new one.
+	 */
+	void PopulateAsset(USUDSScript* Asset, UStringTable* StringTable, const FSUDSPreviousImport* Previous = nullptr);
+	/**
+	 * Save or load the results of a successful import, everything that PopulateAsset needs. Used to cache imports,
+	 * so that unchanged scripts don't have to be parsed again.
+	 */
+	void SerializeParsedState(FArchive& Ar);
+	/**
+	 * Analyse the control flow & variable use of a successfully imported script. The control flow graph includes
+	 * edges into gosubs, and from returns back to every gosub which can return there.
+	 * @param OutAnalysis Receives the results
+	 * @param ProvidedVariables Variables which are set by game code or participants, so are never reported as unset
+	 */
+	void AnalyseScript(FSUDSScriptAnalysis& OutAnalysis, const TArray<FName>& ProvidedVariables);
+	/// Log the results of AnalyseScript. Unreachable speaker lines are warnings, everything else is informational
+	static void LogAnalysis(const FSUDSScriptAnalysis& Analysis, const FString& NameForErrors, FSUDSMessageLogger* Logger);
+	/// Version of the importer's output; bump this whenever a change means the same script would import differently
+	static const int32 ImporterVersion;
 	static FMD5Hash CalculateHash(const TCHAR* Buffer, int32 Len);
 	static const FString EndGotoLabel;
 protected:
@@ -205,6 +280,9 @@ protected:
 		EConditionalStage Stage;
 		/// String identifying the current condition; for elseif or else contains original "if" context 
 		FString ConditionPathElement;
+		/// Full conditional path of this block including all parent blocks, and its interned ID
+		FString Path;
+		int PathID = -1;
 
 		ConditionalContext(int InSelectNodeIdx, int InPrevBlockIdx, EConditionalStage InStage, const FString& InCondStr) :
 			SelectNodeIdx(InSelectNodeIdx),
@@ -238,8 +316,11 @@ protected:
 
 		/// The path entry for this indent, to be combined with all previous levels to provide full path context
 		FString PathEntry;
+		/// Full path of this indent including all previous levels, and its interned ID
+		FString Path;
+		int PathID = -1;
 
-		IndentContext(int NodeIdx, int Indent, const FString& Path) : LastNodeIdx(NodeIdx), ThresholdIndent(Indent), LastTextNodeIdx(-1), PathEntry(Path) {}
+		IndentContext(int NodeIdx, int Indent, const FString& InPathEntry) : LastNodeIdx(NodeIdx), ThresholdIndent(Indent), LastTextNodeIdx(-1), PathEntry(InPathEntry) {}
 
 	};
 
@@ -273,6 +354,19 @@ protected:
 		/// Index of the current conditional block, if any
 		int CurrentConditionalBlockIdx = -1;
 
+		/// Choice & conditional paths are interned, so nodes only need to compare IDs
+		TMap<FString, int> PathIDs;
+		TArray<FString> Paths;
+		/// For each conditional path ID, the most recent choice & text nodes on it, so that a new choice line can find
+		/// the choice node to join without scanning back through the whole tree. A node is dropped once a later node on
+		/// the same path has the same or a lower indent, since that one would always be found first, so each stack is
+		/// only as deep as the number of distinct indents
+		TMap<int, TArray<int>> RecentChoiceNodes;
+		TMap<int, TArray<int>> RecentTextNodes;
+		/// Scratch space for finding path prefixes, so it doesn't need allocating for every choice line
+		mutable FString PathPrefixBuffer;
+		mutable TArray<int> PathPrefixIDs;
+
 		void Reset()
 		{
 			IndentLevelStack.Reset();
@@ -283,12 +377,44 @@ protected:
 			AliasedGotoLabels.Reset();
 			ConditionalBlocks.Reset();
 			CurrentConditionalBlockIdx = -1;
+			PathIDs.Reset();
+			Paths.Reset();
+			RecentChoiceNodes.Reset();
+			RecentTextNodes.Reset();
 		}
 	};
 
 	ParsedTree HeaderTree;
 	ParsedTree BodyTree;
 
+	/// Results shared between all choices while checking that choices lead to speaker lines, since many choices often
+	/// lead to the same place
+	struct ChoicePathCheckState
+	{
+	public:
+		static constexpr int Unresolved = -2;
+		static constexpr int InProgress = -3;
+		static constexpr uint8 NotChecked = 0;
+		static constexpr uint8 Checking = 1;
+		static constexpr uint8 CheckedOK = 2;
+		static constexpr uint8 CheckedBad = 3;
+
+		/// For each node, the node reached by skipping over sets, events & gotos from it (-1 for the end)
+		TArray<int> Terminals;
+		/// For each select node, the result of checking all of its paths
+		TArray<uint8> SelectResults;
+	};
+
+	/// How a sub can finish when it's run without showing any text
+	struct TextlessSubExits
+	{
+	public:
+		/// Whether the sub can return to its caller without showing any text
+		bool bMayReturn = false;
+		/// Whether the sub can get to a speaker line, choice or the end without returning first
+		bool bMayLeave = false;
+	};
+
 	struct ParsedMetadata
 	{
 	public:
@@ -326,6 +452,12 @@ protected:
 	int TextIDHighestNumber = 0;
 	/// For generating gosub IDs
 	int GosubIDHighestNumber = 0;
+	/// Reset all parsing state ready for a new import
+	void StartImport();
+	/// Parse lines from a UTF-8 byte buffer, converting one line at a time
+	bool ImportFromUTF8Buffer(const uint8* Start, int64 Length, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
+	/// Complete an import once all lines have been parsed
+	bool FinishImport(bool bImportedOK, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
 	/// Parse a single line
 	bool ParseLine(const FStringView& Line, int LineNo, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
 	bool ParseHeaderLine(const FStringView& Line, int IndentLevel, int LineNo, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
@@ -461,26 +593,44 @@ protected:
 	FStringView TrimLine(const FStringView& Line, int& OutIndentLevel) const;
 	int FindChoiceAfterTextNode(const FSUDSScriptImporter::ParsedTree& Tree, int TextNodeIdx);
 	int FindLastChoiceNode(const ParsedTree& Tree, int IndentLevel);
-	int FindLastChoiceNode(const ParsedTree& Tree, int IndentLevel, int FromIndex, const FString& ConditionPath);
+	int FindRecentNode(const ParsedTree& Tree, const TMap<int, TArray<int>>& RecentNodes, int PathID, int IndentLevel);
+	static void AddRecentNode(ParsedTree& Tree, int NodeIdx);
+	static void RebuildRecentNodes(ParsedTree& Tree);
 	void PopIndent(ParsedTree& Tree);
 	void PushIndent(ParsedTree& Tree, int NodeIdx, int Indent, const FString& Path);
-	FString GetCurrentTreePath(const FSUDSScriptImporter::ParsedTree& Tree);
-	FString GetCurrentTreeConditionalPath(const FSUDSScriptImporter::ParsedTree& Tree);
+	const FString& GetCurrentTreePath(const FSUDSScriptImporter::ParsedTree& Tree);
+	int GetCurrentTreePathID(const FSUDSScriptImporter::ParsedTree& Tree);
+	const FString& GetCurrentTreeConditionalPath(const FSUDSScriptImporter::ParsedTree& Tree);
+	int GetCurrentTreeConditionalPathID(const FSUDSScriptImporter::ParsedTree& Tree);
+	void UpdateConditionalPath(ParsedTree& Tree, int BlockIdx);
+	static int InternTreePath(ParsedTree& Tree, const FString& Path);
+	/// Get every interned path which is a prefix of a path (including itself), using Buffer to avoid allocating
+	static void GetTreePathPrefixIDs(const ParsedTree& Tree, int PathID, FString& Buffer, TArray<int>& OutPrefixIDs);
 	void SetFallthroughForNewNode(FSUDSScriptImporter::ParsedTree& Tree, FSUDSParsedNode& NewNode);
 	int AppendNode(ParsedTree& Tree, const FSUDSParsedNode& InNode);
+	static void SerializeParsedTree(FArchive& Ar, ParsedTree& Tree);
 	bool SelectNodeIsMissingElsePath(const FSUDSScriptImporter::ParsedTree& Tree, const FSUDSParsedNode& Node);
 	bool PostImportSanityCheck(const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
 	bool ChoiceNodeCheckPaths(const FSUDSParsedNode& ChoiceNode,
+	                          ChoicePathCheckState& State,
 	                          const FString& NameForErrors,
 	                          FSUDSMessageLogger* Logger,
 	                          bool bSilent);
-	bool RecurseChoiceNodeCheckPaths(const FSUDSParsedNode& OrigChoiceNode, const FSUDSParsedNode& CurrChoiceNode, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
-	bool RecurseChoiceNodeCheckPaths(const FSUDSParsedNode& ChoiceNode, const FSUDSParsedEdge& Edge, const FString& NameForErrors, FSUDSMessageLogger*
-	                                 Logger,
-	                                 bool bSilent);
+	bool ChoiceEdgeCheckPaths(const FSUDSParsedEdge& Edge, ChoicePathCheckState& State, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
+	bool SelectNodeCheckPaths(int SelectNodeIdx, ChoicePathCheckState& State, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
+	int FindChoicePathTerminal(int NodeIdx, ChoicePathCheckState& State);
+	bool CheckForTextlessLoops(const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
+	static bool IsTextlessLoopNode(const FSUDSParsedNode& Node);
+	void GetTextlessSuccessors(int NodeIdx, const TMap<FString, TextlessSubExits>& SubExits, TArray<int>& OutSuccessors, bool& bOutCanLeave);
+	void FindTextlessSubExits(TMap<FString, TextlessSubExits>& OutSubExits);
+	void BuildControlFlowGraph(TArray<TArray<int>>& OutSuccessors);
+	void FindSubReturns(TMap<FString, TArray<int>>& OutSubReturns);
+	void AnalyseVariables(FSUDSScriptAnalysis& OutAnalysis, const TArray<FName>& ProvidedVariables) const;
+	/// Remove unreachable nodes from a tree, re-pointing everything which refers to nodes by index
+	static void StripUnreachableNodes(ParsedTree& Tree, const TBitArray<>& ReachableNodes);
 	void ConnectRemainingNodes(ParsedTree& Tree, const FString& NameForErrors, FSUDSMessageLogger* Logger, bool bSilent);
 	void GenerateTextIDs(ParsedTree& BodyTree);
-	int FindFallthroughNodeIndex(ParsedTree& Tree, int StartNodeIndex, const FString& FromChoicePath, const FString& FromConditionalPath);
+	void FindFallthroughNodeIndices(const ParsedTree& Tree, TArray<int>& OutFallthroughIndices);
 	bool RetrieveAndRemoveTextID(FStringView& InOutLine, FString& OutTextID);
 	bool RetrieveAndRemoveGosubID(FStringView& InOutLine, FString& OutTextID);
 	FString GenerateTextID();
@@ -490,7 +640,13 @@ protected:
 	                           const ParsedTree& Tree,
 	                           TArray<class USUDSScriptNode*>* pOutNodes,
 	                           TMap<FName, int>* pOutLabels,
-	                           UStringTable* StringTable);
+	                           UStringTable* StringTable,
+	                           const FSUDSPreviousImport* Previous,
+	                           TArray<uint64>* pOutSectionHashes,
+	                           TSet<FString>& OutStringKeys);
+	/// Calculate the hash of the section each node is in. Sections start at each label, and the hash covers
+	/// everything that goes into nodes & string table entries except line numbers and connections between nodes
+	static void CalculateSectionHashes(const ParsedTree& Tree, TArray<uint64>& OutNodeSectionHashes);
 
 public:
 	const FSUDSParsedNode* GetNode(int Index = 0);
@@ -499,4 +655,8 @@ public:
 	int GetGotoTargetNodeIndex(const FString& Label);
 	static bool RetrieveTextIDFromLine(FStringView& InOutLine, FString& OutTextID, int& OutNumber);
 	static bool RetrieveGosubIDFromLine(FStringView& InOutLine, FString& OutID, int& OutNumber);
+
+	/// Number of nodes examined while joining choices, resolving fallthroughs & checking choice paths in the last
+	/// import, so that tests can check that importing scales linearly without relying on timings
+	int64 Test_ImportSearchSteps = 0;
 };
@@ -0,0 +1,179 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSEditorSettings.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString AnalysisInput = R"RAWSUD(
+NPC: Hello
+[set Unused = 1]
+[gosub greet]
+[gosub noreturn]
+NPC: After the gosubs
+[goto end]
+NPC: Nobody will hear this
+:greet
+NPC: Value is {Provided}
+[return]
+:noreturn
+NPC: Missing is {Missing}
+[goto end]
+:fromcode
+NPC: Only from code
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestAnalysis,
+								 "SUDSTest.TestAnalysis",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestAnalysis::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(AnalysisInput), AnalysisInput.Len(), "AnalysisInput", &Logger, true));
+
+	FSUDSScriptAnalysis Analysis;
+	Importer.AnalyseScript(Analysis, { FName("Provided") });
+
+	// Nothing after the gosub to a sub which never returns can be reached, nor the line after the goto
+	if (TestEqual("Unreachable speaker lines", Analysis.UnreachableSpeakerLines.Num(), 2))
+	{
+		TestEqual("Unreachable line", Analysis.UnreachableSpeakerLines[0].SourceLineNo, 6);
+		TestEqual("Unreachable line", Analysis.UnreachableSpeakerLines[1].SourceLineNo, 8);
+	}
+	if (TestEqual("Unused labels", Analysis.UnusedLabels.Num(), 1))
+	{
+		TestEqual("Unused label", Analysis.UnusedLabels[0].Name, "fromcode");
+	}
+	if (TestEqual("Unread variables", Analysis.UnreadVariables.Num(), 1))
+	{
+		TestEqual("Unread variable", Analysis.UnreadVariables[0].Name, "Unused");
+		TestEqual("Unread variable line", Analysis.UnreadVariables[0].SourceLineNo, 3);
+	}
+	if (TestEqual("Unset variables", Analysis.UnsetVariables.Num(), 1))
+	{
+		TestEqual("Unset variable", Analysis.UnsetVariables[0].Name, "Missing");
+		TestEqual("Unset variable line", Analysis.UnsetVariables[0].SourceLineNo, 13);
+	}
+
+	// Now strip the unreachable lines on import
+	USUDSEditorSettings* Settings = GetMutableDefault<USUDSEditorSettings>();
+	const bool bPrevStrip = Settings->bStripUnreachableLines;
+	Settings->bStripUnreachableLines = true;
+	FSUDSScriptImporter StripImporter;
+	TestTrue("Import should succeed", StripImporter.ImportFromBuffer(GetData(AnalysisInput), AnalysisInput.Len(), "AnalysisInput", &Logger, true));
+	Settings->bStripUnreachableLines = bPrevStrip;
+
+	for (int i = 0; StripImporter.GetNode(i); ++i)
+	{
+		TestNotEqual("Unreachable line should be stripped", StripImporter.GetNode(i)->SourceLineNo, 6);
+		TestNotEqual("Unreachable line should be stripped", StripImporter.GetNode(i)->SourceLineNo, 8);
+	}
+	FSUDSScriptAnalysis StrippedAnalysis;
+	StripImporter.AnalyseScript(StrippedAnalysis, { FName("Provided") });
+	TestEqual("No unreachable nodes after stripping", StrippedAnalysis.NumUnreachableNodes, 0);
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	StripImporter.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	// Script shouldn't be the owner of the dialogue but it's the only UObject we've got right now so why not
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->SetVariableInt("Provided", 3);
+	Dlg->SetVariableInt("Missing", 4);
+	Dlg->Start();
+	TestDialogueText(this, "Start node", Dlg, "NPC", "Hello");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Sub node", Dlg, "NPC", "Value is 3");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Sub node", Dlg, "NPC", "Missing is 4");
+	TestFalse("Continue should end", Dlg->Continue());
+	TestTrue("Should be ended", Dlg->IsEnded());
+
+	Dlg->Restart(false, "fromcode");
+	TestDialogueText(this, "Label node", Dlg, "NPC", "Only from code");
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+const FString MutualRecursionInput = R"RAWSUD(
+NPC: Start
+[gosub a]
+NPC: After a
+[goto end]
+:a
+[if {Depth} > 2]
+	[return]
+[endif]
+[set Depth = {Depth} + 1]
+[gosub b]
+NPC: After b
+[return]
+:b
+NPC: In b
+[gosub a]
+[return]
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestAnalysisMutualRecursion,
+								 "SUDSTest.TestAnalysisMutualRecursion",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestAnalysisMutualRecursion::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(MutualRecursionInput), MutualRecursionInput.Len(), "MutualRecursionInput", &Logger, true));
+
+	// b can only return once a has, and a only gets past its call to b if b returns; both do in the end
+	FSUDSScriptAnalysis Analysis;
+	Importer.AnalyseScript(Analysis, {});
+	TestEqual("Unreachable speaker lines", Analysis.UnreachableSpeakerLines.Num(), 0);
+	TestEqual("Unreachable nodes", Analysis.NumUnreachableNodes, 0);
+
+	USUDSEditorSettings* Settings = GetMutableDefault<USUDSEditorSettings>();
+	const bool bPrevStrip = Settings->bStripUnreachableLines;
+	Settings->bStripUnreachableLines = true;
+	FSUDSScriptImporter StripImporter;
+	TestTrue("Import should succeed", StripImporter.ImportFromBuffer(GetData(MutualRecursionInput), MutualRecursionInput.Len(), "MutualRecursionInput", &Logger, true));
+	Settings->bStripUnreachableLines = bPrevStrip;
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	StripImporter.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->SetVariableInt("Depth", 0);
+	Dlg->Start();
+	TestDialogueText(this, "Start node", Dlg, "NPC", "Start");
+	for (int i = 0; i < 3; ++i)
+	{
+		TestTrue("Continue", Dlg->Continue());
+		TestDialogueText(this, "Into b", Dlg, "NPC", "In b");
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		TestTrue("Continue", Dlg->Continue());
+		TestDialogueText(this, "Back from b", Dlg, "NPC", "After b");
+	}
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Back from a", Dlg, "NPC", "After a");
+	TestFalse("Continue should end", Dlg->Continue());
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
@@ -0,0 +1,183 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "TestParticipant.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString AsyncVariablesInput = R"RAWSUD(
+NPC: Hello
+[if {HasItem} && {ItemCount} > 2]
+    NPC: You have {ItemCount} items
+[else]
+    NPC: You have nothing
+[endif]
+NPC: Bye
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestAsyncVariables,
+								 "SUDSTest.TestAsyncVariables",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestAsyncVariables::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(AsyncVariablesInput), AsyncVariablesInput.Len(), "AsyncVariablesInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Provider = NewObject<UTestAsyncProvider>();
+	Provider->Values.Add("HasItem", true);
+	Provider->Values.Add("ItemCount", 3);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->AddParticipant(Provider);
+	Dlg->Start();
+	TestDialogueText(this, "Start", Dlg, "NPC", "Hello");
+	TestFalse("Nothing to wait for at start", Dlg->IsWaitingForAsyncVariables());
+	TestEqual("Nothing requested at start", Provider->RequestedNames.Num(), 0);
+
+	TestTrue("Continue", Dlg->Continue());
+	TestTrue("Waiting for variables", Dlg->IsWaitingForAsyncVariables());
+	// Both variables in the condition should be requested together
+	TestEqual("Requested both at once", Provider->RequestedNames.Num(), 2);
+	TestTrue("Requested HasItem", Provider->RequestedNames.Contains("HasItem"));
+	TestTrue("Requested ItemCount", Provider->RequestedNames.Contains("ItemCount"));
+	TestDialogueText(this, "Still on previous line", Dlg, "NPC", "Hello");
+
+	Dlg->Continue();
+	TestEqual("Continue ignored while waiting", Provider->RequestedNames.Num(), 2);
+	TestDialogueText(this, "Continue ignored while waiting", Dlg, "NPC", "Hello");
+
+	bool bResumed = false;
+	Dlg->WaitForAsyncVariables().Then([&bResumed](TFuture<void>)
+	{
+		bResumed = true;
+	});
+	TestFalse("Future not fulfilled yet", bResumed);
+
+	Provider->FulfilAll();
+	TestTrue("Future fulfilled", bResumed);
+	TestFalse("No longer waiting", Dlg->IsWaitingForAsyncVariables());
+	// Variables fetched in the step aren't requested again for the text
+	TestEqual("No more requests", Provider->RequestedNames.Num(), 2);
+	TestDialogueText(this, "Resumed", Dlg, "NPC", "You have 3 items");
+
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Bye", Dlg, "NPC", "Bye");
+	TestFalse("Continue", Dlg->Continue());
+	TestTrue("Ended", Dlg->IsEnded());
+
+	// Providers which already have the value don't suspend the step
+	Provider->bCompleteImmediately = true;
+	Provider->RequestedNames.Empty();
+	Dlg->Restart();
+	TestDialogueText(this, "Restart", Dlg, "NPC", "Hello");
+	Dlg->Continue();
+	TestFalse("Not waiting when completed immediately", Dlg->IsWaitingForAsyncVariables());
+	TestEqual("Requested again in a new step", Provider->RequestedNames.Num(), 2);
+	TestDialogueText(this, "Immediate", Dlg, "NPC", "You have 3 items");
+
+	// Ending while waiting cancels, late values are ignored
+	Provider->bCompleteImmediately = false;
+	Provider->Values.Add("ItemCount", 1);
+	Dlg->Restart();
+	Dlg->Continue();
+	TestTrue("Waiting again", Dlg->IsWaitingForAsyncVariables());
+	Dlg->End(true);
+	TestFalse("Not waiting after end", Dlg->IsWaitingForAsyncVariables());
+	Provider->FulfilAll();
+	TestTrue("Still ended", Dlg->IsEnded());
+
+	// A late value from a cancelled request doesn't satisfy the same variable being requested again
+	Provider->Values.Add("ItemCount", 3);
+	Dlg->Restart();
+	Dlg->Continue();
+	TestTrue("Waiting for first request", Dlg->IsWaitingForAsyncVariables());
+	TMap<FName, TPromise<FSUDSValue>> StalePromises = MoveTemp(Provider->Promises);
+	Provider->Promises.Reset();
+	Dlg->Restart();
+	Dlg->Continue();
+	TestTrue("Waiting for second request", Dlg->IsWaitingForAsyncVariables());
+	for (auto& Pair : StalePromises)
+	{
+		Pair.Value.SetValue(Pair.Key == "ItemCount" ? FSUDSValue(1) : Provider->Values.FindRef(Pair.Key));
+	}
+	TestTrue("Stale values ignored", Dlg->IsWaitingForAsyncVariables());
+	TestDialogueText(this, "Stale values ignored", Dlg, "NPC", "Hello");
+	Provider->FulfilAll();
+	TestFalse("Current values accepted", Dlg->IsWaitingForAsyncVariables());
+	TestDialogueText(this, "Current values accepted", Dlg, "NPC", "You have 3 items");
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+const FString AsyncVariablesStepInput = R"RAWSUD(
+NPC: Hello
+[set Total = {Base} + 1]
+[if {Total} > {Threshold}]
+    NPC: Over by {Bonus}
+[else]
+    NPC: Under
+[endif]
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestAsyncVariablesWholeStep,
+								 "SUDSTest.TestAsyncVariablesWholeStep",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestAsyncVariablesWholeStep::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(AsyncVariablesStepInput), AsyncVariablesStepInput.Len(), "AsyncVariablesStepInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Provider = NewObject<UTestAsyncProvider>();
+	Provider->Values.Add("Base", 3);
+	Provider->Values.Add("Threshold", 2);
+	Provider->Values.Add("Bonus", 5);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->AddParticipant(Provider);
+	Dlg->Start();
+	TestDialogueText(this, "Start", Dlg, "NPC", "Hello");
+
+	// The set, the condition & the line after all need variables, but they're asked for together up front
+	TestTrue("Continue", Dlg->Continue());
+	TestTrue("Waiting for variables", Dlg->IsWaitingForAsyncVariables());
+	TestEqual("Requested the whole step at once", Provider->RequestedNames.Num(), 3);
+	TestTrue("Requested Base", Provider->RequestedNames.Contains("Base"));
+	TestTrue("Requested Threshold", Provider->RequestedNames.Contains("Threshold"));
+	TestTrue("Requested Bonus", Provider->RequestedNames.Contains("Bonus"));
+
+	Provider->FulfilAll();
+	TestFalse("Only waited once", Dlg->IsWaitingForAsyncVariables());
+	TestEqual("No more requests", Provider->RequestedNames.Num(), 3);
+	TestDialogueText(this, "Resumed", Dlg, "NPC", "Over by 5");
+	// Total isn't async, but providers are only asked about it once even though several nodes need it
+	TestTrue("Asked about Total", Provider->QueriedNames.Contains("Total"));
+	TestEqual("Asked about each variable once", Provider->QueriedNames.Num(), TSet<FName>(Provider->QueriedNames).Num());
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
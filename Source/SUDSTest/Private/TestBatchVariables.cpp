@@ -0,0 +1,96 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "TestParticipant.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString BatchVariablesInput = R"RAWSUD(
+[if {A} == 1]
+    NPC: One
+[elseif {B} == 1 or {A} == 2]
+    NPC: Two
+[else]
+    NPC: Three {C} {D}
+[endif]
+[event Evt {E}, {F} + {E}]
+NPC: Done
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBatchVariables,
+								 "SUDSTest.TestBatchVariables",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestBatchVariables::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(BatchVariablesInput), BatchVariablesInput.Len(), "BatchVariablesInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Batch = NewObject<UTestBatchParticipant>();
+	Batch->Values.Add("A", 0);
+	Batch->Values.Add("B", 0);
+	Batch->Values.Add("C", 3);
+	Batch->Values.Add("D", 4);
+	// Participants which only implement the single callback still get one call per variable
+	auto Single = NewObject<UTestParticipant>();
+	auto Native = NewObject<UTestNativeParticipant>();
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->SetParticipants({ Batch, Single, Native });
+	Dlg->Start();
+	TestDialogueText(this, "Else path", Dlg, "NPC", "Three 3 4");
+
+	if (TestEqual("Batches for select & text", Batch->Batches.Num(), 2))
+	{
+		// Every condition on the select is requested together
+		TestTrue("Select batch", Batch->Batches[0] == TArray<FName> { "A", "B" });
+		TestTrue("Text batch", Batch->Batches[1] == TArray<FName> { "C", "D" });
+	}
+	TestEqual("Batch participant not called per variable", Batch->VariableRequestedCount, 0);
+
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Done", Dlg, "NPC", "Done");
+	if (TestEqual("Batch for event args", Batch->Batches.Num(), 3))
+	{
+		TestTrue("Event batch", Batch->Batches[2] == TArray<FName> { "E", "F" });
+	}
+
+	TestEqual("Single participant called per variable", Single->VariableRequestedCount, 6);
+	TestEqual("Native participant called per variable", Native->VariableRequestedCount, 6);
+
+	// Opting in to step prefetching asks for everything the step might need, on any path, together: every condition
+	// on the select and the parameters of the lines it could lead to
+	Batch->Batches.Empty();
+	Batch->VariableRequestedCount = 0;
+	Single->VariableRequestedCount = 0;
+	Dlg->SetPrefetchStepVariables(true);
+	Dlg->Restart();
+	TestDialogueText(this, "Else path", Dlg, "NPC", "Three 3 4");
+	if (TestEqual("One batch for the step", Batch->Batches.Num(), 1))
+	{
+		TestTrue("Step batch", Batch->Batches[0] == TArray<FName> { "A", "B", "C", "D" });
+	}
+	TestTrue("Continue", Dlg->Continue());
+	if (TestEqual("One batch for the next step", Batch->Batches.Num(), 2))
+	{
+		TestTrue("Event batch", Batch->Batches[1] == TArray<FName> { "E", "F" });
+	}
+	TestEqual("Single participant still called once per variable", Single->VariableRequestedCount, 6);
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
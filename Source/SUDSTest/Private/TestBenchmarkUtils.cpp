@@ -0,0 +1,246 @@
+﻿#include "TestBenchmarkUtils.h"
+
+#include "Dom/JsonObject.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+void FSUDSBenchmarkScriptParams::ParseCommandLine()
+{
+	const TCHAR* Cmd = FCommandLine::Get();
+	FParse::Value(Cmd, TEXT("SUDSBenchSeed="), Seed);
+	FParse::Value(Cmd, TEXT("SUDSBenchSections="), NumSections);
+	FParse::Value(Cmd, TEXT("SUDSBenchLines="), LinesPerSection);
+	FParse::Value(Cmd, TEXT("SUDSBenchBranching="), BranchingFactor);
+	FParse::Value(Cmd, TEXT("SUDSBenchConditions="), ConditionDensity);
+	FParse::Value(Cmd, TEXT("SUDSBenchGosubDepth="), GosubDepth);
+	FParse::Value(Cmd, TEXT("SUDSBenchParameters="), ParameterDensity);
+	NumSections = FMath::Max(NumSections, 1);
+	LinesPerSection = FMath::Max(LinesPerSection, 1);
+	BranchingFactor = FMath::Max(BranchingFactor, 1);
+	GosubDepth = FMath::Max(GosubDepth, 0);
+}
+
+FString FSUDSBenchmarkScriptParams::ToString() const
+{
+	return FString::Printf(TEXT("seed=%d sections=%d lines=%d branching=%d conditions=%.2f gosubdepth=%d parameters=%.2f"),
+	                       Seed,
+	                       NumSections,
+	                       LinesPerSection,
+	                       BranchingFactor,
+	                       ConditionDensity,
+	                       GosubDepth,
+	                       ParameterDensity);
+}
+
+const TCHAR* FSUDSBenchmarkScriptGenerator::Header = TEXT("===\n[set Gold = 100]\n[set Visits = 0]\n[set Name = \"Traveller\"]\n===\n");
+
+FString FSUDSBenchmarkScriptGenerator::MakeText(FRandomStream& Rand, const FSUDSBenchmarkScriptParams& Params, const TCHAR* Prefix, int A, int B)
+{
+	if (Rand.FRand() < Params.ParameterDensity)
+	{
+		switch (Rand.RandHelper(3))
+		{
+		default:
+		case 0:
+			return FString::Printf(TEXT("%s %d.%d, you have {Gold} gold"), Prefix, A, B);
+		case 1:
+			return FString::Printf(TEXT("%s %d.%d, hello {Name}"), Prefix, A, B);
+		case 2:
+			return FString::Printf(TEXT("%s %d.%d, visit number {Visits}"), Prefix, A, B);
+		}
+	}
+	return FString::Printf(TEXT("%s %d.%d"), Prefix, A, B);
+}
+
+FString FSUDSBenchmarkScriptGenerator::MakeCondition(FRandomStream& Rand)
+{
+	if (Rand.RandHelper(2))
+	{
+		return FString::Printf(TEXT("{Visits} %% %d != 0"), Rand.RandRange(2, 5));
+	}
+	return FString::Printf(TEXT("{Gold} > %d and {Visits} < %d"), Rand.RandRange(0, 200), Rand.RandRange(10, 1000));
+}
+
+FString FSUDSBenchmarkScriptGenerator::GenerateChoiceHub(const FSUDSBenchmarkScriptParams& Params)
+{
+	FRandomStream Rand(Params.Seed);
+	FString Script(Header);
+	Script.Append(TEXT(":hub\n"));
+	Script.Appendf(TEXT("NPC: %s\n"), *MakeText(Rand, Params, TEXT("Hub"), 0, 0));
+	for (int C = 0; C < Params.BranchingFactor; ++C)
+	{
+		// Always leave the first choice unconditional so there's a way forward
+		const bool bConditional = C > 0 && Rand.FRand() < Params.ConditionDensity;
+		if (bConditional)
+		{
+			Script.Appendf(TEXT("[if %s]\n"), *MakeCondition(Rand));
+		}
+		Script.Appendf(TEXT("    * %s\n"), *MakeText(Rand, Params, TEXT("Choice"), 0, C));
+		Script.Appendf(TEXT("        Player: Response %d\n"), C);
+		Script.Append(TEXT("        [set Visits = {Visits} + 1]\n"));
+		Script.Append(TEXT("        [goto hub]\n"));
+		if (bConditional)
+		{
+			Script.Append(TEXT("[endif]\n"));
+		}
+	}
+	return Script;
+}
+
+FString FSUDSBenchmarkScriptGenerator::Generate(const FSUDSBenchmarkScriptParams& Params)
+{
+	FRandomStream Rand(Params.Seed);
+	FString Script;
+	Script.Reserve(Params.NumSections * (Params.LinesPerSection + Params.BranchingFactor * 3) * 40);
+	constexpr int SubsPerLevel = 4;
+
+	Script.Append(Header);
+
+	for (int S = 0; S < Params.NumSections; ++S)
+	{
+		Script.Appendf(TEXT(":s%d\n"), S);
+		Script.Append(TEXT("[set Visits = {Visits} + 1]\n"));
+		for (int L = 0; L < Params.LinesPerSection; ++L)
+		{
+			if (L > 0 && Rand.FRand() < Params.ConditionDensity)
+			{
+				Script.Appendf(TEXT("[if {Gold} > %d]\n"), Rand.RandRange(0, 200));
+				Script.Appendf(TEXT("    NPC: %s\n"), *MakeText(Rand, Params, TEXT("Rich line"), S, L));
+				Script.Append(TEXT("[else]\n"));
+				Script.Appendf(TEXT("    Player: %s\n"), *MakeText(Rand, Params, TEXT("Poor line"), S, L));
+				Script.Append(TEXT("[endif]\n"));
+			}
+			else
+			{
+				Script.Appendf(TEXT("%s: %s\n"), (L % 2) ? TEXT("Player") : TEXT("NPC"), *MakeText(Rand, Params, TEXT("Line"), S, L));
+			}
+		}
+		if (Params.GosubDepth > 0 && Rand.FRand() < 0.5f)
+		{
+			Script.Appendf(TEXT("[gosub sub0_%d]\n"), Rand.RandHelper(SubsPerLevel));
+		}
+
+		Script.Append(TEXT("NPC: What now?\n"));
+		for (int C = 0; C < Params.BranchingFactor; ++C)
+		{
+			// Always leave the first choice unconditional so there's a way forward
+			const bool bConditional = C > 0 && Rand.FRand() < Params.ConditionDensity;
+			if (bConditional)
+			{
+				Script.Appendf(TEXT("[if %s]\n"), *MakeCondition(Rand));
+			}
+			Script.Appendf(TEXT("    * %s\n"), *MakeText(Rand, Params, TEXT("Choice"), S, C));
+			Script.Appendf(TEXT("        Player: Response %d.%d\n"), S, C);
+			if (Rand.FRand() < 0.5f)
+			{
+				Script.Appendf(TEXT("        [set Gold = {Gold} %s %d]\n"), Rand.RandHelper(2) ? TEXT("+") : TEXT("-"), Rand.RandRange(1, 50));
+			}
+			// Only jump forwards so the dialogue always ends
+			if (S + 1 < Params.NumSections)
+			{
+				Script.Appendf(TEXT("        [goto s%d]\n"), Rand.RandRange(S + 1, FMath::Min(S + 4, Params.NumSections - 1)));
+			}
+			else
+			{
+				Script.Append(TEXT("        [goto end]\n"));
+			}
+			if (bConditional)
+			{
+				Script.Append(TEXT("[endif]\n"));
+			}
+		}
+	}
+	Script.Append(TEXT("[goto end]\n"));
+
+	// Subs, each of which may call one on the next level down
+	for (int D = 0; D < Params.GosubDepth; ++D)
+	{
+		for (int K = 0; K < SubsPerLevel; ++K)
+		{
+			Script.Appendf(TEXT(":sub%d_%d\n"), D, K);
+			Script.Appendf(TEXT("NPC: %s\n"), *MakeText(Rand, Params, TEXT("Sub line"), D, K));
+			if (D + 1 < Params.GosubDepth)
+			{
+				Script.Appendf(TEXT("[gosub sub%d_%d]\n"), D + 1, Rand.RandHelper(SubsPerLevel));
+			}
+			Script.Append(TEXT("[return]\n"));
+		}
+	}
+
+	return Script;
+}
+
+FSUDSBenchmarkReport::FSUDSBenchmarkReport(const FString& InBenchmarkName, const FSUDSBenchmarkScriptParams& InParams)
+	: BenchmarkName(InBenchmarkName),
+	  Params(InParams),
+	  Timestamp(FDateTime::UtcNow())
+{
+}
+
+FString FSUDSBenchmarkReport::Add(const FString& Measure, int32 Iterations, double Seconds)
+{
+	Measurements.Add(FMeasurement { Measure, Iterations, Seconds });
+	return FString::Printf(TEXT("%s: %d iterations in %.2fms, %.3fus each"),
+	                       *Measure,
+	                       Iterations,
+	                       Seconds * 1000.0,
+	                       Iterations > 0 ? Seconds * 1000000.0 / Iterations : 0.0);
+}
+
+FString FSUDSBenchmarkReport::GetOutputDir()
+{
+	return FPaths::ProjectSavedDir() / TEXT("SUDSBenchmarks");
+}
+
+bool FSUDSBenchmarkReport::Write() const
+{
+	const FString TimeStr = Timestamp.ToIso8601();
+
+	// JSON for this run
+	const TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetStringField(TEXT("benchmark"), BenchmarkName);
+	Root->SetStringField(TEXT("timestamp"), TimeStr);
+	Root->SetStringField(TEXT("params"), Params.ToString());
+	TArray<TSharedPtr<FJsonValue>> Results;
+	for (const auto& M : Measurements)
+	{
+		const TSharedRef<FJsonObject> Obj = MakeShared<FJsonObject>();
+		Obj->SetStringField(TEXT("measure"), M.Measure);
+		Obj->SetNumberField(TEXT("iterations"), M.Iterations);
+		Obj->SetNumberField(TEXT("totalMs"), M.Seconds * 1000.0);
+		Obj->SetNumberField(TEXT("usPerIteration"), M.Iterations > 0 ? M.Seconds * 1000000.0 / M.Iterations : 0.0);
+		Results.Add(MakeShared<FJsonValueObject>(Obj));
+	}
+	Root->SetArrayField(TEXT("results"), Results);
+	FString Json;
+	const auto Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root, Writer);
+	const FString JsonFile = GetOutputDir() / FString::Printf(TEXT("%s-%s.json"), *BenchmarkName, *Timestamp.ToString());
+	bool bOK = FFileHelper::SaveStringToFile(Json, *JsonFile, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+
+	// Append to the CSV which accumulates all runs
+	const FString CsvFile = GetOutputDir() / TEXT("Benchmarks.csv");
+	FString Csv;
+	if (!IFileManager::Get().FileExists(*CsvFile))
+	{
+		Csv.Append(TEXT("Timestamp,Benchmark,Measure,Iterations,TotalMs,UsPerIteration,Params\n"));
+	}
+	for (const auto& M : Measurements)
+	{
+		Csv.Appendf(TEXT("%s,%s,%s,%d,%.3f,%.4f,\"%s\"\n"),
+		            *TimeStr,
+		            *BenchmarkName,
+		            *M.Measure,
+		            M.Iterations,
+		            M.Seconds * 1000.0,
+		            M.Iterations > 0 ? M.Seconds * 1000000.0 / M.Iterations : 0.0,
+		            *Params.ToString());
+	}
+	bOK = FFileHelper::SaveStringToFile(Csv,
+	                                    *CsvFile,
+	                                    FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM,
+	                                    &IFileManager::Get(),
+	                                    FILEWRITE_Append) && bOK;
+	return bOK;
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/// Shape of a script made by FSUDSBenchmarkScriptGenerator
+struct FSUDSBenchmarkScriptParams
+{
+	/// Seed for everything random about the script, the same parameters always make the same script
+	int32 Seed = 1;
+	/// Number of labelled sections; each has some speaker lines, then a choice which jumps to a later section
+	int32 NumSections = 200;
+	/// Speaker lines in each section, before the choice
+	int32 LinesPerSection = 4;
+	/// Number of choices at the end of each section
+	int32 BranchingFactor = 3;
+	/// Chance (0-1) of each speaker line or choice after the first being inside a conditional
+	float ConditionDensity = 0.3f;
+	/// How deep gosubs go; sections may call a sub, which may call another sub and so on
+	int32 GosubDepth = 2;
+	/// Chance (0-1) of each speaker line or choice using variables in its text
+	float ParameterDensity = 0.3f;
+
+	/// Read any overrides from the command line, e.g. -SUDSBenchSections=1000 -SUDSBenchSeed=7
+	void ParseCommandLine();
+	FString ToString() const;
+};
+
+/// Generates .sud scripts of a given size & shape for benchmarking, see FSUDSBenchmarkScriptParams
+class FSUDSBenchmarkScriptGenerator
+{
+public:
+	static FString Generate(const FSUDSBenchmarkScriptParams& Params);
+	/// A single speaker line with BranchingFactor choices, which all lead back to it. Only the number of choices,
+	/// condition & parameter density and the seed are used
+	static FString GenerateChoiceHub(const FSUDSBenchmarkScriptParams& Params);
+
+protected:
+	static FString MakeText(FRandomStream& Rand, const FSUDSBenchmarkScriptParams& Params, const TCHAR* Prefix, int A, int B);
+	static FString MakeCondition(FRandomStream& Rand);
+	static const TCHAR* Header;
+};
+
+/**
+ * Timings from a benchmark, which are written to Saved/SUDSBenchmarks so they can be compared over time.
+ * Each benchmark writes a JSON file of its own, and also appends its results to Benchmarks.csv.
+ */
+class FSUDSBenchmarkReport
+{
+public:
+	FSUDSBenchmarkReport(const FString& InBenchmarkName, const FSUDSBenchmarkScriptParams& InParams);
+
+	/// Record a measurement, and return a summary of it for the test log
+	FString Add(const FString& Measure, int32 Iterations, double Seconds);
+	/// Write out all the measurements
+	bool Write() const;
+
+	static FString GetOutputDir();
+
+protected:
+	struct FMeasurement
+	{
+		FString Measure;
+		int32 Iterations;
+		double Seconds;
+	};
+	FString BenchmarkName;
+	FSUDSBenchmarkScriptParams Params;
+	FDateTime Timestamp;
+	TArray<FMeasurement> Measurements;
+};
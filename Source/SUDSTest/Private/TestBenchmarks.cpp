@@ -0,0 +1,353 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "TestBenchmarkUtils.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+// Benchmarks use generated scripts, see FSUDSBenchmarkScriptGenerator. They're in the performance filter so they
+// don't run with the functional tests; results are written to Saved/SUDSBenchmarks to compare between runs.
+
+namespace
+{
+	USUDSScript* ImportBenchmarkScript(FAutomationTestBase* Test, const FString& Source, UStringTable* StringTable)
+	{
+		FSUDSMessageLogger Logger(false);
+		FSUDSScriptImporter Importer;
+		if (!Test->TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(Source), Source.Len(), "Benchmark", &Logger, true)))
+		{
+			return nullptr;
+		}
+		auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Benchmark");
+		Importer.PopulateAsset(Script, StringTable);
+		return Script;
+	}
+
+	/// Continue, or make a random choice if there is one. Returns false once the dialogue has ended
+	bool StepBenchmarkDialogue(USUDSDialogue* Dlg, FRandomStream& Rand)
+	{
+		if (Dlg->IsSimpleContinue())
+		{
+			return Dlg->Continue();
+		}
+		return Dlg->Choose(Rand.RandHelper(Dlg->GetNumberOfChoices()));
+	}
+
+	FSUDSBenchmarkScriptParams GetBenchmarkParams()
+	{
+		FSUDSBenchmarkScriptParams Params;
+		Params.ParseCommandLine();
+		return Params;
+	}
+
+	constexpr int NumPlaythroughs = 50;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBenchmarkGenerator,
+								 "SUDSTest.TestBenchmarkGenerator",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestBenchmarkGenerator::RunTest(const FString& Parameters)
+{
+	FSUDSBenchmarkScriptParams Params;
+	Params.NumSections = 20;
+	const FString Source = FSUDSBenchmarkScriptGenerator::Generate(Params);
+	TestEqual("Same seed should generate the same script", FSUDSBenchmarkScriptGenerator::Generate(Params), Source);
+	FSUDSBenchmarkScriptParams OtherParams = Params;
+	OtherParams.Seed = 2;
+	TestNotEqual("Different seed should generate a different script", FSUDSBenchmarkScriptGenerator::Generate(OtherParams), Source);
+
+	const ScopedStringTableHolder StringTableHolder;
+	auto Script = ImportBenchmarkScript(this, Source, StringTableHolder.StringTable);
+	if (!Script)
+	{
+		return false;
+	}
+
+	// Script shouldn't be the owner of the dialogue but it's the only UObject we've got right now so why not
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->Start();
+	FRandomStream Rand(Params.Seed);
+	int Steps = 0;
+	while (StepBenchmarkDialogue(Dlg, Rand) && Steps < 10000)
+	{
+		++Steps;
+	}
+	TestTrue("Generated dialogue should end", Dlg->IsEnded());
+	TestTrue("Generated dialogue should have some steps", Steps > Params.NumSections / 4);
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBenchmarkImport,
+								 "SUDSTest.Benchmark.Import",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+bool FTestBenchmarkImport::RunTest(const FString& Parameters)
+{
+	const FSUDSBenchmarkScriptParams Params = GetBenchmarkParams();
+	const FString Source = FSUDSBenchmarkScriptGenerator::Generate(Params);
+	FSUDSBenchmarkReport Report(TEXT("Import"), Params);
+	constexpr int NumImports = 5;
+
+	// Warm up so the first timing doesn't include one-off costs
+	{
+		FSUDSMessageLogger Logger(false);
+		FSUDSScriptImporter Importer;
+		TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(Source), Source.Len(), "Benchmark", &Logger, true));
+	}
+
+	double ParseTime = 0;
+	double PopulateTime = 0;
+	for (int i = 0; i < NumImports; ++i)
+	{
+		FSUDSMessageLogger Logger(false);
+		FSUDSScriptImporter Importer;
+		double Start = FPlatformTime::Seconds();
+		TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(Source), Source.Len(), "Benchmark", &Logger, true));
+		ParseTime += FPlatformTime::Seconds() - Start;
+
+		const ScopedStringTableHolder StringTableHolder;
+		auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Benchmark");
+		Start = FPlatformTime::Seconds();
+		Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+		PopulateTime += FPlatformTime::Seconds() - Start;
+		Script->MarkAsGarbage();
+	}
+	AddInfo(Report.Add(TEXT("Parse"), NumImports, ParseTime));
+	AddInfo(Report.Add(TEXT("PopulateAsset"), NumImports, PopulateTime));
+	TestTrue("Should write results", Report.Write());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBenchmarkRun,
+								 "SUDSTest.Benchmark.Run",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+bool FTestBenchmarkRun::RunTest(const FString& Parameters)
+{
+	const FSUDSBenchmarkScriptParams Params = GetBenchmarkParams();
+	const ScopedStringTableHolder StringTableHolder;
+	auto Script = ImportBenchmarkScript(this, FSUDSBenchmarkScriptGenerator::Generate(Params), StringTableHolder.StringTable);
+	if (!Script)
+	{
+		return false;
+	}
+	FSUDSBenchmarkReport Report(TEXT("Run"), Params);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	FRandomStream Rand(Params.Seed);
+	int NumStarts = 0, NumContinues = 0, NumChooses = 0;
+	double StartTime = 0, ContinueTime = 0, ChooseTime = 0;
+	for (int i = 0; i < NumPlaythroughs; ++i)
+	{
+		double T = FPlatformTime::Seconds();
+		Dlg->Restart(true);
+		StartTime += FPlatformTime::Seconds() - T;
+		++NumStarts;
+		while (!Dlg->IsEnded())
+		{
+			if (Dlg->IsSimpleContinue())
+			{
+				T = FPlatformTime::Seconds();
+				Dlg->Continue();
+				ContinueTime += FPlatformTime::Seconds() - T;
+				++NumContinues;
+			}
+			else
+			{
+				const int Choice = Rand.RandHelper(Dlg->GetNumberOfChoices());
+				T = FPlatformTime::Seconds();
+				Dlg->Choose(Choice);
+				ChooseTime += FPlatformTime::Seconds() - T;
+				++NumChooses;
+			}
+		}
+	}
+	AddInfo(Report.Add(TEXT("Restart"), NumStarts, StartTime));
+	AddInfo(Report.Add(TEXT("Continue"), NumContinues, ContinueTime));
+	AddInfo(Report.Add(TEXT("Choose"), NumChooses, ChooseTime));
+	TestTrue("Should write results", Report.Write());
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBenchmarkChoices,
+								 "SUDSTest.Benchmark.Choices",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+bool FTestBenchmarkChoices::RunTest(const FString& Parameters)
+{
+	// A hub with lots of conditional choices which every choice comes back to, so that nearly all the time going
+	// back to the hub is spent evaluating which choices are available
+	FSUDSBenchmarkScriptParams Params = GetBenchmarkParams();
+	Params.BranchingFactor = FMath::Max(Params.BranchingFactor, 32);
+	const ScopedStringTableHolder StringTableHolder;
+	auto Script = ImportBenchmarkScript(this, FSUDSBenchmarkScriptGenerator::GenerateChoiceHub(Params), StringTableHolder.StringTable);
+	if (!Script)
+	{
+		return false;
+	}
+	FSUDSBenchmarkReport Report(TEXT("Choices"), Params);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->Start();
+	FRandomStream Rand(Params.Seed);
+	constexpr int NumRounds = 1000;
+	double EvalTime = 0;
+	double ReadTime = 0;
+	int NumChoicesRead = 0;
+	for (int i = 0; i < NumRounds; ++i)
+	{
+		Dlg->Choose(Rand.RandHelper(Dlg->GetNumberOfChoices()));
+		// Continuing from the response goes back to the hub & evaluates all its choices
+		double T = FPlatformTime::Seconds();
+		Dlg->Continue();
+		EvalTime += FPlatformTime::Seconds() - T;
+
+		// What a UI would do with the choices
+		T = FPlatformTime::Seconds();
+		for (int c = 0; c < Dlg->GetNumberOfChoices(); ++c)
+		{
+			Dlg->GetChoiceText(c);
+			Dlg->HasChoiceIndexBeenTakenPreviously(c);
+			++NumChoicesRead;
+		}
+		ReadTime += FPlatformTime::Seconds() - T;
+	}
+	AddInfo(Report.Add(TEXT("EvaluateChoices"), NumRounds, EvalTime));
+	AddInfo(Report.Add(TEXT("ReadChoice"), NumChoicesRead, ReadTime));
+	TestTrue("Should write results", Report.Write());
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBenchmarkTextFormatting,
+								 "SUDSTest.Benchmark.TextFormatting",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+bool FTestBenchmarkTextFormatting::RunTest(const FString& Parameters)
+{
+	// Only text with parameters needs formatting; run a script with none and one where every line has them
+	const FSUDSBenchmarkScriptParams Params = GetBenchmarkParams();
+	FSUDSBenchmarkReport Report(TEXT("TextFormatting"), Params);
+	constexpr int RepeatsPerLine = 20;
+	for (const float ParameterDensity : { 0.0f, 1.0f })
+	{
+		FSUDSBenchmarkScriptParams ScriptParams = Params;
+		ScriptParams.ParameterDensity = ParameterDensity;
+		const ScopedStringTableHolder StringTableHolder;
+		auto Script = ImportBenchmarkScript(this, FSUDSBenchmarkScriptGenerator::Generate(ScriptParams), StringTableHolder.StringTable);
+		if (!Script)
+		{
+			return false;
+		}
+
+		auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+		FRandomStream Rand(Params.Seed);
+		int NumLines = 0;
+		double Time = 0;
+		for (int i = 0; i < NumPlaythroughs; ++i)
+		{
+			Dlg->Restart(true);
+			while (!Dlg->IsEnded())
+			{
+				const double T = FPlatformTime::Seconds();
+				for (int r = 0; r < RepeatsPerLine; ++r)
+				{
+					Dlg->GetText();
+				}
+				Time += FPlatformTime::Seconds() - T;
+				NumLines += RepeatsPerLine;
+				StepBenchmarkDialogue(Dlg, Rand);
+			}
+		}
+		AddInfo(Report.Add(ParameterDensity > 0 ? TEXT("ParameterisedText") : TEXT("PlainText"), NumLines, Time));
+		Script->MarkAsGarbage();
+	}
+	TestTrue("Should write results", Report.Write());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBenchmarkSaveState,
+								 "SUDSTest.Benchmark.SaveState",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+bool FTestBenchmarkSaveState::RunTest(const FString& Parameters)
+{
+	FSUDSBenchmarkScriptParams Params = GetBenchmarkParams();
+	const ScopedStringTableHolder StringTableHolder;
+	auto Script = ImportBenchmarkScript(this, FSUDSBenchmarkScriptGenerator::Generate(Params), StringTableHolder.StringTable);
+	if (!Script)
+	{
+		return false;
+	}
+	FSUDSBenchmarkReport Report(TEXT("SaveState"), Params);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	FRandomStream Rand(Params.Seed);
+	int NumStates = 0;
+	double SaveTime = 0, RestoreTime = 0, CompactSaveTime = 0, CompactRestoreTime = 0;
+	for (int i = 0; i < NumPlaythroughs; ++i)
+	{
+		Dlg->Restart(true);
+		while (!Dlg->IsEnded())
+		{
+			double T = FPlatformTime::Seconds();
+			const FSUDSDialogueState State = Dlg->GetSavedState();
+			SaveTime += FPlatformTime::Seconds() - T;
+
+			T = FPlatformTime::Seconds();
+			Dlg->RestoreSavedState(State);
+			RestoreTime += FPlatformTime::Seconds() - T;
+
+			T = FPlatformTime::Seconds();
+			const FSUDSCompactDialogueState CompactState = Dlg->GetCompactSavedState();
+			CompactSaveTime += FPlatformTime::Seconds() - T;
+
+			T = FPlatformTime::Seconds();
+			Dlg->RestoreCompactSavedState(CompactState);
+			CompactRestoreTime += FPlatformTime::Seconds() - T;
+
+			++NumStates;
+			StepBenchmarkDialogue(Dlg, Rand);
+		}
+	}
+	AddInfo(Report.Add(TEXT("GetSavedState"), NumStates, SaveTime));
+	AddInfo(Report.Add(TEXT("RestoreSavedState"), NumStates, RestoreTime));
+	AddInfo(Report.Add(TEXT("GetCompactSavedState"), NumStates, CompactSaveTime));
+	AddInfo(Report.Add(TEXT("RestoreCompactSavedState"), NumStates, CompactRestoreTime));
+	TestTrue("Should write results", Report.Write());
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
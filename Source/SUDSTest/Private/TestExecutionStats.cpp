@@ -0,0 +1,93 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString ExecutionStatsInput = R"RAWSUD(
+[set Count 0]
+NPC: Hello
+:loop
+[if {Count} < 3]
+    NPC: Round {Count}
+    [set Count {Count} + 1]
+    [goto loop]
+[endif]
+NPC: Done
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestExecutionStats,
+								 "SUDSTest.TestExecutionStats",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestExecutionStats::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(ExecutionStatsInput), ExecutionStatsInput.Len(), "ExecutionStatsInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	const bool bPrevEnabled = USUDSScript::IsExecutionStatsEnabled();
+	USUDSScript::SetExecutionStatsEnabled(false);
+
+	// Nothing is recorded while disabled
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->Start();
+	while (!Dlg->IsEnded())
+	{
+		Dlg->Continue();
+	}
+	TestEqual("No stats while disabled", Script->GetExecutionStats().Nodes.Num(), 0);
+
+	USUDSScript::SetExecutionStatsEnabled(true);
+	Dlg->Restart(true);
+	TestDialogueText(this, "Start", Dlg, "NPC", "Hello");
+	while (!Dlg->IsEnded())
+	{
+		Dlg->Continue();
+	}
+
+	TMap<int, FSUDSNodeExecutionStats> LineStats;
+	Script->GetExecutionStats().GetLineStats(LineStats);
+	if (TestTrue("Set line stats", LineStats.Contains(2)))
+	{
+		TestEqual("Set line count", LineStats[2].ExecutionCount, 1ll);
+	}
+	if (TestTrue("Hello line stats", LineStats.Contains(3)))
+	{
+		TestEqual("Hello line count", LineStats[3].ExecutionCount, 1ll);
+	}
+	if (TestTrue("Round line stats", LineStats.Contains(6)))
+	{
+		TestEqual("Round line count", LineStats[6].ExecutionCount, 3ll);
+	}
+	if (TestTrue("Increment line stats", LineStats.Contains(7)))
+	{
+		TestEqual("Increment line count", LineStats[7].ExecutionCount, 3ll);
+		TestTrue("Increment line has time", LineStats[7].TotalTimeMs >= 0);
+	}
+	if (TestTrue("Done line stats", LineStats.Contains(10)))
+	{
+		TestEqual("Done line count", LineStats[10].ExecutionCount, 1ll);
+	}
+	TestFalse("Text nodes don't record time", LineStats.Contains(3) && LineStats[3].TotalTimeMs > 0);
+
+	Script->ResetExecutionStats();
+	TestEqual("No stats after reset", Script->GetExecutionStats().Nodes.Num(), 0);
+
+	USUDSScript::SetExecutionStatsEnabled(bPrevEnabled);
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
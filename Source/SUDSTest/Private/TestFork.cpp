@@ -0,0 +1,130 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "SUDSSubsystem.h"
+#include "TestParticipant.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString ForkInput = R"RAWSUD(
+===
+[set Mood 1]
+===
+NPC: What'll it be?
+    * Be nice
+        [set Mood {Mood} + 1]
+        [event Nice]
+        NPC: Thanks!
+    * Be rude
+        [set Mood {Mood} - 1]
+        [set global.Reputation -5]
+        [gosub apology]
+        NPC: Hmph.
+NPC: Bye
+
+:apology
+NPC: Say sorry?
+    * Sorry
+        [return]
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestFork,
+								 "SUDSTest.TestFork",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestFork::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(ForkInput), ForkInput.Len(), "ForkInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	USUDSSubsystem::Test_DummyGlobalVariables.Empty();
+	USUDSSubsystem::Test_DummyGlobalVariables.Add("Reputation", 10);
+
+	auto Participant = NewObject<UTestNativeParticipant>();
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->AddParticipant(Participant);
+	Dlg->Start();
+	TestDialogueText(this, "Start", Dlg, "NPC", "What'll it be?");
+	const int SpeakerLines = Participant->SpeakerLineCount;
+	const bool bPrevStatsEnabled = USUDSScript::IsExecutionStatsEnabled();
+	USUDSScript::SetExecutionStatsEnabled(true);
+	Script->ResetExecutionStats();
+
+	// Look ahead down both paths
+	auto NiceFork = Dlg->Fork();
+	if (!TestNotNull("Fork", NiceFork))
+		return true;
+	TestTrue("Fork is silent", NiceFork->IsSilent());
+	TestFalse("Original is not silent", Dlg->IsSilent());
+	TestDialogueText(this, "Fork starts at same line", NiceFork, "NPC", "What'll it be?");
+	TestEqual("Fork has same choices", NiceFork->GetNumberOfChoices(), 2);
+	TestTrue("Choose", NiceFork->Choose(0));
+	TestDialogueText(this, "Fork line", NiceFork, "NPC", "Thanks!");
+	TestEqual("Fork mood", NiceFork->GetVariableInt("Mood"), 2);
+
+	auto RudeFork = Dlg->Fork();
+	TestTrue("Choose", RudeFork->Choose(1));
+	TestDialogueText(this, "Fork gosub line", RudeFork, "NPC", "Say sorry?");
+	TestEqual("Fork mood", RudeFork->GetVariableInt("Mood"), 0);
+	const FSUDSVariableHandle Reputation = USUDSDialogue::GetVariableHandle("global.Reputation");
+	TestEqual("Fork sees its own global", RudeFork->GetVariableInt(Reputation), -5);
+	// Fork of a fork shares its globals & gosub stack
+	auto RudeFork2 = RudeFork->Fork(false);
+	TestTrue("Fork of silent fork is silent", RudeFork2->IsSilent());
+	TestTrue("Continue", RudeFork2->Continue());
+	TestDialogueText(this, "Returned from gosub", RudeFork2, "NPC", "Hmph.");
+	TestEqual("Fork of fork sees global", RudeFork2->GetVariableInt(Reputation), -5);
+	// The first rude fork is still in the gosub
+	TestDialogueText(this, "Fork unaffected by its fork", RudeFork, "NPC", "Say sorry?");
+
+	// None of that touched the original
+	TestDialogueText(this, "Original unchanged", Dlg, "NPC", "What'll it be?");
+	TestEqual("Original mood", Dlg->GetVariableInt("Mood"), 1);
+	TestEqual("Real global unchanged", USUDSSubsystem::Test_DummyGlobalVariables.FindRef("Reputation").GetIntValue(), 10);
+	TestEqual("Original sees real global", Dlg->GetVariableInt(Reputation), 10);
+	TestEqual("Original choice not taken", Dlg->GetSavedState().GetChoicesTaken().Num(), 0);
+	TestEqual("Fork choice taken", NiceFork->GetSavedState().GetChoicesTaken().Num(), 1);
+	TestEqual("No participant calls from silent forks", Participant->SpeakerLineCount, SpeakerLines);
+	TestEqual("No participant events from silent forks", Participant->EventNames.Num(), 0);
+	TestEqual("No participant choices from silent forks", Participant->ChoiceMadeCount, 0);
+	TestEqual("No execution stats from silent forks", Script->GetExecutionStats().Nodes.Num(), 0);
+
+	// Changing the original doesn't change an existing fork either
+	auto LaterFork = Dlg->Fork();
+	Dlg->SetVariableInt("Mood", 10);
+	TestEqual("Fork keeps shared value", LaterFork->GetVariableInt("Mood"), 1);
+	LaterFork->SetVariableInt("Mood", 20);
+	TestEqual("Original keeps own value", Dlg->GetVariableInt("Mood"), 10);
+
+	// Non-silent forks call participants as they go
+	auto LoudFork = Dlg->Fork(false);
+	TestFalse("Fork is not silent", LoudFork->IsSilent());
+	TestTrue("Choose", LoudFork->Choose(0));
+	TestEqual("Participant got event", Participant->EventNames.Num(), 1);
+	TestEqual("Participant got choice", Participant->ChoiceMadeCount, 1);
+	TestTrue("Non-silent fork records execution stats", Script->GetExecutionStats().Nodes.Num() > 0);
+	USUDSScript::SetExecutionStatsEnabled(bPrevStatsEnabled);
+
+	// Original carries on as normal
+	TestTrue("Choose", Dlg->Choose(1));
+	TestDialogueText(this, "Original gosub line", Dlg, "NPC", "Say sorry?");
+	TestEqual("Real global set by original", USUDSSubsystem::Test_DummyGlobalVariables.FindRef("Reputation").GetIntValue(), -5);
+
+	USUDSSubsystem::Test_DummyGlobalVariables.Empty();
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
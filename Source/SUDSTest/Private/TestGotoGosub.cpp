@@ -414,4 +414,296 @@ bool FTestGosubBetweenSpeakerAndChoice2::RunTest(const FString& Parameters)
 }
 
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestGotoHub,
+								 "SUDSTest.TestGotoHub",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+
+bool FTestGotoHub::RunTest(const FString& Parameters)
+{
+	// Lots of choices all going to the same hub, which contains a run of conditionals. Every route through those
+	// conditionals has to be checked to make sure it reaches a speaker line before another choice, which used to be
+	// done again for every choice, and for every combination of conditional branches
+	constexpr int NumChoices = 500;
+	constexpr int NumConditionals = 16;
+	auto GenerateScript = [](bool bBadPath)
+	{
+		FString Script;
+		Script.Append(TEXT("NPC: What would you like?\n"));
+		Script.Append(TEXT(":choices\n"));
+		for (int i = 0; i < NumChoices; ++i)
+		{
+			Script.Appendf(TEXT("* Item %d\n"), i);
+			Script.Appendf(TEXT("    [set Item = %d]\n"), i);
+			Script.Append(TEXT("    [goto hub]\n"));
+		}
+		Script.Append(TEXT(":hub\n"));
+		for (int i = 0; i < NumConditionals; ++i)
+		{
+			Script.Appendf(TEXT("[if {Item} > %d]\n"), i * 30);
+			Script.Appendf(TEXT("    [set Discount%d = true]\n"), i);
+			Script.Append(TEXT("[endif]\n"));
+		}
+		if (bBadPath)
+		{
+			// One route through the hub goes straight back to the choices, with no speaker line in between
+			Script.Append(TEXT("[if {Item} > 450]\n"));
+			Script.Append(TEXT("    [goto choices]\n"));
+			Script.Append(TEXT("[endif]\n"));
+		}
+		Script.Append(TEXT("NPC: Anything else?\n"));
+		return Script;
+	};
+
+	const FString GoodScript = GenerateScript(false);
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	const double Start = FPlatformTime::Seconds();
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(GoodScript), GoodScript.Len(), "GotoHub", &Logger, true));
+	const double Time = FPlatformTime::Seconds() - Start;
+	TestEqual("No errors", Logger.NumErrors(), 0);
+	AddInfo(FString::Printf(TEXT("Imported %d-way hub in %.2fms, %lld nodes examined"), NumChoices, Time * 1000.0, Importer.Test_ImportSearchSteps));
+	// Checking every route separately examined every combination of conditionals for every choice, i.e. millions of
+	// nodes. Sharing the checks means only a few per line
+	const int NumLines = NumChoices * 3 + NumConditionals * 3 + 3;
+	TestTrue("Nodes examined should be proportional to the script", Importer.Test_ImportSearchSteps < NumLines * 20);
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->Start();
+	TestDialogueText(this, "Start node", Dlg, "NPC", "What would you like?");
+	TestEqual("Choice Count", Dlg->GetNumberOfChoices(), NumChoices);
+	TestTrue("Choose", Dlg->Choose(NumChoices - 1));
+	TestDialogueText(this, "Hub node", Dlg, "NPC", "Anything else?");
+	TestTrue("Discount", Dlg->GetVariableBoolean("Discount15"));
+
+	// Make sure errors still get reported once the hub is shared
+	const FString BadScript = GenerateScript(true);
+	FSUDSMessageLogger BadLogger(false);
+	FSUDSScriptImporter BadImporter;
+	TestFalse("Import should fail", BadImporter.ImportFromBuffer(GetData(BadScript), BadScript.Len(), "GotoHubBad", &BadLogger, true));
+	TestTrue("Should have errors", BadLogger.NumErrors() > 0);
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+
+const FString ClosedLoopInput = R"RAWSUD(
+NPC: Hello
+:loop
+[set Count = {Count} + 1]
+[event Looping]
+[goto loop]
+)RAWSUD";
+
+const FString GosubLoopInput = R"RAWSUD(
+NPC: Hello
+:top
+[gosub sub]
+[goto top]
+:sub
+[set x = 1]
+[return]
+)RAWSUD";
+
+const FString ConditionalLoopInput = R"RAWSUD(
+NPC: Hello
+:loop
+[set Count = {Count} + 1]
+[if {Count} >= {Limit}]
+	[goto done]
+[endif]
+[goto loop]
+:done
+NPC: Counted to {Count}
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestTextlessLoops,
+								 "SUDSTest.TestTextlessLoops",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+
+bool FTestTextlessLoops::RunTest(const FString& Parameters)
+{
+	{
+		// A loop with no way out is an error
+		FSUDSMessageLogger Logger(false);
+		FSUDSScriptImporter Importer;
+		TestFalse("Import should fail", Importer.ImportFromBuffer(GetData(ClosedLoopInput), ClosedLoopInput.Len(), "ClosedLoopInput", &Logger, false));
+		TestEqual("Should have an error", Logger.NumErrors(), 1);
+	}
+	{
+		// Going into a sub which always comes back doesn't get out of the loop either
+		FSUDSMessageLogger Logger(false);
+		FSUDSScriptImporter Importer;
+		TestFalse("Import should fail", Importer.ImportFromBuffer(GetData(GosubLoopInput), GosubLoopInput.Len(), "GosubLoopInput", &Logger, false));
+		TestEqual("Should have an error", Logger.NumErrors(), 1);
+	}
+
+	// A loop which can end depending on conditions is a warning
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(ConditionalLoopInput), ConditionalLoopInput.Len(), "ConditionalLoopInput", &Logger, false));
+	int NumWarnings = 0;
+	for (const auto& Msg : Logger.GetErrorMessages())
+	{
+		if (Msg->GetSeverity() == EMessageSeverity::Warning)
+		{
+			++NumWarnings;
+		}
+	}
+	TestEqual("Should have a warning", NumWarnings, 1);
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	// Script shouldn't be the owner of the dialogue but it's the only UObject we've got right now so why not
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->SetNodeBudget(100);
+	Dlg->SetVariableInt("Limit", 10);
+	Dlg->Start();
+	TestDialogueText(this, "Start node", Dlg, "NPC", "Hello");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Loop finished", Dlg, "NPC", "Counted to 10");
+
+	// Now make the loop go on forever, it should be stopped by the budget
+	Dlg->SetVariableInt("Limit", -1);
+	Dlg->Restart(false);
+	TestDialogueText(this, "Start node", Dlg, "NPC", "Hello");
+	AddExpectedError(TEXT("stuck in a loop"), EAutomationExpectedErrorFlags::Contains, 1);
+	TestFalse("Continue should end", Dlg->Continue());
+	TestTrue("Should be ended", Dlg->IsEnded());
+	
+	Script->MarkAsGarbage();
+	return true;
+}
+
+
+
+const FString ChoiceAfterLoopInput = R"RAWSUD(
+NPC: Start
+[goto check]
+:dec
+[set Count = {Count} - 1]
+:check
+[if {Count} > 0]
+	[goto dec]
+[endif]
+* Choice A
+	NPC: A
+	[goto dec]
+* Choice B
+	NPC: B
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestChoiceAfterLoop,
+								 "SUDSTest.TestChoiceAfterLoop",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestChoiceAfterLoop::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(ChoiceAfterLoopInput), ChoiceAfterLoopInput.Len(), "ChoiceAfterLoopInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->Start();
+
+	// The first search goes round the loop before the choices; that mustn't leave the loop marked as having no choices
+	TestDialogueText(this, "Start node", Dlg, "NPC", "Start");
+	TestEqual("Choices", Dlg->GetNumberOfChoices(), 2);
+	TestTrue("Choose 0", Dlg->Choose(0));
+	TestDialogueText(this, "Next", Dlg, "NPC", "A");
+	// Going back into the loop from here still leads to the choices
+	TestEqual("Choices", Dlg->GetNumberOfChoices(), 2);
+	TestEqual("Choice 0 text", Dlg->GetChoiceText(0).ToString(), "Choice A");
+	TestTrue("Choose 1", Dlg->Choose(1));
+	TestDialogueText(this, "Next", Dlg, "NPC", "B");
+	TestFalse("End", Dlg->Continue());
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+const FString ChoiceAfterSharedSubInput = R"RAWSUD(
+NPC: Hello
+	[gosub setup]
+	* Choice A
+		NPC: A
+		[gosub setup]
+		NPC: Back to text
+	* Choice B
+		NPC: B
+		[gosub setup]
+		* Choice B1
+			NPC: B1
+		* Choice B2
+			NPC: B2
+[goto end]
+:setup
+[set Visits = {Visits} + 1]
+[return]
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestChoiceAfterSharedSub,
+								 "SUDSTest.TestChoiceAfterSharedSub",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestChoiceAfterSharedSub::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(ChoiceAfterSharedSubInput), ChoiceAfterSharedSubInput.Len(), "ChoiceAfterSharedSubInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->Start();
+
+	// The sub is only worked out once, but whether there are choices depends on what follows each call
+	TestDialogueText(this, "Start node", Dlg, "NPC", "Hello");
+	TestEqual("Choices", Dlg->GetNumberOfChoices(), 2);
+	TestTrue("Choose 0", Dlg->Choose(0));
+	TestDialogueText(this, "Next", Dlg, "NPC", "A");
+	TestEqual("Choices", Dlg->GetNumberOfChoices(), 1);
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Next", Dlg, "NPC", "Back to text");
+	TestEqual("Visits", Dlg->GetVariableInt("Visits"), 2);
+	TestFalse("End", Dlg->Continue());
+
+	Dlg->Restart(true);
+	TestDialogueText(this, "Start node", Dlg, "NPC", "Hello");
+	TestTrue("Choose 1", Dlg->Choose(1));
+	TestDialogueText(this, "Next", Dlg, "NPC", "B");
+	TestEqual("Choices", Dlg->GetNumberOfChoices(), 2);
+	TestEqual("Choice 0 text", Dlg->GetChoiceText(0).ToString(), "Choice B1");
+	TestEqual("Visits", Dlg->GetVariableInt("Visits"), 2);
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+
 UE_ENABLE_OPTIMIZATION
\ No newline at end of file
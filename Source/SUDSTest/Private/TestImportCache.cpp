@@ -0,0 +1,119 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSImportCache.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString ImportCacheInput = R"RAWSUD(
+===
+[set Name "Bob"]
+===
+:start
+NPC: Hello {Name}
+[event Greeted "a, b", {Name}]
+  * Say hi
+    [set Greeted true]
+    Player: Hi
+  * Leave
+    [goto end]
+[if {Greeted}]
+    NPC: Nice to meet you
+[else]
+    NPC: Rude
+[endif]
+[gosub sub1]
+NPC: Bye
+[goto end]
+:sub1
+NPC: In sub
+[return]
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestImportCache,
+								 "SUDSTest.TestImportCache",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestImportCache::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(ImportCacheInput), ImportCacheInput.Len(), "ImportCacheInput", &Logger, true));
+	Logger.AddMessage(EMessageSeverity::Warning, FText::FromString("A warning"));
+
+	const FString CacheDir = FPaths::ProjectIntermediateDir() / TEXT("SUDSTest") / TEXT("ImportCache");
+	IFileManager::Get().DeleteDirectory(*CacheDir, false, true);
+
+	const FString Key = FSUDSImportCache::MakeKey(FSUDSScriptImporter::CalculateHash(GetData(ImportCacheInput), ImportCacheInput.Len()), "/Game/Test");
+	TestNotEqual("Key should depend on package path", Key, FSUDSImportCache::MakeKey(FSUDSScriptImporter::CalculateHash(GetData(ImportCacheInput), ImportCacheInput.Len()), "/Game/Other"));
+
+	FSUDSScriptImporter CachedImporter;
+	FSUDSMessageLogger CachedLogger(false);
+	TestFalse("Should not load before saving", FSUDSImportCache::Load(CacheDir, Key, CachedImporter, &CachedLogger));
+	TestTrue("Should save", FSUDSImportCache::Save(CacheDir, Key, Importer, &Logger));
+	TestTrue("Should load", FSUDSImportCache::Load(CacheDir, Key, CachedImporter, &CachedLogger));
+	TestEqual("Messages should be restored", CachedLogger.GetErrorMessages().Num(), 1);
+
+	// Parsed nodes should be identical
+	for (int i = 0; ; ++i)
+	{
+		auto Node = Importer.GetNode(i);
+		auto CachedNode = CachedImporter.GetNode(i);
+		if (!Node)
+		{
+			TestNull("Should be no extra cached nodes", CachedNode);
+			break;
+		}
+		if (!TestNotNull("Cached node", CachedNode))
+		{
+			break;
+		}
+		TestEqual("Node type", CachedNode->NodeType, Node->NodeType);
+		TestEqual("Node identifier", CachedNode->Identifier, Node->Identifier);
+		TestEqual("Node text", CachedNode->Text, Node->Text);
+		TestEqual("Node text ID", CachedNode->TextID, Node->TextID);
+		TestEqual("Node expression", CachedNode->Expression.GetSourceString(), Node->Expression.GetSourceString());
+		TestEqual("Node event args", CachedNode->EventArgs.Num(), Node->EventArgs.Num());
+		if (TestEqual("Node edges", CachedNode->Edges.Num(), Node->Edges.Num()))
+		{
+			for (int e = 0; e < Node->Edges.Num(); ++e)
+			{
+				TestEqual("Edge target", CachedNode->Edges[e].TargetNodeIdx, Node->Edges[e].TargetNodeIdx);
+				TestEqual("Edge text", CachedNode->Edges[e].Text, Node->Edges[e].Text);
+				TestEqual("Edge condition", CachedNode->Edges[e].ConditionExpression.GetSourceString(), Node->Edges[e].ConditionExpression.GetSourceString());
+			}
+		}
+	}
+	TestEqual("Goto labels", CachedImporter.GetGotoTargetNodeIndex("sub1"), Importer.GetGotoTargetNodeIndex("sub1"));
+
+	// And the cached version should run
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	CachedImporter.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->Start();
+	TestDialogueText(this, "Start", Dlg, "NPC", "Hello Bob");
+	TestEqual("Choices", Dlg->GetNumberOfChoices(), 2);
+	TestTrue("Choose", Dlg->Choose(0));
+	TestDialogueText(this, "Choice", Dlg, "Player", "Hi");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Condition", Dlg, "NPC", "Nice to meet you");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Gosub", Dlg, "NPC", "In sub");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Return", Dlg, "NPC", "Bye");
+
+	IFileManager::Get().DeleteDirectory(*CacheDir, false, true);
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
@@ -0,0 +1,137 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "SUDSScriptNodeText.h"
+#include "TestUtils.h"
+#include "Internationalization/StringTable.h"
+#include "Internationalization/StringTableCore.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString IncrementalImportInputBefore = R"RAWSUD(
+:a
+NPC: Line A1
+NPC: Line A2
+:b
+NPC: Line B1
+  * Choice B
+    NPC: After choice
+:c
+NPC: Line C1
+)RAWSUD";
+
+const FString IncrementalImportInputAfter = R"RAWSUD(
+:a
+NPC: Line A1
+NPC: Line A2
+:b
+NPC: Line B1 edited
+  * Choice B
+    NPC: After choice
+:c
+NPC: Line C1
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestIncrementalImport,
+								 "SUDSTest.TestIncrementalImport",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestIncrementalImport::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(IncrementalImportInputBefore), IncrementalImportInputBefore.Len(), "IncrementalImportInputBefore", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+	const TArray<USUDSScriptNode*> NodesBefore = Script->GetNodes();
+	if (!TestEqual("Nodes before", NodesBefore.Num(), 6))
+	{
+		return false;
+	}
+	TestEqual("Section hashes", Script->NodeSectionHashes.Num(), NodesBefore.Num());
+
+	// Re-import over the top, like a reimport does
+	FSUDSScriptImporter ReImporter;
+	TestTrue("Re-import should succeed", ReImporter.ImportFromBuffer(GetData(IncrementalImportInputAfter), IncrementalImportInputAfter.Len(), "IncrementalImportInputAfter", &Logger, true));
+	const FSUDSPreviousImport Previous(Script);
+	Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	ReImporter.PopulateAsset(Script, StringTableHolder.StringTable, &Previous);
+	const TArray<USUDSScriptNode*>& NodesAfter = Script->GetNodes();
+	if (!TestEqual("Nodes after", NodesAfter.Num(), 6))
+	{
+		return false;
+	}
+
+	// Sections a & c are unchanged, b was edited
+	TestTrue("Section a node 0 should be re-used", NodesAfter[0] == NodesBefore[0]);
+	TestTrue("Section a node 1 should be re-used", NodesAfter[1] == NodesBefore[1]);
+	TestTrue("Section b node 0 should be new", NodesAfter[2] != NodesBefore[2]);
+	TestTrue("Section b node 1 should be new", NodesAfter[3] != NodesBefore[3]);
+	TestTrue("Section b node 2 should be new", NodesAfter[4] != NodesBefore[4]);
+	TestTrue("Section c node 0 should be re-used", NodesAfter[5] == NodesBefore[5]);
+
+	if (auto TextNode = Cast<USUDSScriptNodeText>(NodesAfter[2]))
+	{
+		FString SourceString;
+		TestTrue("String table entry", StringTableHolder.StringTable->GetStringTable()->GetSourceString(TextNode->GetTextID(), SourceString));
+		TestEqual("String table should be updated", SourceString, "Line B1 edited");
+	}
+
+	// Edges across the section boundaries must point at the new nodes
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->Start();
+	TestDialogueText(this, "A1", Dlg, "NPC", "Line A1");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "A2", Dlg, "NPC", "Line A2");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "B1", Dlg, "NPC", "Line B1 edited");
+	TestEqual("Choices", Dlg->GetNumberOfChoices(), 1);
+	TestTrue("Choose", Dlg->Choose(0));
+	TestDialogueText(this, "After choice", Dlg, "NPC", "After choice");
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "C1", Dlg, "NPC", "Line C1");
+	TestFalse("Continue", Dlg->Continue());
+
+	// Re-import into a new string table, e.g. after moving it to its own package; unchanged sections must still
+	// fill it in
+	UStringTable* NewStringTable = NewObject<UStringTable>(GetTransientPackage(), "TestStringsNew");
+	const FSUDSPreviousImport PreviousForNewTable(Script);
+	Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	ReImporter.PopulateAsset(Script, NewStringTable, &PreviousForNewTable);
+	TestTrue("Nodes should all be re-used", Script->GetNodes() == NodesAfter);
+	for (const USUDSScriptNode* Node : Script->GetNodes())
+	{
+		if (auto TextNode = Cast<USUDSScriptNodeText>(Node))
+		{
+			FString SourceString;
+			TestTrue("New string table entry", NewStringTable->GetStringTable()->GetSourceString(TextNode->GetTextID(), SourceString));
+			TestEqual("New string table speaker", NewStringTable->GetStringTable()->GetMetaData(TextNode->GetTextID(), "Speaker"), "NPC");
+		}
+		for (auto& Edge : Node->GetEdges())
+		{
+			if (!Edge.GetText().IsEmpty())
+			{
+				FString SourceString;
+				TestTrue("New string table choice entry", NewStringTable->GetStringTable()->GetSourceString(Edge.GetTextID(), SourceString));
+				TestEqual("New string table choice text", SourceString, "Choice B");
+			}
+		}
+	}
+	auto NewTableDlg = USUDSLibrary::CreateDialogue(Script, Script);
+	NewTableDlg->Start();
+	TestDialogueText(this, "A1 from new table", NewTableDlg, "NPC", "Line A1");
+	FStringTableRegistry::Get().UnregisterStringTable(NewStringTable->GetStringTableId());
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
@@ -0,0 +1,152 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "TestParticipant.h"
+#include "TestUtils.h"
+#include "Internationalization/Internationalization.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString NativeParticipantInput = R"RAWSUD(
+Player: Hello, I'm {SpeakerName.Player}
+[set IntVar 2]
+[event SomethingHappened]
+NPC: Greetings, {SpeakerName.Player}, my name is {SpeakerName.NPC}
+NPC: You have {NumCats} {NumCats}|plural(one=cat,other=cats)
+	* Goodbye
+		Player: Bye
+	* Later
+		Player: See you later
+)RAWSUD";
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestNativeParticipant,
+								 "SUDSTest.TestNativeParticipant",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+
+bool FTestNativeParticipant::RunTest(const FString& Parameters)
+{
+	// Plural formatting is locale-specific
+	FInternationalization::FCultureStateSnapshot CultureStateSnapshot;
+	FInternationalization::Get().BackupCultureState(CultureStateSnapshot);
+	FInternationalization::Get().SetCurrentCulture(TEXT("en-US"));
+	ON_SCOPE_EXIT
+	{
+		FInternationalization::Get().RestoreCultureState(CultureStateSnapshot);
+	};
+
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(NativeParticipantInput), NativeParticipantInput.Len(), "NativeParticipantInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	// Mix native & reflected participants, priority ordering should apply across both
+	auto Native1 = NewObject<UTestNativeParticipant>();
+	Native1->TestNumber = 1; // priority 200
+	auto Native0 = NewObject<UTestNativeParticipant>();
+	Native0->TestNumber = 0; // priority 0
+	auto Reflected = NewObject<UTestParticipant>();
+	Reflected->TestNumber = 1; // priority 100
+	Dlg->AddParticipant(Native1);
+	Dlg->AddParticipant(Reflected);
+	Dlg->AddParticipant(Native0);
+
+	if (TestEqual("Num participants", Dlg->GetParticipants().Num(), 3))
+	{
+		TestEqual("Participant order 0", Dlg->GetParticipants()[0], (UObject*)Native0);
+		TestEqual("Participant order 1", Dlg->GetParticipants()[1], (UObject*)Reflected);
+		TestEqual("Participant order 2", Dlg->GetParticipants()[2], (UObject*)Native1);
+	}
+	
+	Dlg->Start();
+
+	// Native1 overrides the player name, Reflected overrides the rest of Native0
+	TestDialogueText(this, "Line 1", Dlg, "Player", "Hello, I'm Native Hero");
+	Dlg->Continue();
+	TestDialogueText(this, "Line 2", Dlg, "NPC", "Greetings, Native Hero, my name is Bob The NPC");
+	Dlg->Continue();
+	TestDialogueText(this, "Line 3", Dlg, "NPC", "You have 5 cats");
+
+	TestTrue("Native should have been told about set", Native0->SetVarNames.Contains("IntVar"));
+	if (TestEqual("Native event count", Native0->EventNames.Num(), 1))
+	{
+		TestEqual("Native event name", Native0->EventNames[0], FName("SomethingHappened"));
+	}
+	// Reflected participant should still be called as before
+	TestEqual("Reflected event count", Reflected->EventRecords.Num(), 1);
+	TestTrue("Native should have had variables requested", Native0->VariableRequestedCount > 0);
+	TestEqual("Variable requests should match", Native0->VariableRequestedCount, Reflected->VariableRequestedCount);
+
+	Dlg->Choose(0);
+	TestDialogueText(this, "Line 4", Dlg, "Player", "Bye");
+	Dlg->Continue();
+	TestTrue("Should be ended", Dlg->IsEnded());
+
+	TestEqual("Native speaker lines", Native0->SpeakerLineCount, 4);
+	TestEqual("Native choices made", Native0->ChoiceMadeCount, 1);
+	TestEqual("Native proceeding", Native0->ProceedingCount, 4);
+	TestTrue("Native finished", Native0->bFinished);
+	
+	Script->MarkAsGarbage();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestNativeParticipantBenchmark,
+								 "SUDSTest.TestNativeParticipantBenchmark",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+
+bool FTestNativeParticipantBenchmark::RunTest(const FString& Parameters)
+{
+	constexpr int NumDispatches = 1000000;
+	const FName VarName("SomeVariable");
+
+	auto NativeDlg = NewObject<UTestDispatchDialogue>(GetTransientPackage());
+	auto Native = NewObject<UTestNativeParticipant>();
+	NativeDlg->AddParticipant(Native);
+
+	auto ReflectedDlg = NewObject<UTestDispatchDialogue>(GetTransientPackage());
+	auto Reflected = NewObject<UTestParticipant>();
+	ReflectedDlg->AddParticipant(Reflected);
+
+	const double NativeStart = FPlatformTime::Seconds();
+	for (int i = 0; i < NumDispatches; ++i)
+	{
+		NativeDlg->TestRaiseVariableRequested(VarName);
+	}
+	const double NativeTime = FPlatformTime::Seconds() - NativeStart;
+
+	const double ReflectedStart = FPlatformTime::Seconds();
+	for (int i = 0; i < NumDispatches; ++i)
+	{
+		ReflectedDlg->TestRaiseVariableRequested(VarName);
+	}
+	const double ReflectedTime = FPlatformTime::Seconds() - ReflectedStart;
+
+	AddInfo(FString::Printf(TEXT("%d variable requested dispatches: native %.2fms, reflected %.2fms"),
+	                        NumDispatches,
+	                        NativeTime * 1000.0,
+	                        ReflectedTime * 1000.0));
+	TestEqual("Native dispatch count", Native->VariableRequestedCount, NumDispatches);
+	TestEqual("Reflected dispatch count", Reflected->VariableRequestedCount, NumDispatches);
+
+	NativeDlg->MarkAsGarbage();
+	ReflectedDlg->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
@@ -981,4 +981,277 @@ bool FTestTrailingEventProblem::RunTest(const FString& Parameters)
 	return true;
 }
 
+const FString LineClassificationInput = R"RAWSUD(
+#= Key: Some meta: with colons
+NPC: See http://example.com for details
+Player: Hello @12@
+[set Name = "a, b"]
+[set Other   5]
+[event Some.Event "a, b", 2,  {Other} ]
+[go to mylabel]
+:mylabel
+[go sub sub1]
+[goto end]
+: sub1
+NPC: In sub
+[return ]
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLineClassification,
+								 "SUDSTest.TestLineClassification",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestLineClassification::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(LineClassificationInput), LineClassificationInput.Len(), "LineClassificationInput", &Logger, true));
+
+	auto Node = Importer.GetNode(0);
+	if (TestParsedText(this, "Text with URL", Node, "NPC", "See http://example.com for details"))
+	{
+		// Key is up to the last colon in the first word
+		const FString* Meta = Node->TextMetadata.Find("Key");
+		if (TestNotNull("Metadata key", Meta))
+		{
+			TestEqual("Metadata value", *Meta, "Some meta: with colons");
+		}
+	}
+	Node = Importer.GetNode(1);
+	if (TestParsedText(this, "Text with ID", Node, "Player", "Hello"))
+	{
+		TestEqual("Text ID", Node->TextID, "@12@");
+	}
+	Node = Importer.GetNode(2);
+	if (TestNotNull("Set with equals", Node))
+	{
+		TestEqual("Set with equals type", Node->NodeType, ESUDSParsedNodeType::SetVariable);
+		TestEqual("Set with equals name", Node->Identifier, "Name");
+		TestTrue("Set with equals literal", Node->Expression.IsTextLiteral());
+		TestEqual("Set with equals value", Node->Expression.GetTextLiteralValue().ToString(), "a, b");
+	}
+	Node = Importer.GetNode(3);
+	if (TestNotNull("Set with spaces", Node))
+	{
+		TestEqual("Set with spaces type", Node->NodeType, ESUDSParsedNodeType::SetVariable);
+		TestEqual("Set with spaces name", Node->Identifier, "Other");
+		TestEqual("Set with spaces value", Node->Expression.GetIntLiteralValue(), 5);
+	}
+	Node = Importer.GetNode(4);
+	if (TestNotNull("Event", Node))
+	{
+		TestEqual("Event type", Node->NodeType, ESUDSParsedNodeType::Event);
+		TestEqual("Event name", Node->Identifier, "Some.Event");
+		if (TestEqual("Event args", Node->EventArgs.Num(), 3))
+		{
+			TestEqual("Event arg 0", Node->EventArgs[0].GetTextLiteralValue().ToString(), "a, b");
+			TestEqual("Event arg 1", Node->EventArgs[1].GetIntLiteralValue(), 2);
+			TestFalse("Event arg 2", Node->EventArgs[2].IsLiteral());
+		}
+	}
+	Node = Importer.GetNode(5);
+	if (TestNotNull("Go to", Node))
+	{
+		TestEqual("Go to type", Node->NodeType, ESUDSParsedNodeType::Goto);
+		TestEqual("Go to label", Node->Identifier, "mylabel");
+	}
+	Node = Importer.GetNode(6);
+	if (TestNotNull("Go sub", Node))
+	{
+		TestEqual("Go sub type", Node->NodeType, ESUDSParsedNodeType::Gosub);
+		TestEqual("Go sub label", Node->Identifier, "sub1");
+	}
+	Node = Importer.GetNode(7);
+	if (TestNotNull("Goto end", Node))
+	{
+		TestEqual("Goto end type", Node->NodeType, ESUDSParsedNodeType::Goto);
+		TestEqual("Goto end label", Node->Identifier, "end");
+	}
+	TestParsedText(this, "Text in sub", Importer.GetNode(8), "NPC", "In sub");
+	Node = Importer.GetNode(9);
+	if (TestNotNull("Return", Node))
+	{
+		TestEqual("Return type", Node->NodeType, ESUDSParsedNodeType::Return);
+	}
+	
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestImportBenchmark,
+								 "SUDSTest.TestImportBenchmark",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+bool FTestImportBenchmark::RunTest(const FString& Parameters)
+{
+	// Generate a large script which uses every kind of line
+	constexpr int TargetLines = 100000;
+	FString Script;
+	int NumLines = 0;
+	for (int Block = 0; NumLines < TargetLines; ++Block)
+	{
+		Script.Appendf(TEXT(":block%d\n"), Block);
+		Script.Appendf(TEXT("#= Comment: Block %d\n"), Block);
+		Script.Appendf(TEXT("NPC: Hello, this is block %d and the count is {Count}\n"), Block);
+		Script.Append(TEXT("Player: A reply\n"));
+		Script.Append(TEXT("    which continues on another line\n"));
+		Script.Append(TEXT("[set Count = {Count} + 1]\n"));
+		Script.Append(TEXT("[if {Count} > 2]\n"));
+		Script.Append(TEXT("    NPC: That's quite a lot\n"));
+		Script.Append(TEXT("[elseif {Count} == 1]\n"));
+		Script.Append(TEXT("    NPC: Just the one\n"));
+		Script.Append(TEXT("[else]\n"));
+		Script.Append(TEXT("    NPC: Not many\n"));
+		Script.Append(TEXT("[endif]\n"));
+		Script.Appendf(TEXT("[event Block.Done %d, \"some text\", {Count}]\n"), Block);
+		Script.Append(TEXT("[random]\n"));
+		Script.Append(TEXT("    NPC: Random one\n"));
+		Script.Append(TEXT("[or]\n"));
+		Script.Append(TEXT("    NPC: Random two\n"));
+		Script.Append(TEXT("[endrandom]\n"));
+		Script.Append(TEXT("* First choice\n"));
+		Script.Append(TEXT("    Player: I chose the first\n"));
+		Script.Appendf(TEXT("    [goto block%d]\n"), Block + 1);
+		Script.Append(TEXT("* Second choice\n"));
+		Script.Append(TEXT("    Player: I chose the second\n"));
+		Script.Append(TEXT("\n"));
+		NumLines += 25;
+	}
+	Script.Appendf(TEXT(":block%d\n"), NumLines / 25);
+	Script.Append(TEXT("NPC: The end\n"));
+	NumLines += 2;
+
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	const double Start = FPlatformTime::Seconds();
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(Script), Script.Len(), "ImportBenchmark", &Logger, true));
+	const double Time = FPlatformTime::Seconds() - Start;
+
+	AddInfo(FString::Printf(TEXT("Imported %d lines in %.2fms (%.0f lines/sec)"),
+	                        NumLines,
+	                        Time * 1000.0,
+	                        Time > 0 ? NumLines / Time : 0.0));
+	
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestImportScaling,
+								 "SUDSTest.TestImportScaling",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+bool FTestImportScaling::RunTest(const FString& Parameters)
+{
+	// One long list of choices with nested choices & conditionals, all of which fall through to the end. Resolving
+	// fallthroughs & choices used to be quadratic in the length of the list, it should now be linear
+	auto GenerateScript = [](int NumChoices)
+	{
+		FString Script;
+		Script.Append(TEXT("NPC: Pick one\n"));
+		for (int i = 0; i < NumChoices; ++i)
+		{
+			Script.Appendf(TEXT("* Choice %d\n"), i);
+			Script.Appendf(TEXT("    NPC: You picked %d\n"), i);
+			Script.Appendf(TEXT("    [if {Count} > %d]\n"), i);
+			Script.Append(TEXT("        Player: That's a lot\n"));
+			Script.Append(TEXT("    [endif]\n"));
+			Script.Append(TEXT("    * Nested A\n"));
+			Script.Append(TEXT("        NPC: Nested A\n"));
+			Script.Append(TEXT("    * Nested B\n"));
+			Script.Append(TEXT("        [set Count = {Count} + 1]\n"));
+		}
+		Script.Append(TEXT("NPC: After\n"));
+		return Script;
+	};
+	auto TimeImport = [this](const FString& Script, int64& OutSearchSteps)
+	{
+		FSUDSMessageLogger Logger(false);
+		FSUDSScriptImporter Importer;
+		const double Start = FPlatformTime::Seconds();
+		TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(Script), Script.Len(), "ImportScaling", &Logger, true));
+		OutSearchSteps = Importer.Test_ImportSearchSteps;
+		return FPlatformTime::Seconds() - Start;
+	};
+
+	constexpr int SmallSize = 2000;
+	constexpr int ScaleFactor = 4;
+	const FString SmallScript = GenerateScript(SmallSize);
+	const FString LargeScript = GenerateScript(SmallSize * ScaleFactor);
+	int64 SmallSteps = 0;
+	int64 LargeSteps = 0;
+	// Warm up so the first timing doesn't include one-off costs
+	TimeImport(SmallScript, SmallSteps);
+	const double SmallTime = TimeImport(SmallScript, SmallSteps);
+	const double LargeTime = TimeImport(LargeScript, LargeSteps);
+	const double Ratio = SmallTime > 0 ? LargeTime / SmallTime : 0;
+	const double StepsRatio = SmallSteps > 0 ? static_cast<double>(LargeSteps) / SmallSteps : 0;
+
+	AddInfo(FString::Printf(TEXT("%d choices: %.2fms, %d choices: %.2fms, ratio %.2f (linear is %d)"),
+	                        SmallSize,
+	                        SmallTime * 1000.0,
+	                        SmallSize * ScaleFactor,
+	                        LargeTime * 1000.0,
+	                        Ratio,
+	                        ScaleFactor));
+	// Timings are too noisy to test, but the number of nodes examined isn't. Quadratic would be 16x
+	TestTrue("Nodes should be examined", SmallSteps > 0);
+	TestTrue("Nodes examined should scale linearly", StepsRatio <= ScaleFactor * 1.1);
+	
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestImportFromFile,
+								 "SUDSTest.TestImportFromFile",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestImportFromFile::RunTest(const FString& Parameters)
+{
+	// Mixed line endings and non-ASCII text, which must come out the same as importing from a string
+	const FString Contents = TEXT("NPC: Hello there\r\nPlayer: Café crème\r* Choice ümlaut\n    NPC: Done\r\n\r\n[goto end]");
+	const FString Filename = FPaths::ProjectIntermediateDir() / TEXT("SUDSTest") / TEXT("ImportFromFile.sud");
+
+	for (const auto Encoding : { FFileHelper::EEncodingOptions::ForceUTF8, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, FFileHelper::EEncodingOptions::ForceUnicode })
+	{
+		TestTrue("Should write file", FFileHelper::SaveStringToFile(Contents, *Filename, Encoding));
+
+		FSUDSMessageLogger Logger(false);
+		FSUDSScriptImporter FileImporter;
+		FMD5Hash Hash;
+		TestTrue("File import should succeed", FileImporter.ImportFromFile(Filename, "ImportFromFile", &Logger, true, &Hash));
+		TestEqual("Hash should match file", LexToString(Hash), LexToString(FMD5Hash::HashFile(*Filename)));
+
+		FSUDSScriptImporter BufferImporter;
+		TestTrue("Buffer import should succeed", BufferImporter.ImportFromBuffer(GetData(Contents), Contents.Len(), "ImportFromFile", &Logger, true));
+
+		TestParsedText(this, "First line", FileImporter.GetNode(0), "NPC", "Hello there");
+		TestParsedText(this, "Non-ASCII line", FileImporter.GetNode(1), "Player", TEXT("Café crème"));
+		for (int i = 0; i < 5; ++i)
+		{
+			auto FileNode = FileImporter.GetNode(i);
+			auto BufferNode = BufferImporter.GetNode(i);
+			if (TestNotNull("File node", FileNode) && TestNotNull("Buffer node", BufferNode))
+			{
+				TestEqual("Node types should match", FileNode->NodeType, BufferNode->NodeType);
+				TestEqual("Node text should match", FileNode->Text, BufferNode->Text);
+				TestEqual("Node line numbers should match", FileNode->SourceLineNo, BufferNode->SourceLineNo);
+				TestEqual("Node edges should match", FileNode->Edges.Num(), BufferNode->Edges.Num());
+			}
+		}
+	}
+
+	IFileManager::Get().Delete(*Filename);
+	
+	return true;
+}
+
 UE_ENABLE_OPTIMIZATION
\ No newline at end of file
@@ -66,3 +66,120 @@ void UTestParticipant::OnDialogueVariableChanged_Implementation(USUDSDialogue* D
 	SetVarRecords.Add(FSetVarRecord { VariableName, Value, bFromScript });
 }
 
+void UTestParticipant::OnDialogueVariableRequested_Implementation(USUDSDialogue* Dialogue, FName VariableName)
+{
+	++VariableRequestedCount;
+}
+
+void UTestNativeParticipant::OnDialogueStarting(USUDSDialogue* Dialogue, FName AtLabel)
+{
+	switch(TestNumber)
+	{
+	default:
+	case 0:
+		Dialogue->SetVariable("SpeakerName.Player", FText::FromString("Protagonist"));
+		Dialogue->SetVariable("SpeakerName.NPC", FText::FromString("An NPC"));
+		Dialogue->SetVariable("NumCats", 3);
+		break;
+	case 1:
+		// Overrides the reflected participant at priority 100
+		Dialogue->SetVariable("SpeakerName.Player", FText::FromString("Native Hero"));
+		break;
+	}
+}
+
+void UTestNativeParticipant::OnDialogueFinished(USUDSDialogue* Dialogue)
+{
+	bFinished = true;
+}
+
+void UTestNativeParticipant::OnDialogueSpeakerLine(USUDSDialogue* Dialogue)
+{
+	++SpeakerLineCount;
+}
+
+void UTestNativeParticipant::OnDialogueChoiceMade(USUDSDialogue* Dialogue, int ChoiceIndex)
+{
+	++ChoiceMadeCount;
+}
+
+void UTestNativeParticipant::OnDialogueProceeding(USUDSDialogue* Dialogue)
+{
+	++ProceedingCount;
+}
+
+void UTestNativeParticipant::OnDialogueEvent(USUDSDialogue* Dialogue,
+	FName EventName,
+	const TArray<FSUDSValue>& Arguments)
+{
+	EventNames.Add(EventName);
+}
+
+void UTestNativeParticipant::OnDialogueVariableChanged(USUDSDialogue* Dialogue,
+	FName VariableName,
+	const FSUDSValue& Value,
+	bool bFromScript)
+{
+	SetVarNames.Add(VariableName);
+}
+
+void UTestNativeParticipant::OnDialogueVariableRequested(USUDSDialogue* Dialogue, FName VariableName)
+{
+	++VariableRequestedCount;
+}
+
+int UTestNativeParticipant::GetDialogueParticipantPriority() const
+{
+	switch(TestNumber)
+	{
+	default:
+	case 0:
+		return 0;
+	case 1:
+		return 200;
+	}
+}
+
+void UTestBatchParticipant::OnDialogueVariableRequested_Implementation(USUDSDialogue* Dialogue, FName VariableName)
+{
+	++VariableRequestedCount;
+}
+
+void UTestBatchParticipant::OnDialogueVariablesRequested_Implementation(USUDSDialogue* Dialogue, const TArray<FName>& VariableNames)
+{
+	Batches.Add(VariableNames);
+	for (const FName& Name : VariableNames)
+	{
+		if (const FSUDSValue* Value = Values.Find(Name))
+		{
+			Dialogue->SetVariable(Name, *Value);
+		}
+	}
+}
+
+void UTestAsyncProvider::FulfilAll()
+{
+	// Fulfilling can resume the dialogue, which may request more
+	TMap<FName, TPromise<FSUDSValue>> ToFulfil = MoveTemp(Promises);
+	Promises.Reset();
+	for (auto& Pair : ToFulfil)
+	{
+		Pair.Value.SetValue(Values.FindRef(Pair.Key));
+	}
+}
+
+bool UTestAsyncProvider::ProvidesDialogueVariableAsync_Implementation(USUDSDialogue* Dialogue, FName VariableName)
+{
+	QueriedNames.Add(VariableName);
+	return Values.Contains(VariableName);
+}
+
+TFuture<FSUDSValue> UTestAsyncProvider::RequestDialogueVariableAsync(USUDSDialogue* Dialogue, FName VariableName)
+{
+	RequestedNames.Add(VariableName);
+	if (bCompleteImmediately)
+	{
+		return MakeFulfilledPromise<FSUDSValue>(Values.FindRef(VariableName)).GetFuture();
+	}
+	return Promises.Add(VariableName).GetFuture();
+}
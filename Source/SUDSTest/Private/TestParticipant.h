@@ -1,6 +1,9 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
+#include "SUDSAsyncVariableProvider.h"
+#include "SUDSDialogue.h"
+#include "SUDSNativeParticipant.h"
 #include "SUDSParticipant.h"
 #include "SUDSValue.h"
 #include "UObject/Object.h"
@@ -31,6 +34,7 @@ public:
 
 	TArray<FEventRecord> EventRecords;
 	TArray<FSetVarRecord> SetVarRecords;
+	int VariableRequestedCount = 0;
 
 	
 	virtual void OnDialogueStarting_Implementation(USUDSDialogue* Dialogue, FName AtLabel) override;
@@ -42,4 +46,85 @@ public:
 		FName VariableName,
 		const FSUDSValue& Value,
 		bool bFromScript) override;
+	virtual void OnDialogueVariableRequested_Implementation(USUDSDialogue* Dialogue, FName VariableName) override;
+};
+
+/**
+ * Same as UTestParticipant but using the native interface
+ */
+UCLASS()
+class SUDSTEST_API UTestNativeParticipant : public UObject, public ISUDSNativeParticipant
+{
+	GENERATED_BODY()
+
+public:
+	int TestNumber = 0;
+
+	TArray<FName> EventNames;
+	TArray<FName> SetVarNames;
+	int VariableRequestedCount = 0;
+	int SpeakerLineCount = 0;
+	int ChoiceMadeCount = 0;
+	int ProceedingCount = 0;
+	bool bFinished = false;
+
+	virtual void OnDialogueStarting(USUDSDialogue* Dialogue, FName AtLabel) override;
+	virtual void OnDialogueFinished(USUDSDialogue* Dialogue) override;
+	virtual void OnDialogueSpeakerLine(USUDSDialogue* Dialogue) override;
+	virtual void OnDialogueChoiceMade(USUDSDialogue* Dialogue, int ChoiceIndex) override;
+	virtual void OnDialogueProceeding(USUDSDialogue* Dialogue) override;
+	virtual void OnDialogueEvent(USUDSDialogue* Dialogue, FName EventName, const TArray<FSUDSValue>& Arguments) override;
+	virtual void OnDialogueVariableChanged(USUDSDialogue* Dialogue, FName VariableName, const FSUDSValue& Value, bool bFromScript) override;
+	virtual void OnDialogueVariableRequested(USUDSDialogue* Dialogue, FName VariableName) override;
+	virtual int GetDialogueParticipantPriority() const override;
+};
+
+/**
+ * Participant which supplies variables in batches, recording each batch
+ */
+UCLASS()
+class SUDSTEST_API UTestBatchParticipant : public UObject, public ISUDSParticipant
+{
+	GENERATED_BODY()
+
+public:
+	TMap<FName, FSUDSValue> Values;
+	TArray<TArray<FName>> Batches;
+	int VariableRequestedCount = 0;
+
+	virtual void OnDialogueVariableRequested_Implementation(USUDSDialogue* Dialogue, FName VariableName) override;
+	virtual void OnDialogueVariablesRequested_Implementation(USUDSDialogue* Dialogue, const TArray<FName>& VariableNames) override;
+};
+
+/**
+ * Async variable provider which holds on to requests until told to fulfil them
+ */
+UCLASS()
+class SUDSTEST_API UTestAsyncProvider : public UObject, public ISUDSAsyncVariableProvider
+{
+	GENERATED_BODY()
+
+public:
+	TMap<FName, FSUDSValue> Values;
+	TArray<FName> RequestedNames;
+	TArray<FName> QueriedNames;
+	bool bCompleteImmediately = false;
+	TMap<FName, TPromise<FSUDSValue>> Promises;
+
+	void FulfilAll();
+
+	virtual bool ProvidesDialogueVariableAsync_Implementation(USUDSDialogue* Dialogue, FName VariableName) override;
+	virtual TFuture<FSUDSValue> RequestDialogueVariableAsync(USUDSDialogue* Dialogue, FName VariableName) override;
+};
+
+/**
+ * Dialogue subclass which lets benchmarks drive participant dispatch directly
+ */
+UCLASS()
+class SUDSTEST_API UTestDispatchDialogue : public USUDSDialogue
+{
+	GENERATED_BODY()
+
+public:
+	void TestRaiseVariableRequested(FName VarName) { RaiseVariableRequested(VarName, 0); }
 };
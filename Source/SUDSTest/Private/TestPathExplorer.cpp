@@ -0,0 +1,184 @@
+﻿#include "SUDSMessageLogger.h"
+#include "SUDSPathExplorer.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString PathExplorerInput = R"RAWSUD(
+===
+[set Bought false]
+===
+NPC: Hello
+[random]
+    NPC: Heads
+[or]
+    NPC: Tails
+[endrandom]
+:shop
+NPC: Buy something?
+    * Buy
+        [set Bought true]
+        [goto shop]
+    * Leave
+        NPC: Bye
+[if {Secret}]
+    * Secret
+        NPC: Never heard
+[endif]
+[goto end]
+NPC: Nobody will hear this
+:broken
+NPC: Going back
+[return]
+)RAWSUD";
+
+const FString PathExplorerLoopInput = R"RAWSUD(
+:top
+NPC: Round and round
+    * Again
+        [goto top]
+    * And again
+        [goto top]
+)RAWSUD";
+
+const FString PathExplorerGameVariablesInput = R"RAWSUD(
+===
+[set Mood 0]
+===
+NPC: Hi
+[if {Trusted}]
+    NPC: Psst
+[elseif {Bribe} > 10]
+    NPC: Fine then
+[else]
+    NPC: Go away
+[endif]
+[if {Mood} > 5]
+    NPC: Cheerful
+[endif]
+[set Seen true]
+[set Copy {Trusted}]
+[if {Seen}]
+    NPC: Seen you
+[else]
+    NPC: Never shown
+[endif]
+[if {Copy}]
+    NPC: Copied
+[endif]
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestPathExplorer,
+								 "SUDSTest.TestPathExplorer",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestPathExplorer::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(PathExplorerInput), PathExplorerInput.Len(), "PathExplorerInput", &Logger, true));
+	FSUDSScriptImporter LoopImporter;
+	TestTrue("Import should succeed", LoopImporter.ImportFromBuffer(GetData(PathExplorerLoopInput), PathExplorerLoopInput.Len(), "PathExplorerLoopInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+	auto LoopScript = NewObject<USUDSScript>(GetTransientPackage(), "TestLoop");
+	const ScopedStringTableHolder LoopStringTableHolder;
+	LoopImporter.PopulateAsset(LoopScript, LoopStringTableHolder.StringTable);
+
+	FSUDSPathExplorer Explorer;
+	Explorer.NumWorkers = 4;
+	TArray<FSUDSExploreResult> Results;
+	Explorer.Explore({ Script, LoopScript }, Results);
+	if (TestEqual("Results", Results.Num(), 2))
+	{
+		const FSUDSExploreResult& Result = Results[0];
+		// Start, :shop and :broken
+		TestEqual("Start points", Result.NumStartPoints, 3);
+		// Heads & Tails lead to the same state, buying twice is the same as buying once
+		TestEqual("States", Result.NumStates, 10ll);
+		TestFalse("Truncated", Result.bTruncated);
+		TestEqual("Speaker lines", Result.NumSpeakerLines, 8);
+		if (TestEqual("Unreached speaker lines", Result.UnreachedSpeakerLines.Num(), 1))
+		{
+			TestEqual("Unreached line", Result.UnreachedSpeakerLines[0], 23);
+		}
+		TestEqual("Choices", Result.NumChoices, 3);
+		// Nothing sets {Secret}, so the game might
+		TestEqual("Unreached choices", Result.UnreachedChoices.Num(), 0);
+		if (TestEqual("Dead ends", Result.DeadEnds.Num(), 1))
+		{
+			TestEqual("Dead end line", Result.DeadEnds[0].SourceLineNo, 26);
+		}
+		TestEqual("Loops", Result.Loops.Num(), 0);
+		TestTrue("Has problems", Result.HasProblems());
+
+		const FSUDSExploreResult& LoopResult = Results[1];
+		TestEqual("Start points", LoopResult.NumStartPoints, 1);
+		// One state for each combination of choices taken
+		TestEqual("States", LoopResult.NumStates, 4ll);
+		TestEqual("Speaker line coverage", LoopResult.GetSpeakerLineCoverage(), 1.0f);
+		TestEqual("Choice coverage", LoopResult.GetChoiceCoverage(), 1.0f);
+		TestEqual("Dead ends", LoopResult.DeadEnds.Num(), 0);
+		if (TestEqual("Loops", LoopResult.Loops.Num(), 1))
+		{
+			TestEqual("Loop line", LoopResult.Loops[0].SourceLineNo, 3);
+		}
+	}
+
+	// Same answer on one thread
+	Explorer.NumWorkers = 1;
+	TArray<FSUDSExploreResult> SingleResults;
+	Explorer.Explore({ Script, LoopScript }, SingleResults);
+	if (TestEqual("Results", SingleResults.Num(), 2))
+	{
+		TestEqual("States", SingleResults[0].NumStates, Results[0].NumStates);
+		TestEqual("States", SingleResults[1].NumStates, Results[1].NumStates);
+	}
+
+	// Conditions on variables the game supplies, or whose header defaults it can override, could go either way, but
+	// variables set on the path are still followed
+	FSUDSScriptImporter GameVarsImporter;
+	TestTrue("Import should succeed", GameVarsImporter.ImportFromBuffer(GetData(PathExplorerGameVariablesInput), PathExplorerGameVariablesInput.Len(), "PathExplorerGameVariablesInput", &Logger, true));
+	auto GameVarsScript = NewObject<USUDSScript>(GetTransientPackage(), "TestGameVars");
+	const ScopedStringTableHolder GameVarsStringTableHolder;
+	GameVarsImporter.PopulateAsset(GameVarsScript, GameVarsStringTableHolder.StringTable);
+	Explorer.Explore({ GameVarsScript }, SingleResults);
+	if (TestEqual("Results", SingleResults.Num(), 1))
+	{
+		const FSUDSExploreResult& GameVarsResult = SingleResults[0];
+		// Hi, each of the 3 branches, then they all meet at the same state for each line after
+		TestEqual("States", GameVarsResult.NumStates, 7ll);
+		TestEqual("Speaker lines", GameVarsResult.NumSpeakerLines, 8);
+		// Cheerful is reached even though the header sets Mood to 0, and Copied though Copy was set from a game variable
+		if (TestEqual("Unreached speaker lines", GameVarsResult.UnreachedSpeakerLines.Num(), 1))
+		{
+			TestEqual("Unreached line", GameVarsResult.UnreachedSpeakerLines[0], 21);
+		}
+		TestEqual("Dead ends", GameVarsResult.DeadEnds.Num(), 0);
+		TestEqual("Loops", GameVarsResult.Loops.Num(), 0);
+	}
+
+	// Stopping early
+	Explorer.MaxStatesPerScript = 2;
+	Explorer.Explore({ LoopScript }, SingleResults);
+	if (TestEqual("Results", SingleResults.Num(), 1))
+	{
+		TestTrue("Truncated", SingleResults[0].bTruncated);
+		TestEqual("No loops reported when truncated", SingleResults[0].Loops.Num(), 0);
+	}
+
+	Script->MarkAsGarbage();
+	LoopScript->MarkAsGarbage();
+	GameVarsScript->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
@@ -42,7 +42,7 @@ bool FTestRandomBasics::RunTest(const FString& Parameters)
     auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
 
     // Seed random so we have consistent results
-    FMath::SRandInit(34);
+    Dlg->SetRandomSeed(34);
     Dlg->Start();
 
     TestDialogueText(this, "Text node", Dlg, "Player", "Hello");
@@ -114,7 +114,7 @@ bool FTestRandomNested::RunTest(const FString& Parameters)
     auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
 
     // Seed random so we have consistent results
-    FMath::SRandInit(785);
+    Dlg->SetRandomSeed(785);
     Dlg->Start();
 
     TestDialogueText(this, "Text node", Dlg, "Player", "Hello");
@@ -194,7 +194,7 @@ bool FTestRandomSibling::RunTest(const FString& Parameters)
     auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
 
     // Seed random so we have consistent results
-    FMath::SRandInit(2376);
+    Dlg->SetRandomSeed(2376);
     Dlg->Start();
 
     TestDialogueText(this, "Text node", Dlg, "Player", "Hello");
@@ -292,7 +292,7 @@ bool FTestRandomMixed::RunTest(const FString& Parameters)
     auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
 
     // Seed random so we have consistent results
-    FMath::SRandInit(999);
+    Dlg->SetRandomSeed(999);
     Dlg->SetVariableInt("x", 5);
     Dlg->Start();
 
@@ -339,4 +339,65 @@ bool FTestRandomMixed::RunTest(const FString& Parameters)
     
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestRandomPerDialogueStreams,
+                                 "SUDSTest.TestRandomPerDialogueStreams",
+                                 EAutomationTestFlags::EditorContext |
+                                 EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestRandomPerDialogueStreams::RunTest(const FString& Parameters)
+{
+    FSUDSMessageLogger Logger(false);
+    FSUDSScriptImporter Importer;
+    TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(BasicRandomInput), BasicRandomInput.Len(), "BasicRandomInput", &Logger, true));
+
+    auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+    const ScopedStringTableHolder StringTableHolder;
+    Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+    // Two dialogues with the same seed should give the same sequence even when interleaved
+    auto Dlg1 = USUDSLibrary::CreateDialogue(Script, Script);
+    auto Dlg2 = USUDSLibrary::CreateDialogue(Script, Script);
+    Dlg1->SetRandomSeed(34);
+    Dlg2->SetRandomSeed(34);
+    Dlg1->Start();
+    Dlg2->Start();
+
+    const TArray<FString> Expected = {
+        "Reply when random == 2",
+        "Reply when random == 1",
+        "Reply when random == 0",
+        "Reply when random == 1"
+    };
+    for (int i = 0; i < Expected.Num(); ++i)
+    {
+        TestTrue("Continue", Dlg1->Continue());
+        TestDialogueText(this, "Random node 1", Dlg1, "NPC", Expected[i]);
+        TestTrue("Continue", Dlg2->Continue());
+        TestDialogueText(this, "Random node 2", Dlg2, "NPC", Expected[i]);
+        TestTrue("Continue", Dlg1->Continue());
+        TestTrue("Continue", Dlg2->Continue());
+
+        // Global random should have no effect
+        FMath::SRand();
+    }
+
+    // Saved state should continue the same sequence
+    auto SavedState = Dlg1->GetSavedState();
+    auto Dlg3 = USUDSLibrary::CreateDialogue(Script, Script);
+    Dlg3->RestoreSavedState(SavedState);
+    for (int i = 0; i < 4; ++i)
+    {
+        TestTrue("Continue", Dlg1->Continue());
+        TestTrue("Continue", Dlg3->Continue());
+        TestEqual("Restored random matches", Dlg3->GetText().ToString(), Dlg1->GetText().ToString());
+        TestTrue("Continue", Dlg1->Continue());
+        TestTrue("Continue", Dlg3->Continue());
+    }
+
+    Script->MarkAsGarbage();
+    return true;
+}
+
 UE_ENABLE_OPTIMIZATION
\ No newline at end of file
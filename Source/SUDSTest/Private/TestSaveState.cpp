@@ -3,8 +3,11 @@
 #include "SUDSMessageLogger.h"
 #include "SUDSScript.h"
 #include "SUDSScriptImporter.h"
+#include "SUDSSubsystem.h"
 #include "TestUtils.h"
 #include "Misc/AutomationTest.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 
 UE_DISABLE_OPTIMIZATION
 
@@ -139,8 +142,275 @@ bool FTestSaveState::RunTest(const FString& Parameters)
     TestTrue("Choice not taken", Dlg2->HasChoiceIndexBeenTakenPreviously(2));
     TestFalse("Choice not taken", Dlg2->HasChoiceIndexBeenTakenPreviously(3));
 
+    // Round trip through plain memory archives, which don't carry custom versions
+    TArray<uint8> Bytes;
+    FMemoryWriter Writer(Bytes);
+    Writer << SaveState;
+    FSUDSDialogueState LoadedState;
+    FMemoryReader Reader(Bytes);
+    Reader << LoadedState;
+    TestFalse("Read without error", Reader.IsError());
+    TestTrue("Read everything", Reader.AtEnd());
+    TestEqual("Text node ID", LoadedState.GetTextNodeID(), SaveState.GetTextNodeID());
+    TestEqual("Variables", LoadedState.GetVariables().Num(), SaveState.GetVariables().Num());
+    TestTrue("Choices taken", LoadedState.GetChoicesTaken() == SaveState.GetChoicesTaken());
+    TestTrue("Return stack", LoadedState.GetReturnStack() == SaveState.GetReturnStack());
+    TestEqual("Random seed", LoadedState.GetRandomSeed(), SaveState.GetRandomSeed());
+    auto Dlg3 = USUDSLibrary::CreateDialogue(Script, Script);
+    Dlg3->RestoreSavedState(LoadedState);
+    TestDialogueText(this, "Text node", Dlg3, "Player", "I took the 1.3 choice");
+    TestEqual("y value", Dlg3->GetVariableFloat("y"), 23.5f);
+
     Script->MarkAsGarbage();
 	return true;
 }
 
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestCompactSaveState,
+								 "SUDSTest.TestCompactSaveState",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+
+bool FTestCompactSaveState::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(SaveStateInput), SaveStateInput.Len(), "SaveStateInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+    Dlg->SetVariableInt("x", 5);
+	Dlg->Start();
+
+    // y is still at its header default so shouldn't be saved
+    auto EarlyState = Dlg->GetCompactSavedState();
+    TestEqual("Only changed vars", EarlyState.GetChangedVariables().Num(), 1);
+    TestTrue("x is changed", EarlyState.GetChangedVariables().Contains("x"));
+
+    TestDialogueText(this, "Text Node", Dlg, "NPC", "Hello");
+    if (!TestEqual("Num choices", Dlg->GetNumberOfChoices(), 4))
+        return true;
+    TestTrue("Choose", Dlg->Choose(2));
+    TestDialogueText(this, "Text node", Dlg, "Player", "I took the 1.3 choice");
+
+    Dlg->SetVariableFloat("y", 23.5f);
+    Dlg->SetVariableText("name", FText::FromString("Bob"));
+    Dlg->SetVariableInt("negative", -1234567);
+
+    // Save it here, via binary archive
+    auto SaveState = Dlg->GetCompactSavedState();
+    TArray<uint8> Bytes;
+    FMemoryWriter Writer(Bytes);
+    Writer << SaveState;
+
+    // Should be smaller than the full state
+    auto FullState = Dlg->GetSavedState();
+    TArray<uint8> FullBytes;
+    FMemoryWriter FullWriter(FullBytes);
+    FullWriter << FullState;
+    TestTrue("Compact state is smaller", Bytes.Num() < FullBytes.Num());
+
+    FSUDSCompactDialogueState LoadedState;
+    FMemoryReader Reader(Bytes);
+    Reader << LoadedState;
+    TestFalse("Read without error", Reader.IsError());
+
+    // Re-construct the dialogue & restore
+    auto Dlg2 = USUDSLibrary::CreateDialogue(Script, Script);
+    Dlg2->RestoreCompactSavedState(LoadedState);
+
+    // We should be back at the same point
+    TestDialogueText(this, "Text node", Dlg2, "Player", "I took the 1.3 choice");
+    TestEqual("x value", Dlg2->GetVariableInt("x"), 5);
+    TestEqual("y value", Dlg2->GetVariableFloat("y"), 23.5f);
+    TestEqual("name value", Dlg2->GetVariableText("name").ToString(), "Bob");
+    TestEqual("negative value", Dlg2->GetVariableInt("negative"), -1234567);
+    TestTrue("Continue", Dlg2->Continue());
+    TestDialogueText(this, "Text node", Dlg2, "NPC", "Bye");
+
+    // Restart to check choices were remembered
+    Dlg2->Restart();
+    TestDialogueText(this, "Text Node", Dlg2, "NPC", "Hello");
+    TestFalse("Choice not taken", Dlg2->HasChoiceIndexBeenTakenPreviously(0));
+    TestFalse("Choice not taken", Dlg2->HasChoiceIndexBeenTakenPreviously(1));
+    TestTrue("Choice not taken", Dlg2->HasChoiceIndexBeenTakenPreviously(2));
+    TestFalse("Choice not taken", Dlg2->HasChoiceIndexBeenTakenPreviously(3));
+
+    // Unsetting a header variable should survive a round trip too
+    Dlg2->UnSetVariable("y");
+    auto UnsetState = Dlg2->GetCompactSavedState();
+    auto Dlg3 = USUDSLibrary::CreateDialogue(Script, Script);
+    Dlg3->RestoreCompactSavedState(UnsetState);
+    TestFalse("y should be unset", Dlg3->IsVariableSet("y"));
+
+    Script->MarkAsGarbage();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestCompactSaveStateBenchmark,
+								 "SUDSTest.TestCompactSaveStateBenchmark",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::PerfFilter)
+
+
+
+bool FTestCompactSaveStateBenchmark::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(SaveStateInput), SaveStateInput.Len(), "SaveStateInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	constexpr int NumDialogues = 1000;
+	TArray<USUDSDialogue*> Dialogues;
+	for (int i = 0; i < NumDialogues; ++i)
+	{
+		auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+		Dlg->SetVariableInt("x", i % 3);
+		Dlg->Start();
+		Dlg->Choose(i % Dlg->GetNumberOfChoices());
+		Dialogues.Add(Dlg);
+	}
+
+	TArray<uint8> FullBytes;
+	FMemoryWriter FullWriter(FullBytes);
+	const double FullStart = FPlatformTime::Seconds();
+	for (auto Dlg : Dialogues)
+	{
+		auto State = Dlg->GetSavedState();
+		FullWriter << State;
+	}
+	const double FullTime = FPlatformTime::Seconds() - FullStart;
+
+	TArray<uint8> CompactBytes;
+	FMemoryWriter CompactWriter(CompactBytes);
+	const double CompactStart = FPlatformTime::Seconds();
+	for (auto Dlg : Dialogues)
+	{
+		auto State = Dlg->GetCompactSavedState();
+		CompactWriter << State;
+	}
+	const double CompactTime = FPlatformTime::Seconds() - CompactStart;
+
+	AddInfo(FString::Printf(TEXT("Saved %d dialogues: full %d bytes in %.2fms, compact %d bytes in %.2fms"),
+	                        NumDialogues,
+	                        FullBytes.Num(),
+	                        FullTime * 1000.0,
+	                        CompactBytes.Num(),
+	                        CompactTime * 1000.0));
+	TestTrue("Compact state is smaller", CompactBytes.Num() < FullBytes.Num());
+
+	// Make sure it all reads back
+	FMemoryReader Reader(CompactBytes);
+	for (auto Dlg : Dialogues)
+	{
+		FSUDSCompactDialogueState State;
+		Reader << State;
+		auto Restored = USUDSLibrary::CreateDialogue(Script, Script);
+		Restored->RestoreCompactSavedState(State);
+		TestEqual("Restored text", Restored->GetText().ToString(), Dlg->GetText().ToString());
+		TestEqual("Restored x", Restored->GetVariableInt("x"), Dlg->GetVariableInt("x"));
+	}
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBulkSaveState,
+								 "SUDSTest.TestBulkSaveState",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+
+bool FTestBulkSaveState::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(SaveStateInput), SaveStateInput.Len(), "SaveStateInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Subsystem = NewObject<USUDSSubsystem>(GetTransientPackage());
+	Subsystem->SetGlobalVariableInt("GlobalCount", 42);
+
+	auto Dlg1 = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg1->SetVariableInt("x", 5);
+	Dlg1->Start();
+	TestTrue("Choose", Dlg1->Choose(2));
+	TestDialogueText(this, "Text node", Dlg1, "Player", "I took the 1.3 choice");
+	Subsystem->RegisterDialogue("NPC1", Dlg1);
+
+	auto Dlg2 = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg2->SetVariableInt("x", 0);
+	Dlg2->Start();
+	TestTrue("Choose", Dlg2->Choose(1));
+	TestDialogueText(this, "Text node", Dlg2, "Player", "I took the alt 1.2 choice");
+	Subsystem->RegisterDialogue("NPC2", Dlg2);
+
+	const FSUDSBulkState BulkState = Subsystem->GetSavedBulkState();
+
+	// Should be smaller than saving the dialogues separately
+	TArray<uint8> SeparateBytes;
+	FMemoryWriter SeparateWriter(SeparateBytes);
+	auto State1 = Dlg1->GetSavedState();
+	auto State2 = Dlg2->GetSavedState();
+	auto GlobalState = Subsystem->GetSavedGlobalState();
+	SeparateWriter << State1 << State2 << GlobalState;
+	TestTrue("Bulk state is smaller", BulkState.GetData().Num() < SeparateBytes.Num());
+
+	// Restore into a new subsystem, with only one of the dialogues registered so far
+	auto Subsystem2 = NewObject<USUDSSubsystem>(GetTransientPackage());
+	auto Restored1 = USUDSLibrary::CreateDialogue(Script, Script);
+	Subsystem2->RegisterDialogue("NPC1", Restored1);
+	TestTrue("Restore bulk", Subsystem2->RestoreSavedBulkState(BulkState));
+
+	TestEqual("Global restored", Subsystem2->GetGlobalVariableInt("GlobalCount"), 42);
+	TestDialogueText(this, "Text node", Restored1, "Player", "I took the 1.3 choice");
+	TestEqual("x value", Restored1->GetVariableInt("x"), 5);
+
+	// Registering later should pick up the pending state
+	auto Restored2 = USUDSLibrary::CreateDialogue(Script, Script);
+	Subsystem2->RegisterDialogue("NPC2", Restored2);
+	TestDialogueText(this, "Text node", Restored2, "Player", "I took the alt 1.2 choice");
+	TestEqual("x value", Restored2->GetVariableInt("x"), 0);
+	Restored2->Restart();
+	TestTrue("Choice remembered", Restored2->HasChoiceIndexBeenTakenPreviously(1));
+
+	// Corrupt or truncated data is rejected without restoring anything
+	AddExpectedError(TEXT("corrupt"), EAutomationExpectedErrorFlags::Contains, 2);
+	Subsystem2->SetGlobalVariableInt("GlobalCount", 7);
+	uint8 Version = BulkState.GetData()[0];
+	TArray<uint8> HugeCountData;
+	FMemoryWriter HugeCountWriter(HugeCountData);
+	uint32 HugeCount = 0x7FFFFFFF;
+	HugeCountWriter << Version;
+	HugeCountWriter.SerializeIntPacked(HugeCount);
+	TestFalse("Huge count rejected", Subsystem2->RestoreSavedBulkState(FSUDSBulkState(MoveTemp(HugeCountData))));
+	// Says it has strings, but they've been cut off
+	TArray<uint8> TruncatedData;
+	FMemoryWriter TruncatedWriter(TruncatedData);
+	uint32 StringCount = 3;
+	TruncatedWriter << Version;
+	TruncatedWriter.SerializeIntPacked(StringCount);
+	TestFalse("Truncated data rejected", Subsystem2->RestoreSavedBulkState(FSUDSBulkState(MoveTemp(TruncatedData))));
+	TestEqual("Global not restored", Subsystem2->GetGlobalVariableInt("GlobalCount"), 7);
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
 UE_ENABLE_OPTIMIZATION
\ No newline at end of file
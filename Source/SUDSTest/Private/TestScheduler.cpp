@@ -0,0 +1,145 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "SUDSSubsystem.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString SchedulerLinesInput = R"RAWSUD(
+NPC: Line 1
+NPC: Line 2
+NPC: Line 3
+NPC: Line 4
+NPC: Line 5
+)RAWSUD";
+
+const FString SchedulerChoiceInput = R"RAWSUD(
+NPC: Pick one
+    * First
+        NPC: You picked first
+    * Second
+        NPC: You picked second
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestScheduler,
+								 "SUDSTest.TestScheduler",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestScheduler::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(SchedulerLinesInput), SchedulerLinesInput.Len(), "SchedulerLinesInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Sub = NewObject<USUDSSubsystem>(GetTransientPackage());
+	// Zero budget means only one dialogue can advance per frame
+	Sub->SetSchedulerFrameBudget(0);
+
+	auto High = USUDSLibrary::CreateDialogue(Script, Script);
+	auto Low = USUDSLibrary::CreateDialogue(Script, Script);
+
+	FSUDSAutoAdvancePolicy Policy;
+	Policy.LineDelay = 0;
+	Policy.Priority = 0;
+	Sub->ScheduleDialogue(Low, Policy);
+	Policy.Priority = 2;
+	Sub->ScheduleDialogue(High, Policy);
+
+	TestTrue("Scheduled dialogues are started", !High->IsEnded() && !Low->IsEnded());
+	TestTrue("High is scheduled", Sub->IsDialogueScheduled(High));
+	TestTrue("Low is scheduled", Sub->IsDialogueScheduled(Low));
+	TestDialogueText(this, "High start", High, "NPC", "Line 1");
+	TestDialogueText(this, "Low start", Low, "NPC", "Line 1");
+
+	// Higher priority goes first
+	Sub->Tick(0.1f);
+	TestDialogueText(this, "High tick 1", High, "NPC", "Line 2");
+	TestDialogueText(this, "Low tick 1", Low, "NPC", "Line 1");
+	FSUDSSchedulerStats Stats = Sub->GetSchedulerStats();
+	TestEqual("Scheduled", Stats.NumScheduled, 2);
+	TestEqual("Advanced tick 1", Stats.NumAdvancedLastFrame, 1);
+	TestEqual("Deferred tick 1", Stats.NumDeferredLastFrame, 1);
+
+	Sub->Tick(0.1f);
+	TestDialogueText(this, "High tick 2", High, "NPC", "Line 3");
+	TestDialogueText(this, "Low tick 2", Low, "NPC", "Line 1");
+
+	// Low has now waited long enough to catch up with High's priority, and has been due for longer
+	Sub->Tick(0.1f);
+	TestDialogueText(this, "High tick 3", High, "NPC", "Line 3");
+	TestDialogueText(this, "Low tick 3", Low, "NPC", "Line 2");
+	Stats = Sub->GetSchedulerStats();
+	TestEqual("Deferred tick 3", Stats.NumDeferredLastFrame, 1);
+	TestEqual("Total deferred", Stats.TotalDeferred, 3ll);
+	TestEqual("Max frames deferred", Stats.MaxFramesDeferred, 2);
+
+	// With enough budget, everything that's due advances
+	Sub->SetSchedulerFrameBudget(1000);
+	Sub->Tick(0.1f);
+	TestDialogueText(this, "High tick 4", High, "NPC", "Line 4");
+	TestDialogueText(this, "Low tick 4", Low, "NPC", "Line 3");
+	Stats = Sub->GetSchedulerStats();
+	TestEqual("Advanced tick 4", Stats.NumAdvancedLastFrame, 2);
+	TestEqual("Deferred tick 4", Stats.NumDeferredLastFrame, 0);
+
+	Sub->UnscheduleDialogue(Low);
+	TestFalse("Low is unscheduled", Sub->IsDialogueScheduled(Low));
+
+	// Line delay
+	Policy.LineDelay = 1.0f;
+	Sub->ScheduleDialogue(High, Policy);
+	Sub->Tick(0.5f);
+	TestDialogueText(this, "Not due yet", High, "NPC", "Line 4");
+	TestDialogueText(this, "Unscheduled doesn't advance", Low, "NPC", "Line 3");
+	Sub->Tick(0.6f);
+	TestDialogueText(this, "Due", High, "NPC", "Line 5");
+
+	// Finished dialogues are removed
+	Sub->Tick(1.0f);
+	TestTrue("High has ended", High->IsEnded());
+	TestFalse("High is removed when finished", Sub->IsDialogueScheduled(High));
+	TestEqual("Nothing scheduled", Sub->GetSchedulerStats().NumScheduled, 0);
+	TestFalse("Not tickable with nothing scheduled", Sub->IsTickable());
+
+	Script->MarkAsGarbage();
+
+	// Choices & restarting
+	FSUDSScriptImporter ChoiceImporter;
+	TestTrue("Import should succeed", ChoiceImporter.ImportFromBuffer(GetData(SchedulerChoiceInput), SchedulerChoiceInput.Len(), "SchedulerChoiceInput", &Logger, true));
+	auto ChoiceScript = NewObject<USUDSScript>(GetTransientPackage(), "TestChoice");
+	const ScopedStringTableHolder ChoiceStringTableHolder;
+	ChoiceImporter.PopulateAsset(ChoiceScript, ChoiceStringTableHolder.StringTable);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(ChoiceScript, ChoiceScript);
+	Policy = FSUDSAutoAdvancePolicy();
+	Policy.LineDelay = 0;
+	Policy.ChoiceMode = ESUDSAutoChoiceMode::First;
+	Policy.bRestartWhenFinished = true;
+	Sub->ScheduleDialogue(Dlg, Policy);
+	TestDialogueText(this, "Choice start", Dlg, "NPC", "Pick one");
+	Sub->Tick(0.1f);
+	TestDialogueText(this, "First choice taken", Dlg, "NPC", "You picked first");
+	Sub->Tick(0.1f);
+	TestTrue("Ended", Dlg->IsEnded());
+	TestTrue("Still scheduled to restart", Sub->IsDialogueScheduled(Dlg));
+	Sub->Tick(0.1f);
+	TestDialogueText(this, "Restarted", Dlg, "NPC", "Pick one");
+
+	Sub->UnscheduleDialogue(Dlg);
+	ChoiceScript->MarkAsGarbage();
+	Sub->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
@@ -0,0 +1,144 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "SUDSSubsystem.h"
+#include "TestParticipant.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString VariableHandlesInput = R"RAWSUD(
+===
+[set Counter 1]
+===
+Player: Count is {Counter}
+[set Counter {Counter} + 1]
+NPC: Now it's {Counter}
+Player: Bye
+)RAWSUD";
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestVariableHandles,
+								 "SUDSTest.TestVariableHandles",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+
+bool FTestVariableHandles::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(VariableHandlesInput), VariableHandlesInput.Len(), "VariableHandlesInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	auto Participant = NewObject<UTestParticipant>();
+	Dlg->AddParticipant(Participant);
+
+	const FSUDSVariableHandle Counter = USUDSDialogue::GetVariableHandle("Counter");
+	const FSUDSVariableHandle NewVar = USUDSDialogue::GetVariableHandle("NewVar");
+	TestFalse("Counter is not global", Counter.IsGlobal());
+	TestEqual("Counter from header", Dlg->GetVariableInt(Counter), 1);
+	TestFalse("NewVar not set yet", Dlg->IsVariableSet(NewVar));
+
+	Dlg->Start();
+	TestDialogueText(this, "Line 1", Dlg, "Player", "Count is 1");
+
+	// Setting via handle should raise the usual change notifications
+	Participant->SetVarRecords.Empty();
+	Dlg->SetVariableInt(Counter, 5);
+	TestEqual("Counter set by handle", Dlg->GetVariableInt("Counter"), 5);
+	if (TestEqual("Set var records", Participant->SetVarRecords.Num(), 1))
+	{
+		TestEqual("Set var name", Participant->SetVarRecords[0].Name, FName("Counter"));
+		TestEqual("Set var value", Participant->SetVarRecords[0].Value.GetIntValue(), 5);
+		TestFalse("Set var not from script", Participant->SetVarRecords[0].bFromScript);
+	}
+	// Setting to the same value shouldn't
+	Dlg->SetVariableInt(Counter, 5);
+	TestEqual("Set var records after same value", Participant->SetVarRecords.Num(), 1);
+	TestDialogueText(this, "Line 1 after set", Dlg, "Player", "Count is 5");
+
+	// Script changes should be visible to the handle
+	Dlg->Continue();
+	TestDialogueText(this, "Line 2", Dlg, "NPC", "Now it's 6");
+	TestEqual("Counter updated by script", Dlg->GetVariableInt(Counter), 6);
+
+	// Variables added later by name should be found by the handle, and removals noticed
+	Dlg->SetVariableBoolean("NewVar", true);
+	TestTrue("NewVar set", Dlg->IsVariableSet(NewVar));
+	TestTrue("NewVar value", Dlg->GetVariableBoolean(NewVar));
+	Dlg->UnSetVariable("NewVar");
+	TestFalse("NewVar unset", Dlg->IsVariableSet(NewVar));
+	Dlg->SetVariableBoolean(NewVar, true);
+	TestTrue("NewVar set by handle", Dlg->GetVariableBoolean("NewVar"));
+
+	// Save, change, then restore
+	auto SavedState = Dlg->GetSavedState();
+	Dlg->SetVariableInt(Counter, 20);
+	Dlg->RestoreSavedState(SavedState);
+	TestEqual("Counter after restore", Dlg->GetVariableInt(Counter), 6);
+	TestTrue("NewVar after restore", Dlg->GetVariableBoolean(NewVar));
+
+	// Restart & reset should re-run the header
+	Dlg->Restart(true);
+	TestEqual("Counter after restart", Dlg->GetVariableInt(Counter), 1);
+	TestFalse("NewVar after restart", Dlg->IsVariableSet(NewVar));
+
+	// Handles can be shared between dialogues
+	auto Dlg2 = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg2->SetVariableInt(Counter, 33);
+	TestEqual("Counter on second dialogue", Dlg2->GetVariableInt(Counter), 33);
+	TestEqual("Counter on first dialogue", Dlg->GetVariableInt(Counter), 1);
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestGlobalVariableHandles,
+								 "SUDSTest.TestGlobalVariableHandles",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+
+bool FTestGlobalVariableHandles::RunTest(const FString& Parameters)
+{
+	auto Subsystem = NewObject<USUDSSubsystem>(GetTransientPackage());
+
+	// Prefix is optional for the subsystem, both refer to the same variable
+	const FSUDSVariableHandle Prefixed = USUDSSubsystem::GetGlobalVariableHandle("global.Score");
+	const FSUDSVariableHandle Unprefixed = USUDSSubsystem::GetGlobalVariableHandle("Score");
+	TestTrue("Prefixed is global", Prefixed.IsGlobal());
+	TestEqual("Names match", Prefixed.GetName(), Unprefixed.GetName());
+
+	TestFalse("Not set yet", Subsystem->IsGlobalVariableSet(Prefixed));
+	Subsystem->SetGlobalVariableInt(Prefixed, 10);
+	TestEqual("Set by handle, read by name", Subsystem->GetGlobalVariableInt("Score"), 10);
+	TestEqual("Read by other handle", Subsystem->GetGlobalVariableInt(Unprefixed), 10);
+
+	Subsystem->SetGlobalVariableInt("Score", 11);
+	TestEqual("Set by name, read by handle", Subsystem->GetGlobalVariableInt(Prefixed), 11);
+
+	Subsystem->SetGlobalVariableInt(Prefixed, 12);
+
+	// Reset & restore
+	auto Saved = Subsystem->GetSavedGlobalState();
+	Subsystem->ResetGlobalState();
+	TestFalse("Unset after reset", Subsystem->IsGlobalVariableSet(Prefixed));
+	Subsystem->RestoreSavedGlobalState(Saved);
+	TestEqual("Restored", Subsystem->GetGlobalVariableInt(Prefixed), 12);
+
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION
@@ -0,0 +1,99 @@
+﻿#include "SUDSDialogue.h"
+#include "SUDSLibrary.h"
+#include "SUDSMessageLogger.h"
+#include "SUDSScript.h"
+#include "SUDSScriptImporter.h"
+#include "SUDSScriptNodeText.h"
+#include "TestParticipant.h"
+#include "TestUtils.h"
+#include "Misc/AutomationTest.h"
+
+UE_DISABLE_OPTIMIZATION
+
+const FString VariablesNeededInput = R"RAWSUD(
+NPC: Hello {Name}
+[if {A} == 1]
+    [set X {B} + 1]
+    [event Ping {C}]
+[endif]
+NPC: Next {X}
+    * Take {Item}
+        [set Taken {Greedy}]
+    * Leave
+NPC: Bye
+)RAWSUD";
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestVariablesNeededNext,
+								 "SUDSTest.TestVariablesNeededNext",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+
+bool FTestVariablesNeededNext::RunTest(const FString& Parameters)
+{
+	FSUDSMessageLogger Logger(false);
+	FSUDSScriptImporter Importer;
+	TestTrue("Import should succeed", Importer.ImportFromBuffer(GetData(VariablesNeededInput), VariablesNeededInput.Len(), "VariablesNeededInput", &Logger, true));
+
+	auto Script = NewObject<USUDSScript>(GetTransientPackage(), "Test");
+	const ScopedStringTableHolder StringTableHolder;
+	Importer.PopulateAsset(Script, StringTableHolder.StringTable);
+
+	auto SameNames = [](const TArray<FName>& Actual, const TSet<FName>& Expected)
+	{
+		return Actual.Num() == Expected.Num() && TSet<FName>(Actual).Includes(Expected);
+	};
+
+	auto Batch = NewObject<UTestBatchParticipant>();
+	Batch->Values.Add("Name", FText::FromString("Bob"));
+	Batch->Values.Add("A", 1);
+	Batch->Values.Add("B", 2);
+	Batch->Values.Add("C", 3);
+
+	auto Dlg = USUDSLibrary::CreateDialogue(Script, Script);
+	Dlg->AddParticipant(Batch);
+
+	// Statically worked out on import, up to the next speaker line on every path
+	auto FirstNode = Cast<USUDSScriptNodeText>(Script->GetFirstNode());
+	if (TestNotNull("First node is text", FirstNode))
+	{
+		TestTrue("First line variables", SameNames(FirstNode->GetVariablesNeededNext(), { "Name", "A", "B", "C" }));
+	}
+
+	Dlg->SetPrefetchVariables(true);
+	Dlg->Start();
+	TestDialogueText(this, "First line", Dlg, "NPC", "Hello Bob");
+	TestTrue("Dialogue variables needed", SameNames(Dlg->GetVariablesNeededNext(), { "Name", "A", "B", "C" }));
+	// Everything is asked for at once when the line is shown, and not again while resolving it
+	if (TestEqual("One batch for the first line", Batch->Batches.Num(), 1))
+	{
+		TestTrue("Prefetch batch", SameNames(Batch->Batches[0], { "Name", "A", "B", "C" }));
+	}
+
+	TestTrue("Continue", Dlg->Continue());
+	TestDialogueText(this, "Second line", Dlg, "NPC", "Next 3");
+	TestTrue("Choice variables needed", SameNames(Dlg->GetVariablesNeededNext(), { "X", "Item", "Greedy" }));
+	if (TestEqual("One batch for the second line", Batch->Batches.Num(), 2))
+	{
+		TestTrue("Second prefetch batch", SameNames(Batch->Batches[1], { "X", "Item", "Greedy" }));
+	}
+
+	TestTrue("Choose", Dlg->Choose(1));
+	TestDialogueText(this, "Last line", Dlg, "NPC", "Bye");
+	TestEqual("Last line needs nothing", Dlg->GetVariablesNeededNext().Num(), 0);
+	TestEqual("No batch for the last line", Batch->Batches.Num(), 2);
+
+	// Without prefetching, variables are requested as they're used
+	Batch->Batches.Empty();
+	Dlg->SetPrefetchVariables(false);
+	Dlg->Restart();
+	TestDialogueText(this, "Restarted", Dlg, "NPC", "Hello Bob");
+	TestEqual("Requested on use", Batch->Batches.Num(), 1);
+	TestTrue("Text batch", SameNames(Batch->Batches[0], { "Name" }));
+
+	Script->MarkAsGarbage();
+	return true;
+}
+
+UE_ENABLE_OPTIMIZATION